@@ -0,0 +1,536 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Benchmarks for the transfer, thumbnail and streaming hot paths. Everything
+ * runs against AfcEmulator, so the numbers are reproducible without a phone
+ * and can be compared release over release from the JSON output.
+ */
+
+#include "afcemulator.h"
+#include "exportmanager.h"
+#include "iDescriptor.h"
+#include "mediastreamer.h"
+#include "photomodel.h"
+#include "servicemanager.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+
+const char *SMALL_ALBUM = "/DCIM/100APPLE";
+const char *MEDIA_ALBUM = "/DCIM/101APPLE";
+const char *LARGE_DIR = "/Large";
+const int WAIT_TIMEOUT_MS = 10 * 60 * 1000;
+
+struct Fixture {
+    QString root;
+    QStringList smallFiles;  // device paths
+    QStringList largeFiles;  // device paths
+    QStringList heicFiles;   // local paths, decoded directly
+    QStringList mediaFiles;  // device paths of the supplied videos
+    qint64 smallBytes = 0;
+    qint64 largeBytes = 0;
+};
+
+double megabytesPerSecond(qint64 bytes, qint64 nanoseconds)
+{
+    if (nanoseconds <= 0) {
+        return 0.0;
+    }
+    return (bytes / (1024.0 * 1024.0)) / (nanoseconds / 1e9);
+}
+
+double milliseconds(qint64 nanoseconds) { return nanoseconds / 1e6; }
+
+QJsonObject latencySummary(QList<qint64> samples)
+{
+    QJsonObject summary;
+    if (samples.isEmpty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    qint64 total = 0;
+    for (qint64 sample : samples) {
+        total += sample;
+    }
+    auto percentile = [&samples](double p) {
+        const int index = qMin(samples.size() - 1,
+                               static_cast<int>(p * samples.size()));
+        return milliseconds(samples.at(index));
+    };
+    summary["samples"] = samples.size();
+    summary["mean_ms"] = milliseconds(total / samples.size());
+    summary["p50_ms"] = percentile(0.50);
+    summary["p95_ms"] = percentile(0.95);
+    summary["max_ms"] = milliseconds(samples.last());
+    return summary;
+}
+
+QJsonObject skipped(const QString &name, const QString &reason)
+{
+    return {{"name", name}, {"skipped", true}, {"reason", reason}};
+}
+
+// Photo-like content so thumbnail decoding does real work
+bool writeSampleJpeg(const QString &path, int index)
+{
+    QImage image(4032, 3024, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, image.width(), image.height());
+    gradient.setColorAt(0, QColor::fromHsv((index * 37) % 360, 200, 220));
+    gradient.setColorAt(1, QColor::fromHsv((index * 71) % 360, 120, 60));
+    painter.fillRect(image.rect(), gradient);
+    painter.end();
+    return image.save(path, "JPG", 85);
+}
+
+bool writeRandomFile(const QString &path, qint64 size)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QByteArray chunk(1024 * 1024, Qt::Uninitialized);
+    auto *words = reinterpret_cast<quint32 *>(chunk.data());
+    QRandomGenerator::global()->fillRange(words, chunk.size() / 4);
+    for (qint64 written = 0; written < size; written += chunk.size()) {
+        const qint64 length = qMin<qint64>(chunk.size(), size - written);
+        if (file.write(chunk.constData(), length) != length) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool createFixture(Fixture &fixture, const QString &root, int smallCount,
+                   int largeCount, qint64 largeSize, const QString &mediaDir)
+{
+    fixture.root = root;
+    QDir dir(root);
+    for (const char *path : {SMALL_ALBUM, MEDIA_ALBUM, LARGE_DIR}) {
+        if (!dir.mkpath(QString(path).mid(1))) {
+            return false;
+        }
+    }
+
+    // Encoding 12 MP JPEGs is slow, write one per hue and copy it around
+    const int distinct = qMin(smallCount, 8);
+    for (int i = 0; i < smallCount; ++i) {
+        const QString name = QString("IMG_%1.JPG").arg(i, 4, 10, QChar('0'));
+        const QString devicePath = QString(SMALL_ALBUM) + "/" + name;
+        const QString localPath = root + devicePath;
+        if (i < distinct) {
+            if (!writeSampleJpeg(localPath, i)) {
+                return false;
+            }
+        } else {
+            const QString source = root + fixture.smallFiles.at(i % distinct);
+            if (!QFile::copy(source, localPath)) {
+                return false;
+            }
+        }
+        fixture.smallFiles.append(devicePath);
+        fixture.smallBytes += QFileInfo(localPath).size();
+    }
+
+    for (int i = 0; i < largeCount; ++i) {
+        const QString devicePath =
+            QString("%1/large_%2.bin").arg(LARGE_DIR).arg(i);
+        if (!writeRandomFile(root + devicePath, largeSize)) {
+            return false;
+        }
+        fixture.largeFiles.append(devicePath);
+        fixture.largeBytes += largeSize;
+    }
+
+    // HEIC and video samples can't be synthesised, take them if supplied
+    if (!mediaDir.isEmpty()) {
+        const QFileInfoList entries = QDir(mediaDir).entryInfoList(QDir::Files);
+        for (const QFileInfo &entry : entries) {
+            const QString suffix = entry.suffix().toUpper();
+            if (suffix == "HEIC" || suffix == "HEIF") {
+                fixture.heicFiles.append(entry.absoluteFilePath());
+            } else if (suffix == "MOV" || suffix == "MP4" || suffix == "M4V") {
+                const QString devicePath =
+                    QString(MEDIA_ALBUM) + "/" + entry.fileName();
+                if (QFile::copy(entry.absoluteFilePath(), root + devicePath)) {
+                    fixture.mediaFiles.append(devicePath);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+QJsonObject benchmarkReadToByteArray(iDescriptorDevice *device,
+                                     const Fixture &fixture)
+{
+    const QString name = "afc.read_file_to_byte_array";
+    if (fixture.largeFiles.isEmpty()) {
+        return skipped(name, "no large files");
+    }
+
+    qint64 bytes = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const QString &path : fixture.largeFiles) {
+        bytes += ServiceManager::safeReadAfcFileToByteArray(
+                     device, path.toUtf8().constData())
+                     .size();
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    return {{"name", name},
+            {"files", fixture.largeFiles.size()},
+            {"bytes", bytes},
+            {"seconds", elapsed / 1e9},
+            {"mb_per_s", megabytesPerSecond(bytes, elapsed)}};
+}
+
+QJsonObject benchmarkExport(iDescriptorDevice *device, const QString &name,
+                            const QStringList &paths, qint64 expectedBytes,
+                            const QString &destination)
+{
+    if (paths.isEmpty()) {
+        return skipped(name, "no files");
+    }
+
+    QList<ExportItem> items;
+    for (const QString &path : paths) {
+        items.append(ExportItem(path, QFileInfo(path).fileName()));
+    }
+
+    ExportManager *manager = ExportManager::sharedInstance();
+    QEventLoop loop;
+    QUuid jobId;
+    ExportJobSummary summary;
+    bool finished = false;
+    auto finishedConnection = QObject::connect(
+        manager, &ExportManager::exportFinished, &loop,
+        [&](const QUuid &id, const ExportJobSummary &result) {
+            if (id == jobId) {
+                summary = result;
+                finished = true;
+                loop.quit();
+            }
+        },
+        Qt::QueuedConnection);
+    QTimer::singleShot(WAIT_TIMEOUT_MS, &loop, &QEventLoop::quit);
+
+    QElapsedTimer timer;
+    timer.start();
+    jobId = manager->startExport(device, items, destination);
+    if (!jobId.isNull()) {
+        loop.exec();
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+    QObject::disconnect(finishedConnection);
+
+    if (!finished) {
+        return skipped(name, "export did not finish");
+    }
+    return {{"name", name},
+            {"files", summary.successfulItems},
+            {"failed", summary.failedItems},
+            {"bytes", summary.totalBytesTransferred},
+            {"expected_bytes", expectedBytes},
+            {"seconds", elapsed / 1e9},
+            {"mb_per_s",
+             megabytesPerSecond(summary.totalBytesTransferred, elapsed)},
+            {"files_per_s", summary.successfulItems / (elapsed / 1e9)}};
+}
+
+// Asks for every decoration like a fully visible grid would
+QJsonObject benchmarkThumbnailGrid(iDescriptorDevice *device,
+                                   const QString &name,
+                                   const QString &albumPath,
+                                   PhotoModel::FilterType filter)
+{
+    PhotoModel model(device, filter);
+    model.setAlbumPath(albumPath);
+    const int rows = model.rowCount();
+    if (rows == 0) {
+        return skipped(name, "album is empty");
+    }
+
+    QEventLoop loop;
+    QElapsedTimer timer;
+    qint64 firstThumbnail = -1;
+    int loaded = 0;
+    QObject::connect(&model, &PhotoModel::dataChanged, &loop,
+                     [&](const QModelIndex &topLeft,
+                         const QModelIndex &bottomRight) {
+                         if (firstThumbnail < 0) {
+                             firstThumbnail = timer.nsecsElapsed();
+                         }
+                         loaded += bottomRight.row() - topLeft.row() + 1;
+                         if (loaded >= rows) {
+                             loop.quit();
+                         }
+                     });
+    QTimer::singleShot(WAIT_TIMEOUT_MS, &loop, &QEventLoop::quit);
+
+    timer.start();
+    for (int row = 0; row < rows; ++row) {
+        model.data(model.index(row), Qt::DecorationRole);
+    }
+    loop.exec();
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    return {{"name", name},
+            {"items", rows},
+            {"loaded", loaded},
+            {"first_thumbnail_ms", milliseconds(firstThumbnail)},
+            {"full_grid_ms", milliseconds(elapsed)},
+            {"per_item_ms", milliseconds(elapsed) / rows}};
+}
+
+// Time from sending a Range request to the first body byte
+QJsonObject benchmarkStreamSeek(iDescriptorDevice *device,
+                                const Fixture &fixture, int seeks)
+{
+    const QString name = "stream.seek_to_first_byte";
+    if (fixture.largeFiles.isEmpty()) {
+        return skipped(name, "no large files");
+    }
+
+    const QString path = fixture.largeFiles.first();
+    const qint64 size = QFileInfo(fixture.root + path).size();
+    MediaStreamer streamer(device, device->afcClient, path);
+    if (!streamer.isListening()) {
+        return skipped(name, "streamer failed to listen");
+    }
+
+    QList<qint64> samples;
+    for (int i = 0; i < seeks; ++i) {
+        const qint64 offset = QRandomGenerator::global()->bounded(size);
+        QTcpSocket socket;
+        socket.connectToHost(QHostAddress::LocalHost,
+                             streamer.serverPort());
+        if (!socket.waitForConnected(5000)) {
+            continue;
+        }
+
+        QEventLoop loop;
+        QByteArray received;
+        QElapsedTimer timer;
+        bool gotBody = false;
+        QObject::connect(&socket, &QTcpSocket::readyRead, &loop, [&]() {
+            received += socket.readAll();
+            const int headerEnd = received.indexOf("\r\n\r\n");
+            if (headerEnd >= 0 && received.size() > headerEnd + 4) {
+                gotBody = true;
+                loop.quit();
+            }
+        });
+        QObject::connect(&socket, &QTcpSocket::disconnected, &loop,
+                         &QEventLoop::quit);
+        QTimer::singleShot(30000, &loop, &QEventLoop::quit);
+
+        timer.start();
+        socket.write(QString("GET / HTTP/1.1\r\n"
+                             "Host: 127.0.0.1\r\n"
+                             "Range: bytes=%1-\r\n\r\n")
+                         .arg(offset)
+                         .toUtf8());
+        loop.exec();
+        if (gotBody) {
+            samples.append(timer.nsecsElapsed());
+        }
+        socket.abort();
+        // Let the streamer see the disconnect before the next request
+        QCoreApplication::processEvents();
+    }
+
+    QJsonObject result = latencySummary(samples);
+    result["name"] = name;
+    result["requested"] = seeks;
+    return result;
+}
+
+// Decode cost only, the data is read from local disk up front
+QJsonObject benchmarkHeicDecode(const Fixture &fixture)
+{
+    const QString name = "decode.heic";
+    if (fixture.heicFiles.isEmpty()) {
+        return skipped(name, "no HEIC samples, pass --media");
+    }
+
+    QList<qint64> full;
+    QList<qint64> thumbnail;
+    for (const QString &path : fixture.heicFiles) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        const QByteArray data = file.readAll();
+
+        QElapsedTimer timer;
+        timer.start();
+        if (!load_heic(data).isNull()) {
+            full.append(timer.nsecsElapsed());
+        }
+        timer.restart();
+        if (!load_heic(data, QSize(256, 256)).isNull()) {
+            thumbnail.append(timer.nsecsElapsed());
+        }
+    }
+
+    return {{"name", name},
+            {"files", fixture.heicFiles.size()},
+            {"full", latencySummary(full)},
+            {"thumbnail_256", latencySummary(thumbnail)}};
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // ExportManager owns a progress dialog, keep it off screen
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("iDescriptor-benchmarks");
+    QCoreApplication::setApplicationVersion(APP_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Benchmarks iDescriptor hot paths against an emulated device.");
+    parser.addHelpOption();
+    QCommandLineOption profileOption(
+        "profile", "Link to emulate: usb2, usb3, wifi or none.", "profile",
+        "usb2");
+    QCommandLineOption outputOption(
+        "output", "Write JSON results to <file> instead of stdout.", "file");
+    QCommandLineOption mediaOption(
+        "media", "Directory with HEIC and video samples to include.", "dir");
+    QCommandLineOption smallOption(
+        "small-files", "Number of photos in the test album.", "count", "200");
+    QCommandLineOption largeOption("large-files",
+                                   "Number of large files.", "count", "2");
+    QCommandLineOption largeSizeOption(
+        "large-size-mb", "Size of each large file in MiB.", "size", "256");
+    QCommandLineOption seeksOption(
+        "seeks", "Number of random stream seeks.", "count", "20");
+    QCommandLineOption verboseOption("verbose", "Keep debug logging.");
+    parser.addOptions({profileOption, outputOption, mediaOption, smallOption,
+                       largeOption, largeSizeOption, seeksOption,
+                       verboseOption});
+    parser.process(app);
+
+    if (!parser.isSet(verboseOption)) {
+        QLoggingCategory::setFilterRules("*.debug=false");
+    }
+
+    QTemporaryDir workspace;
+    if (!workspace.isValid()) {
+        qCritical() << "Could not create a temporary directory";
+        return 1;
+    }
+    const QString deviceRoot = workspace.filePath("device");
+    const QString exportRoot = workspace.filePath("export");
+
+    Fixture fixture;
+    const qint64 largeSize =
+        parser.value(largeSizeOption).toLongLong() * 1024 * 1024;
+    if (!createFixture(fixture, deviceRoot,
+                       parser.value(smallOption).toInt(),
+                       parser.value(largeOption).toInt(), largeSize,
+                       parser.value(mediaOption))) {
+        qCritical() << "Could not create the emulated device tree";
+        return 1;
+    }
+
+    const QString profileName = parser.value(profileOption);
+    const AfcEmulator::LinkProfile profile =
+        AfcEmulator::profileByName(profileName);
+    iDescriptorDevice *device = AfcEmulator::createDevice(deviceRoot, profile);
+    if (!device) {
+        return 1;
+    }
+
+    QJsonArray results;
+    results.append(benchmarkReadToByteArray(device, fixture));
+    results.append(benchmarkExport(device, "export.small_files",
+                                   fixture.smallFiles, fixture.smallBytes,
+                                   exportRoot + "/small"));
+    results.append(benchmarkExport(device, "export.large_files",
+                                   fixture.largeFiles, fixture.largeBytes,
+                                   exportRoot + "/large"));
+    results.append(benchmarkThumbnailGrid(device, "photomodel.image_grid",
+                                          SMALL_ALBUM,
+                                          PhotoModel::ImagesOnly));
+    if (fixture.mediaFiles.isEmpty()) {
+        results.append(skipped("photomodel.video_grid",
+                               "no video samples, pass --media"));
+    } else {
+        results.append(benchmarkThumbnailGrid(device,
+                                              "photomodel.video_grid",
+                                              MEDIA_ALBUM,
+                                              PhotoModel::VideosOnly));
+    }
+    results.append(benchmarkStreamSeek(device, fixture,
+                                       parser.value(seeksOption).toInt()));
+    results.append(benchmarkHeicDecode(fixture));
+
+    QJsonObject link{{"name", profileName},
+                     {"latency_us", qint64(profile.latency.count())},
+                     {"bandwidth_bytes_per_s", qint64(profile.bandwidth)}};
+    QJsonObject report{
+        {"version", APP_VERSION},
+        {"timestamp",
+         QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+        {"link", link},
+        {"results", results}};
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    AfcEmulator::destroyDevice(device);
+
+    if (parser.isSet(outputOption)) {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+            output.write(json) != json.size()) {
+            qCritical() << "Could not write" << output.fileName();
+            return 1;
+        }
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,618 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "afcemulator.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+
+struct EmulatedClient {
+    QString rootPath;
+    AfcEmulator::LinkProfile profile;
+    // A real AFC connection handles one request at a time
+    std::mutex mutex;
+    uint64_t nextHandle = 1;
+    std::unordered_map<uint64_t, std::unique_ptr<QFile>> files;
+};
+
+std::shared_mutex registryMutex;
+std::unordered_set<EmulatedClient *> registry;
+
+EmulatedClient *findClient(afc_client_t client)
+{
+    if (!client) {
+        return nullptr;
+    }
+    auto *candidate = reinterpret_cast<EmulatedClient *>(client);
+    std::shared_lock lock(registryMutex);
+    return registry.count(candidate) ? candidate : nullptr;
+}
+
+// Called with the client mutex held, so concurrent requests queue up
+void simulateTransfer(const EmulatedClient *client, quint64 payloadBytes)
+{
+    auto delay = client->profile.latency;
+    if (client->profile.bandwidth > 0 && payloadBytes > 0) {
+        delay += std::chrono::microseconds(payloadBytes * 1000000 /
+                                           client->profile.bandwidth);
+    }
+    if (delay.count() > 0) {
+        std::this_thread::sleep_for(delay);
+    }
+}
+
+// Maps a device path onto the root, null if it would escape it
+QString localPath(const EmulatedClient *client, const char *path)
+{
+    if (!path) {
+        return QString();
+    }
+    const QString cleaned =
+        QDir::cleanPath(QStringLiteral("/") + QString::fromUtf8(path));
+    if (cleaned.startsWith(QStringLiteral("/.."))) {
+        return QString();
+    }
+    return client->rootPath + cleaned;
+}
+
+char **toAfcList(const QStringList &items)
+{
+    auto **list =
+        static_cast<char **>(calloc(items.size() + 1, sizeof(char *)));
+    for (int i = 0; i < items.size(); ++i) {
+        list[i] = strdup(items.at(i).toUtf8().constData());
+    }
+    return list;
+}
+
+QString fileFormat(const QFileInfo &info)
+{
+    if (info.isSymLink()) {
+        return QStringLiteral("S_IFLNK");
+    }
+    return info.isDir() ? QStringLiteral("S_IFDIR") : QStringLiteral("S_IFREG");
+}
+
+// AFC reports timestamps in nanoseconds since the epoch
+quint64 afcTime(const QDateTime &time)
+{
+    return time.isValid() ? quint64(time.toMSecsSinceEpoch()) * 1000000 : 0;
+}
+
+afc_error_t readDirectory(EmulatedClient *client, const char *path,
+                          char ***directoryInformation)
+{
+    if (!directoryInformation) {
+        return AFC_E_INVALID_ARG;
+    }
+    std::lock_guard lock(client->mutex);
+
+    const QString dirPath = localPath(client, path);
+    const QFileInfo info(dirPath);
+    if (dirPath.isEmpty() || !info.isDir()) {
+        simulateTransfer(client, 0);
+        return AFC_E_OBJECT_NOT_FOUND;
+    }
+
+    // Like the device, "." and ".." are part of every listing
+    QStringList entries = {QStringLiteral("."), QStringLiteral("..")};
+    entries += QDir(dirPath).entryList(QDir::AllEntries | QDir::Hidden |
+                                           QDir::System | QDir::NoDotAndDotDot,
+                                       QDir::Unsorted);
+
+    quint64 payload = 0;
+    for (const QString &entry : entries) {
+        payload += entry.toUtf8().size() + 1;
+    }
+    simulateTransfer(client, payload);
+
+    *directoryInformation = toAfcList(entries);
+    return AFC_E_SUCCESS;
+}
+
+afc_error_t getFileInfo(EmulatedClient *client, const char *path,
+                        QFileInfo &info)
+{
+    std::lock_guard lock(client->mutex);
+    const QString filePath = localPath(client, path);
+    info = QFileInfo(filePath);
+    // The reply is a handful of short key/value strings
+    simulateTransfer(client, 256);
+    if (filePath.isEmpty() || !info.exists()) {
+        return AFC_E_OBJECT_NOT_FOUND;
+    }
+    return AFC_E_SUCCESS;
+}
+
+afc_error_t getFileInfoList(EmulatedClient *client, const char *path,
+                            char ***fileInformation)
+{
+    if (!fileInformation) {
+        return AFC_E_INVALID_ARG;
+    }
+    QFileInfo info;
+    const afc_error_t err = getFileInfo(client, path, info);
+    if (err != AFC_E_SUCCESS) {
+        return err;
+    }
+
+    const quint64 size = info.isDir() ? 0 : info.size();
+    *fileInformation = toAfcList({
+        QStringLiteral("st_size"),
+        QString::number(size),
+        QStringLiteral("st_blocks"),
+        QString::number((size + 511) / 512),
+        QStringLiteral("st_nlink"),
+        QStringLiteral("1"),
+        QStringLiteral("st_ifmt"),
+        fileFormat(info),
+        QStringLiteral("st_mtime"),
+        QString::number(afcTime(info.lastModified())),
+        QStringLiteral("st_birthtime"),
+        QString::number(afcTime(info.birthTime().isValid()
+                                    ? info.birthTime()
+                                    : info.lastModified())),
+    });
+    return AFC_E_SUCCESS;
+}
+
+afc_error_t getFileInfoPlist(EmulatedClient *client, const char *path,
+                             plist_t *fileInformation)
+{
+    if (!fileInformation) {
+        return AFC_E_INVALID_ARG;
+    }
+    QFileInfo info;
+    const afc_error_t err = getFileInfo(client, path, info);
+    if (err != AFC_E_SUCCESS) {
+        return err;
+    }
+
+    const quint64 size = info.isDir() ? 0 : info.size();
+    const QDateTime birthTime = info.birthTime().isValid()
+                                    ? info.birthTime()
+                                    : info.lastModified();
+    plist_t dict = plist_new_dict();
+    plist_dict_set_item(dict, "st_size", plist_new_uint(size));
+    plist_dict_set_item(dict, "st_blocks", plist_new_uint((size + 511) / 512));
+    plist_dict_set_item(dict, "st_nlink", plist_new_uint(1));
+    const QByteArray format = fileFormat(info).toUtf8();
+    plist_dict_set_item(dict, "st_ifmt", plist_new_string(format.constData()));
+    plist_dict_set_item(dict, "st_mtime",
+                        plist_new_uint(afcTime(info.lastModified())));
+    plist_dict_set_item(dict, "st_birthtime",
+                        plist_new_uint(afcTime(birthTime)));
+    *fileInformation = dict;
+    return AFC_E_SUCCESS;
+}
+
+QIODevice::OpenMode openMode(afc_file_mode_t mode)
+{
+    switch (mode) {
+    case AFC_FOPEN_RDONLY:
+        return QIODevice::ReadOnly;
+    case AFC_FOPEN_RW:
+        return QIODevice::ReadWrite;
+    case AFC_FOPEN_WRONLY:
+        return QIODevice::WriteOnly | QIODevice::Truncate;
+    case AFC_FOPEN_WR:
+        return QIODevice::ReadWrite | QIODevice::Truncate;
+    case AFC_FOPEN_APPEND:
+        return QIODevice::WriteOnly | QIODevice::Append;
+    case AFC_FOPEN_RDAPPEND:
+        return QIODevice::ReadWrite | QIODevice::Append;
+    }
+    return QIODevice::NotOpen;
+}
+
+afc_error_t fileOpen(EmulatedClient *client, const char *path,
+                     afc_file_mode_t mode, uint64_t *handle)
+{
+    const QIODevice::OpenMode flags = openMode(mode);
+    if (!handle || flags == QIODevice::NotOpen) {
+        return AFC_E_INVALID_ARG;
+    }
+    std::lock_guard lock(client->mutex);
+    simulateTransfer(client, 0);
+
+    const QString filePath = localPath(client, path);
+    if (filePath.isEmpty()) {
+        return AFC_E_PERM_DENIED;
+    }
+    if (QFileInfo(filePath).isDir()) {
+        return AFC_E_OBJECT_IS_DIR;
+    }
+    if (mode == AFC_FOPEN_RDONLY && !QFileInfo::exists(filePath)) {
+        return AFC_E_OBJECT_NOT_FOUND;
+    }
+
+    auto file = std::make_unique<QFile>(filePath);
+    if (!file->open(flags)) {
+        qDebug() << "AfcEmulator: could not open" << filePath << ":"
+                 << file->errorString();
+        return QFileInfo::exists(filePath) ? AFC_E_PERM_DENIED
+                                           : AFC_E_OBJECT_NOT_FOUND;
+    }
+
+    *handle = client->nextHandle++;
+    client->files.emplace(*handle, std::move(file));
+    return AFC_E_SUCCESS;
+}
+
+QFile *openFile(EmulatedClient *client, uint64_t handle)
+{
+    auto it = client->files.find(handle);
+    return it != client->files.end() ? it->second.get() : nullptr;
+}
+
+afc_error_t fileRead(EmulatedClient *client, uint64_t handle, char *data,
+                     uint32_t length, uint32_t *bytesRead)
+{
+    if (!data || !bytesRead) {
+        return AFC_E_INVALID_ARG;
+    }
+    std::lock_guard lock(client->mutex);
+    QFile *file = openFile(client, handle);
+    if (!file) {
+        simulateTransfer(client, 0);
+        return AFC_E_INVALID_ARG;
+    }
+
+    const qint64 read = file->read(data, length);
+    if (read < 0) {
+        simulateTransfer(client, 0);
+        return AFC_E_READ_ERROR;
+    }
+    simulateTransfer(client, read);
+    *bytesRead = static_cast<uint32_t>(read);
+    return AFC_E_SUCCESS;
+}
+
+afc_error_t fileWrite(EmulatedClient *client, uint64_t handle,
+                      const char *data, uint32_t length,
+                      uint32_t *bytesWritten)
+{
+    if (!data || !bytesWritten) {
+        return AFC_E_INVALID_ARG;
+    }
+    std::lock_guard lock(client->mutex);
+    simulateTransfer(client, length);
+    QFile *file = openFile(client, handle);
+    if (!file) {
+        return AFC_E_INVALID_ARG;
+    }
+
+    const qint64 written = file->write(data, length);
+    if (written < 0) {
+        return AFC_E_WRITE_ERROR;
+    }
+    *bytesWritten = static_cast<uint32_t>(written);
+    return AFC_E_SUCCESS;
+}
+
+afc_error_t fileSeek(EmulatedClient *client, uint64_t handle, int64_t offset,
+                     int whence)
+{
+    std::lock_guard lock(client->mutex);
+    simulateTransfer(client, 0);
+    QFile *file = openFile(client, handle);
+    if (!file) {
+        return AFC_E_INVALID_ARG;
+    }
+
+    qint64 position = offset;
+    if (whence == SEEK_CUR) {
+        position += file->pos();
+    } else if (whence == SEEK_END) {
+        position += file->size();
+    } else if (whence != SEEK_SET) {
+        return AFC_E_INVALID_ARG;
+    }
+    if (position < 0 || !file->seek(position)) {
+        return AFC_E_INVALID_ARG;
+    }
+    return AFC_E_SUCCESS;
+}
+
+afc_error_t fileTell(EmulatedClient *client, uint64_t handle,
+                     uint64_t *position)
+{
+    if (!position) {
+        return AFC_E_INVALID_ARG;
+    }
+    std::lock_guard lock(client->mutex);
+    simulateTransfer(client, 0);
+    QFile *file = openFile(client, handle);
+    if (!file) {
+        return AFC_E_INVALID_ARG;
+    }
+    *position = file->pos();
+    return AFC_E_SUCCESS;
+}
+
+afc_error_t fileClose(EmulatedClient *client, uint64_t handle)
+{
+    std::lock_guard lock(client->mutex);
+    simulateTransfer(client, 0);
+    return client->files.erase(handle) ? AFC_E_SUCCESS : AFC_E_INVALID_ARG;
+}
+
+afc_error_t makeDirectory(EmulatedClient *client, const char *path)
+{
+    std::lock_guard lock(client->mutex);
+    simulateTransfer(client, 0);
+    const QString dirPath = localPath(client, path);
+    if (dirPath.isEmpty()) {
+        return AFC_E_PERM_DENIED;
+    }
+    return QDir().mkpath(dirPath) ? AFC_E_SUCCESS : AFC_E_PERM_DENIED;
+}
+
+template <typename Function> Function realAfcFunction(const char *name)
+{
+    auto *function = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+    if (!function) {
+        qWarning() << "AfcEmulator: could not resolve" << name;
+    }
+    return function;
+}
+
+} // namespace
+
+AfcEmulator::LinkProfile AfcEmulator::usb2Profile()
+{
+    // ~35 MB/s is what AFC manages in practice over USB 2.0
+    return {std::chrono::microseconds(500), 35ull * 1000 * 1000};
+}
+
+AfcEmulator::LinkProfile AfcEmulator::usb3Profile()
+{
+    return {std::chrono::microseconds(150), 300ull * 1000 * 1000};
+}
+
+AfcEmulator::LinkProfile AfcEmulator::wifiProfile()
+{
+    return {std::chrono::microseconds(3000), 10ull * 1000 * 1000};
+}
+
+AfcEmulator::LinkProfile AfcEmulator::unlimitedProfile() { return {}; }
+
+AfcEmulator::LinkProfile AfcEmulator::profileByName(const QString &name)
+{
+    const QString lower = name.toLower();
+    if (lower == "usb2") {
+        return usb2Profile();
+    }
+    if (lower == "usb3") {
+        return usb3Profile();
+    }
+    if (lower == "wifi") {
+        return wifiProfile();
+    }
+    return unlimitedProfile();
+}
+
+afc_client_t AfcEmulator::createClient(const QString &rootPath,
+                                       const LinkProfile &profile)
+{
+    if (!QFileInfo(rootPath).isDir()) {
+        qWarning() << "AfcEmulator: root is not a directory:" << rootPath;
+        return nullptr;
+    }
+
+    auto *client = new EmulatedClient;
+    client->rootPath = QDir(rootPath).absolutePath();
+    client->profile = profile;
+
+    std::unique_lock lock(registryMutex);
+    registry.insert(client);
+    return reinterpret_cast<afc_client_t>(client);
+}
+
+bool AfcEmulator::isEmulated(afc_client_t client)
+{
+    return findClient(client) != nullptr;
+}
+
+void AfcEmulator::setLinkProfile(afc_client_t client,
+                                 const LinkProfile &profile)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        std::lock_guard lock(emulated->mutex);
+        emulated->profile = profile;
+    }
+}
+
+iDescriptorDevice *AfcEmulator::createDevice(const QString &rootPath,
+                                             const LinkProfile &profile)
+{
+    afc_client_t client = createClient(rootPath, profile);
+    if (!client) {
+        return nullptr;
+    }
+
+    auto *device = new iDescriptorDevice();
+    device->udid = "emulator-" + QFileInfo(rootPath).fileName().toStdString();
+    device->conn_type = CONNECTION_USBMUXD;
+    device->device = nullptr;
+    device->afcClient = client;
+    device->afc2Client = nullptr;
+    device->is_iPhone = true;
+    device->mutex = new std::recursive_mutex();
+    return device;
+}
+
+void AfcEmulator::destroyDevice(iDescriptorDevice *device)
+{
+    if (!device) {
+        return;
+    }
+    afc_client_free(device->afcClient);
+    delete device->mutex;
+    delete device;
+}
+
+/*
+ * Interposed libimobiledevice entry points. Symbols defined in the
+ * executable take precedence over the shared library, anything that is not
+ * an emulated client is passed on to the real implementation.
+ */
+
+afc_error_t afc_client_free(afc_client_t client)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        {
+            std::unique_lock lock(registryMutex);
+            registry.erase(emulated);
+        }
+        delete emulated;
+        return AFC_E_SUCCESS;
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_client_free)>("afc_client_free");
+    return real ? real(client) : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_read_directory(afc_client_t client, const char *path,
+                               char ***directory_information)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return readDirectory(emulated, path, directory_information);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_read_directory)>("afc_read_directory");
+    return real ? real(client, path, directory_information)
+                : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_get_file_info(afc_client_t client, const char *path,
+                              char ***file_information)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return getFileInfoList(emulated, path, file_information);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_get_file_info)>("afc_get_file_info");
+    return real ? real(client, path, file_information) : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_get_file_info_plist(afc_client_t client, const char *path,
+                                    plist_t *file_information)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return getFileInfoPlist(emulated, path, file_information);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_get_file_info_plist)>(
+            "afc_get_file_info_plist");
+    return real ? real(client, path, file_information) : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_file_open(afc_client_t client, const char *filename,
+                          afc_file_mode_t file_mode, uint64_t *handle)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return fileOpen(emulated, filename, file_mode, handle);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_file_open)>("afc_file_open");
+    return real ? real(client, filename, file_mode, handle)
+                : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_file_read(afc_client_t client, uint64_t handle, char *data,
+                          uint32_t length, uint32_t *bytes_read)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return fileRead(emulated, handle, data, length, bytes_read);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_file_read)>("afc_file_read");
+    return real ? real(client, handle, data, length, bytes_read)
+                : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_file_write(afc_client_t client, uint64_t handle,
+                           const char *data, uint32_t length,
+                           uint32_t *bytes_written)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return fileWrite(emulated, handle, data, length, bytes_written);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_file_write)>("afc_file_write");
+    return real ? real(client, handle, data, length, bytes_written)
+                : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_file_seek(afc_client_t client, uint64_t handle,
+                          int64_t offset, int whence)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return fileSeek(emulated, handle, offset, whence);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_file_seek)>("afc_file_seek");
+    return real ? real(client, handle, offset, whence) : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_file_tell(afc_client_t client, uint64_t handle,
+                          uint64_t *position)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return fileTell(emulated, handle, position);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_file_tell)>("afc_file_tell");
+    return real ? real(client, handle, position) : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_file_close(afc_client_t client, uint64_t handle)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return fileClose(emulated, handle);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_file_close)>("afc_file_close");
+    return real ? real(client, handle) : AFC_E_UNKNOWN_ERROR;
+}
+
+afc_error_t afc_make_directory(afc_client_t client, const char *path)
+{
+    if (EmulatedClient *emulated = findClient(client)) {
+        return makeDirectory(emulated, path);
+    }
+    static const auto real =
+        realAfcFunction<decltype(&afc_make_directory)>("afc_make_directory");
+    return real ? real(client, path) : AFC_E_UNKNOWN_ERROR;
+}
@@ -0,0 +1,73 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef AFCEMULATOR_H
+#define AFCEMULATOR_H
+
+#include "iDescriptor.h"
+#include <QString>
+#include <chrono>
+#include <libimobiledevice/afc.h>
+
+/**
+ * @brief In-process AFC service backed by a local directory tree
+ *
+ * Emulated clients are handed out as ordinary afc_client_t values. The afc_*
+ * entry points the app uses are interposed in this translation unit: calls
+ * on an emulated client are served from the directory, every other client is
+ * forwarded to libimobiledevice. This lets ServiceManager, ExportManager,
+ * PhotoModel and MediaStreamer run unchanged without a phone attached.
+ *
+ * Every request is delayed according to a LinkProfile so that USB2, USB3 and
+ * Wi-Fi transfers can be reproduced on a plain Linux machine. Only built
+ * with ENABLE_AFC_EMULATOR.
+ */
+class AfcEmulator
+{
+public:
+    struct LinkProfile {
+        // Added to every AFC request, models the round trip over usbmuxd
+        std::chrono::microseconds latency{0};
+        // Payload throughput in bytes per second, 0 means unlimited
+        quint64 bandwidth = 0;
+    };
+
+    static LinkProfile usb2Profile();
+    static LinkProfile usb3Profile();
+    static LinkProfile wifiProfile();
+    static LinkProfile unlimitedProfile();
+    // "usb2", "usb3", "wifi" or "none", unknown names are unlimited
+    static LinkProfile profileByName(const QString &name);
+
+    // Release with afc_client_free() like any other client
+    static afc_client_t
+    createClient(const QString &rootPath,
+                 const LinkProfile &profile = unlimitedProfile());
+    static bool isEmulated(afc_client_t client);
+    static void setLinkProfile(afc_client_t client,
+                               const LinkProfile &profile);
+
+    // Minimal device so the ServiceManager wrappers accept the client
+    static iDescriptorDevice *
+    createDevice(const QString &rootPath,
+                 const LinkProfile &profile = unlimitedProfile());
+    static void destroyDevice(iDescriptorDevice *device);
+};
+
+#endif // AFCEMULATOR_H
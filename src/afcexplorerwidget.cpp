@@ -18,6 +18,7 @@
  */
 
 #include "afcexplorerwidget.h"
+#include "appcontext.h"
 #include "exportmanager.h"
 #include "iDescriptor-ui.h"
 #include "iDescriptor.h"
@@ -26,6 +27,7 @@
 #include "settingsmanager.h"
 #include <QDebug>
 #include <QDesktopServices>
+#include <QFutureWatcher>
 #include <QFileDialog>
 #include <QHBoxLayout>
 #include <QHeaderView>
@@ -43,8 +45,11 @@
 #include <QTemporaryDir>
 #include <QTreeWidget>
 #include <QVariant>
+#include <QtConcurrent/QtConcurrent>
 #include <libimobiledevice/afc.h>
 #include <libimobiledevice/libimobiledevice.h>
+#include <atomic>
+#include <memory>
 
 AfcExplorerWidget::AfcExplorerWidget(iDescriptorDevice *device, bool favEnabled,
                                      afc_client_t afcClient, QString root,
@@ -301,8 +306,9 @@ void AfcExplorerWidget::onFileListContextMenu(const QPoint &pos)
         }
 
         // Start export with singleton - manager will show its own dialog
-        ExportManager::sharedInstance()->startExport(m_device, exportItems, dir,
-                                                     m_afc);
+        ExportManager::sharedInstance()->startExport(
+            m_device, exportItems, dir, m_afc, transferBackend(),
+            SettingsManager::sharedInstance()->defaultJailbrokenRootPassword());
     } else if (selectedAction == openAction) {
         onItemDoubleClicked(item);
     } else if (selectedAction == openNativeAction) {
@@ -356,8 +362,9 @@ void AfcExplorerWidget::onExportClicked()
     }
 
     // Start export with singleton - manager will show its own dialog
-    ExportManager::sharedInstance()->startExport(m_device, exportItems, dir,
-                                                 m_afc);
+    ExportManager::sharedInstance()->startExport(
+        m_device, exportItems, dir, m_afc, transferBackend(),
+        SettingsManager::sharedInstance()->defaultJailbrokenRootPassword());
 }
 
 void AfcExplorerWidget::exportSelectedFile(QListWidgetItem *item,
@@ -434,6 +441,103 @@ int AfcExplorerWidget::exportFileToPath(afc_client_t afc,
     return 0;
 }
 
+bool AfcExplorerWidget::sftpAvailable() const
+{
+    // AFC2 paths are device root paths, the same ones SFTP uses
+    return m_device && m_device->deviceInfo.jailbroken && m_afc &&
+           m_afc == m_device->afc2Client;
+}
+
+TransferBackend AfcExplorerWidget::transferBackend() const
+{
+    if (!m_transferBackendCombo)
+        return TransferBackend::Afc;
+    return static_cast<TransferBackend>(
+        m_transferBackendCombo->currentData().toInt());
+}
+
+void AfcExplorerWidget::updateTransferBackendToolTip()
+{
+    if (!m_transferBackendCombo)
+        return;
+
+    QStringList rates;
+    for (TransferBackend backend :
+         {TransferBackend::Afc, TransferBackend::Sftp}) {
+        const double rate = ExportManager::sharedInstance()->measuredThroughput(
+            m_device->udid, backend);
+        if (rate > 0) {
+            rates << QString("%1: %2 MB/s")
+                         .arg(SftpSession::backendName(backend))
+                         .arg(rate / (1024.0 * 1024.0), 0, 'f', 1);
+        }
+    }
+
+    QString toolTip = "Transfer method for export and import. SFTP needs "
+                      "OpenSSH on the device and moves several files at "
+                      "once.";
+    if (!rates.isEmpty())
+        toolTip += "\nLast export from this device: " + rates.join(", ");
+    m_transferBackendCombo->setToolTip(toolTip);
+}
+
+void AfcExplorerWidget::importFilesOverSftp(const QStringList &localPaths,
+                                            const QString &deviceDir)
+{
+    auto *watcher = new QFutureWatcher<QStringList>(this);
+    connect(watcher, &QFutureWatcher<QStringList>::finished, this,
+            [this, watcher, deviceDir]() {
+                const QStringList errors = watcher->result();
+                watcher->deleteLater();
+                if (!errors.isEmpty()) {
+                    QMessageBox::warning(this, "Import Failed",
+                                         errors.join("\n"));
+                }
+                loadPath(deviceDir);
+            });
+
+    iDescriptorDevice *device = m_device;
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    // Emitted before the device is freed, the upload has to stop first
+    connect(
+        AppContext::sharedInstance(), &AppContext::deviceRemoved, watcher,
+        [watcher, cancelled, udid = device->udid](const std::string &removed) {
+            if (removed == udid) {
+                cancelled->store(true);
+                watcher->waitForFinished();
+            }
+        },
+        Qt::DirectConnection);
+
+    const QString password =
+        SettingsManager::sharedInstance()->defaultJailbrokenRootPassword();
+    watcher->setFuture(QtConcurrent::run([device, password, localPaths,
+                                          deviceDir, cancelled]() {
+        QStringList errors;
+        SftpSession session(device, password);
+        QString error;
+        if (cancelled->load() || !session.open(&error))
+            return QStringList{error};
+
+        auto progress = [cancelled](qint64, qint64) {
+            return !cancelled->load();
+        };
+        for (const QString &localPath : localPaths) {
+            if (cancelled->load())
+                break;
+            const QString devicePath =
+                deviceDir + QFileInfo(localPath).fileName();
+            if (!session.upload(localPath, devicePath, progress, &error)) {
+                errors << QString("%1: %2").arg(devicePath, error);
+            } else {
+                qDebug() << "Imported" << localPath << "to" << devicePath
+                         << "over SFTP";
+            }
+        }
+        return errors;
+    }));
+}
+
 // should be disabled if there is an error loading afc
 void AfcExplorerWidget::onImportClicked()
 {
@@ -447,6 +551,11 @@ void AfcExplorerWidget::onImportClicked()
     if (!currPath.endsWith("/"))
         currPath += "/";
 
+    if (transferBackend() == TransferBackend::Sftp) {
+        importFilesOverSftp(fileNames, currPath);
+        return;
+    }
+
     // Import each file
     for (const QString &localPath : fileNames) {
         QFileInfo fi(localPath);
@@ -582,6 +691,18 @@ void AfcExplorerWidget::setupFileExplorer()
     navLayout->addWidget(m_addressBar);
     navLayout->addWidget(m_importBtn);
     navLayout->addWidget(m_exportBtn);
+    if (sftpAvailable()) {
+        m_transferBackendCombo = new QComboBox();
+        m_transferBackendCombo->addItem(
+            "AFC2", static_cast<int>(TransferBackend::Afc));
+        m_transferBackendCombo->addItem(
+            "SFTP", static_cast<int>(TransferBackend::Sftp));
+        navLayout->addWidget(m_transferBackendCombo);
+        updateTransferBackendToolTip();
+        connect(ExportManager::sharedInstance(),
+                &ExportManager::exportFinished, this,
+                &AfcExplorerWidget::updateTransferBackendToolTip);
+    }
     if (m_favEnabled)
         navLayout->addWidget(m_addToFavoritesBtn);
 
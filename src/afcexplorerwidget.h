@@ -22,7 +22,9 @@
 
 #include "iDescriptor-ui.h"
 #include "iDescriptor.h"
+#include "sftpsession.h"
 #include <QAction>
+#include <QComboBox>
 #include <QHBoxLayout>
 #include <QInputDialog>
 #include <QLabel>
@@ -77,6 +79,8 @@ private:
     ZIconWidget *m_exportBtn;
     ZIconWidget *m_importBtn;
     ZIconWidget *m_addToFavoritesBtn;
+    // Only on the AFC2 explorer of a jailbroken device
+    QComboBox *m_transferBackendCombo = nullptr;
     QListWidget *m_fileList;
     QStack<QString> m_history;
     QStack<QString> m_forwardHistory;
@@ -114,6 +118,11 @@ private:
                          const char *local_path);
     int importFileToDevice(afc_client_t afc, const char *device_path,
                            const char *local_path);
+    bool sftpAvailable() const;
+    TransferBackend transferBackend() const;
+    void updateTransferBackendToolTip();
+    void importFilesOverSftp(const QStringList &localPaths,
+                             const QString &deviceDir);
     void updateNavStyles();
     void updateButtonStates();
     void goUp();
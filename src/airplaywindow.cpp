@@ -47,6 +47,7 @@
 
 // Include the rpiplay server functions
 #include "../lib/airplay/renderers/video_renderer.h"
+#include "loggingcategories.h"
 extern "C" {
 int start_server_qt(const char *name, void *callbacks);
 int stop_server_qt();
@@ -401,7 +402,8 @@ void AirPlayWindow::initV4L2(int width, int height, const char *device)
 
     m_v4l2_fd = open(device, O_WRONLY);
     if (m_v4l2_fd < 0) {
-        qWarning("Failed to open V4L2 device %s: %s", device, strerror(errno));
+        qCWarning(lcAirplay, "Failed to open V4L2 device %s: %s", device,
+                  strerror(errno));
         return;
     }
 
@@ -416,7 +418,7 @@ void AirPlayWindow::initV4L2(int width, int height, const char *device)
     fmt.fmt.pix.sizeimage = (unsigned int)width * height * 3;
 
     if (ioctl(m_v4l2_fd, VIDIOC_S_FMT, &fmt) < 0) {
-        qWarning("Failed to set V4L2 format: %s", strerror(errno));
+        qCWarning(lcAirplay, "Failed to set V4L2 format: %s", strerror(errno));
         ::close(m_v4l2_fd);
         m_v4l2_fd = -1;
         return;
@@ -424,7 +426,8 @@ void AirPlayWindow::initV4L2(int width, int height, const char *device)
 
     m_v4l2_width = width;
     m_v4l2_height = height;
-    qDebug("V4L2 device %s initialized to %dx%d", device, width, height);
+    qCDebug(lcAirplay, "V4L2 device %s initialized to %dx%d", device, width,
+            height);
 }
 
 void AirPlayWindow::closeV4L2()
@@ -447,8 +450,8 @@ void AirPlayWindow::writeFrameToV4L2(uint8_t *data, int width, int height)
         ssize_t bytes_written =
             write(m_v4l2_fd, data, (size_t)width * height * 3);
         if (bytes_written < 0) {
-            qWarning("Failed to write frame to V4L2 device: %s",
-                     strerror(errno));
+            qCWarning(lcAirplay, "Failed to write frame to V4L2 device: %s",
+                      strerror(errno));
             closeV4L2(); // Close on error to retry initialization
         }
     }
@@ -460,7 +463,8 @@ bool AirPlayWindow::checkV4L2LoopbackExists()
         QFileInfo videoDevice("/dev/video0");
         return videoDevice.exists();
     } catch (...) {
-        qWarning("Exception occurred while checking for V4L2 loopback device");
+        qCWarning(lcAirplay,
+                  "Exception occurred while checking for V4L2 loopback device");
         return false;
     }
 }
@@ -479,12 +483,12 @@ bool AirPlayWindow::createV4L2Loopback()
         process.start("pkexec", arguments);
 
         if (!process.waitForStarted(5000)) {
-            qWarning("Failed to start pkexec process");
+            qCWarning(lcAirplay, "Failed to start pkexec process");
             return false;
         }
 
         if (!process.waitForFinished(10000)) {
-            qWarning("Timeout waiting for modprobe to complete");
+            qCWarning(lcAirplay, "Timeout waiting for modprobe to complete");
             process.kill();
             return false;
         }
@@ -492,8 +496,8 @@ bool AirPlayWindow::createV4L2Loopback()
         int exitCode = process.exitCode();
         if (exitCode != 0) {
             QString errorOutput = process.readAllStandardError();
-            qWarning("modprobe failed with exit code %d: %s", exitCode,
-                     errorOutput.toUtf8().constData());
+            qCWarning(lcAirplay, "modprobe failed with exit code %d: %s",
+                      exitCode, errorOutput.toUtf8().constData());
             return false;
         }
 
@@ -504,7 +508,8 @@ bool AirPlayWindow::createV4L2Loopback()
         return checkV4L2LoopbackExists();
 
     } catch (...) {
-        qWarning("Exception occurred while creating V4L2 loopback device");
+        qCWarning(lcAirplay,
+                  "Exception occurred while creating V4L2 loopback device");
         return false;
     }
 }
@@ -521,7 +526,8 @@ void AirPlayWindow::setupV4L2Checkbox()
                 &AirPlayWindow::onV4L2CheckboxToggled);
 
     } catch (...) {
-        qWarning("Exception occurred while setting up V4L2 checkbox");
+        qCWarning(lcAirplay,
+                  "Exception occurred while setting up V4L2 checkbox");
     }
 }
 #endif
\ No newline at end of file
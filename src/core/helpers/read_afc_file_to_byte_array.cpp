@@ -18,6 +18,7 @@
  */
 
 #include "../../iDescriptor.h"
+#include "../../loggingcategories.h"
 #include <QByteArray>
 #include <QDebug>
 
@@ -28,7 +29,7 @@ QByteArray read_afc_file_to_byte_array(afc_client_t afcClient, const char *path)
         afc_file_open(afcClient, path, AFC_FOPEN_RDONLY, &fd_handle);
 
     if (fd_err != AFC_E_SUCCESS) {
-        qDebug() << "Could not open file" << path << "Error:" << fd_err;
+        qCDebug(lcAfc) << "Could not open file" << path << "Error:" << fd_err;
         return QByteArray();
     }
 
@@ -67,8 +68,8 @@ QByteArray read_afc_file_to_byte_array(afc_client_t afcClient, const char *path)
                           &bytesReadThisChunk);
 
         if (read_err != AFC_E_SUCCESS) {
-            qDebug() << "AFC Error: Read failed for file" << path
-                     << "Error:" << read_err;
+            qCDebug(lcAfc) << "AFC Error: Read failed for file" << path
+                           << "Error:" << read_err;
             afc_file_close(afcClient, fd_handle);
             return QByteArray();
         }
@@ -83,8 +84,8 @@ QByteArray read_afc_file_to_byte_array(afc_client_t afcClient, const char *path)
     afc_file_close(afcClient, fd_handle);
 
     if (totalBytesRead != fileSize) {
-        qDebug() << "AFC Error: Read mismatch for file" << path
-                 << "Read:" << totalBytesRead << "Expected:" << fileSize;
+        qCDebug(lcAfc) << "AFC Error: Read mismatch for file" << path << "Read:"
+                       << totalBytesRead << "Expected:" << fileSize;
         return QByteArray(); // Read failed
     }
 
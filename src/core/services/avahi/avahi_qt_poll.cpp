@@ -0,0 +1,139 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "avahi_qt_poll.h"
+#include <QObject>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <avahi-common/timeval.h>
+#include <climits>
+
+struct AvahiWatch : public QObject {
+    int fd = -1;
+    AvahiWatchEvent events = static_cast<AvahiWatchEvent>(0);
+    // Events being dispatched, reported by watch_get_events()
+    AvahiWatchEvent lastEvents = static_cast<AvahiWatchEvent>(0);
+    AvahiWatchCallback callback = nullptr;
+    void *userdata = nullptr;
+    QSocketNotifier *readNotifier = nullptr;
+    QSocketNotifier *writeNotifier = nullptr;
+    bool freed = false;
+};
+
+struct AvahiTimeout : public QObject {
+    QTimer timer;
+    AvahiTimeoutCallback callback = nullptr;
+    void *userdata = nullptr;
+};
+
+static void dispatchWatch(AvahiWatch *w, AvahiWatchEvent event)
+{
+    w->lastEvents = event;
+    w->callback(w, w->fd, event, w->userdata);
+    // The callback may have freed the watch; deletion is deferred
+    if (!w->freed)
+        w->lastEvents = static_cast<AvahiWatchEvent>(0);
+}
+
+static void watchUpdate(AvahiWatch *w, AvahiWatchEvent events)
+{
+    w->events = events;
+    w->readNotifier->setEnabled(events & (AVAHI_WATCH_IN | AVAHI_WATCH_HUP |
+                                          AVAHI_WATCH_ERR));
+    w->writeNotifier->setEnabled(events & AVAHI_WATCH_OUT);
+}
+
+static AvahiWatch *watchNew(const AvahiPoll *api, int fd,
+                            AvahiWatchEvent events,
+                            AvahiWatchCallback callback, void *userdata)
+{
+    Q_UNUSED(api)
+
+    auto *w = new AvahiWatch;
+    w->fd = fd;
+    w->callback = callback;
+    w->userdata = userdata;
+    w->readNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, w);
+    w->writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write, w);
+
+    QObject::connect(w->readNotifier, &QSocketNotifier::activated, w,
+                     [w]() { dispatchWatch(w, AVAHI_WATCH_IN); });
+    QObject::connect(w->writeNotifier, &QSocketNotifier::activated, w,
+                     [w]() { dispatchWatch(w, AVAHI_WATCH_OUT); });
+
+    watchUpdate(w, events);
+    return w;
+}
+
+static AvahiWatchEvent watchGetEvents(AvahiWatch *w) { return w->lastEvents; }
+
+static void watchFree(AvahiWatch *w)
+{
+    w->freed = true;
+    w->readNotifier->setEnabled(false);
+    w->writeNotifier->setEnabled(false);
+    w->deleteLater();
+}
+
+static void timeoutUpdate(AvahiTimeout *t, const struct timeval *tv)
+{
+    if (!tv) {
+        t->timer.stop();
+        return;
+    }
+
+    // tv is absolute; avahi_age() is negative while it lies in the future
+    const AvahiUsec remaining = -avahi_age(tv);
+    const AvahiUsec msec = remaining > 0 ? (remaining + 999) / 1000 : 0;
+    t->timer.start(static_cast<int>(qMin<AvahiUsec>(msec, INT_MAX)));
+}
+
+static AvahiTimeout *timeoutNew(const AvahiPoll *api, const struct timeval *tv,
+                                AvahiTimeoutCallback callback, void *userdata)
+{
+    Q_UNUSED(api)
+
+    auto *t = new AvahiTimeout;
+    t->callback = callback;
+    t->userdata = userdata;
+    t->timer.setSingleShot(true);
+    QObject::connect(&t->timer, &QTimer::timeout, t,
+                     [t]() { t->callback(t, t->userdata); });
+
+    timeoutUpdate(t, tv);
+    return t;
+}
+
+static void timeoutFree(AvahiTimeout *t)
+{
+    t->timer.stop();
+    t->deleteLater();
+}
+
+AvahiQtPoll::AvahiQtPoll()
+{
+    m_poll.userdata = this;
+    m_poll.watch_new = watchNew;
+    m_poll.watch_update = watchUpdate;
+    m_poll.watch_get_events = watchGetEvents;
+    m_poll.watch_free = watchFree;
+    m_poll.timeout_new = timeoutNew;
+    m_poll.timeout_update = timeoutUpdate;
+    m_poll.timeout_free = timeoutFree;
+}
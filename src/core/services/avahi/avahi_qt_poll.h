@@ -0,0 +1,47 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef AVAHI_QT_POLL_H
+#define AVAHI_QT_POLL_H
+
+#include <QtGlobal>
+#include <avahi-common/watch.h>
+
+/**
+ * @brief AvahiPoll implementation driven by the Qt event loop.
+ *
+ * Watches are backed by QSocketNotifiers and timeouts by single-shot
+ * QTimers, so Avahi only runs when its socket is ready or a timeout is due.
+ * Must be used from the thread that created it and outlive every client
+ * created with it.
+ */
+class AvahiQtPoll
+{
+public:
+    AvahiQtPoll();
+
+    const AvahiPoll *get() const { return &m_poll; }
+
+private:
+    Q_DISABLE_COPY(AvahiQtPoll)
+
+    AvahiPoll m_poll;
+};
+
+#endif // AVAHI_QT_POLL_H
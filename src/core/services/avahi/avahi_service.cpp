@@ -19,18 +19,25 @@
 
 #include "avahi_service.h"
 #include <QDebug>
-#include <QMutexLocker>
+#include <QStringList>
 #include <avahi-common/error.h>
 #include <avahi-common/malloc.h>
 
 AvahiService::AvahiService(QObject *parent)
-    : QObject(parent), m_simplePoll(nullptr), m_client(nullptr),
-      m_serviceBrowser(nullptr), m_pollTimer(new QTimer(this)), m_running(false)
+    : QObject(parent), m_client(nullptr), m_serviceBrowser(nullptr),
+      m_expiryTimer(new QTimer(this)), m_running(false)
 {
-    connect(m_pollTimer, &QTimer::timeout, this, &AvahiService::pollAvahi);
+    m_expiryTimer->setSingleShot(true);
+    connect(m_expiryTimer, &QTimer::timeout, this,
+            &AvahiService::onExpiryTimeout);
 }
 
-AvahiService::~AvahiService() { stopBrowsing(); }
+AvahiService::~AvahiService()
+{
+    stopBrowsing();
+    // stopBrowsing() is a no-op once the client has failed
+    cleanupAvahi();
+}
 
 void AvahiService::startBrowsing()
 {
@@ -40,8 +47,7 @@ void AvahiService::startBrowsing()
     qDebug() << "Starting Avahi browsing for Apple devices";
     initializeAvahi();
 
-    if (m_simplePoll) {
-        m_pollTimer->start(100); // Poll every 100ms
+    if (m_client) {
         m_running = true;
     }
 }
@@ -53,42 +59,32 @@ void AvahiService::stopBrowsing()
 
     qDebug() << "Stopping Avahi browsing";
     m_running = false;
-    m_pollTimer->stop();
+    m_expiryTimer->stop();
     cleanupAvahi();
 
-    QMutexLocker locker(&m_devicesMutex);
-    m_networkDevices.clear();
+    // Resolvers were freed along with the client
+    m_devices.clear();
+    m_resolving.clear();
 }
 
 QList<NetworkDevice> AvahiService::getNetworkDevices() const
 {
-    QMutexLocker locker(&m_devicesMutex);
-    return m_networkDevices;
-}
-
-void AvahiService::pollAvahi()
-{
-    if (m_simplePoll && m_running) {
-        avahi_simple_poll_iterate(m_simplePoll, 0); // Non-blocking
+    QList<NetworkDevice> devices;
+    devices.reserve(m_devices.size());
+    for (const DeviceEntry &entry : m_devices) {
+        devices.append(entry.device);
     }
+    return devices;
 }
 
 void AvahiService::initializeAvahi()
 {
     int error;
 
-    m_simplePoll = avahi_simple_poll_new();
-    if (!m_simplePoll) {
-        qWarning() << "Failed to create Avahi simple poll";
-        return;
-    }
-
-    m_client =
-        avahi_client_new(avahi_simple_poll_get(m_simplePoll),
-                         (AvahiClientFlags)0, clientCallback, this, &error);
+    m_client = avahi_client_new(m_poll.get(), (AvahiClientFlags)0,
+                                clientCallback, this, &error);
     if (!m_client) {
         qWarning() << "Failed to create Avahi client:" << avahi_strerror(error);
-        cleanupAvahi();
         return;
     }
 }
@@ -104,11 +100,91 @@ void AvahiService::cleanupAvahi()
         avahi_client_free(m_client);
         m_client = nullptr;
     }
+}
 
-    if (m_simplePoll) {
-        avahi_simple_poll_free(m_simplePoll);
-        m_simplePoll = nullptr;
+AvahiServiceResolver *AvahiService::resolve(AvahiIfIndex interface,
+                                            AvahiProtocol protocol,
+                                            const char *name,
+                                            const char *type,
+                                            const char *domain,
+                                            AvahiProtocol addressProtocol)
+{
+    return avahi_service_resolver_new(m_client, interface, protocol, name,
+                                      type, domain, addressProtocol,
+                                      (AvahiLookupFlags)0, resolveCallback,
+                                      this);
+}
+
+void AvahiService::startResolve(AvahiIfIndex interface,
+                                AvahiProtocol protocol, const char *name,
+                                const char *type, const char *domain,
+                                AvahiProtocol addressProtocol)
+{
+    AvahiServiceResolver *resolver =
+        resolve(interface, protocol, name, type, domain, addressProtocol);
+    if (!resolver) {
+        qWarning() << "Failed to create resolver for" << name;
+        return;
     }
+    m_resolving.insert(QString::fromUtf8(name),
+                       PendingResolve{resolver, addressProtocol});
+}
+
+void AvahiService::removeDevice(const QString &name)
+{
+    auto it = m_devices.find(name);
+    if (it == m_devices.end())
+        return;
+
+    if (it->revalidator) {
+        avahi_service_resolver_free(it->revalidator);
+    }
+    m_devices.erase(it);
+    emit deviceRemoved(name);
+}
+
+void AvahiService::scheduleExpiry()
+{
+    qint64 next = -1;
+    for (const DeviceEntry &entry : m_devices) {
+        if (entry.revalidator)
+            continue;
+        const qint64 remaining = entry.expiry.remainingTime();
+        if (next < 0 || remaining < next) {
+            next = remaining;
+        }
+    }
+
+    if (next < 0) {
+        m_expiryTimer->stop();
+    } else {
+        m_expiryTimer->start(static_cast<int>(next));
+    }
+}
+
+void AvahiService::onExpiryTimeout()
+{
+    QStringList lost;
+    for (auto it = m_devices.begin(); it != m_devices.end(); ++it) {
+        if (it->revalidator || !it->expiry.hasExpired())
+            continue;
+
+        // Missed REMOVE events leave stale entries behind; keep a device
+        // only if it still answers
+        it->revalidator =
+            resolve(it->interface, it->protocol,
+                    it->device.name.toUtf8().constData(),
+                    it->type.constData(), it->domain.constData(),
+                    it->addressProtocol);
+        if (!it->revalidator) {
+            lost.append(it.key());
+        }
+    }
+
+    for (const QString &name : lost) {
+        removeDevice(name);
+    }
+    scheduleExpiry();
 }
 
 void AvahiService::clientCallback(AvahiClient *client, AvahiClientState state,
@@ -146,28 +222,31 @@ void AvahiService::browseCallback(AvahiServiceBrowser *browser,
     AvahiService *service = static_cast<AvahiService *>(userdata);
 
     switch (event) {
-    case AVAHI_BROWSER_NEW:
-        if (!avahi_service_resolver_new(service->m_client, interface, protocol,
-                                        name, type, domain, AVAHI_PROTO_UNSPEC,
-                                        (AvahiLookupFlags)0, resolveCallback,
-                                        userdata)) {
-            qWarning() << "Failed to create resolver for" << name;
-        }
+    case AVAHI_BROWSER_NEW: {
+        // Resolved or being resolved through another interface or protocol
+        const QString serviceName = QString::fromUtf8(name);
+        if (service->m_devices.contains(serviceName) ||
+            service->m_resolving.contains(serviceName))
+            break;
+
+        // Prefer IPv4, a link-local IPv6 address has no usable scope here
+        service->startResolve(interface, protocol, name, type, domain,
+                              AVAHI_PROTO_INET);
         break;
+    }
 
-    case AVAHI_BROWSER_REMOVE:
+    case AVAHI_BROWSER_REMOVE: {
         qDebug() << "Apple device removed:" << name;
-        emit service->deviceRemoved(QString::fromUtf8(name));
-
-        // Remove from our list
-        {
-            QMutexLocker locker(&service->m_devicesMutex);
-            service->m_networkDevices.removeIf(
-                [name](const NetworkDevice &dev) {
-                    return dev.name == QString::fromUtf8(name);
-                });
+        const QString serviceName = QString::fromUtf8(name);
+        auto pending = service->m_resolving.find(serviceName);
+        if (pending != service->m_resolving.end()) {
+            avahi_service_resolver_free(pending->resolver);
+            service->m_resolving.erase(pending);
         }
+        service->removeDevice(serviceName);
+        service->scheduleExpiry();
         break;
+    }
 
     case AVAHI_BROWSER_FAILURE:
         qWarning() << "Browser failure";
@@ -185,17 +264,30 @@ void AvahiService::resolveCallback(
     const AvahiAddress *address, uint16_t port, AvahiStringList *txt,
     AvahiLookupResultFlags flags, void *userdata)
 {
-    Q_UNUSED(interface)
-    Q_UNUSED(protocol)
-    Q_UNUSED(type)
-    Q_UNUSED(domain)
     Q_UNUSED(flags)
 
     AvahiService *service = static_cast<AvahiService *>(userdata);
+    const QString serviceName = QString::fromUtf8(name);
+
+    AvahiProtocol addressProtocol = AVAHI_PROTO_UNSPEC;
+    bool initial = false;
+    auto pending = service->m_resolving.find(serviceName);
+    if (pending != service->m_resolving.end() &&
+        pending->resolver == resolver) {
+        addressProtocol = pending->addressProtocol;
+        initial = true;
+        service->m_resolving.erase(pending);
+    }
+
+    auto it = service->m_devices.find(serviceName);
+    if (it != service->m_devices.end() && it->revalidator == resolver) {
+        it->revalidator = nullptr;
+        addressProtocol = it->addressProtocol;
+    }
 
     if (event == AVAHI_RESOLVER_FOUND) {
         NetworkDevice device;
-        device.name = QString::fromUtf8(name);
+        device.name = serviceName;
         device.hostname = QString::fromUtf8(host_name);
         device.port = port > 0 ? port : 22; // Default to SSH port
 
@@ -221,23 +313,43 @@ void AvahiService::resolveCallback(
         qDebug() << "Resolved Apple device:" << device.name << "at"
                  << device.address << ":" << device.port;
 
-        // Add to our list if not already present
-        {
-            QMutexLocker locker(&service->m_devicesMutex);
-            bool exists = std::any_of(service->m_networkDevices.begin(),
-                                      service->m_networkDevices.end(),
-                                      [&device](const NetworkDevice &existing) {
-                                          return existing == device;
-                                      });
-            if (!exists) {
-                service->m_networkDevices.append(device);
+        if (it == service->m_devices.end()) {
+            DeviceEntry entry;
+            entry.device = device;
+            entry.interface = interface;
+            entry.protocol = protocol;
+            entry.type = type;
+            entry.domain = domain;
+            entry.addressProtocol = addressProtocol;
+            entry.expiry = QDeadlineTimer(DeviceTtlMs);
+            service->m_devices.insert(serviceName, entry);
+            emit service->deviceAdded(device);
+        } else {
+            const bool moved = !(it->device == device) ||
+                               it->device.port != device.port;
+            it->device = device;
+            it->expiry = QDeadlineTimer(DeviceTtlMs);
+            if (moved) {
+                emit service->deviceRemoved(serviceName);
                 emit service->deviceAdded(device);
             }
         }
-
     } else if (event == AVAHI_RESOLVER_FAILURE) {
-        qWarning() << "Failed to resolve service" << name;
+        qWarning() << "Failed to resolve service" << name << ":"
+                   << avahi_strerror(
+                          avahi_client_errno(service->m_client));
+
+        if (initial && addressProtocol == AVAHI_PROTO_INET) {
+            // No IPv4 address, take whatever the device has
+            service->startResolve(interface, protocol, name, type, domain,
+                                  AVAHI_PROTO_UNSPEC);
+        } else if (it != service->m_devices.end() && !it->revalidator &&
+                   it->expiry.hasExpired()) {
+            // A device that stopped answering after its TTL is gone
+            service->removeDevice(serviceName);
+        }
     }
 
     avahi_service_resolver_free(resolver);
-}
\ No newline at end of file
+    service->scheduleExpiry();
+}
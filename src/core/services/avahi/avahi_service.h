@@ -21,18 +21,17 @@
 #define AVAHI_SERVICE_H
 
 #include "../../../iDescriptor.h"
+#include "avahi_qt_poll.h"
+#include <QByteArray>
+#include <QDeadlineTimer>
+#include <QHash>
 #include <QList>
-#include <QMutex>
 #include <QObject>
 #include <QString>
-#include <QThread>
 #include <QTimer>
-#include <map>
-#include <string>
 
 #include <avahi-client/client.h>
 #include <avahi-client/lookup.h>
-#include <avahi-common/simple-watch.h>
 
 class AvahiService : public QObject
 {
@@ -44,6 +43,7 @@ public:
 
     void startBrowsing();
     void stopBrowsing();
+    // Must be called from the thread that owns the service
     QList<NetworkDevice> getNetworkDevices() const;
 
 signals:
@@ -51,11 +51,42 @@ signals:
     void deviceRemoved(const QString &deviceName);
 
 private slots:
-    void pollAvahi();
+    void onExpiryTimeout();
 
 private:
+    struct DeviceEntry {
+        NetworkDevice device;
+        AvahiIfIndex interface;
+        AvahiProtocol protocol;
+        QByteArray type;
+        QByteArray domain;
+        AvahiProtocol addressProtocol; // what the address was resolved with
+        QDeadlineTimer expiry;
+        // Set while an expired entry is being re-resolved
+        AvahiServiceResolver *revalidator = nullptr;
+    };
+
+    // First resolve of a browsed name, announcements on other interfaces
+    // or protocols wait for it
+    struct PendingResolve {
+        AvahiServiceResolver *resolver;
+        AvahiProtocol addressProtocol;
+    };
+
+    // How long a resolved device is trusted before it is re-resolved
+    static constexpr qint64 DeviceTtlMs = 120 * 1000;
+
     void initializeAvahi();
     void cleanupAvahi();
+    AvahiServiceResolver *resolve(AvahiIfIndex interface,
+                                  AvahiProtocol protocol, const char *name,
+                                  const char *type, const char *domain,
+                                  AvahiProtocol addressProtocol);
+    void startResolve(AvahiIfIndex interface, AvahiProtocol protocol,
+                      const char *name, const char *type, const char *domain,
+                      AvahiProtocol addressProtocol);
+    void removeDevice(const QString &name);
+    void scheduleExpiry();
 
     static void clientCallback(AvahiClient *client, AvahiClientState state,
                                void *userdata);
@@ -73,13 +104,14 @@ private:
                                 AvahiStringList *txt,
                                 AvahiLookupResultFlags flags, void *userdata);
 
-    AvahiSimplePoll *m_simplePoll;
+    AvahiQtPoll m_poll;
     AvahiClient *m_client;
     AvahiServiceBrowser *m_serviceBrowser;
-    QTimer *m_pollTimer;
+    QTimer *m_expiryTimer;
 
-    mutable QMutex m_devicesMutex;
-    QList<NetworkDevice> m_networkDevices;
+    // Keyed by service name
+    QHash<QString, DeviceEntry> m_devices;
+    QHash<QString, PendingResolve> m_resolving;
     bool m_running;
 };
 
@@ -19,7 +19,6 @@
 
 #include "dnssd_service.h"
 #include <QDebug>
-#include <QMutexLocker>
 #include <cstring>
 
 #ifdef _WIN32
@@ -28,7 +27,6 @@
 #pragma comment(lib, "ws2_32.lib")
 #else
 #include <arpa/inet.h>
-#include <sys/select.h>
 #include <unistd.h>
 #endif
 
@@ -73,15 +71,16 @@ void DnssdService::stopBrowsing()
     m_running = false;
     cleanupDnssd();
 
-    QMutexLocker locker(&m_devicesMutex);
-    m_networkDevices.clear();
-    m_pendingDevices.clear();
+    const QList<Resolution *> pending = m_resolutions.values();
+    for (Resolution *res : pending) {
+        finishResolution(res);
+    }
+    m_devices.clear();
 }
 
 QList<NetworkDevice> DnssdService::getNetworkDevices() const
 {
-    QMutexLocker locker(&m_devicesMutex);
-    return m_networkDevices;
+    return m_devices.values();
 }
 
 void DnssdService::processDnssdEvents()
@@ -104,14 +103,164 @@ void DnssdService::cleanupDnssd()
     }
 }
 
+void DnssdService::startResolution(const char *serviceName,
+                                   const char *regtype,
+                                   const char *replyDomain,
+                                   uint32_t interfaceIndex)
+{
+    const QString name = QString::fromUtf8(serviceName);
+
+    // Services are announced once per interface; resolve them once
+    if (m_devices.contains(name) || m_resolutions.contains(name))
+        return;
+
+    auto *res = new Resolution;
+    res->service = this;
+    res->serviceName = name;
+    res->interfaceIndex = interfaceIndex;
+
+    DNSServiceErrorType err =
+        DNSServiceResolve(&res->resolveRef, 0, interfaceIndex, serviceName,
+                          regtype, replyDomain, resolveCallback, res);
+    if (err != kDNSServiceErr_NoError) {
+        qWarning() << "DNSServiceResolve failed for" << name << ":" << err;
+        delete res;
+        return;
+    }
+
+    m_resolutions.insert(name, res);
+    res->resolveNotifier = watchQuery(res, res->resolveRef);
+
+    res->timeout = new QTimer(this);
+    res->timeout->setSingleShot(true);
+    connect(res->timeout, &QTimer::timeout, this, [this, res]() {
+        qWarning() << "Timed out resolving" << res->serviceName;
+        finishResolution(res);
+    });
+    res->timeout->start(ResolveTimeoutMs);
+}
+
+QSocketNotifier *DnssdService::watchQuery(Resolution *res, DNSServiceRef ref)
+{
+    auto *notifier = new QSocketNotifier(DNSServiceRefSockFD(ref),
+                                         QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this,
+            [this, res, ref]() { processQuery(res, ref); });
+    return notifier;
+}
+
+void DnssdService::processQuery(Resolution *res, DNSServiceRef ref)
+{
+    DNSServiceErrorType err = DNSServiceProcessResult(ref);
+    if (err != kDNSServiceErr_NoError) {
+        qWarning() << "DNS-SD query failed for" << res->serviceName << ":"
+                   << err;
+        finishResolution(res);
+        return;
+    }
+
+    // Refs are only released here, never from inside their own callback
+    if (ref == res->resolveRef && res->resolved) {
+        stopQuery(res->resolveRef, res->resolveNotifier);
+        lookupAddress(res);
+    } else if (ref == res->addrRef && !res->address.isEmpty()) {
+        completeResolution(res);
+    }
+}
+
+void DnssdService::lookupAddress(Resolution *res)
+{
+    auto cached = m_addressCache.constFind(res->hostname);
+    if (cached != m_addressCache.constEnd() && !cached->expiry.hasExpired()) {
+        res->address = cached->address;
+        completeResolution(res);
+        return;
+    }
+
+    DNSServiceErrorType err = DNSServiceGetAddrInfo(
+        &res->addrRef, 0, res->interfaceIndex, kDNSServiceProtocol_IPv4,
+        res->hostname.toUtf8().constData(), addrInfoCallback, res);
+    if (err != kDNSServiceErr_NoError) {
+        qWarning() << "DNSServiceGetAddrInfo failed for" << res->hostname
+                   << ":" << err;
+        res->addrRef = nullptr;
+        finishResolution(res);
+        return;
+    }
+
+    res->addrNotifier = watchQuery(res, res->addrRef);
+}
+
+void DnssdService::completeResolution(Resolution *res)
+{
+    NetworkDevice device;
+    // Extract a better device name from hostname or use TXT records
+    QString friendlyName = res->hostname;
+    if (friendlyName.endsWith(".local.")) {
+        friendlyName =
+            friendlyName.left(friendlyName.length() - 7); // Remove ".local."
+        qDebug() << "friendly name:" << friendlyName;
+    }
+
+    // Try to get device name from TXT records first
+    if (res->txt.contains("DvNm")) {
+        device.name = res->txt["DvNm"];
+        qDebug() << "Device name from DvNm TXT record:" << device.name;
+    } else if (res->txt.contains("Name")) {
+        device.name = res->txt["Name"];
+        qDebug() << "Device name from Name TXT record:" << device.name;
+    } else {
+        // Use the cleaned hostname as fallback
+        qDebug() << "Using hostname as device name:" << friendlyName;
+        device.name = friendlyName;
+    }
+
+    device.hostname = res->hostname;
+    device.address = res->address;
+    device.port = res->port > 0 ? res->port : 22; // Default to SSH port
+
+    qDebug() << "Resolved IP for Apple device:" << device.name << "at"
+             << device.address << ":" << device.port;
+
+    m_devices.insert(res->serviceName, device);
+    finishResolution(res);
+    emit deviceAdded(device);
+}
+
+void DnssdService::finishResolution(Resolution *res)
+{
+    stopQuery(res->resolveRef, res->resolveNotifier);
+    stopQuery(res->addrRef, res->addrNotifier);
+    if (res->timeout) {
+        res->timeout->stop();
+        res->timeout->deleteLater();
+    }
+
+    m_resolutions.remove(res->serviceName);
+    delete res;
+}
+
+void DnssdService::stopQuery(DNSServiceRef &ref, QSocketNotifier *&notifier)
+{
+    // May run from the notifier's own activated() signal
+    if (notifier) {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+        notifier = nullptr;
+    }
+
+    if (ref) {
+        DNSServiceRefDeallocate(ref);
+        ref = nullptr;
+    }
+}
+
 void DNSSD_API DnssdService::browseCallback(
     DNSServiceRef sdRef, DNSServiceFlags flags, uint32_t interfaceIndex,
     DNSServiceErrorType errorCode, const char *serviceName, const char *regtype,
     const char *replyDomain, void *context)
 {
     Q_UNUSED(sdRef)
-    Q_UNUSED(regtype)
-    Q_UNUSED(replyDomain)
 
     if (errorCode != kDNSServiceErr_NoError)
         return;
@@ -119,37 +268,23 @@ void DNSSD_API DnssdService::browseCallback(
     DnssdService *service = static_cast<DnssdService *>(context);
 
     if (flags & kDNSServiceFlagsAdd) {
-        // Start resolving the service
-        DNSServiceRef resolveRef;
-        DNSServiceErrorType err =
-            DNSServiceResolve(&resolveRef, 0, interfaceIndex, serviceName,
-                              regtype, replyDomain, resolveCallback, context);
-
-        if (err == kDNSServiceErr_NoError) {
-            // Process the resolve synchronously for simplicity
-            int fd = DNSServiceRefSockFD(resolveRef);
-            fd_set readfds;
-            FD_ZERO(&readfds);
-            FD_SET(fd, &readfds);
-            struct timeval timeout = {5, 0}; // 5 second timeout
-            if (select(fd + 1, &readfds, nullptr, nullptr, &timeout) > 0) {
-                if (FD_ISSET(fd, &readfds)) {
-                    DNSServiceProcessResult(resolveRef);
-                }
-            }
-            DNSServiceRefDeallocate(resolveRef);
-        }
+        service->startResolution(serviceName, regtype, replyDomain,
+                                 interfaceIndex);
     } else {
         qDebug() << "Apple device removed:" << serviceName;
-        emit service->deviceRemoved(QString::fromUtf8(serviceName));
-
-        // Remove from our list
-        QMutexLocker locker(&service->m_devicesMutex);
-        service->m_networkDevices.removeIf(
-            [serviceName](const NetworkDevice &dev) {
-                return dev.name == QString::fromUtf8(serviceName);
-            });
-        service->m_pendingDevices.remove(QString::fromUtf8(serviceName));
+        const QString name = QString::fromUtf8(serviceName);
+
+        if (Resolution *res = service->m_resolutions.value(name)) {
+            service->finishResolution(res);
+        }
+
+        // Listeners know the device by its display name
+        auto it = service->m_devices.find(name);
+        if (it != service->m_devices.end()) {
+            const QString deviceName = it->name;
+            service->m_devices.erase(it);
+            emit service->deviceRemoved(deviceName);
+        }
     }
 }
 
@@ -161,19 +296,15 @@ void DNSSD_API DnssdService::resolveCallback(
 {
     Q_UNUSED(sdRef)
     Q_UNUSED(flags)
+    Q_UNUSED(interfaceIndex)
 
-    if (errorCode != kDNSServiceErr_NoError)
+    auto *res = static_cast<Resolution *>(context);
+    if (errorCode != kDNSServiceErr_NoError || res->resolved)
         return;
 
-    DnssdService *service = static_cast<DnssdService *>(context);
-    QString serviceName = QString::fromUtf8(fullname);
-
-    // Store pending device info
-    PendingDevice pending;
-    pending.name = serviceName;
-    pending.hostname = QString::fromUtf8(hosttarget);
-    pending.port = ntohs(port);
-    pending.interfaceIndex = interfaceIndex;
+    res->resolved = true;
+    res->hostname = QString::fromUtf8(hosttarget);
+    res->port = ntohs(port);
 
     // Parse TXT records
     if (txtLen > 0 && txtRecord) {
@@ -191,37 +322,14 @@ void DNSSD_API DnssdService::resolveCallback(
             if (equalPos != -1) {
                 QString key = record.left(equalPos);
                 QString value = record.mid(equalPos + 1);
-                pending.txt[key] = value;
+                res->txt[key] = value;
             }
             ptr += len;
         }
     }
 
-    service->m_pendingDevices[serviceName] = pending;
-
-    qDebug() << "Resolved Apple device:" << serviceName
-             << "host:" << pending.hostname << "port:" << pending.port;
-
-    // Now resolve the IP address
-    DNSServiceRef addrRef;
-    DNSServiceErrorType err = DNSServiceGetAddrInfo(
-        &addrRef, 0, interfaceIndex, kDNSServiceProtocol_IPv4, hosttarget,
-        addrInfoCallback, context);
-
-    if (err == kDNSServiceErr_NoError) {
-        // Process the address resolution synchronously
-        int fd = DNSServiceRefSockFD(addrRef);
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        FD_SET(fd, &readfds);
-        struct timeval timeout = {5, 0}; // 5 second timeout
-        if (select(fd + 1, &readfds, nullptr, nullptr, &timeout) > 0) {
-            if (FD_ISSET(fd, &readfds)) {
-                DNSServiceProcessResult(addrRef);
-            }
-        }
-        DNSServiceRefDeallocate(addrRef);
-    }
+    qDebug() << "Resolved Apple device:" << QString::fromUtf8(fullname)
+             << "host:" << res->hostname << "port:" << res->port;
 }
 
 void DNSSD_API DnssdService::addrInfoCallback(
@@ -230,82 +338,26 @@ void DNSSD_API DnssdService::addrInfoCallback(
     const struct sockaddr *address, uint32_t ttl, void *context)
 {
     Q_UNUSED(sdRef)
-    Q_UNUSED(flags)
     Q_UNUSED(interfaceIndex)
-    Q_UNUSED(ttl)
 
-    if (errorCode != kDNSServiceErr_NoError)
+    auto *res = static_cast<Resolution *>(context);
+    if (errorCode != kDNSServiceErr_NoError || !res->address.isEmpty())
         return;
-
-    DnssdService *service = static_cast<DnssdService *>(context);
-    QString hostnameStr = QString::fromUtf8(hostname);
-
-    // Find the pending device with matching hostname
-    QString deviceName;
-    for (auto it = service->m_pendingDevices.begin();
-         it != service->m_pendingDevices.end(); ++it) {
-        if (it.value().hostname == hostnameStr) {
-            deviceName = it.key();
-            break;
-        }
-    }
-
-    if (deviceName.isEmpty()) {
-        qWarning() << "Could not find pending device for hostname:"
-                   << hostnameStr;
+    if (!(flags & kDNSServiceFlagsAdd) || !address ||
+        address->sa_family != AF_INET)
         return;
-    }
-
-    PendingDevice pending = service->m_pendingDevices[deviceName];
 
     // Convert IP address
     char ip[INET_ADDRSTRLEN];
     auto *addr_in = reinterpret_cast<const struct sockaddr_in *>(address);
     inet_ntop(AF_INET, &addr_in->sin_addr, ip, sizeof(ip));
-
-    NetworkDevice device;
-    // Extract a better device name from hostname or use TXT records
-    QString friendlyName = pending.hostname;
-    if (friendlyName.endsWith(".local.")) {
-        friendlyName =
-            friendlyName.left(friendlyName.length() - 7); // Remove ".local."
-        qDebug() << "friendly name:" << friendlyName;
-    }
-
-    // Try to get device name from TXT records first
-    if (pending.txt.contains("DvNm")) {
-        device.name = pending.txt["DvNm"];
-        qDebug() << "Device name from DvNm TXT record:" << device.name;
-    } else if (pending.txt.contains("Name")) {
-        device.name = pending.txt["Name"];
-        qDebug() << "Device name from Name TXT record:" << device.name;
-    } else {
-        // Use the cleaned hostname as fallback
-        qDebug() << "Using hostname as device name:" << friendlyName;
-        device.name = friendlyName;
-    }
-
-    device.hostname = pending.hostname;
-    device.address = QString::fromUtf8(ip);
-    device.port = pending.port > 0 ? pending.port : 22; // Default to SSH port
-
-    qDebug() << "Resolved IP for Apple device:" << device.name << "at"
-             << device.address << ":" << device.port;
-
-    // Add to our list if not already present
-    {
-        QMutexLocker locker(&service->m_devicesMutex);
-        bool exists = std::any_of(service->m_networkDevices.begin(),
-                                  service->m_networkDevices.end(),
-                                  [&device](const NetworkDevice &existing) {
-                                      return existing == device;
-                                  });
-        if (!exists) {
-            service->m_networkDevices.append(device);
-            emit service->deviceAdded(device);
-        }
-    }
-
-    // Remove from pending
-    service->m_pendingDevices.remove(deviceName);
-}
\ No newline at end of file
+    res->address = QString::fromUtf8(ip);
+
+    Q_UNUSED(hostname)
+    auto &cache = res->service->m_addressCache;
+    cache.removeIf([](QHash<QString, CachedAddress>::iterator it) {
+        return it->expiry.hasExpired();
+    });
+    cache.insert(res->hostname,
+                 {res->address, QDeadlineTimer(qint64(ttl) * 1000)});
+}
@@ -21,14 +21,14 @@
 #define DNSSD_SERVICE_H
 
 #include "../../../iDescriptor.h"
+#include <QDeadlineTimer>
+#include <QHash>
 #include <QList>
 #include <QMap>
-#include <QMutex>
 #include <QObject>
 #include <QSocketNotifier>
 #include <QString>
-#include <map>
-#include <string>
+#include <QTimer>
 
 #ifdef WIN32
 #include "dns_sd.h"
@@ -46,6 +46,7 @@ public:
 
     void startBrowsing();
     void stopBrowsing();
+    // Must be called from the thread that owns the service
     QList<NetworkDevice> getNetworkDevices() const;
 
 signals:
@@ -56,7 +57,41 @@ private slots:
     void processDnssdEvents();
 
 private:
+    // One in-flight resolve and address lookup for a browsed service
+    struct Resolution {
+        DnssdService *service = nullptr;
+        QString serviceName;
+        uint32_t interfaceIndex = 0;
+        DNSServiceRef resolveRef = nullptr;
+        QSocketNotifier *resolveNotifier = nullptr;
+        DNSServiceRef addrRef = nullptr;
+        QSocketNotifier *addrNotifier = nullptr;
+        QTimer *timeout = nullptr;
+
+        bool resolved = false;
+        QString hostname;
+        uint16_t port = 0;
+        QMap<QString, QString> txt;
+        QString address;
+    };
+
+    struct CachedAddress {
+        QString address;
+        QDeadlineTimer expiry;
+    };
+
+    // Upper bound for resolving a single service, address lookup included
+    static constexpr int ResolveTimeoutMs = 5000;
+
     void cleanupDnssd();
+    void startResolution(const char *serviceName, const char *regtype,
+                         const char *replyDomain, uint32_t interfaceIndex);
+    QSocketNotifier *watchQuery(Resolution *res, DNSServiceRef ref);
+    void processQuery(Resolution *res, DNSServiceRef ref);
+    void lookupAddress(Resolution *res);
+    void completeResolution(Resolution *res);
+    void finishResolution(Resolution *res);
+    static void stopQuery(DNSServiceRef &ref, QSocketNotifier *&notifier);
 
     static void DNSSD_API browseCallback(
         DNSServiceRef sdRef, DNSServiceFlags flags, uint32_t interfaceIndex,
@@ -76,20 +111,13 @@ private:
 
     DNSServiceRef m_browseRef;
     QSocketNotifier *m_socketNotifier;
-
-    mutable QMutex m_devicesMutex;
-    QList<NetworkDevice> m_networkDevices;
     bool m_running;
 
-    // Temporary storage for devices being resolved
-    struct PendingDevice {
-        QString name;
-        QString hostname;
-        uint16_t port;
-        uint32_t interfaceIndex;
-        QMap<QString, QString> txt;
-    };
-    QMap<QString, PendingDevice> m_pendingDevices;
+    // Keyed by browsed service name
+    QHash<QString, NetworkDevice> m_devices;
+    QHash<QString, Resolution *> m_resolutions;
+    // Keyed by host name, expires with the record TTL
+    QHash<QString, CachedAddress> m_addressCache;
 };
 
 #endif // DNSSD_SERVICE_H
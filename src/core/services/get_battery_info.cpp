@@ -43,9 +43,10 @@ void get_battery_info(std::string productType, idevice_t idevice,
 
             qDebug()
                 << "Failed to query diagnostics relay for AppleARMPMUCharger.";
-            if (diagnostics_client)
-                diagnostics_relay_client_free(diagnostics_client);
         }
+        // One-shot query, periodic sampling lives in DeviceTelemetry
+        diagnostics_relay_goodbye(diagnostics_client);
+        diagnostics_relay_client_free(diagnostics_client);
     } catch (const std::exception &e) {
         if (diagnostics_client)
             diagnostics_relay_client_free(diagnostics_client);
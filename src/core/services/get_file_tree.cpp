@@ -18,6 +18,7 @@
  */
 
 #include "../../iDescriptor.h"
+#include "../../loggingcategories.h"
 #include <QDebug>
 #include <iostream>
 #include <libimobiledevice/afc.h>
@@ -51,8 +52,8 @@ AFCFileTree get_file_tree(afc_client_t afcClient, const std::string &path)
                 AFC_E_SUCCESS &&
             info) {
             if (entryName == "var") {
-                qDebug() << "File info for var:" << info[0] << info[1]
-                         << info[2] << info[3] << info[4] << info[5];
+                qCDebug(lcAfc) << "File info for var:" << info[0] << info[1]
+                               << info[2] << info[3] << info[4] << info[5];
             }
             for (int j = 0; info[j]; j += 2) {
                 if (strcmp(info[j], "st_ifmt") == 0) {
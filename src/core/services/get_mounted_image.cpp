@@ -18,6 +18,7 @@
  */
 
 #include "../../iDescriptor.h"
+#include "../../servicebroker.h"
 #include <stdlib.h>
 #define _GNU_SOURCE 1
 #define __USE_GNU 1
@@ -48,71 +49,23 @@
 #include <printf.h>
 #endif
 
-plist_t _get_mounted_image(const char *udid)
+plist_t _get_mounted_image(idevice_t device)
 {
-    mobile_image_mounter_client_t mim = NULL;
-    lockdownd_client_t lckd = NULL;
-    lockdownd_error_t ldret = LOCKDOWN_E_UNKNOWN_ERROR;
-    afc_client_t afc = NULL;
-    lockdownd_service_descriptor_t service = NULL;
-    idevice_t device = NULL;
-
-    mobile_image_mounter_error_t err = MOBILE_IMAGE_MOUNTER_E_UNKNOWN_ERROR;
     plist_t result = NULL;
-    size_t sig_length = 0;
     const char *imagetype = "Developer";
 
-    if (IDEVICE_E_SUCCESS != idevice_new_with_options(&device, udid,
-
-                                                      IDEVICE_LOOKUP_USBMUX)) {
-        qDebug() << "ERROR: Could not create idevice!";
-        goto leave;
-    }
-
-    if (LOCKDOWN_E_SUCCESS != (ldret = lockdownd_client_new_with_handshake(
-                                   device, &lckd, TOOL_NAME))) {
-        qDebug() << "ERROR: Could not connect to lockdownd service!";
-        goto leave;
-    }
-
-    lockdownd_start_service(lckd, "com.apple.mobile.mobile_image_mounter",
-                            &service);
-
-    if (!service || service->port == 0) {
-        printf("ERROR: Could not start mobile_image_mounter service!\n");
-        goto leave;
-    }
-
-    if (mobile_image_mounter_new(device, service, &mim) !=
-        MOBILE_IMAGE_MOUNTER_E_SUCCESS) {
-        printf("ERROR: Could not connect to mobile_image_mounter!\n");
-        goto leave;
-    }
-
-    if (!service || service->port == 0) {
-        qDebug() << "ERROR: Could not start mobile_image_mounter service!";
-        goto leave;
+    ServiceLease<mobile_image_mounter_client_t> mim(device);
+    if (!mim) {
+        qDebug() << "ERROR: Could not connect to mobile_image_mounter!";
+        return NULL;
     }
 
     // will sometimes return MOBILE_IMAGE_MOUNTER_E_SUCCESS even if the device
     // is locked - mostly on older devices
-    err = mobile_image_mounter_lookup_image(mim, imagetype, &result);
-
-leave:
-    if (mim) {
-        mobile_image_mounter_free(mim);
-    }
-    if (afc) {
-        afc_client_free(afc);
-    }
-    if (lckd) {
-        lockdownd_client_free(lckd);
-    }
-    if (device) {
-        idevice_free(device);
+    if (mobile_image_mounter_lookup_image(mim.get(), imagetype, &result) !=
+        MOBILE_IMAGE_MOUNTER_E_SUCCESS) {
+        mim.invalidate();
     }
 
     return result;
 }
-
-// int main(){return 0;}
\ No newline at end of file
@@ -19,7 +19,10 @@
 
 #include "../../devicedatabase.h"
 #include "../../iDescriptor.h"
+#include "../../loggingcategories.h"
+#include "../../servicebroker.h"
 #include "../../servicemanager.h"
+#include "../../tracer.h"
 #ifdef ENABLE_RECOVERY_DEVICE_SUPPORT
 #include "libirecovery.h"
 #endif
@@ -97,8 +100,8 @@ void parseOldDevice(PlistNavigator &ioreg, DeviceInfo &d)
 
     uint64_t maxCapacity = ioreg["MaxCapacity"].getUInt();
 
-    qDebug() << "Design capacity: " << designCapacity;
-    qDebug() << "Max capacity: " << maxCapacity;
+    qCDebug(lcDeviceInit) << "Design capacity: " << designCapacity;
+    qCDebug(lcDeviceInit) << "Max capacity: " << maxCapacity;
 
     // Compat
     int healthPercent =
@@ -120,8 +123,8 @@ void parseDeviceBattery(PlistNavigator &ioreg, DeviceInfo &d)
 
     d.batteryInfo.fullyCharged = ioreg["FullyCharged"].getBool();
 
-    qDebug() << "Stalebatteryinfo:"
-             << ioreg["BatteryData"]["StateOfCharge"].getUInt();
+    qCDebug(lcDeviceInit) << "Stalebatteryinfo:"
+                          << ioreg["BatteryData"]["StateOfCharge"].getUInt();
     /* data is stale here so we need to calculate */
     // d.batteryInfo.currentBatteryLevel =
     //     ioreg["BatteryData"]["StateOfCharge"].getUInt();
@@ -234,10 +237,10 @@ DeviceInfo fullDeviceInfo(const pugi::xml_document &doc,
             }
             afc_dictionary_free(info);
         } catch (const std::exception &e) {
-            qDebug() << "Error parsing disk info: " << e.what();
+            qCDebug(lcDeviceInit) << "Error parsing disk info: " << e.what();
         }
     } catch (const std::exception &e) {
-        qDebug() << e.what();
+        qCDebug(lcDeviceInit) << e.what();
         /*It's ok if any of those fails*/
     }
 
@@ -284,7 +287,7 @@ DeviceInfo fullDeviceInfo(const pugi::xml_document &doc,
     get_battery_info(rawProductType, result.device, d.is_iPhone, diagnostics);
 
     if (!diagnostics) {
-        qDebug() << "Failed to get diagnostics plist.";
+        qCDebug(lcDeviceInit) << "Failed to get diagnostics plist.";
         return d;
     }
     try {
@@ -317,8 +320,8 @@ DeviceInfo fullDeviceInfo(const pugi::xml_document &doc,
                               : ioreg["BatteryData"]["MaxCapacity"].getUInt()
                         : ioreg["BatteryData"]["MaxCapacity"].getUInt();
 
-        qDebug() << "Design capacity: " << designCapacity;
-        qDebug() << "Max capacity: " << maxCapacity;
+        qCDebug(lcDeviceInit) << "Design capacity: " << designCapacity;
+        qCDebug(lcDeviceInit) << "Max capacity: " << maxCapacity;
 
         // seems to be to the most accurate way to get health
         d.batteryInfo.health =
@@ -335,70 +338,89 @@ DeviceInfo fullDeviceInfo(const pugi::xml_document &doc,
 
         return d;
     } catch (const std::exception &e) {
-        qDebug() << "Error occurred: " << e.what();
+        qCDebug(lcDeviceInit) << "Error occurred: " << e.what();
         return d;
     }
 }
 
 iDescriptorInitDeviceResult init_idescriptor_device(const char *udid)
 {
-    qDebug() << "Initializing iDescriptor device with UDID: "
-             << QString::fromUtf8(udid);
+    qCDebug(lcDeviceInit) << "Initializing iDescriptor device with UDID: "
+                          << QString::fromUtf8(udid);
     iDescriptorInitDeviceResult result = {};
+    TraceSpan initSpan("device-init", "init_idescriptor_device", udid);
 
     // 1. Initialize all resource handles to nullptr
     idevice_t device = nullptr;
-    lockdownd_client_t client = nullptr;
+    ServiceBroker *broker = ServiceBroker::sharedInstance();
     lockdownd_service_descriptor_t lockdownService = nullptr;
     afc_client_t afcClient = nullptr;
     afc_client_t afc2Client = nullptr;
     pugi::xml_document infoXml;
 
-    idevice_error_t ret =
-        idevice_new_with_options(&device, udid, IDEVICE_LOOKUP_USBMUX);
+    // Each stage is its own block so the trace spans don't cross the gotos
+    idevice_error_t ret;
+    {
+        TraceSpan span("device-init", "idevice_new", udid);
+        ret = idevice_new_with_options(&device, udid, IDEVICE_LOOKUP_USBMUX);
+    }
 
     if (ret != IDEVICE_E_SUCCESS) {
-        qDebug() << "Failed to connect to device: " << ret;
+        qCDebug(lcDeviceInit) << "Failed to connect to device: " << ret;
         // result.error is not set here as idevice_error_t is different
         goto cleanup;
     }
+    broker->registerDevice(device);
 
+    // The session opened here stays with the broker for later services
     lockdownd_error_t ldret;
-    if (LOCKDOWN_E_SUCCESS != (ldret = lockdownd_client_new_with_handshake(
-                                   device, &client, APP_LABEL))) {
-        result.error = ldret;
-        qDebug() << "Failed to create lockdown client: " << ldret;
-        goto cleanup;
+    {
+        TraceSpan span("device-init", "start_service", udid);
+        span.setDetail("com.apple.afc");
+        ldret = broker->startService(device, "com.apple.afc", &lockdownService);
     }
-
-    if (LOCKDOWN_E_SUCCESS !=
-        (ldret = lockdownd_start_service(client, "com.apple.afc",
-                                         &lockdownService))) {
+    if (LOCKDOWN_E_SUCCESS != ldret) {
         result.error = ldret;
-        qDebug() << "Failed to start AFC service: " << ldret;
+        qCDebug(lcDeviceInit) << "Failed to start AFC service: " << ldret;
         goto cleanup;
     }
 
-    if (afc_client_new(device, lockdownService, &afcClient) != AFC_E_SUCCESS) {
-        qDebug() << "Failed to create AFC client.";
+    afc_error_t afc_err;
+    {
+        TraceSpan span("device-init", "afc_client_new", udid);
+        afc_err = afc_client_new(device, lockdownService, &afcClient);
+    }
+    if (afc_err != AFC_E_SUCCESS) {
+        qCDebug(lcDeviceInit) << "Failed to create AFC client.";
 
         goto cleanup;
     }
 
     // AFC2 is optional, so we don't goto cleanup on failure
     afc_error_t afc2_err;
-    if ((afc2_err = afc2_client_new(device, &afc2Client)) != AFC_E_SUCCESS) {
-        qDebug() << "AFC2 client not available. Error:" << afc2_err;
+    {
+        TraceSpan span("device-init", "afc2_client_new", udid);
+        afc2_err = afc2_client_new(device, &afc2Client);
+    }
+    if (afc2_err != AFC_E_SUCCESS) {
+        qCDebug(lcDeviceInit) << "AFC2 client not available. Error:"
+                              << afc2_err;
         afc2Client = nullptr;
     } else {
-        qDebug() << "AFC2 client created successfully.";
+        qCDebug(lcDeviceInit) << "AFC2 client created successfully.";
     }
 
-    get_device_info_xml(udid, client, device, infoXml);
+    {
+        TraceSpan span("device-init", "get_device_info", udid);
+        broker->withLockdown(device, [&](lockdownd_client_t client) {
+            get_device_info_xml(udid, client, device, infoXml);
+            return LOCKDOWN_E_SUCCESS;
+        });
+    }
 
     if (infoXml.empty()) {
-        qDebug() << "Failed to retrieve device info XML for UDID: "
-                 << QString::fromUtf8(udid);
+        qCDebug(lcDeviceInit) << "Failed to retrieve device info XML for UDID: "
+                              << QString::fromUtf8(udid);
         goto cleanup;
     }
 
@@ -407,15 +429,15 @@ iDescriptorInitDeviceResult init_idescriptor_device(const char *udid)
     result.device = device;
     result.afcClient = afcClient;
     result.afc2Client = afc2Client;
-    fullDeviceInfo(infoXml, afcClient, result);
+    {
+        TraceSpan span("device-init", "parse_device_info", udid);
+        fullDeviceInfo(infoXml, afcClient, result);
+    }
 
 cleanup:
     if (lockdownService) {
         lockdownd_service_descriptor_free(lockdownService);
     }
-    if (client) {
-        lockdownd_client_free(client);
-    }
 
     // free on error
     if (!result.success) {
@@ -426,6 +448,7 @@ cleanup:
             afc_client_free(afcClient);
         }
         if (device) {
+            broker->forgetDevice(device);
             idevice_free(device);
         }
     }
@@ -436,7 +459,8 @@ cleanup:
 iDescriptorInitDeviceResultRecovery
 init_idescriptor_recovery_device(uint64_t ecid)
 {
-    qDebug() << "Initializing iDescriptor recovery device with ECID: " << ecid;
+    qCDebug(lcDeviceInit)
+        << "Initializing iDescriptor recovery device with ECID: " << ecid;
     iDescriptorInitDeviceResultRecovery result = {};
 
     irecv_client_t client = nullptr;
@@ -448,35 +472,42 @@ init_idescriptor_recovery_device(uint64_t ecid)
         &client, ecid, RECOVERY_CLIENT_CONNECTION_TRIES);
 
     if (ret != IRECV_E_SUCCESS) {
-        qDebug() << "Failed to open recovery client with ECID:" << ecid
-                 << "Error:" << ret;
+        qCDebug(lcDeviceInit) << "Failed to open recovery client with ECID:"
+                              << ecid << "Error:" << ret;
         result.error = ret;
         goto cleanup;
     }
 
     ret = irecv_get_mode(client, (int *)&result.mode);
     if (ret != IRECV_E_SUCCESS) {
-        qDebug() << "Failed to get recovery mode. Error:" << ret;
+        qCDebug(lcDeviceInit) << "Failed to get recovery mode. Error:" << ret;
         result.error = ret;
         goto cleanup;
     }
 
     deviceInfo = irecv_get_device_info(client);
     if (!deviceInfo) {
-        qDebug() << "Failed to get device info from recovery client";
+        qCDebug(lcDeviceInit)
+            << "Failed to get device info from recovery client";
         result.error = IRECV_E_UNKNOWN_ERROR;
         goto cleanup;
     }
 
-    if (irecv_devices_get_device_by_client(client, &device) ==
-            IRECV_E_SUCCESS &&
-        device && device->hardware_model) {
-        qDebug() << "Recovery device hardware_model: "
-                 << device->hardware_model;
+    info = DeviceDatabase::findByChipAndBoard(deviceInfo->cpid,
+                                              deviceInfo->bdid);
+    if (info) {
+        qCDebug(lcDeviceInit) << "Recovery device resolved from CPID/BDID: "
+                              << info->modelIdentifier;
+    } else if (irecv_devices_get_device_by_client(client, &device) ==
+                   IRECV_E_SUCCESS &&
+               device && device->hardware_model) {
+        qCDebug(lcDeviceInit) << "Recovery device hardware_model: "
+                              << device->hardware_model;
         info =
             DeviceDatabase::findByHwModel(std::string(device->hardware_model));
     } else {
-        qDebug() << "Could not resolve hardware_model from client.";
+        qCDebug(lcDeviceInit)
+            << "Could not resolve hardware_model from client.";
     }
 
     result.displayName =
@@ -47,6 +47,8 @@
 #include <libimobiledevice/lockdown.h>
 #include <libimobiledevice/notification_proxy.h>
 
+#include "../../servicebroker.h"
+
 
 #include <plist/plist.h>
 
@@ -313,9 +315,7 @@ static int afc_upload_file(afc_client_t afc, const char *filename,
 instproxy_error_t install_IPA(idevice_t device, afc_client_t afc,
                               const char *filePath)
 {
-    lockdownd_client_t client = NULL;
     instproxy_client_t ipc = NULL;
-    lockdownd_service_descriptor_t service = NULL;
     instproxy_error_t err = INSTPROXY_E_UNKNOWN_ERROR;
     char *bundleidentifier = NULL;
     struct install_status_data status_data = {0, 0, NULL};
@@ -342,34 +342,10 @@ instproxy_error_t install_IPA(idevice_t device, afc_client_t afc,
         return INSTPROXY_E_INVALID_ARG;
     }
 
-    lockdownd_error_t lerr = lockdownd_client_new_with_handshake(
-        device, &client, "ideviceinstaller");
-    if (lerr != LOCKDOWN_E_SUCCESS) {
-        fprintf(stderr, "Could not connect to lockdownd: %s. Exiting.\n",
-                lockdownd_strerror(lerr));
-        return INSTPROXY_E_OP_FAILED;
-    }
-
-    lerr = lockdownd_start_service(
-        client, "com.apple.mobile.installation_proxy", &service);
-    if (lerr != LOCKDOWN_E_SUCCESS) {
-        fprintf(stderr,
-                "Could not start com.apple.mobile.installation_proxy: %s\n",
-                lockdownd_strerror(lerr));
-        lockdownd_client_free(client);
-        return INSTPROXY_E_OP_FAILED;
-    }
-
-    err = instproxy_client_new(device, service, &ipc);
-    if (service) {
-        lockdownd_service_descriptor_free(service);
-        service = NULL;
-    }
-
-    if (err != INSTPROXY_E_SUCCESS) {
+    ipc = ServiceBroker::sharedInstance()->acquire<instproxy_client_t>(device);
+    if (!ipc) {
         fprintf(stderr, "Could not connect to installation_proxy!\n");
-        lockdownd_client_free(client);
-        return err;
+        return INSTPROXY_E_OP_FAILED;
     }
 
     setbuf(stdout, NULL);
@@ -545,8 +521,9 @@ zip_cleanup:
     }
 
 leave_cleanup:
-    instproxy_client_free(ipc);
-    lockdownd_client_free(client);
+    /* the status thread of an install may still be winding down, so the
+     * client is not handed out again */
+    ServiceBroker::sharedInstance()->release(device, ipc, false);
     free(bundleidentifier);
     free(status_data.last_status);
 
@@ -18,44 +18,122 @@
  */
 
 #include "../../iDescriptor.h"
+#include "../../imagedecoder.h"
+#include "../../loggingcategories.h"
 #include <QByteArray>
 #include <QDebug>
 #include <QImage>
-#include <QPixmap>
+#include <QThread>
 #include <libheif/heif.h>
+#include <optional>
+#include <vector>
 
-QPixmap load_heic(const QByteArray &imageData)
+/*
+ * Pick the smallest embedded thumbnail that still covers the requested size.
+ * iPhone HEICs carry one, which saves decoding the whole 12-48 MP grid just
+ * to throw most of it away.
+ */
+static heif_image_handle *find_thumbnail(heif_image_handle *primary,
+                                         const QSize &fitted)
+{
+    const int count = heif_image_handle_get_number_of_thumbnails(primary);
+    if (count <= 0) {
+        return nullptr;
+    }
+
+    std::vector<heif_item_id> ids(count);
+    heif_image_handle_get_list_of_thumbnail_IDs(primary, ids.data(), count);
+
+    const int needed = qMax(fitted.width(), fitted.height());
+    heif_image_handle *best = nullptr;
+    int bestSide = 0;
+    for (heif_item_id id : ids) {
+        heif_image_handle *candidate = nullptr;
+        heif_error err =
+            heif_image_handle_get_thumbnail(primary, id, &candidate);
+        if (err.code != heif_error_Ok) {
+            continue;
+        }
+
+        const int side = qMax(heif_image_handle_get_width(candidate),
+                              heif_image_handle_get_height(candidate));
+        if (side >= needed && (!best || side < bestSide)) {
+            if (best) {
+                heif_image_handle_release(best);
+            }
+            best = candidate;
+            bestSide = side;
+        } else {
+            heif_image_handle_release(candidate);
+        }
+    }
+    return best;
+}
+
+/*
+ * Safe to call from worker threads, never touches QPixmap. With a valid
+ * targetSize the result fits inside it, otherwise it's full resolution.
+ */
+QImage load_heic(const QByteArray &imageData, const QSize &targetSize)
 {
     heif_context *ctx = heif_context_alloc();
     if (!ctx) {
-        qWarning() << "Failed to allocate heif_context";
-        return QPixmap();
+        qCWarning(lcGallery) << "Failed to allocate heif_context";
+        return QImage();
     }
 
-    heif_error err = heif_context_read_from_memory(ctx, imageData.constData(),
-                                                   imageData.size(), nullptr);
+    heif_error err = heif_context_read_from_memory_without_copy(
+        ctx, imageData.constData(), imageData.size(), nullptr);
     if (err.code != heif_error_Ok) {
-        qWarning() << "Failed to read HEIC from memory:" << err.message;
+        qCWarning(lcGallery) << "Failed to read HEIC from memory:"
+                             << err.message;
         heif_context_free(ctx);
-        return QPixmap();
+        return QImage();
     }
 
+#if LIBHEIF_HAVE_VERSION(1, 13, 0)
+    // Thumbnails already run in parallel on the pool, only let full size
+    // decodes fan out over the grid tiles
+    heif_context_set_max_decoding_threads(
+        ctx, targetSize.isValid() ? 1 : QThread::idealThreadCount());
+#endif
+
     heif_image_handle *handle;
     err = heif_context_get_primary_image_handle(ctx, &handle);
     if (err.code != heif_error_Ok) {
-        qWarning() << "Failed to get primary image handle:" << err.message;
+        qCWarning(lcGallery) << "Failed to get primary image handle:"
+                             << err.message;
         heif_context_free(ctx);
-        return QPixmap();
+        return QImage();
+    }
+
+    heif_image_handle *thumbnail = nullptr;
+    if (targetSize.isValid()) {
+        const QSize primarySize(heif_image_handle_get_width(handle),
+                                heif_image_handle_get_height(handle));
+        thumbnail = find_thumbnail(
+            handle, primarySize.scaled(targetSize, Qt::KeepAspectRatio));
+    }
+
+    // Only decodes of the primary image count against the full decode limit
+    std::optional<ImageDecoder::FullDecodeSlot> slot;
+    if (!thumbnail) {
+        slot.emplace();
     }
 
     heif_image *img;
-    err = heif_decode_image(handle, &img, heif_colorspace_RGB,
-                            heif_chroma_interleaved_RGB, nullptr);
+    err = heif_decode_image(thumbnail ? thumbnail : handle, &img,
+                            heif_colorspace_RGB, heif_chroma_interleaved_RGB,
+                            nullptr);
+    if (thumbnail) {
+        heif_image_handle_release(thumbnail);
+    }
+    heif_image_handle_release(handle);
+
     if (err.code != heif_error_Ok) {
-        qWarning() << "Failed to decode HEIC image:" << err.message;
-        heif_image_handle_release(handle);
+        qCWarning(lcGallery) << "Failed to decode HEIC image:" << err.message;
         heif_context_free(ctx);
-        return QPixmap();
+        return QImage();
     }
 
     int width = heif_image_get_width(img, heif_channel_interleaved);
@@ -69,19 +147,24 @@ QPixmap load_heic(const QByteArray &imageData)
         heif_image_get_plane_readonly(img, heif_channel_interleaved, &stride);
 
     if (!data) {
-        qWarning() << "Failed to get image plane data";
+        qCWarning(lcGallery) << "Failed to get image plane data";
         heif_image_release(img);
-        heif_image_handle_release(handle);
         heif_context_free(ctx);
-        return QPixmap();
+        return QImage();
     }
 
-    QImage qimg(data, width, height, stride, QImage::Format_RGB888);
-    QPixmap result = QPixmap::fromImage(qimg);
+    // The QImage takes ownership of the decoded plane, no copy is made
+    QImage result(
+        data, width, height, stride, QImage::Format_RGB888,
+        [](void *info) { heif_image_release(static_cast<heif_image *>(info)); },
+        img);
 
-    heif_image_release(img);
-    heif_image_handle_release(handle);
     heif_context_free(ctx);
 
+    if (targetSize.isValid() && (result.width() > targetSize.width() ||
+                                 result.height() > targetSize.height())) {
+        return result.scaled(targetSize, Qt::KeepAspectRatio,
+                             Qt::SmoothTransformation);
+    }
     return result;
 }
@@ -21,6 +21,7 @@
 
 #define _GNU_SOURCE 1
 #include "../../iDescriptor.h"
+#include "../../servicebroker.h"
 #include <stdlib.h>
 #define __USE_GNU 1
 #include <errno.h>
@@ -59,26 +60,65 @@ static const char *imagetype = NULL;
 static const char PKG_PATH[] = "PublicStaging";
 static const char PATH_PREFIX[] = "/private/var/mobile/Media";
 
+// stdio's default buffer is a few KB, the image is read in big blocks
+static const size_t UPLOAD_READ_AHEAD = 4 * 1024 * 1024;
+static const size_t AFC_UPLOAD_CHUNK = 1024 * 1024;
+
+typedef struct {
+    FILE *f;
+    uint64_t sent;
+    uint64_t total;
+    const std::function<bool(uint64_t, uint64_t)> *progress;
+} upload_source_t;
+
+static FILE *open_image(const char *path, char **read_ahead)
+{
+    FILE *f = fopen(path, "rb");
+    if (f && !*read_ahead) {
+        *read_ahead = (char *)malloc(UPLOAD_READ_AHEAD);
+    }
+    if (f && *read_ahead) {
+        setvbuf(f, *read_ahead, _IOFBF, UPLOAD_READ_AHEAD);
+    }
+    return f;
+}
+
+// A short read makes the mounter give up, which is how cancel works
+static bool upload_progress(upload_source_t *source, size_t amount)
+{
+    source->sent += amount;
+    return !*source->progress || (*source->progress)(source->sent,
+                                                     source->total);
+}
+
 static ssize_t mim_upload_cb(void *buf, size_t size, void *userdata)
 {
-    return fread(buf, 1, size, (FILE *)userdata);
+    upload_source_t *source = (upload_source_t *)userdata;
+    size_t amount = fread(buf, 1, size, source->f);
+    if (!upload_progress(source, amount)) {
+        return -1;
+    }
+    return amount;
 }
 // extend the mobile_image_mounter_error_t type and return sucess if there is
 // already a disk image
-mobile_image_mounter_error_t mount_dev_image(idevice_t device,
-                                             unsigned int device_version,
-                                             const char *image_dir_path)
+mobile_image_mounter_error_t
+mount_dev_image(idevice_t device, unsigned int device_version,
+                const char *image_dir_path,
+                const std::function<bool(uint64_t, uint64_t)> &progress)
 {
     mobile_image_mounter_client_t mim = NULL;
     int res = -1;
     size_t image_size = 0;
-    lockdownd_client_t lckd = NULL;
+    ServiceBroker *broker = ServiceBroker::sharedInstance();
     lockdownd_error_t ldret = LOCKDOWN_E_UNKNOWN_ERROR;
     afc_client_t afc = NULL;
     lockdownd_service_descriptor_t service = NULL;
     char *image_path = NULL;
     char *image_sig_path = NULL;
     FILE *f = NULL;
+    char *read_ahead = NULL;
+    upload_source_t upload = {NULL, 0, 0, &progress};
     unsigned char *sig = NULL;
     plist_t mount_options = NULL;
     char *targetname = NULL;
@@ -90,20 +130,13 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
     plist_t result = NULL;
     size_t sig_length = 0;
 
-    if (LOCKDOWN_E_SUCCESS != (ldret = lockdownd_client_new_with_handshake(
-                                   device, &lckd, TOOL_NAME))) {
-        qDebug() << "ERROR: Could not connect to lockdownd service!";
-        res = -1;
-        goto leave;
-    }
-
     if (device_version >= IDEVICE_DEVICE_VERSION(7, 0, 0)) {
         disk_image_upload_type = DISK_IMAGE_UPLOAD_TYPE_UPLOAD_IMAGE;
     }
 
     if (disk_image_upload_type == DISK_IMAGE_UPLOAD_TYPE_AFC) {
         lockdownd_error_t lerr =
-            lockdownd_start_service(lckd, "com.apple.afc", &service);
+            broker->startService(device, "com.apple.afc", &service);
         if (lerr != LOCKDOWN_E_SUCCESS) {
             qDebug() << "ERROR: Could not start AFC service!"
                      << lockdownd_strerror(lerr) << "(" << lerr << ")";
@@ -142,8 +175,10 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
     if (device_version >= IDEVICE_DEVICE_VERSION(16, 0, 0)) {
         uint8_t dev_mode_status = 0;
         plist_t val = NULL;
-        ldret = lockdownd_get_value(lckd, "com.apple.security.mac.amfi",
-                                    "DeveloperModeStatus", &val);
+        ldret = broker->withLockdown(device, [&](lockdownd_client_t lckd) {
+            return lockdownd_get_value(lckd, "com.apple.security.mac.amfi",
+                                       "DeveloperModeStatus", &val);
+        });
         if (ldret == LOCKDOWN_E_SUCCESS) {
             plist_get_bool_val(val, &dev_mode_status);
             plist_free(val);
@@ -157,23 +192,12 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
         }
     }
 
-    lockdownd_start_service(lckd, "com.apple.mobile.mobile_image_mounter",
-                            &service);
-
-    if (!service || service->port == 0) {
-        qDebug() << "ERROR: Could not start mobile_image_mounter service!";
-        res = -1;
-        goto leave;
-    }
-
-    if (mobile_image_mounter_new(device, service, &mim) !=
-        MOBILE_IMAGE_MOUNTER_E_SUCCESS) {
+    mim = broker->acquire<mobile_image_mounter_client_t>(device);
+    if (!mim) {
         qDebug() << "ERROR: Could not connect to mobile_image_mounter!";
         res = -1;
         goto leave;
     }
-    lockdownd_service_descriptor_free(service);
-    service = NULL;
 
     struct stat fst;
     if (stat(image_path, &fst) != 0) {
@@ -212,7 +236,7 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
             goto leave;
         }
 
-        f = fopen(image_path, "rb");
+        f = open_image(image_path, &read_ahead);
         if (!f) {
             qDebug() << "Error opening image file" << image_path << ":"
                      << strerror(errno);
@@ -318,7 +342,7 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
             image_path, plist_get_string_ptr(p_dmg_path, NULL), NULL);
         free(image_path);
         image_path = dmg_path;
-        f = fopen(image_path, "rb");
+        f = open_image(image_path, &read_ahead);
         if (!f) {
             qDebug() << "Error opening image file" << image_path << ":"
                      << strerror(errno);
@@ -351,10 +375,9 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
             qDebug() << "Using existing personalization manifest from device.";
         } else {
             /* we need to re-connect in this case */
-            mobile_image_mounter_free(mim);
-            mim = NULL;
-            if (mobile_image_mounter_start_service(device, &mim, TOOL_NAME) !=
-                MOBILE_IMAGE_MOUNTER_E_SUCCESS) {
+            broker->release(device, mim, false);
+            mim = broker->acquireFresh<mobile_image_mounter_client_t>(device);
+            if (!mim) {
                 res = -1;
                 goto leave;
             }
@@ -401,7 +424,8 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
                 res = -1;
                 goto leave;
             }
-            mobile_image_mounter_free(mim);
+            /* TSS can take a while, don't keep the mounter waiting */
+            broker->release(device, mim, false);
             mim = NULL;
 
             plist_dict_set_item(
@@ -453,11 +477,24 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
         imagetype = "Developer";
     }
 
+    if (!mim) {
+        // Dropped for TSS, reconnect rather than reuse a pooled mounter
+        mim = broker->acquireFresh<mobile_image_mounter_client_t>(device);
+        if (!mim) {
+            qDebug() << "ERROR: Could not connect to mobile_image_mounter!";
+            res = -1;
+            goto leave;
+        }
+    }
+
     switch (disk_image_upload_type) {
     case DISK_IMAGE_UPLOAD_TYPE_UPLOAD_IMAGE:
         qDebug() << "Uploading" << image_path;
+        upload.f = f;
+        upload.total = image_size;
         err = mobile_image_mounter_upload_image(mim, imagetype, image_size, sig,
-                                                sig_length, mim_upload_cb, f);
+                                                sig_length, mim_upload_cb,
+                                                &upload);
         break;
     case DISK_IMAGE_UPLOAD_TYPE_AFC:
     default:
@@ -481,15 +518,18 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
             goto leave;
         }
 
-        char buf[8192];
+        std::vector<char> buf(AFC_UPLOAD_CHUNK);
         size_t amount = 0;
+        upload.f = f;
+        upload.total = image_size;
         do {
-            amount = fread(buf, 1, sizeof(buf), f);
+            amount = fread(buf.data(), 1, buf.size(), f);
             if (amount > 0) {
                 uint32_t written, total = 0;
                 while (total < amount) {
                     written = 0;
-                    if (afc_file_write(afc, af, buf + total, amount - total,
+                    if (afc_file_write(afc, af, buf.data() + total,
+                                       amount - total,
                                        &written) != AFC_E_SUCCESS) {
                         qDebug() << "AFC Write error!";
                         break;
@@ -503,6 +543,12 @@ mobile_image_mounter_error_t mount_dev_image(idevice_t device,
                     res = -1;
                     goto leave;
                 }
+                if (!upload_progress(&upload, amount)) {
+                    qDebug() << "Upload cancelled";
+                    afc_file_close(afc, af);
+                    res = -1;
+                    goto leave;
+                }
             }
         } while (amount > 0);
 
@@ -579,18 +625,19 @@ leave:
     if (f) {
         fclose(f);
     }
+    free(read_ahead);
     if (result) {
         plist_free(result);
     }
     if (mim) {
-        mobile_image_mounter_free(mim);
+        broker->release(device, mim, err == MOBILE_IMAGE_MOUNTER_E_SUCCESS);
+    }
+    if (service) {
+        lockdownd_service_descriptor_free(service);
     }
     if (afc) {
         afc_client_free(afc);
     }
-    if (lckd) {
-        lockdownd_client_free(lckd);
-    }
     if (image_path) {
         free(image_path);
     }
@@ -21,50 +21,112 @@
 #include "libimobiledevice/diagnostics_relay.h"
 #include <QDebug>
 #include <plist/plist.h>
+#include <string.h>
 
-bool query_mobile_gestalt(iDescriptorDevice *id_device, const QStringList &keys,
-                          uint32_t &xml_size, char *&xml_data)
+static QVariant plist_scalar_to_variant(plist_t node)
 {
-    if (!id_device) {
-        qDebug() << "Invalid device";
-        return false;
+    switch (plist_get_node_type(node)) {
+    case PLIST_BOOLEAN: {
+        uint8_t value = 0;
+        plist_get_bool_val(node, &value);
+        return QVariant(value != 0);
+    }
+    case PLIST_INT: {
+        uint64_t value = 0;
+        plist_get_uint_val(node, &value);
+        return QVariant(static_cast<qulonglong>(value));
+    }
+    case PLIST_REAL: {
+        double value = 0;
+        plist_get_real_val(node, &value);
+        return QVariant(value);
+    }
+    case PLIST_STRING: {
+        char *value = nullptr;
+        plist_get_string_val(node, &value);
+        QVariant result(QString::fromUtf8(value));
+        free(value);
+        return result;
     }
+    case PLIST_DATA: {
+        char *value = nullptr;
+        uint64_t length = 0;
+        plist_get_data_val(node, &value, &length);
+        QVariant result(QString::fromLatin1(
+            QByteArray(value, static_cast<qsizetype>(length)).toBase64()));
+        free(value);
+        return result;
+    }
+    default:
+        // Arrays and dicts have no single value to show
+        return QVariant();
+    }
+}
 
-    diagnostics_relay_client_t diagnostics_client = nullptr;
-    if (diagnostics_relay_client_start_service(id_device->device,
-                                               &diagnostics_client, nullptr) !=
-        DIAGNOSTICS_RELAY_E_SUCCESS) {
-        qDebug() << "Failed to start diagnostics service";
+/*
+ * Runs one MobileGestalt query on an already open diagnostics session and
+ * walks the result dict once, so the cost is linear in the number of keys.
+ * Keys the device doesn't know about are simply absent from values.
+ */
+bool query_mobile_gestalt(diagnostics_relay_client_t client,
+                          const QStringList &keys,
+                          QHash<QString, QVariant> &values)
+{
+    if (!client) {
+        qDebug() << "Invalid diagnostics client";
         return false;
     }
 
     plist_t result = nullptr;
     plist_t keys_array = plist_new_array();
     for (const QString &key : keys) {
-        plist_t key_node = plist_new_string(key.toStdString().c_str());
+        plist_t key_node = plist_new_string(key.toUtf8().constData());
         plist_array_append_item(keys_array, key_node);
     }
 
-    diagnostics_relay_error_t err = diagnostics_relay_query_mobilegestalt(
-        diagnostics_client, keys_array, &result);
+    diagnostics_relay_error_t err =
+        diagnostics_relay_query_mobilegestalt(client, keys_array, &result);
 
     plist_free(keys_array); // Free the keys array
 
     if (err != DIAGNOSTICS_RELAY_E_SUCCESS) {
         qDebug() << "Failed to query mobile gestalt";
-        diagnostics_relay_client_free(diagnostics_client);
+        if (result)
+            plist_free(result);
         return false;
     }
 
     if (!result) {
         qDebug() << "No result from mobile gestalt query";
-        diagnostics_relay_client_free(diagnostics_client);
         return false;
     }
 
-    plist_to_xml(result, &xml_data, &xml_size);
-    plist_free(result); // Free the result plist
-    diagnostics_relay_client_free(diagnostics_client);
+    plist_t gestalt = plist_dict_get_item(result, "MobileGestalt");
+    if (!gestalt || plist_get_node_type(gestalt) != PLIST_DICT) {
+        qDebug() << "No MobileGestalt dict in query result";
+        plist_free(result);
+        return false;
+    }
+
+    values.reserve(values.size() + plist_dict_get_size(gestalt));
+    plist_dict_iter it = nullptr;
+    plist_dict_new_iter(gestalt, &it);
+    char *key = nullptr;
+    plist_t node = nullptr;
+    for (plist_dict_next_item(gestalt, it, &key, &node); node;
+         plist_dict_next_item(gestalt, it, &key, &node)) {
+        // Status is part of the reply envelope, not a gestalt key
+        if (key && strcmp(key, "Status") != 0) {
+            QVariant value = plist_scalar_to_variant(node);
+            if (value.isValid()) {
+                values.insert(QString::fromUtf8(key), value);
+            }
+        }
+        free(key);
+        key = nullptr;
+    }
+    free(it);
 
+    plist_free(result); // Free the result plist
     return true;
 }
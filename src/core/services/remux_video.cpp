@@ -0,0 +1,368 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../iDescriptor.h"
+#include "../../loggingcategories.h"
+#include "../../servicemanager.h"
+#include <QFile>
+#include <cstring>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+namespace
+{
+// AFC round trips dominate, so read the source in big blocks
+constexpr int AvioBufferSize = 1024 * 1024;
+// Generous upper bound of sample table bytes per packet (stts, ctts, stsz,
+// stss, stsc and co64 entries) plus room for everything else in moov
+constexpr int64_t MoovBytesPerPacket = 48;
+constexpr int64_t MoovBaseBytes = 256 * 1024;
+
+enum class RemuxResult { Ok, Failed, MoovTooSmall };
+
+struct AfcReader {
+    iDescriptorDevice *device;
+    std::optional<afc_client_t> altAfc;
+    uint64_t handle;
+    int64_t size;
+    int64_t pos;
+};
+
+int afcRead(void *opaque, uint8_t *buf, int bufSize)
+{
+    auto *reader = static_cast<AfcReader *>(opaque);
+    if (reader->pos >= reader->size) {
+        return AVERROR_EOF;
+    }
+
+    uint32_t bytesRead = 0;
+    const uint32_t toRead = static_cast<uint32_t>(
+        std::min<int64_t>(bufSize, reader->size - reader->pos));
+    if (ServiceManager::safeAfcFileRead(reader->device, reader->handle,
+                                        reinterpret_cast<char *>(buf), toRead,
+                                        &bytesRead, reader->altAfc) !=
+            AFC_E_SUCCESS ||
+        bytesRead == 0) {
+        return AVERROR(EIO);
+    }
+    reader->pos += bytesRead;
+    return static_cast<int>(bytesRead);
+}
+
+int64_t afcSeek(void *opaque, int64_t offset, int whence)
+{
+    auto *reader = static_cast<AfcReader *>(opaque);
+    if (whence & AVSEEK_SIZE) {
+        return reader->size;
+    }
+
+    int64_t target = offset;
+    switch (whence & ~AVSEEK_FORCE) {
+    case SEEK_SET:
+        break;
+    case SEEK_CUR:
+        target += reader->pos;
+        break;
+    case SEEK_END:
+        target += reader->size;
+        break;
+    default:
+        return -1;
+    }
+    if (target < 0 || target > reader->size) {
+        return -1;
+    }
+    if (ServiceManager::safeAfcFileSeek(reader->device, reader->handle,
+                                        target, SEEK_SET,
+                                        reader->altAfc) != AFC_E_SUCCESS) {
+        return -1;
+    }
+    reader->pos = target;
+    return target;
+}
+
+QString avError(int err)
+{
+    char message[AV_ERROR_MAX_STRING_SIZE] = {};
+    av_strerror(err, message, sizeof(message));
+    return QString::fromUtf8(message);
+}
+
+/*
+ Space reserved for moov in front of mdat, so fast-start needs no second
+ pass over the output. 0 if the demuxer didn't tell us the sample counts.
+*/
+int64_t moovReservation(const AVFormatContext *in,
+                        const std::vector<int> &streamMap)
+{
+    int64_t packets = 0;
+    for (unsigned i = 0; i < in->nb_streams; ++i) {
+        if (streamMap[i] < 0) {
+            continue;
+        }
+        if (in->streams[i]->nb_frames <= 0) {
+            return 0;
+        }
+        packets += in->streams[i]->nb_frames;
+    }
+    return MoovBaseBytes + packets * MoovBytesPerPacket;
+}
+
+// Rotation lives in stream side data, newer libavformat copies it along
+// with the codec parameters
+void copyDisplayMatrix(const AVStream *src, AVStream *dst)
+{
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(60, 15, 100)
+#if LIBAVFORMAT_VERSION_MAJOR < 59
+    int size = 0;
+#else
+    size_t size = 0;
+#endif
+    const uint8_t *matrix =
+        av_stream_get_side_data(src, AV_PKT_DATA_DISPLAYMATRIX, &size);
+    if (matrix) {
+        uint8_t *copy =
+            av_stream_new_side_data(dst, AV_PKT_DATA_DISPLAYMATRIX, size);
+        if (copy) {
+            memcpy(copy, matrix, size);
+        }
+    }
+#else
+    Q_UNUSED(src);
+    Q_UNUSED(dst);
+#endif
+}
+
+RemuxResult remuxOnce(iDescriptorDevice *device, const char *devicePath,
+                      const QString &outputPath,
+                      std::optional<afc_client_t> altAfc, bool reserveMoov,
+                      const std::function<bool(qint64, qint64)> &progress,
+                      QString &error, qint64 &bytesRead)
+{
+    uint64_t handle = 0;
+    if (ServiceManager::safeAfcFileOpen(device, devicePath, AFC_FOPEN_RDONLY,
+                                        &handle, altAfc) != AFC_E_SUCCESS ||
+        handle == 0) {
+        error = QString("Failed to open file on device: %1").arg(devicePath);
+        return RemuxResult::Failed;
+    }
+
+    int64_t size = 0;
+    char **info = nullptr;
+    if (ServiceManager::safeAfcGetFileInfo(device, devicePath, &info,
+                                           altAfc) == AFC_E_SUCCESS &&
+        info) {
+        for (int i = 0; info[i] && info[i + 1]; i += 2) {
+            if (strcmp(info[i], "st_size") == 0) {
+                size = strtoll(info[i + 1], nullptr, 10);
+            }
+        }
+        afc_dictionary_free(info);
+    }
+
+    AfcReader reader{device, altAfc, handle, size, 0};
+    AVIOContext *avio = nullptr;
+    AVFormatContext *in = nullptr;
+    AVFormatContext *out = nullptr;
+    AVPacket *packet = nullptr;
+    std::vector<int> streamMap;
+    RemuxResult result = RemuxResult::Failed;
+    int err = 0;
+
+    do {
+        if (size <= 0) {
+            error = "Empty video file";
+            break;
+        }
+
+        auto *buffer = static_cast<uint8_t *>(av_malloc(AvioBufferSize));
+        avio = buffer ? avio_alloc_context(buffer, AvioBufferSize, 0, &reader,
+                                           afcRead, nullptr, afcSeek)
+                      : nullptr;
+        in = avformat_alloc_context();
+        if (!avio || !in) {
+            if (!avio) {
+                av_free(buffer);
+            }
+            error = "Out of memory";
+            break;
+        }
+        in->pb = avio;
+        in->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+        // Frees the context on failure
+        if ((err = avformat_open_input(&in, nullptr, nullptr, nullptr)) < 0 ||
+            (err = avformat_find_stream_info(in, nullptr)) < 0) {
+            error = "Could not read video: " + avError(err);
+            break;
+        }
+
+        if ((err = avformat_alloc_output_context2(&out, nullptr, "mp4",
+                                                  nullptr)) < 0) {
+            error = "Could not create MP4 muxer: " + avError(err);
+            break;
+        }
+
+        streamMap.assign(in->nb_streams, -1);
+        for (unsigned i = 0; i < in->nb_streams; ++i) {
+            const AVStream *src = in->streams[i];
+            // Timecode and metadata tracks have no MP4 mapping
+            if (src->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
+                src->codecpar->codec_type != AVMEDIA_TYPE_AUDIO) {
+                continue;
+            }
+            AVStream *dst = avformat_new_stream(out, nullptr);
+            if (!dst ||
+                avcodec_parameters_copy(dst->codecpar, src->codecpar) < 0) {
+                continue;
+            }
+            // Apple players only take HEVC tagged as hvc1
+            dst->codecpar->codec_tag =
+                src->codecpar->codec_id == AV_CODEC_ID_HEVC
+                    ? MKTAG('h', 'v', 'c', '1')
+                    : 0;
+            dst->time_base = src->time_base;
+            av_dict_copy(&dst->metadata, src->metadata, 0);
+            copyDisplayMatrix(src, dst);
+            streamMap[i] = dst->index;
+        }
+        if (out->nb_streams == 0) {
+            error = "No audio or video streams to remux";
+            break;
+        }
+        av_dict_copy(&out->metadata, in->metadata, 0);
+
+        if ((err = avio_open(&out->pb, outputPath.toUtf8().constData(),
+                             AVIO_FLAG_WRITE)) < 0) {
+            error = QString("Failed to create local file: %1 (%2)")
+                        .arg(outputPath, avError(err));
+            break;
+        }
+
+        AVDictionary *options = nullptr;
+        const int64_t reserve =
+            reserveMoov ? moovReservation(in, streamMap) : 0;
+        if (reserve > 0) {
+            av_dict_set_int(&options, "moov_size", reserve, 0);
+        } else {
+            // Rewrites the output once at the end, local I/O only
+            av_dict_set(&options, "movflags", "+faststart", 0);
+        }
+        err = avformat_write_header(out, &options);
+        av_dict_free(&options);
+        if (err < 0) {
+            error = "Could not write MP4 header: " + avError(err);
+            break;
+        }
+
+        packet = av_packet_alloc();
+        bool cancelled = false;
+        while (packet && (err = av_read_frame(in, packet)) >= 0) {
+            const int target =
+                packet->stream_index < int(streamMap.size())
+                    ? streamMap[packet->stream_index]
+                    : -1;
+            if (target < 0) {
+                av_packet_unref(packet);
+                continue;
+            }
+            av_packet_rescale_ts(packet,
+                                 in->streams[packet->stream_index]->time_base,
+                                 out->streams[target]->time_base);
+            packet->stream_index = target;
+            packet->pos = -1;
+            if ((err = av_interleaved_write_frame(out, packet)) < 0) {
+                break;
+            }
+            if (progress && !progress(reader.pos, reader.size)) {
+                cancelled = true;
+                break;
+            }
+        }
+        if (cancelled) {
+            error = "Export cancelled by user";
+            break;
+        }
+        if (err != AVERROR_EOF) {
+            error = "Remux failed: " + avError(err);
+            break;
+        }
+
+        if ((err = av_write_trailer(out)) < 0) {
+            // The muxer refuses to finish if moov outgrew the reservation
+            result = reserve > 0 ? RemuxResult::MoovTooSmall
+                                 : RemuxResult::Failed;
+            error = "Could not finish MP4: " + avError(err);
+            break;
+        }
+        result = RemuxResult::Ok;
+    } while (false);
+
+    av_packet_free(&packet);
+    if (out) {
+        avio_closep(&out->pb);
+        avformat_free_context(out);
+    }
+    avformat_close_input(&in);
+    if (avio) {
+        av_freep(&avio->buffer);
+        avio_context_free(&avio);
+    }
+    ServiceManager::safeAfcFileClose(device, handle, altAfc);
+
+    bytesRead = reader.pos;
+    if (result != RemuxResult::Ok) {
+        QFile::remove(outputPath);
+    }
+    return result;
+}
+} // namespace
+
+/*
+ Streams the QuickTime file straight from AFC into the MP4 muxer, packets
+ are copied as they are, nothing is decoded and nothing is staged on disk.
+*/
+bool remux_mov_to_mp4(iDescriptorDevice *device, const char *devicePath,
+                      const QString &outputPath,
+                      std::optional<afc_client_t> altAfc,
+                      const std::function<bool(qint64, qint64)> &progress,
+                      QString *error, qint64 *bytesRead)
+{
+    QString message;
+    qint64 read = 0;
+    RemuxResult result = remuxOnce(device, devicePath, outputPath, altAfc,
+                                   true, progress, message, read);
+    if (result == RemuxResult::MoovTooSmall) {
+        qCDebug(lcExport) << "moov outgrew its reservation, remuxing"
+                          << devicePath << "again with faststart";
+        result = remuxOnce(device, devicePath, outputPath, altAfc, false,
+                           progress, message, read);
+    }
+
+    if (error) {
+        *error = message;
+    }
+    if (bytesRead) {
+        *bytesRead = read;
+    }
+    return result == RemuxResult::Ok;
+}
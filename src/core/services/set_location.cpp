@@ -20,6 +20,7 @@
  */
 
 #include "../../iDescriptor.h"
+#include "../../servicebroker.h"
 #define DT_SIMULATELOCATION_SERVICE "com.apple.dt.simulatelocation"
 
 #include <errno.h>
@@ -44,77 +45,92 @@
 #include <QDebug>
 
 enum { SET_LOCATION = 0, RESET_LOCATION = 1 };
-bool set_location(idevice_t device, char *lat, char *lon)
-{
-    uint32_t mode = 0;
-    lockdownd_client_t lockdown = NULL;
-    lockdownd_error_t lerr =
-        lockdownd_client_new_with_handshake(device, &lockdown, TOOL_NAME);
-    try {
-        /* code */
 
-        if (lerr != LOCKDOWN_E_SUCCESS) {
-            idevice_free(device);
-            printf("ERROR: Could not connect to lockdownd: %s (%d)\n",
-                   lockdownd_strerror(lerr), lerr);
-            return false;
+/*
+ * Starts com.apple.dt.simulatelocation. The returned client can be used
+ * for any number of location_session_send calls, which is what route
+ * playback relies on. Never frees the device, it's shared.
+ */
+service_client_t location_session_open(idevice_t device)
+{
+    lockdownd_service_descriptor_t svc = NULL;
+    lockdownd_error_t lerr = ServiceBroker::sharedInstance()->startService(
+        device, DT_SIMULATELOCATION_SERVICE, &svc);
+    if (lerr != LOCKDOWN_E_SUCCESS) {
+        qDebug() << "Could not start" << DT_SIMULATELOCATION_SERVICE
+                 << lockdownd_strerror(lerr) << lerr;
+        if (svc) {
+            lockdownd_service_descriptor_free(svc);
         }
+        return NULL;
+    }
 
-        lockdownd_service_descriptor_t svc = NULL;
-        lerr = lockdownd_start_service(lockdown, DT_SIMULATELOCATION_SERVICE,
-                                       &svc);
-        if (lerr != LOCKDOWN_E_SUCCESS) {
-            unsigned int device_version = idevice_get_device_version(device);
-            lockdownd_client_free(lockdown);
-            idevice_free(device);
-
-            return false;
-        }
-        lockdownd_client_free(lockdown);
+    service_client_t service = NULL;
+    service_error_t serr = service_client_new(device, svc, &service);
+    lockdownd_service_descriptor_free(svc);
+    if (serr != SERVICE_E_SUCCESS) {
+        qDebug() << "Could not connect to location service:" << serr;
+        return NULL;
+    }
+    return service;
+}
 
-        service_client_t service = NULL;
+static bool send_all(service_client_t service, const char *data, uint32_t size)
+{
+    uint32_t sent = 0;
+    return service_send(service, data, size, &sent) == SERVICE_E_SUCCESS &&
+           sent == size;
+}
 
-        service_error_t serr = service_client_new(device, svc, &service);
+bool location_session_send(service_client_t service, double latitude,
+                           double longitude)
+{
+    if (!service) {
+        return false;
+    }
 
-        lockdownd_service_descriptor_free(svc);
+    const QByteArray lat = QByteArray::number(latitude, 'f', 7);
+    const QByteArray lon = QByteArray::number(longitude, 'f', 7);
 
-        if (serr != SERVICE_E_SUCCESS) {
-            idevice_free(device);
-            return false;
-        }
+    // mode, then length-prefixed latitude and longitude strings
+    QByteArray buf;
+    buf.reserve(12 + lat.size() + lon.size());
+    uint32_t l = htobe32(SET_LOCATION);
+    buf.append(reinterpret_cast<const char *>(&l), 4);
+    l = htobe32(static_cast<uint32_t>(lat.size()));
+    buf.append(reinterpret_cast<const char *>(&l), 4);
+    buf.append(lat);
+    l = htobe32(static_cast<uint32_t>(lon.size()));
+    buf.append(reinterpret_cast<const char *>(&l), 4);
+    buf.append(lon);
 
-        uint32_t l;
-        uint32_t s = 0;
+    return send_all(service, buf.constData(),
+                    static_cast<uint32_t>(buf.size()));
+}
 
-        l = htobe32(mode);
-        service_send(service, (const char *)&l, 4, &s);
-        if (mode == SET_LOCATION) {
-            int len = 4 + strlen(lat) + 4 + strlen(lon);
-            char *buf = (char *)malloc(len);
-            uint32_t latlen;
-            latlen = strlen(lat);
-            l = htobe32(latlen);
-            memcpy(buf, &l, 4);
-            memcpy(buf + 4, lat, latlen);
-            uint32_t longlen = strlen(lon);
-            l = htobe32(longlen);
-            memcpy(buf + 4 + latlen, &l, 4);
-            memcpy(buf + 4 + latlen + 4, lon, longlen);
+bool location_session_reset(service_client_t service)
+{
+    if (!service) {
+        return false;
+    }
+    uint32_t l = htobe32(RESET_LOCATION);
+    return send_all(service, reinterpret_cast<const char *>(&l), 4);
+}
 
-            s = 0;
-            service_send(service, buf, len, &s);
-            free(buf); // <-- free the buffer after use
-        }
+void location_session_close(service_client_t service)
+{
+    if (service) {
+        service_client_free(service);
+    }
+}
 
-        return true;
-    } catch (...) {
-        if (lockdown) {
-            lockdownd_client_free(lockdown);
-        }
-        if (device) {
-            idevice_free(device);
-        }
-        qDebug() << "Exception occurred while setting location.";
+bool set_location(idevice_t device, double latitude, double longitude)
+{
+    service_client_t service = location_session_open(device);
+    if (!service) {
         return false;
     }
-}
\ No newline at end of file
+    bool success = location_session_send(service, latitude, longitude);
+    location_session_close(service);
+    return success;
+}
@@ -0,0 +1,163 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "../../iDescriptor.h"
+#include "../../loggingcategories.h"
+#include <QBuffer>
+#include <QByteArray>
+#include <QImageWriter>
+#include <QtEndian>
+#include <libheif/heif.h>
+#include <vector>
+
+/*
+ * Raw TIFF payload (starting at "II"/"MM") of the primary image's Exif
+ * block. HEIF prefixes it with a 32-bit offset to that header.
+ */
+static QByteArray heic_exif(const QByteArray &imageData)
+{
+    heif_context *ctx = heif_context_alloc();
+    if (!ctx) {
+        return QByteArray();
+    }
+
+    QByteArray tiff;
+    heif_image_handle *handle = nullptr;
+    if (heif_context_read_from_memory_without_copy(ctx, imageData.constData(),
+                                                   imageData.size(), nullptr)
+                .code == heif_error_Ok &&
+        heif_context_get_primary_image_handle(ctx, &handle).code ==
+            heif_error_Ok) {
+        heif_item_id id;
+        if (heif_image_handle_get_list_of_metadata_block_IDs(handle, "Exif",
+                                                             &id, 1) == 1) {
+            std::vector<uint8_t> block(
+                heif_image_handle_get_metadata_size(handle, id));
+            if (block.size() > 4 &&
+                heif_image_handle_get_metadata(handle, id, block.data())
+                        .code == heif_error_Ok) {
+                const quint32 offset = qFromBigEndian<quint32>(block.data());
+                if (4 + quint64(offset) < block.size()) {
+                    tiff = QByteArray(
+                        reinterpret_cast<const char *>(block.data()) + 4 +
+                            offset,
+                        block.size() - 4 - offset);
+                }
+            }
+        }
+        heif_image_handle_release(handle);
+    }
+    heif_context_free(ctx);
+
+    if (!tiff.startsWith("II") && !tiff.startsWith("MM")) {
+        return QByteArray();
+    }
+    return tiff;
+}
+
+/*
+ * libheif already applies the rotation and mirroring to the pixels, so a
+ * copied orientation tag would rotate the JPEG a second time.
+ */
+static void reset_exif_orientation(QByteArray &tiff)
+{
+    const bool little = tiff.startsWith("II");
+    auto *data = reinterpret_cast<uchar *>(tiff.data());
+    auto read16 = [&](qsizetype at) {
+        return little ? qFromLittleEndian<quint16>(data + at)
+                      : qFromBigEndian<quint16>(data + at);
+    };
+    auto read32 = [&](qsizetype at) {
+        return little ? qFromLittleEndian<quint32>(data + at)
+                      : qFromBigEndian<quint32>(data + at);
+    };
+
+    if (tiff.size() < 8) {
+        return;
+    }
+    const quint32 ifd = read32(4);
+    if (quint64(ifd) + 2 > quint64(tiff.size())) {
+        return;
+    }
+    const quint16 count = read16(ifd);
+    for (quint16 i = 0; i < count; ++i) {
+        const quint64 entry = ifd + 2 + quint64(i) * 12;
+        if (entry + 12 > quint64(tiff.size())) {
+            return;
+        }
+        if (read16(entry) == 0x0112) {
+            // SHORT, stored inline in the first two bytes of the value
+            if (little) {
+                qToLittleEndian<quint16>(1, data + entry + 8);
+            } else {
+                qToBigEndian<quint16>(1, data + entry + 8);
+            }
+            return;
+        }
+    }
+}
+
+/*
+ * Full resolution decode through load_heic, so it shares the process-wide
+ * full decode limit, then Qt's JPEG encoder. The Exif block is carried over
+ * as an APP1 segment right after SOI.
+ */
+QByteArray transcode_heic_to_jpeg(const QByteArray &imageData, int quality,
+                                  QString *error)
+{
+    const QImage image = load_heic(imageData);
+    if (image.isNull()) {
+        if (error) {
+            *error = "Could not decode HEIC image";
+        }
+        return QByteArray();
+    }
+
+    QByteArray jpeg;
+    QBuffer buffer(&jpeg);
+    buffer.open(QIODevice::WriteOnly);
+    QImageWriter writer(&buffer, "jpeg");
+    writer.setQuality(qBound(1, quality, 100));
+    if (!writer.write(image)) {
+        if (error) {
+            *error = "Could not encode JPEG: " + writer.errorString();
+        }
+        return QByteArray();
+    }
+    buffer.close();
+
+    QByteArray tiff = heic_exif(imageData);
+    // An APP1 segment length is 16 bits and includes itself and "Exif\0\0"
+    constexpr int App1Overhead = 2 + 6;
+    if (!tiff.isEmpty() && tiff.size() + App1Overhead <= 0xFFFF &&
+        jpeg.startsWith("\xFF\xD8")) {
+        reset_exif_orientation(tiff);
+
+        QByteArray app1("\xFF\xE1", 2);
+        const quint16 length = quint16(tiff.size() + App1Overhead);
+        app1.append(char(length >> 8));
+        app1.append(char(length & 0xFF));
+        app1.append("Exif\0\0", 6);
+        app1.append(tiff);
+        jpeg.insert(2, app1);
+    } else if (!tiff.isEmpty()) {
+        qCDebug(lcExport) << "Exif block too large for a JPEG, dropped";
+    }
+    return jpeg;
+}
@@ -94,6 +94,12 @@ void DevDiskImageHelper::setupUI()
 
 void DevDiskImageHelper::start()
 {
+    // Mounted earlier in this connection, nothing to show
+    if (DevDiskManager::sharedInstance()->isImageMounted(m_device->udid)) {
+        finishWithSuccess();
+        return;
+    }
+
     m_loadingIndicator->start();
     showStatus("Please wait...");
 
@@ -125,8 +131,7 @@ void DevDiskImageHelper::start()
 void DevDiskImageHelper::checkAndMount()
 {
     GetMountedImageResult result =
-        DevDiskManager::sharedInstance()->getMountedImage(
-            m_device->udid.c_str());
+        DevDiskManager::sharedInstance()->getMountedImage(m_device);
     qDebug() << "checkAndMount result:" << result.success
              << result.message.c_str() << QString::fromStdString(result.sig);
     if (!result.success) {
@@ -175,26 +180,7 @@ void DevDiskImageHelper::onMountButtonClicked()
 
     if (hasDownloadedImage) {
         // Mount directly
-        showStatus("Mounting developer disk image...");
-
-        mobile_image_mounter_error_t err =
-            DevDiskManager::sharedInstance()->mountImage(versionToMount,
-                                                         m_device);
-
-        m_isMounting = false;
-        if (err == MOBILE_IMAGE_MOUNTER_E_SUCCESS) {
-            showStatus("Developer disk image mounted successfully");
-            finishWithSuccess();
-        } else if (err == MOBILE_IMAGE_MOUNTER_E_DEVICE_LOCKED) {
-            showRetryUI(
-                "Device is locked. Please unlock your device and try again.");
-        } else {
-            showRetryUI("Failed to mount developer disk image.\n"
-                        "Please ensure:\n"
-                        "• Device is unlocked\n"
-                        "• Using a genuine cable\n"
-                        "• Developer mode is enabled (iOS 16+)");
-        }
+        startMount(versionToMount);
     } else {
         // Need to download first
         showStatus(
@@ -235,11 +221,50 @@ void DevDiskImageHelper::onImageDownloadFinished(const QString &version,
     }
 
     // Download successful, now mount
-    showStatus("Download complete. Mounting...");
+    startMount(version);
+}
 
-    mobile_image_mounter_error_t err =
-        DevDiskManager::sharedInstance()->mountImage(version, m_device);
+void DevDiskImageHelper::startMount(const QString &version)
+{
+    showStatus("Mounting developer disk image...");
+    m_isMounting = true;
 
+    DevDiskManager *manager = DevDiskManager::sharedInstance();
+    connect(manager, &DevDiskManager::imageUploadProgress, this,
+            &DevDiskImageHelper::onImageUploadProgress, Qt::UniqueConnection);
+    connect(manager, &DevDiskManager::imageMountFinished, this,
+            &DevDiskImageHelper::onImageMountFinished, Qt::UniqueConnection);
+    if (manager->isMountPending(m_device->udid)) {
+        // Clicked again, the running mount reports to us as well
+        return;
+    }
+    if (!manager->mountImageAsync(version, m_device)) {
+        m_isMounting = false;
+        showRetryUI("Failed to mount developer disk image.\n"
+                    "The downloaded image could not be verified.");
+    }
+}
+
+void DevDiskImageHelper::onImageUploadProgress(const QString &udid,
+                                               qint64 sent, qint64 total)
+{
+    if (!m_isMounting || udid.toStdString() != m_device->udid || total <= 0) {
+        return;
+    }
+    showStatus(QString("Uploading developer disk image... %1%")
+                   .arg(sent * 100 / total));
+}
+
+void DevDiskImageHelper::onImageMountFinished(
+    const QString &udid, const QString &version,
+    mobile_image_mounter_error_t err)
+{
+    Q_UNUSED(version);
+    if (!m_isMounting || udid.toStdString() != m_device->udid) {
+        return;
+    }
+
+    m_isMounting = false;
     if (err == MOBILE_IMAGE_MOUNTER_E_SUCCESS) {
         showStatus("Developer disk image mounted successfully");
         finishWithSuccess();
@@ -247,9 +272,11 @@ void DevDiskImageHelper::onImageDownloadFinished(const QString &version,
         showRetryUI(
             "Device is locked. Please unlock your device and try again.");
     } else {
-        showRetryUI(
-            "Failed to mount developer disk image.\n"
-            "Please ensure the device is unlocked and using a genuine cable.");
+        showRetryUI("Failed to mount developer disk image.\n"
+                    "Please ensure:\n"
+                    "• Device is unlocked\n"
+                    "• Using a genuine cable\n"
+                    "• Developer mode is enabled (iOS 16+)");
     }
 }
 
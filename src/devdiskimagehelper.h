@@ -49,9 +49,14 @@ private slots:
     void onRetryButtonClicked();
     void onImageDownloadFinished(const QString &version, bool success,
                                  const QString &errorMessage);
+    void onImageUploadProgress(const QString &udid, qint64 sent,
+                               qint64 total);
+    void onImageMountFinished(const QString &udid, const QString &version,
+                              mobile_image_mounter_error_t err);
 
 private:
     void setupUI();
+    void startMount(const QString &version);
     void showStatus(const QString &message, bool isError = false);
     void showMountUI();
     void showRetryUI(const QString &errorMessage);
@@ -56,6 +56,12 @@ DevDiskImagesWidget::DevDiskImagesWidget(iDescriptorDevice *device,
     setupUi();
     connect(DevDiskManager::sharedInstance(), &DevDiskManager::imageListFetched,
             this, &DevDiskImagesWidget::onImageListFetched);
+    connect(DevDiskManager::sharedInstance(),
+            &DevDiskManager::imageDownloadProgress, this,
+            &DevDiskImagesWidget::onImageDownloadProgress);
+    connect(DevDiskManager::sharedInstance(),
+            &DevDiskManager::imageDownloadFinished, this,
+            &DevDiskImagesWidget::onImageDownloadFinished);
 
     updateDeviceList();
     connect(AppContext::sharedInstance(), &AppContext::deviceAdded, this,
@@ -341,156 +347,81 @@ void DevDiskImagesWidget::onDownloadButtonClicked()
     startDownload(version);
 }
 
-void DevDiskImagesWidget::startDownload(const QString &version)
+bool DevDiskImagesWidget::findVersionWidgets(const QString &version,
+                                             QPushButton **button,
+                                             QProgressBar **progressBar) const
 {
-    // Find the button and progress bar for this version
-    QPushButton *downloadButton = nullptr;
-    QProgressBar *progressBar = nullptr;
     for (int i = 0; i < m_imageListWidget->count(); ++i) {
         auto *item = m_imageListWidget->item(i);
         auto *widget = m_imageListWidget->itemWidget(item);
-        auto *button = widget->findChild<QPushButton *>();
-        if (button && button->property("version") == version) {
-            downloadButton = button;
-            progressBar = widget->findChild<QProgressBar *>();
-            break;
+        auto *candidate = widget->findChild<QPushButton *>();
+        if (candidate && candidate->property("version") == version) {
+            *button = candidate;
+            *progressBar = widget->findChild<QProgressBar *>();
+            return *progressBar != nullptr;
         }
     }
+    return false;
+}
 
-    if (!downloadButton || !progressBar)
+void DevDiskImagesWidget::startDownload(const QString &version)
+{
+    QPushButton *downloadButton = nullptr;
+    QProgressBar *progressBar = nullptr;
+    if (!findVersionWidgets(version, &downloadButton, &progressBar))
         return;
 
     downloadButton->setEnabled(false);
     progressBar->setVisible(true);
     progressBar->setValue(0);
 
-    QString targetDir =
-        QDir(SettingsManager::sharedInstance()->devdiskimgpath())
-            .filePath(version);
-    if (!QDir().mkpath(targetDir)) {
-        QMessageBox::critical(
-            this, "Error",
-            QString("Could not create directory: %1").arg(targetDir));
-        downloadButton->setEnabled(true);
-        progressBar->setVisible(false);
-        return;
-    }
-    // todo is this safe ?
-    auto *downloadItem = new DownloadItem();
-    downloadItem->version = version;
-    downloadItem->progressBar = progressBar;
-    downloadItem->downloadButton = downloadButton;
-
-    auto replies = DevDiskManager::sharedInstance()->downloadImage(version);
-    downloadItem->dmgReply = replies.first;
-    downloadItem->sigReply = replies.second;
-
-    if (!downloadItem->dmgReply || !downloadItem->sigReply) {
-        delete downloadItem;
-        downloadButton->setEnabled(true);
-        progressBar->setVisible(false);
-        return;
-    }
-
-    connect(downloadItem->dmgReply, &QNetworkReply::downloadProgress, this,
-            &DevDiskImagesWidget::onDownloadProgress);
-    connect(downloadItem->dmgReply, &QNetworkReply::finished, this,
-            &DevDiskImagesWidget::onFileDownloadFinished);
-    connect(downloadItem->sigReply, &QNetworkReply::downloadProgress, this,
-            &DevDiskImagesWidget::onDownloadProgress);
-    connect(downloadItem->sigReply, &QNetworkReply::finished, this,
-            &DevDiskImagesWidget::onFileDownloadFinished);
-
-    m_activeDownloads[downloadItem->dmgReply] = downloadItem;
-    m_activeDownloads[downloadItem->sigReply] = downloadItem;
+    m_activeDownloads.insert(version);
+    DevDiskManager::sharedInstance()->downloadImage(version);
 }
 
-void DevDiskImagesWidget::onDownloadProgress(qint64 bytesReceived,
-                                             qint64 bytesTotal)
+void DevDiskImagesWidget::onImageDownloadProgress(const QString &version,
+                                                  int percentage)
 {
-    auto *reply = qobject_cast<QNetworkReply *>(sender());
-    if (!reply || !m_activeDownloads.contains(reply))
+    QPushButton *downloadButton = nullptr;
+    QProgressBar *progressBar = nullptr;
+    if (!m_activeDownloads.contains(version) ||
+        !findVersionWidgets(version, &downloadButton, &progressBar))
         return;
 
-    auto *item = m_activeDownloads[reply];
-
-    if (reply->property("totalSizeAdded").isNull() && bytesTotal > 0) {
-        item->totalSize += bytesTotal;
-        reply->setProperty("totalSizeAdded", true);
-    }
-
-    if (reply == item->dmgReply) {
-        item->dmgReceived = bytesReceived;
-    } else if (reply == item->sigReply) {
-        item->sigReceived = bytesReceived;
-    }
-
-    item->totalReceived = item->dmgReceived + item->sigReceived;
-
-    if (item->totalSize > 0) {
-        item->progressBar->setValue((item->totalReceived * 100) /
-                                    item->totalSize);
-    }
+    downloadButton->setEnabled(false);
+    progressBar->setVisible(true);
+    progressBar->setValue(percentage);
 }
 
-// TODO: file saving should be in manager
-void DevDiskImagesWidget::onFileDownloadFinished()
+void DevDiskImagesWidget::onImageDownloadFinished(const QString &version,
+                                                  bool success,
+                                                  const QString &errorMessage)
 {
-    auto *reply = qobject_cast<QNetworkReply *>(sender());
-    if (!reply || !m_activeDownloads.contains(reply))
+    if (!m_activeDownloads.remove(version))
         return;
 
-    auto *item = m_activeDownloads[reply];
-    m_activeDownloads.remove(reply);
-
-    if (reply->error() != QNetworkReply::NoError) {
-        QMessageBox::critical(this, "Download Error",
-                              QString("Failed to download %1: %2")
-                                  .arg(reply->url().path())
-                                  .arg(reply->errorString()));
-
-        if (reply == item->dmgReply && item->sigReply)
-            item->sigReply->abort();
-        if (reply == item->sigReply && item->dmgReply)
-            item->dmgReply->abort();
-
-        item->downloadButton->setEnabled(true);
-        item->downloadButton->setText("Retry");
-        item->progressBar->setVisible(false);
+    QPushButton *downloadButton = nullptr;
+    QProgressBar *progressBar = nullptr;
+    const bool visible =
+        findVersionWidgets(version, &downloadButton, &progressBar);
 
-        if (m_activeDownloads.key(item) == nullptr) {
-            delete item;
+    if (!success) {
+        QMessageBox::critical(
+            this, "Download Error",
+            QString("Failed to download %1: %2").arg(version, errorMessage));
+        if (visible) {
+            downloadButton->setEnabled(true);
+            downloadButton->setText("Retry");
+            progressBar->setVisible(false);
         }
-        reply->deleteLater();
         return;
     }
 
-    QString path = QUrl::fromPercentEncoding(reply->url().path().toUtf8());
-    QFileInfo fileInfo(path);
-    QString filename = fileInfo.fileName();
-    QString targetPath =
-        QDir(QDir(SettingsManager::sharedInstance()->devdiskimgpath())
-                 .filePath(item->version))
-            .filePath(filename);
-
-    QFile file(targetPath);
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::critical(
-            this, "File Error",
-            QString("Could not save file: %1").arg(targetPath));
-    } else {
-        file.write(reply->readAll());
-        file.close();
-    }
-
-    reply->deleteLater();
-
-    if (m_activeDownloads.key(item) == nullptr) { // Both files downloaded
-        item->downloadButton->setText("Downloaded");
-        item->downloadButton->setEnabled(false);
-        item->progressBar->setValue(100);
-        item->progressBar->setVisible(false);
-        delete item;
+    if (visible) {
+        downloadButton->setText("Downloaded");
+        downloadButton->setEnabled(false);
+        progressBar->setValue(100);
+        progressBar->setVisible(false);
     }
 }
 
@@ -612,8 +543,8 @@ void DevDiskImagesWidget::mountImage(const QString &version)
         break;
     default:
         GetMountedImageResult result =
-            DevDiskManager::sharedInstance()->getMountedImage(
-                udid.toStdString().c_str());
+            DevDiskManager::sharedInstance()->getMountedImage(m_currentDevice,
+                                                              true);
         /*
          *   FIXME:  there is no error enum like
          * MOBILE_IMAGE_MOUNTER_E_ALREADY_MOUNTED  so we work around here
@@ -655,13 +586,11 @@ void DevDiskImagesWidget::closeEvent(QCloseEvent *event)
             return;
         }
 
-        // Cancel all active downloads
-        for (auto it = m_activeDownloads.begin(); it != m_activeDownloads.end();
-             ++it) {
-            QNetworkReply *reply = it.key();
-            if (reply) {
-                reply->abort();
-            }
+        // Cancel all active downloads, they resume on the next attempt
+        const QSet<QString> versions = m_activeDownloads;
+        m_activeDownloads.clear(); // no error dialogs for these
+        for (const QString &version : versions) {
+            DevDiskManager::sharedInstance()->cancelDownload(version);
         }
     }
 
@@ -683,8 +612,8 @@ void DevDiskImagesWidget::checkMountedImage()
     }
 
     GetMountedImageResult result =
-        DevDiskManager::sharedInstance()->getMountedImage(
-            m_currentDevice->udid.c_str());
+        DevDiskManager::sharedInstance()->getMountedImage(m_currentDevice,
+                                                          true);
 
     qDebug() << "checkMountedImage result:" << result.success
              << result.message.c_str() << QString::fromStdString(result.sig);
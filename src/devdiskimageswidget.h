@@ -29,6 +29,7 @@
 #include <QNetworkReply>
 #include <QPair>
 #include <QProgressBar>
+#include <QSet>
 #include <QPushButton>
 #include <QStackedWidget>
 #include <QStringList>
@@ -45,8 +46,9 @@ public:
 private slots:
     void fetchImages();
     void onDownloadButtonClicked();
-    void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
-    void onFileDownloadFinished();
+    void onImageDownloadProgress(const QString &version, int percentage);
+    void onImageDownloadFinished(const QString &version, bool success,
+                                 const QString &errorMessage);
     void updateDeviceList();
     void onMountButtonClicked();
     void onImageListFetched(bool success,
@@ -60,18 +62,8 @@ private:
     void onDeviceSelectionChanged(int index);
     void closeEvent(QCloseEvent *event) override;
     void checkMountedImage();
-
-    struct DownloadItem {
-        QNetworkReply *dmgReply = nullptr;
-        QNetworkReply *sigReply = nullptr;
-        QProgressBar *progressBar = nullptr;
-        QPushButton *downloadButton = nullptr;
-        QString version;
-        qint64 totalSize = 0;
-        qint64 totalReceived = 0;
-        qint64 dmgReceived = 0;
-        qint64 sigReceived = 0;
-    };
+    bool findVersionWidgets(const QString &version, QPushButton **button,
+                            QProgressBar **progressBar) const;
 
     std::string m_mounted_sig = "";
     uint64_t m_mounted_sig_len = 0;
@@ -92,7 +84,8 @@ private:
 
     QMap<QString, QPair<QString, QString>>
         m_availableImages; // version -> {dmg_path, sig_path}
-    QMap<QNetworkReply *, DownloadItem *> m_activeDownloads;
+    // Started here, the list is rebuilt while they run
+    QSet<QString> m_activeDownloads;
 };
 
 #endif // DEVDISKIMAGESWIDGET_H
@@ -18,6 +18,7 @@
  */
 
 #include "devdiskmanager.h"
+#include "appcontext.h"
 #include "iDescriptor.h"
 #include "settingsmanager.h"
 #include <QApplication>
@@ -25,12 +26,14 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QtConcurrent/QtConcurrent>
 #include <libimobiledevice/mobile_image_mounter.h>
 
 DevDiskManager *DevDiskManager::sharedInstance()
@@ -42,6 +45,19 @@ DevDiskManager *DevDiskManager::sharedInstance()
 DevDiskManager::DevDiskManager(QObject *parent) : QObject{parent}
 {
     m_networkManager = new QNetworkAccessManager(this);
+    m_imageCache = new DiskImageCache(this);
+    connect(m_imageCache, &DiskImageCache::progress, this,
+            [this](const QString &version, qint64 received, qint64 total) {
+                if (total > 0) {
+                    emit imageDownloadProgress(version,
+                                               (received * 100) / total);
+                }
+            });
+    connect(m_imageCache, &DiskImageCache::finished, this,
+            &DevDiskManager::imageDownloadFinished);
+    // Emitted before the device is freed, a running mount has to stop first
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            &DevDiskManager::onDeviceRemoved, Qt::DirectConnection);
     populateImageList();
 }
 
@@ -277,49 +293,36 @@ QList<ImageInfo> DevDiskManager::getAllImages() const
     return m_availableImages.values();
 }
 
-QPair<QNetworkReply *, QNetworkReply *>
-DevDiskManager::downloadImage(const QString &version)
+bool DevDiskManager::downloadImage(const QString &version)
 {
     qDebug() << "Request to download image version:" << version;
     if (!m_availableImages.contains(version)) {
         qDebug() << "Image not found:" << version;
         emit imageDownloadFinished(version, false, "Image version not found.");
-        return {nullptr, nullptr};
-    }
-
-    QString targetDir =
-        QDir(SettingsManager::sharedInstance()->devdiskimgpath())
-            .filePath(version);
-    if (!QDir().mkpath(targetDir)) {
-        qDebug() << "Could not create directory:" << targetDir;
-        emit imageDownloadFinished(
-            version, false,
-            QString("Could not create directory: %1").arg(targetDir));
-        return {nullptr, nullptr};
+        return false;
     }
 
     const ImageInfo &info = m_availableImages[version];
+    m_imageCache->setBandwidthLimit(
+        qint64(SettingsManager::sharedInstance()->diskImageDownloadLimit()) *
+        1024);
+    // The image list has no digests, files are hashed but not checked
+    m_imageCache->fetch(
+        SettingsManager::sharedInstance()->mkDevDiskImgPath(), version,
+        {{"DeveloperDiskImage.dmg", QUrl(info.dmgPath)},
+         {"DeveloperDiskImage.dmg.signature", QUrl(info.sigPath)}});
+    return true;
+}
 
-    QUrl dmgUrl(info.dmgPath);
-    QNetworkRequest dmgRequest(dmgUrl);
-    QNetworkReply *dmgReply = m_networkManager->get(dmgRequest);
-
-    QUrl sigUrl(info.sigPath);
-    QNetworkRequest sigRequest(sigUrl);
-    QNetworkReply *sigReply = m_networkManager->get(sigRequest);
-
-    return {dmgReply, sigReply};
+void DevDiskManager::cancelDownload(const QString &version)
+{
+    m_imageCache->cancel(version);
 }
 
 bool DevDiskManager::isImageDownloaded(const QString &version,
                                        const QString &downloadPath) const
 {
-    QString versionPath = QDir(downloadPath).filePath(version);
-    QString dmgPath = QDir(versionPath).filePath("DeveloperDiskImage.dmg");
-    QString sigPath =
-        QDir(versionPath).filePath("DeveloperDiskImage.dmg.signature");
-
-    return QFile::exists(dmgPath) && QFile::exists(sigPath);
+    return m_imageCache->isCached(downloadPath, version);
 }
 
 bool DevDiskManager::downloadCompatibleImage(iDescriptorDevice *device,
@@ -372,25 +375,7 @@ bool DevDiskManager::downloadCompatibleImage(iDescriptorDevice *device,
                 << "No compatible image found locally. Downloading version:"
                 << versionToDownload;
 
-            QPair<QNetworkReply *, QNetworkReply *> replies =
-                downloadImage(versionToDownload);
-            auto *downloadItem = new DownloadItem();
-            downloadItem->version = versionToDownload;
-            downloadItem->downloadPath = path;
-            downloadItem->dmgReply = replies.first;
-            downloadItem->sigReply = replies.second;
-
-            connect(downloadItem->dmgReply, &QNetworkReply::downloadProgress,
-                    this, &DevDiskManager::onDownloadProgress);
-            connect(downloadItem->dmgReply, &QNetworkReply::finished, this,
-                    &DevDiskManager::onFileDownloadFinished);
-            connect(downloadItem->sigReply, &QNetworkReply::downloadProgress,
-                    this, &DevDiskManager::onDownloadProgress);
-            connect(downloadItem->sigReply, &QNetworkReply::finished, this,
-                    &DevDiskManager::onFileDownloadFinished);
-
-            m_activeDownloads[downloadItem->dmgReply] = downloadItem;
-            m_activeDownloads[downloadItem->sigReply] = downloadItem;
+            downloadImage(versionToDownload);
             return true; // Indicate that the async operation has started
         }
     }
@@ -463,25 +448,7 @@ bool DevDiskManager::mountCompatibleImage(iDescriptorDevice *device)
                 Qt::SingleShotConnection);
 
             // Start the download
-            QPair<QNetworkReply *, QNetworkReply *> replies =
-                downloadImage(versionToDownload);
-            auto *downloadItem = new DownloadItem();
-            downloadItem->version = versionToDownload;
-            downloadItem->downloadPath = path;
-            downloadItem->dmgReply = replies.first;
-            downloadItem->sigReply = replies.second;
-
-            connect(downloadItem->dmgReply, &QNetworkReply::downloadProgress,
-                    this, &DevDiskManager::onDownloadProgress);
-            connect(downloadItem->dmgReply, &QNetworkReply::finished, this,
-                    &DevDiskManager::onFileDownloadFinished);
-            connect(downloadItem->sigReply, &QNetworkReply::downloadProgress,
-                    this, &DevDiskManager::onDownloadProgress);
-            connect(downloadItem->sigReply, &QNetworkReply::finished, this,
-                    &DevDiskManager::onFileDownloadFinished);
-
-            m_activeDownloads[downloadItem->dmgReply] = downloadItem;
-            m_activeDownloads[downloadItem->sigReply] = downloadItem;
+            downloadImage(versionToDownload);
             return true; // Indicate that the async operation has started
         }
     }
@@ -497,90 +464,112 @@ DevDiskManager::mountImage(const QString &version, iDescriptorDevice *device)
 {
     const QString downloadPath =
         SettingsManager::sharedInstance()->devdiskimgpath();
-    if (!isImageDownloaded(version, downloadPath)) {
+    // Hashes again whatever changed on disk since it was verified
+    if (!m_imageCache->verify(downloadPath, version)) {
         return MOBILE_IMAGE_MOUNTER_E_INVALID_ARG;
     }
 
     QString versionPath = QDir(downloadPath).filePath(version);
-    return mount_dev_image(device->device,
-                           device->deviceInfo.parsedDeviceVersion,
-                           versionPath.toUtf8().constData());
+    mobile_image_mounter_error_t err = mount_dev_image(
+        device->device, device->deviceInfo.parsedDeviceVersion,
+        versionPath.toUtf8().constData());
+    if (err == MOBILE_IMAGE_MOUNTER_E_SUCCESS) {
+        setImageMounted(device->udid, localSignature(versionPath));
+    }
+    return err;
 }
 
-void DevDiskManager::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
+bool DevDiskManager::mountImageAsync(const QString &version,
+                                     iDescriptorDevice *device)
 {
-    auto *reply = qobject_cast<QNetworkReply *>(sender());
-    if (!reply || !m_activeDownloads.contains(reply))
-        return;
-
-    auto *item = m_activeDownloads[reply];
-
-    if (reply->property("totalSizeAdded").isNull() && bytesTotal > 0) {
-        item->totalSize += bytesTotal;
-        reply->setProperty("totalSizeAdded", true);
-    }
-
-    if (reply == item->dmgReply) {
-        item->dmgReceived = bytesReceived;
-    } else if (reply == item->sigReply) {
-        item->sigReceived = bytesReceived;
+    const QString downloadPath =
+        SettingsManager::sharedInstance()->devdiskimgpath();
+    const std::string udid = device->udid;
+    if (m_pendingMounts.contains(udid) ||
+        !m_imageCache->verify(downloadPath, version)) {
+        return false;
     }
 
-    qint64 totalReceived = item->dmgReceived + item->sigReceived;
+    const QString versionPath = QDir(downloadPath).filePath(version);
+    const QString qUdid = QString::fromStdString(udid);
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    // Called for every 64 KB, only whole percents are passed on
+    auto progress = [this, qUdid, cancelled,
+                     lastPercent = -1](uint64_t sent, uint64_t total) mutable {
+        const int percent = total > 0 ? int(sent * 100 / total) : 0;
+        if (percent != lastPercent) {
+            lastPercent = percent;
+            emit imageUploadProgress(qUdid, qint64(sent), qint64(total));
+        }
+        return !cancelled->load();
+    };
 
-    if (item->totalSize > 0) {
-        emit imageDownloadProgress(item->version,
-                                   (totalReceived * 100) / item->totalSize);
-    }
+    auto *watcher = new QFutureWatcher<mobile_image_mounter_error_t>(this);
+    connect(watcher, &QFutureWatcher<mobile_image_mounter_error_t>::finished,
+            this, [this, watcher, udid, qUdid, version, versionPath]() {
+                watcher->deleteLater();
+                const mobile_image_mounter_error_t err = watcher->result();
+                // Gone if the device was removed meanwhile
+                if (m_pendingMounts.remove(udid) > 0 &&
+                    err == MOBILE_IMAGE_MOUNTER_E_SUCCESS) {
+                    setImageMounted(udid, localSignature(versionPath));
+                }
+                emit imageMountFinished(qUdid, version, err);
+            });
+
+    QFuture<mobile_image_mounter_error_t> future = QtConcurrent::run(
+        [handle = device->device,
+         deviceVersion = device->deviceInfo.parsedDeviceVersion,
+         path = versionPath.toUtf8(), progress]() {
+            return mount_dev_image(handle, deviceVersion, path.constData(),
+                                   progress);
+        });
+    m_pendingMounts.insert(udid, PendingMount{future, cancelled});
+    watcher->setFuture(future);
+    return true;
 }
 
-void DevDiskManager::onFileDownloadFinished()
+bool DevDiskManager::isImageMounted(const std::string &udid) const
 {
-    auto *reply = qobject_cast<QNetworkReply *>(sender());
-    if (!reply || !m_activeDownloads.contains(reply))
-        return;
-
-    auto *item = m_activeDownloads[reply];
-    m_activeDownloads.remove(reply);
+    QMutexLocker locker(&m_mountStateMutex);
+    return m_mountedImages.contains(udid);
+}
 
-    if (reply->error() != QNetworkReply::NoError) {
-        emit imageDownloadFinished(item->version, false, reply->errorString());
+void DevDiskManager::setImageMounted(const std::string &udid,
+                                     const std::string &signature)
+{
+    QMutexLocker locker(&m_mountStateMutex);
+    m_mountedImages.insert(udid, signature.empty() ? "Mounted" : signature);
+}
 
-        if (reply == item->dmgReply && item->sigReply)
-            item->sigReply->abort();
-        if (reply == item->sigReply && item->dmgReply)
-            item->dmgReply->abort();
+void DevDiskManager::forgetMountedImage(const std::string &udid)
+{
+    QMutexLocker locker(&m_mountStateMutex);
+    m_mountedImages.remove(udid);
+}
 
-        if (m_activeDownloads.key(item) == nullptr) {
-            delete item;
-        }
-        reply->deleteLater();
-        return;
-    }
+void DevDiskManager::onDeviceRemoved(const std::string &udid)
+{
+    forgetMountedImage(udid);
 
-    QString path = QUrl::fromPercentEncoding(reply->url().path().toUtf8());
-    QFileInfo fileInfo(path);
-    QString filename = fileInfo.fileName();
-    QString targetPath = QDir(QDir(item->downloadPath).filePath(item->version))
-                             .filePath(filename);
-
-    QFile file(targetPath);
-    qDebug() << "Saving downloaded file to:" << targetPath;
-    if (!file.open(QIODevice::WriteOnly)) {
-        emit imageDownloadFinished(
-            item->version, false,
-            QString("Could not save file: %1").arg(targetPath));
-    } else {
-        file.write(reply->readAll());
-        file.close();
+    auto it = m_pendingMounts.find(udid);
+    if (it != m_pendingMounts.end()) {
+        it->cancelled->store(true);
+        it->future.waitForFinished();
+        m_pendingMounts.erase(it);
     }
+}
 
-    reply->deleteLater();
-
-    if (m_activeDownloads.key(item) == nullptr) { // Both files finished
-        emit imageDownloadFinished(item->version, true);
-        delete item;
+// What lookup_image reports for images that come with a signature file,
+// personalized images have none
+std::string DevDiskManager::localSignature(const QString &versionPath)
+{
+    QFile file(
+        QDir(versionPath).filePath("DeveloperDiskImage.dmg.signature"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return std::string();
     }
+    return file.readAll().toStdString();
 }
 
 bool DevDiskManager::unmountImage()
@@ -634,14 +623,28 @@ bool DevDiskManager::compareSignatures(const char *signature_file_path,
    e0b8e0>, "Status": "Complete"
     }
 */
-GetMountedImageResult DevDiskManager::getMountedImage(const char *udid)
+GetMountedImageResult
+DevDiskManager::getMountedImage(iDescriptorDevice *device, bool refresh)
 {
+    if (!device || !device->device) {
+        return GetMountedImageResult{false, "", "Device is not connected"};
+    }
+
+    if (!refresh) {
+        QMutexLocker locker(&m_mountStateMutex);
+        auto it = m_mountedImages.constFind(device->udid);
+        if (it != m_mountedImages.constEnd()) {
+            return GetMountedImageResult{true, it.value(),
+                                         "There is already an image mounted."};
+        }
+    }
+
     /*
         FIXME: _get_mounted_image can return MOBILE_IMAGE_MOUNTER_E_SUCCESS even
         if the device is locked so we are going to go off of the result
         dictionary
     */
-    plist_t result = _get_mounted_image(udid);
+    plist_t result = _get_mounted_image(device->device);
     plist_print(result);
     const char *lockedErr = "DeviceLocked";
 
@@ -670,6 +673,7 @@ GetMountedImageResult DevDiskManager::getMountedImage(const char *udid)
      */
     if (image_present) {
         plist_free(result);
+        setImageMounted(device->udid, "FIXME");
         return GetMountedImageResult{true, "FIXME",
                                      "There is already an image mounted."};
     }
@@ -678,6 +682,7 @@ GetMountedImageResult DevDiskManager::getMountedImage(const char *udid)
 
     if (sig_array_node == NULL) {
         plist_free(result);
+        forgetMountedImage(device->udid);
         return GetMountedImageResult{true, "", "No disk image mounted"};
     }
 
@@ -695,8 +700,10 @@ GetMountedImageResult DevDiskManager::getMountedImage(const char *udid)
     free(mounted_sig);
     plist_free(result);
     if (mounted_sig_str.empty()) {
+        forgetMountedImage(device->udid);
         return GetMountedImageResult{
             true, "", "No disk image mounted (No signature found)"};
     }
+    setImageMounted(device->udid, mounted_sig_str);
     return GetMountedImageResult{true, mounted_sig_str, "Success"};
 }
\ No newline at end of file
@@ -20,14 +20,19 @@
 #ifndef DEVDISKMANAGER_H
 #define DEVDISKMANAGER_H
 
+#include "diskimagecache.h"
 #include "iDescriptor.h"
+#include <QFuture>
 #include <QMap>
+#include <QMutex>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QObject>
 #include <QStringList>
+#include <atomic>
 #include <libimobiledevice/mobile_image_mounter.h>
+#include <memory>
 
 class DevDiskManager : public QObject
 {
@@ -42,9 +47,9 @@ public:
                                     uint64_t mounted_sig_len);
     QList<ImageInfo> getAllImages() const;
 
-    // Download management
-    QPair<QNetworkReply *, QNetworkReply *>
-    downloadImage(const QString &version);
+    // Download management, reported through imageDownload* signals
+    bool downloadImage(const QString &version);
+    void cancelDownload(const QString &version);
     bool isImageDownloaded(const QString &version,
                            const QString &downloadPath) const;
 
@@ -52,6 +57,14 @@ public:
 
     mobile_image_mounter_error_t mountImage(const QString &version,
                                             iDescriptorDevice *device);
+    // Mounts on a worker, reports imageUploadProgress and then
+    // imageMountFinished. False if it could not start.
+    bool mountImageAsync(const QString &version, iDescriptorDevice *device);
+    // A mountImageAsync() for the device is still running, GUI thread only
+    bool isMountPending(const std::string &udid) const
+    {
+        return m_pendingMounts.contains(udid);
+    }
     bool unmountImage();
 
     // Signature comparison
@@ -59,7 +72,14 @@ public:
                            const char *mounted_sig, uint64_t mounted_sig_len);
 
     QByteArray getImageListData() const { return m_imageListJsonData; }
-    GetMountedImageResult getMountedImage(const char *udid);
+    // A known mount is answered without asking the device unless refresh
+    GetMountedImageResult getMountedImage(iDescriptorDevice *device,
+                                          bool refresh = false);
+    // Mount state per device, no device I/O and safe from any thread.
+    // Forgotten when the device disconnects, which a reboot implies.
+    bool isImageMounted(const std::string &udid) const;
+    void setImageMounted(const std::string &udid,
+                         const std::string &signature);
     bool mountCompatibleImage(iDescriptorDevice *device);
     bool downloadCompatibleImage(iDescriptorDevice *device,
                                  std::function<void(bool)> callback);
@@ -70,26 +90,28 @@ signals:
     void imageDownloadProgress(const QString &version, int percentage);
     void imageDownloadFinished(const QString &version, bool success,
                                const QString &errorMessage = QString());
-
-private slots:
-    void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
-    void onFileDownloadFinished();
+    void imageUploadProgress(const QString &udid, qint64 sent, qint64 total);
+    void imageMountFinished(const QString &udid, const QString &version,
+                            mobile_image_mounter_error_t error);
 
 private:
-    struct DownloadItem {
-        QString version;
-        QString downloadPath;
-        QNetworkReply *dmgReply = nullptr;
-        QNetworkReply *sigReply = nullptr;
-        qint64 dmgReceived = 0;
-        qint64 sigReceived = 0;
-        qint64 totalSize = 0;
+    struct PendingMount {
+        QFuture<mobile_image_mounter_error_t> future;
+        std::shared_ptr<std::atomic<bool>> cancelled;
     };
 
+    void onDeviceRemoved(const std::string &udid);
+    void forgetMountedImage(const std::string &udid);
+    static std::string localSignature(const QString &versionPath);
+
     QNetworkAccessManager *m_networkManager;
+    DiskImageCache *m_imageCache;
     QByteArray m_imageListJsonData;
     QMap<QString, ImageInfo> m_availableImages;
-    QMap<QNetworkReply *, DownloadItem *> m_activeDownloads;
+
+    mutable QMutex m_mountStateMutex;
+    QMap<std::string, std::string> m_mountedImages; // udid -> signature
+    QMap<std::string, PendingMount> m_pendingMounts;
 
     QMap<QString, QMap<QString, QString>> parseDiskDir();
     QList<ImageInfo>
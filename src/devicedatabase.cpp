@@ -18,10 +18,18 @@
  */
 
 #include "devicedatabase.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <utility>
 
+namespace
+{
 // https://github.com/libimobiledevice/libirecovery/blob/master/src/libirecovery.c
-const DeviceDatabaseInfo DeviceDatabase::m_devices[] = {
+constexpr DeviceDatabaseInfo kDevices[] = {
     /* iPhone */
     {"iPhone1,1", "m68ap", 0x00, 0x8900, "iPhone 2G", "iPhone 2G"},
     {"iPhone1,2", "n82ap", 0x04, 0x8900, "iPhone 3G", "iPhone 3G"},
@@ -430,145 +438,191 @@ const DeviceDatabaseInfo DeviceDatabase::m_devices[] = {
     {"AppleDisplay2,1", "j327ap", 0x22, 0x8030, "Studio Display"},
     /* Apple Vision Pro */
     {"RealityDevice14,1", "n301ap", 0x42, 0x8112, "Apple Vision Pro"},
-    {NULL, NULL, -1, -1, NULL}};
+};
 
-const DeviceDatabaseInfo *
-DeviceDatabase::findByIdentifier(const std::string &identifier)
+constexpr size_t kDeviceCount = std::size(kDevices);
+static_assert(kDeviceCount <= UINT16_MAX, "index entries are 16 bit");
+
+using DeviceIndex = std::array<uint16_t, kDeviceCount>;
+
+/*
+ * Row numbers of kDevices sorted by the given key, built at compile time.
+ * Equal keys keep table order so lookups still return the first matching
+ * row, like the linear scans they replace.
+ */
+template <typename KeyOf> constexpr DeviceIndex makeIndex(KeyOf keyOf)
 {
-    for (const auto &device : m_devices) {
-        if (device.modelIdentifier == nullptr) {
-            break;
-        }
-        if (identifier == device.modelIdentifier) {
-            return &device;
-        }
+    DeviceIndex index{};
+    for (size_t i = 0; i < kDeviceCount; ++i) {
+        index[i] = static_cast<uint16_t>(i);
     }
-    return nullptr;
+    std::sort(index.begin(), index.end(), [&](uint16_t a, uint16_t b) {
+        const auto keyA = keyOf(kDevices[a]);
+        const auto keyB = keyOf(kDevices[b]);
+        return keyA < keyB || (!(keyB < keyA) && a < b);
+    });
+    return index;
 }
 
-const DeviceDatabaseInfo *
-DeviceDatabase::findByHwModel(const std::string &hwModel)
+template <typename KeyOf>
+constexpr bool hasUniqueKeys(const DeviceIndex &index, KeyOf keyOf)
 {
-    for (const auto &device : m_devices) {
-        if (device.boardId == nullptr) {
-            break;
-        }
-        if (hwModel == device.boardId) {
-            return &device;
+    for (size_t i = 1; i < index.size(); ++i) {
+        if (!(keyOf(kDevices[index[i - 1]]) < keyOf(kDevices[index[i]]))) {
+            return false;
         }
     }
-    return nullptr;
+    return true;
 }
 
-std::string DeviceDatabase::parseRegionInfo(const std::string &code)
+template <typename KeyOf, typename Key>
+const DeviceDatabaseInfo *lookup(const DeviceIndex &index, KeyOf keyOf,
+                                 const Key &key)
 {
-    // North America
-    if (code == "LL/A")
-        return "United States, Canada";
-    if (code == "LL")
-        return "United States, Canada";
+    auto it = std::lower_bound(
+        index.begin(), index.end(), key,
+        [&](uint16_t row, const Key &k) { return keyOf(kDevices[row]) < k; });
+    if (it == index.end() || keyOf(kDevices[*it]) != key) {
+        return nullptr;
+    }
+    return &kDevices[*it];
+}
 
-    // Latin America
-    if (code == "LA/A")
-        return "Latin America";
-    if (code == "BR/A" || code == "BZ/A")
-        return "Brazil";
-    if (code == "CL/A")
-        return "Chile";
-    if (code == "CO/A")
-        return "Colombia";
-    if (code == "MX/A")
-        return "Mexico";
-    if (code == "AR/A")
-        return "Argentina";
+constexpr std::string_view identifierOf(const DeviceDatabaseInfo &d)
+{
+    return d.modelIdentifier;
+}
 
-    // Asia Pacific
-    if (code == "J/A")
-        return "Japan";
-    if (code == "KH/A")
-        return "Thailand, Cambodia";
-    if (code == "MY/A")
-        return "Malaysia";
-    if (code == "ZP/A")
-        return "Hong Kong, Macau";
-    if (code == "CH/A")
-        return "China";
-    if (code == "TA/A")
-        return "Taiwan";
-    if (code == "KR/A")
-        return "Korea";
-    if (code == "SG/A")
-        return "Singapore";
-    if (code == "IN/A")
-        return "India";
-    if (code == "TH/A")
-        return "Thailand";
-    if (code == "VN/A")
-        return "Vietnam";
-    if (code == "ID/A")
-        return "Indonesia";
-    if (code == "PH/A")
-        return "Philippines";
-    if (code == "NZ/A")
-        return "New Zealand";
-    if (code == "AU/A" || code == "X/A")
-        return "Australia";
+constexpr std::string_view hwModelOf(const DeviceDatabaseInfo &d)
+{
+    return d.boardId;
+}
 
-    // Europe
-    if (code == "ZA/A")
-        return "South Africa";
-    if (code == "AB/A")
-        return "Egypt, Jordan, Saudi Arabia, UAE";
-    if (code == "AE/A")
-        return "United Arab Emirates";
-    if (code == "B/A")
-        return "United Kingdom, Ireland";
-    if (code == "FB/A")
-        return "France, Luxembourg";
-    if (code == "FD/A")
-        return "Austria, Liechtenstein, Switzerland";
-    if (code == "GR/A")
-        return "Greece";
-    if (code == "HN/A")
-        return "India";
-    if (code == "IP/A")
-        return "Italy";
-    if (code == "KN/A")
-        return "Denmark, Norway";
-    if (code == "KS/A")
-        return "Finland, Sweden";
-    if (code == "LZ/A")
-        return "Paraguay, Uruguay";
-    if (code == "MG/A")
-        return "Hungary";
-    if (code == "PO/A")
-        return "Poland";
-    if (code == "PP/A")
-        return "Philippines";
-    if (code == "RO/A")
-        return "Romania";
-    if (code == "RS/A")
-        return "Russia";
-    if (code == "SL/A")
-        return "Slovakia";
-    if (code == "SO/A")
-        return "South Africa";
-    if (code == "T/A")
-        return "Italy";
-    if (code == "TU/A")
-        return "Turkey";
-    if (code == "Y/A")
-        return "Spain";
-    if (code == "ZD/A")
-        return "Germany, Luxembourg";
+constexpr std::pair<int, int> chipAndBoardOf(const DeviceDatabaseInfo &d)
+{
+    return {d.chipId, d.boardNumber};
+}
 
-    // Middle East
-    if (code == "HB/A")
-        return "Israel";
+constexpr DeviceIndex kByIdentifier = makeIndex(identifierOf);
+constexpr DeviceIndex kByHwModel = makeIndex(hwModelOf);
+constexpr DeviceIndex kByChipAndBoard = makeIndex(chipAndBoardOf);
+
+static_assert(hasUniqueKeys(kByHwModel, hwModelOf),
+              "hardware models must be unique");
+static_assert(hasUniqueKeys(kByChipAndBoard, chipAndBoardOf),
+              "(chip id, board id) pairs must be unique");
 
+struct RegionInfo {
+    std::string_view code;
+    std::string_view region;
+};
+
+constexpr RegionInfo kRegionsUnsorted[] = {
+    // North America
+    {"LL/A", "United States, Canada"},
+    {"LL", "United States, Canada"},
+    // Latin America
+    {"LA/A", "Latin America"},
+    {"BR/A", "Brazil"},
+    {"BZ/A", "Brazil"},
+    {"CL/A", "Chile"},
+    {"CO/A", "Colombia"},
+    {"MX/A", "Mexico"},
+    {"AR/A", "Argentina"},
+    // Asia Pacific
+    {"J/A", "Japan"},
+    {"KH/A", "Thailand, Cambodia"},
+    {"MY/A", "Malaysia"},
+    {"ZP/A", "Hong Kong, Macau"},
+    {"CH/A", "China"},
+    {"TA/A", "Taiwan"},
+    {"KR/A", "Korea"},
+    {"SG/A", "Singapore"},
+    {"IN/A", "India"},
+    {"TH/A", "Thailand"},
+    {"VN/A", "Vietnam"},
+    {"ID/A", "Indonesia"},
+    {"PH/A", "Philippines"},
+    {"NZ/A", "New Zealand"},
+    {"AU/A", "Australia"},
+    {"X/A", "Australia"},
+    // Europe
+    {"ZA/A", "South Africa"},
+    {"AB/A", "Egypt, Jordan, Saudi Arabia, UAE"},
+    {"AE/A", "United Arab Emirates"},
+    {"B/A", "United Kingdom, Ireland"},
+    {"FB/A", "France, Luxembourg"},
+    {"FD/A", "Austria, Liechtenstein, Switzerland"},
+    {"GR/A", "Greece"},
+    {"HN/A", "India"},
+    {"IP/A", "Italy"},
+    {"KN/A", "Denmark, Norway"},
+    {"KS/A", "Finland, Sweden"},
+    {"LZ/A", "Paraguay, Uruguay"},
+    {"MG/A", "Hungary"},
+    {"PO/A", "Poland"},
+    {"PP/A", "Philippines"},
+    {"RO/A", "Romania"},
+    {"RS/A", "Russia"},
+    {"SL/A", "Slovakia"},
+    {"SO/A", "South Africa"},
+    {"T/A", "Italy"},
+    {"TU/A", "Turkey"},
+    {"Y/A", "Spain"},
+    {"ZD/A", "Germany, Luxembourg"},
+    // Middle East
+    {"HB/A", "Israel"},
     // Canada
-    if (code == "C/A")
-        return "Canada (English, French)";
+    {"C/A", "Canada (English, French)"},
+};
+
+constexpr auto kRegions = [] {
+    std::array<RegionInfo, std::size(kRegionsUnsorted)> regions{};
+    std::copy(std::begin(kRegionsUnsorted), std::end(kRegionsUnsorted),
+              regions.begin());
+    std::sort(regions.begin(), regions.end(),
+              [](const RegionInfo &a, const RegionInfo &b) {
+                  return a.code < b.code;
+              });
+    return regions;
+}();
+
+static_assert(std::adjacent_find(kRegions.begin(), kRegions.end(),
+                                 [](const RegionInfo &a, const RegionInfo &b) {
+                                     return a.code == b.code;
+                                 }) == kRegions.end(),
+              "region codes must be unique");
+} // namespace
+
+const DeviceDatabaseInfo *
+DeviceDatabase::findByIdentifier(const std::string &identifier)
+{
+    return lookup(kByIdentifier, identifierOf, std::string_view(identifier));
+}
+
+const DeviceDatabaseInfo *
+DeviceDatabase::findByHwModel(const std::string &hwModel)
+{
+    return lookup(kByHwModel, hwModelOf, std::string_view(hwModel));
+}
+
+const DeviceDatabaseInfo *DeviceDatabase::findByChipAndBoard(int chipId,
+                                                             int boardNumber)
+{
+    return lookup(kByChipAndBoard, chipAndBoardOf,
+                  std::make_pair(chipId, boardNumber));
+}
+
+std::string DeviceDatabase::parseRegionInfo(const std::string &code)
+{
+    auto it = std::lower_bound(kRegions.begin(), kRegions.end(),
+                               std::string_view(code),
+                               [](const RegionInfo &info, std::string_view c) {
+                                   return info.code < c;
+                               });
+    if (it != kRegions.end() && it->code == code) {
+        return std::string(it->region);
+    }
 
     return "Unknown Region (" + code + ")";
-}
\ No newline at end of file
+}
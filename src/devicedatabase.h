@@ -39,10 +39,10 @@ public:
     static const DeviceDatabaseInfo *
     findByIdentifier(const std::string &identifier);
     static const DeviceDatabaseInfo *findByHwModel(const std::string &hwModel);
+    // Recovery/DFU devices only report CPID and BDID
+    static const DeviceDatabaseInfo *findByChipAndBoard(int chipId,
+                                                        int boardNumber);
     static std::string parseRegionInfo(const std::string &code);
-
-private:
-    static const DeviceDatabaseInfo m_devices[];
 };
 
 #endif // DEVICEDATABASE_H
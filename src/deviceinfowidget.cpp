@@ -19,6 +19,7 @@
 
 #include "deviceinfowidget.h"
 #include "batterywidget.h"
+#include "devicetelemetry.h"
 #include "diskusagewidget.h"
 #include "fileexplorerwidget.h"
 #include "iDescriptor-ui.h"
@@ -347,10 +348,15 @@ DeviceInfoWidget::DeviceInfoWidget(iDescriptorDevice *device, QWidget *parent)
     mainLayout->addLayout(rightSideLayout);
     mainLayout->addStretch();
 
-    m_updateTimer = new QTimer(this);
-    connect(m_updateTimer, &QTimer::timeout, this,
+    // Sampling runs on the telemetry thread, we only get told about changes
+    DeviceTelemetrySampler *sampler =
+        DeviceTelemetry::sharedInstance()->sampler(m_device);
+    connect(sampler, &DeviceTelemetrySampler::sampleChanged, this,
             &DeviceInfoWidget::updateBatteryInfo);
-    m_updateTimer->start(30000); // Update every 30 seconds
+    BatterySample latest;
+    if (sampler->latest(latest)) {
+        updateBatteryInfo(latest);
+    }
 }
 
 DeviceInfoWidget::~DeviceInfoWidget() {}
@@ -368,36 +374,25 @@ void DeviceInfoWidget::onBatteryMoreClicked()
     msgBox.exec();
 }
 
-void DeviceInfoWidget::updateBatteryInfo()
+void DeviceInfoWidget::updateBatteryInfo(const BatterySample &sample)
 {
-    qDebug() << "Updating battery info...";
-    plist_t diagnostics = nullptr;
-    get_battery_info(m_device->deviceInfo.rawProductType, m_device->device,
-                     m_device->deviceInfo.is_iPhone, diagnostics);
-
-    if (!diagnostics) {
-        qDebug() << "Failed to get diagnostics plist.";
-        return;
-    }
     /*DATA*/
-    DeviceInfo &d = m_device->deviceInfo;
-    qDebug() << "old device" << d.oldDevice;
-    PlistNavigator ioreg = PlistNavigator(diagnostics)["IORegistry"];
-    if (d.oldDevice)
-        parseOldDeviceBattery(ioreg, d);
-    else
-        parseDeviceBattery(ioreg, d);
+    BatteryInfo &b = m_device->deviceInfo.batteryInfo;
+    b.isCharging = sample.isCharging;
+    b.fullyCharged = sample.fullyCharged;
+    b.currentBatteryLevel = sample.level;
+    b.usbConnectionType = sample.connectionType;
+    b.adapterVoltage = sample.adapterVoltage;
+    b.watts = sample.watts;
     /*UI*/
     updateChargingStatusIcon();
     m_chargingWattsWithCableTypeLabel->setText(
-        QString::number(d.batteryInfo.watts) + "W" + "/" +
-        (d.batteryInfo.usbConnectionType == BatteryInfo::ConnectionType::USB
-             ? "USB"
-             : "USB-C"));
+        QString::number(b.watts) + "W" + "/" +
+        (b.usbConnectionType == BatteryInfo::ConnectionType::USB ? "USB"
+                                                                 : "USB-C"));
 
     m_batteryWidget->updateContext(
-        d.batteryInfo.isCharging,
-        qBound<int>(1, d.batteryInfo.currentBatteryLevel, 100));
+        b.isCharging, qBound<int>(1, b.currentBatteryLevel, 100));
 }
 
 void DeviceInfoWidget::updateChargingStatusIcon()
@@ -21,10 +21,10 @@
 #define DEVICEINFOWIDGET_H
 #include "batterywidget.h"
 #include "deviceimagewidget.h"
+#include "devicetelemetry.h"
 #include "iDescriptor-ui.h"
 #include "iDescriptor.h"
 #include <QLabel>
-#include <QTimer>
 #include <QWidget>
 
 class DeviceInfoWidget : public QWidget
@@ -37,11 +37,10 @@ public:
 
 private slots:
     void onBatteryMoreClicked();
+    void updateBatteryInfo(const BatterySample &sample);
 
 private:
     iDescriptorDevice *m_device;
-    QTimer *m_updateTimer;
-    void updateBatteryInfo();
     void updateChargingStatusIcon();
     QLabel *m_chargingStatusLabel;
     QLabel *m_chargingWattsWithCableTypeLabel;
@@ -0,0 +1,267 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "devicetelemetry.h"
+#include "appcontext.h"
+#include "servicebroker.h"
+#include "settingsmanager.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QMutexLocker>
+
+bool BatterySample::differsForUi(const BatterySample &other) const
+{
+    return level != other.level || isCharging != other.isCharging ||
+           fullyCharged != other.fullyCharged ||
+           externalConnected != other.externalConnected ||
+           connectionType != other.connectionType || watts != other.watts ||
+           adapterVoltage != other.adapterVoltage;
+}
+
+DeviceTelemetrySampler::DeviceTelemetrySampler(iDescriptorDevice *device,
+                                               int intervalMs,
+                                               QObject *parent)
+    : QThread(parent), m_device(device),
+      m_oldDevice(device->deviceInfo.oldDevice), m_intervalMs(intervalMs),
+      m_ring(HistoryCapacity)
+{
+}
+
+DeviceTelemetrySampler::~DeviceTelemetrySampler()
+{
+    stop();
+    wait();
+}
+
+void DeviceTelemetrySampler::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_shouldStop = true;
+    m_waitCondition.wakeAll();
+}
+
+void DeviceTelemetrySampler::setInterval(int intervalMs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_intervalMs == intervalMs) {
+        return;
+    }
+    m_intervalMs = intervalMs;
+    // Take the next sample right away so the new rate applies immediately
+    m_waitCondition.wakeAll();
+}
+
+QVector<BatterySample> DeviceTelemetrySampler::history() const
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<BatterySample> samples;
+    samples.reserve(m_count);
+    const int first = (m_head - m_count + HistoryCapacity) % HistoryCapacity;
+    for (int i = 0; i < m_count; ++i) {
+        samples.append(m_ring[(first + i) % HistoryCapacity]);
+    }
+    return samples;
+}
+
+bool DeviceTelemetrySampler::latest(BatterySample &sample) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_count == 0) {
+        return false;
+    }
+    sample = m_ring[(m_head - 1 + HistoryCapacity) % HistoryCapacity];
+    return true;
+}
+
+void DeviceTelemetrySampler::run()
+{
+    ServiceBroker *broker = ServiceBroker::sharedInstance();
+    diagnostics_relay_client_t client = nullptr;
+
+    QMutexLocker locker(&m_mutex);
+    while (!m_shouldStop) {
+        locker.unlock();
+
+        if (!client) {
+            // Only the service start goes through the shared lockdown session
+            client = broker->acquire<diagnostics_relay_client_t>(
+                m_device->device);
+            if (!client) {
+                qDebug() << "DeviceTelemetrySampler: Failed to start "
+                            "diagnostics relay for"
+                         << QString::fromStdString(m_device->udid);
+            }
+        }
+
+        BatterySample sample;
+        if (client && readSample(client, sample)) {
+            record(sample);
+        } else if (client) {
+            // Session went stale, reopen it on the next tick
+            broker->release(m_device->device, client, false);
+            client = nullptr;
+        }
+
+        locker.relock();
+        if (m_shouldStop) {
+            break;
+        }
+        m_waitCondition.wait(&m_mutex, m_intervalMs);
+    }
+    locker.unlock();
+
+    if (client) {
+        broker->release(m_device->device, client);
+    }
+}
+
+bool DeviceTelemetrySampler::readSample(diagnostics_relay_client_t client,
+                                        BatterySample &sample)
+{
+    plist_t diagnostics = nullptr;
+    if (diagnostics_relay_query_ioregistry_entry(
+            client, nullptr, "IOPMPowerSource", &diagnostics) !=
+            DIAGNOSTICS_RELAY_E_SUCCESS ||
+        !diagnostics) {
+        if (diagnostics) {
+            plist_free(diagnostics);
+        }
+        return false;
+    }
+
+    PlistNavigator ioreg = PlistNavigator(diagnostics)["IORegistry"];
+    if (!ioreg.valid()) {
+        plist_free(diagnostics);
+        return false;
+    }
+
+    // Same parsing as device init, on a scratch copy so the shared
+    // DeviceInfo is only ever written from the GUI thread
+    DeviceInfo scratch;
+    if (m_oldDevice)
+        parseOldDeviceBattery(ioreg, scratch);
+    else
+        parseDeviceBattery(ioreg, scratch);
+
+    const BatteryInfo &b = scratch.batteryInfo;
+    sample.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    sample.level = static_cast<int>(b.currentBatteryLevel);
+    sample.isCharging = b.isCharging;
+    sample.fullyCharged = b.fullyCharged;
+    sample.externalConnected = ioreg["ExternalConnected"].getBool();
+    sample.connectionType = b.usbConnectionType;
+    sample.watts = b.watts;
+    sample.adapterVoltage = b.adapterVoltage;
+    sample.voltage = static_cast<int>(ioreg["Voltage"].getUInt());
+    // Signed in the registry, libplist hands it back as raw bits
+    const uint64_t amperage = ioreg["InstantAmperage"].getUInt();
+    sample.amperage = static_cast<int>(static_cast<int64_t>(amperage));
+    sample.temperature = static_cast<int>(ioreg["Temperature"].getUInt());
+
+    plist_free(diagnostics);
+    return true;
+}
+
+void DeviceTelemetrySampler::record(const BatterySample &sample)
+{
+    bool publish = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_ring[m_head] = sample;
+        m_head = (m_head + 1) % HistoryCapacity;
+        m_count = qMin(m_count + 1, HistoryCapacity);
+
+        if (!m_hasPublished || sample.differsForUi(m_lastPublished)) {
+            m_hasPublished = true;
+            m_lastPublished = sample;
+            publish = true;
+        }
+    }
+
+    if (publish) {
+        emit sampleChanged(sample);
+    }
+}
+
+DeviceTelemetry *DeviceTelemetry::sharedInstance()
+{
+    static DeviceTelemetry instance;
+    return &instance;
+}
+
+DeviceTelemetry::DeviceTelemetry(QObject *parent) : QObject(parent)
+{
+    qRegisterMetaType<BatterySample>("BatterySample");
+
+    // deviceRemoved is emitted before the device is freed, so the
+    // sampler is guaranteed to be gone by the time idevice_free runs
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            &DeviceTelemetry::removeSampler);
+    connect(SettingsManager::sharedInstance(),
+            &SettingsManager::batterySampleIntervalChanged, this,
+            &DeviceTelemetry::setInterval);
+    connect(qApp, &QCoreApplication::aboutToQuit, this,
+            &DeviceTelemetry::stopAll);
+}
+
+DeviceTelemetry::~DeviceTelemetry() { stopAll(); }
+
+DeviceTelemetrySampler *DeviceTelemetry::sampler(iDescriptorDevice *device)
+{
+    auto it = m_samplers.find(device->udid);
+    if (it != m_samplers.end()) {
+        return it.value();
+    }
+
+    const int intervalMs =
+        SettingsManager::sharedInstance()->batterySampleInterval() * 1000;
+    auto *sampler = new DeviceTelemetrySampler(device, intervalMs);
+    m_samplers.insert(device->udid, sampler);
+    sampler->start(QThread::LowPriority);
+    return sampler;
+}
+
+void DeviceTelemetry::removeSampler(const std::string &udid)
+{
+    DeviceTelemetrySampler *sampler = m_samplers.take(udid);
+    if (sampler) {
+        // Blocks for at most one in-flight query
+        delete sampler;
+    }
+}
+
+void DeviceTelemetry::setInterval(int seconds)
+{
+    for (DeviceTelemetrySampler *sampler : m_samplers) {
+        sampler->setInterval(seconds * 1000);
+    }
+}
+
+void DeviceTelemetry::stopAll()
+{
+    // Signal every thread first so they wind down in parallel
+    for (DeviceTelemetrySampler *sampler : m_samplers) {
+        sampler->stop();
+    }
+    for (DeviceTelemetrySampler *sampler : m_samplers) {
+        delete sampler;
+    }
+    m_samplers.clear();
+}
@@ -0,0 +1,135 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DEVICETELEMETRY_H
+#define DEVICETELEMETRY_H
+
+#include "iDescriptor.h"
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+#include <libimobiledevice/diagnostics_relay.h>
+
+/**
+ * @brief One battery/charger reading, cheap to copy and keep in bulk
+ */
+struct BatterySample {
+    qint64 timestampMs = 0; // msecs since epoch
+    int level = 0;          // percent
+    bool isCharging = false;
+    bool fullyCharged = false;
+    bool externalConnected = false;
+    BatteryInfo::ConnectionType connectionType =
+        BatteryInfo::ConnectionType::USB;
+    uint64_t watts = 0;
+    uint64_t adapterVoltage = 0; // mV
+    int voltage = 0;             // mV
+    int amperage = 0;            // mA, negative while discharging
+    int temperature = 0;         // centi-degrees Celsius
+
+    // True if anything shown in the device info page differs
+    bool differsForUi(const BatterySample &other) const;
+};
+Q_DECLARE_METATYPE(BatterySample)
+
+/**
+ * @brief Samples battery state of one device on its own thread
+ *
+ * Keeps a single diagnostics_relay session open for the lifetime of the
+ * sampler instead of starting a new service per reading, and only reopens
+ * it after a failed query. Every reading goes into a fixed-size ring
+ * buffer, sampleChanged() is only emitted when something the UI shows
+ * actually changed.
+ */
+class DeviceTelemetrySampler : public QThread
+{
+    Q_OBJECT
+
+public:
+    // ~11 hours of history at the default 10 s interval
+    static constexpr int HistoryCapacity = 4096;
+
+    explicit DeviceTelemetrySampler(iDescriptorDevice *device,
+                                    int intervalMs,
+                                    QObject *parent = nullptr);
+    ~DeviceTelemetrySampler() override;
+
+    void stop();
+    void setInterval(int intervalMs);
+
+    // Oldest first
+    QVector<BatterySample> history() const;
+    bool latest(BatterySample &sample) const;
+
+signals:
+    void sampleChanged(const BatterySample &sample);
+
+protected:
+    void run() override;
+
+private:
+    bool readSample(diagnostics_relay_client_t client,
+                    BatterySample &sample);
+    void record(const BatterySample &sample);
+
+    iDescriptorDevice *m_device;
+    const bool m_oldDevice;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_waitCondition;
+    bool m_shouldStop = false;
+    int m_intervalMs;
+
+    QVector<BatterySample> m_ring;
+    int m_head = 0; // next slot to write
+    int m_count = 0;
+    bool m_hasPublished = false;
+    BatterySample m_lastPublished;
+};
+
+/**
+ * @brief Owns one DeviceTelemetrySampler per connected device
+ *
+ * Samplers are started on first use and stopped when the device goes
+ * away, before its idevice_t is freed.
+ */
+class DeviceTelemetry : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DeviceTelemetry *sharedInstance();
+
+    DeviceTelemetrySampler *sampler(iDescriptorDevice *device);
+    void stopAll();
+
+private:
+    explicit DeviceTelemetry(QObject *parent = nullptr);
+    ~DeviceTelemetry();
+
+    void removeSampler(const std::string &udid);
+    void setInterval(int seconds);
+
+    QMap<std::string, DeviceTelemetrySampler *> m_samplers;
+};
+
+#endif // DEVICETELEMETRY_H
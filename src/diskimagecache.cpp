@@ -0,0 +1,690 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "diskimagecache.h"
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkRequest>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrent>
+#include <filesystem>
+#include <limits>
+
+namespace
+{
+// Every chunk is its own request, a dropped connection costs at most one
+constexpr qint64 ChunkBytes = 16 * 1024 * 1024;
+constexpr int MaxActiveTransfers = 4;
+constexpr int MaxRetries = 3;
+// Qt stops reading the socket once this much is buffered, which is what
+// lets the budget hold the sender back
+constexpr qint64 ReadBufferBytes = 256 * 1024;
+constexpr int TicksPerSecond = 10;
+
+constexpr char PartialDir[] = ".partial";
+constexpr char ObjectsDir[] = "objects";
+constexpr char ManifestName[] = "manifest.json";
+
+QString objectPath(const QString &root, const QByteArray &sha256)
+{
+    return QDir(QDir(root).filePath(ObjectsDir))
+        .filePath(QString::fromLatin1(sha256));
+}
+
+QString imagePath(const QString &root, const QString &version,
+                  const QString &name)
+{
+    return QDir(QDir(root).filePath(version)).filePath(name);
+}
+
+QByteArray readValidator(const QString &partPath)
+{
+    QFile file(partPath + ".validator");
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+void writeValidator(const QString &partPath, const QByteArray &validator)
+{
+    QFile file(partPath + ".validator");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(validator);
+    }
+}
+
+// Size of the hashed prefix, -1 if it can't be read
+qint64 hashPrefix(const QString &path, QCryptographicHash *hash)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || !hash->addData(&file)) {
+        return -1;
+    }
+    return file.size();
+}
+} // namespace
+
+DiskImageCache::DiskImageCache(QObject *parent)
+    : QObject{parent}, m_networkManager(new QNetworkAccessManager(this))
+{
+    m_ticker.setInterval(1000 / TicksPerSecond);
+    connect(&m_ticker, &QTimer::timeout, this, &DiskImageCache::onTick);
+}
+
+void DiskImageCache::fetch(const QString &root, const QString &version,
+                           const QList<File> &files)
+{
+    if (m_fetches.contains(version)) {
+        return;
+    }
+
+    const QString partialDir =
+        QDir(QDir(root).filePath(PartialDir)).filePath(version);
+    if (!QDir().mkpath(partialDir) ||
+        !QDir().mkpath(QDir(root).filePath(ObjectsDir)) ||
+        !QDir().mkpath(QDir(root).filePath(version))) {
+        emit finished(version, false,
+                      QString("Could not create directory: %1").arg(root));
+        return;
+    }
+
+    auto state = std::make_shared<Fetch>();
+    state->root = root;
+    state->version = version;
+    state->pending = files.size();
+    m_fetches.insert(version, state);
+
+    for (const File &file : files) {
+        auto transfer = std::make_shared<Transfer>();
+        transfer->fetch = state;
+        transfer->file = file;
+        transfer->partPath = QDir(partialDir).filePath(file.name + ".part");
+        m_queue.append(transfer);
+    }
+    startNext();
+}
+
+void DiskImageCache::cancel(const QString &version)
+{
+    if (auto fetch = m_fetches.value(version)) {
+        stop(fetch.get(), "Download cancelled");
+    }
+}
+
+bool DiskImageCache::isFetching(const QString &version) const
+{
+    return m_fetches.contains(version);
+}
+
+void DiskImageCache::startNext()
+{
+    while (m_active.size() < MaxActiveTransfers && !m_queue.isEmpty()) {
+        TransferPtr transfer = m_queue.takeFirst();
+        m_active.append(transfer);
+        start(transfer);
+    }
+    if (m_bandwidthLimit > 0 && !m_active.isEmpty() && !m_ticker.isActive()) {
+        m_ticker.start();
+    }
+}
+
+void DiskImageCache::start(const TransferPtr &transfer)
+{
+    Fetch *fetch = transfer->fetch.get();
+
+    // Images from before the cache existed resume like a partial download,
+    // the server has nothing left to send for a complete one
+    const QString legacy =
+        imagePath(fetch->root, fetch->version, transfer->file.name);
+    if (!QFile::exists(transfer->partPath) && QFile::exists(legacy) &&
+        !manifest(fetch->root).contains(fetch->version)) {
+        QFile::rename(legacy, transfer->partPath);
+    }
+    transfer->validator = readValidator(transfer->partPath);
+
+    auto *watcher = new QFutureWatcher<qint64>(this);
+    connect(watcher, &QFutureWatcher<qint64>::finished, this,
+            [this, watcher, transfer]() {
+                watcher->deleteLater();
+                if (transfer->fetch->stopped) {
+                    return;
+                }
+                const qint64 size = watcher->result();
+                transfer->output.setFileName(transfer->partPath);
+                if (size <= 0) {
+                    transfer->hash.reset();
+                    transfer->validator.clear();
+                }
+                transfer->offset = qMax<qint64>(size, 0);
+                const auto mode = transfer->offset > 0
+                                      ? QIODevice::Append
+                                      : QIODevice::Truncate;
+                if (!transfer->output.open(QIODevice::WriteOnly | mode)) {
+                    stop(transfer->fetch.get(),
+                         QString("Could not write %1: %2")
+                             .arg(transfer->partPath,
+                                  transfer->output.errorString()));
+                    return;
+                }
+                if (transfer->offset > 0) {
+                    qDebug() << "Resuming" << transfer->file.url << "at"
+                             << transfer->offset;
+                }
+                requestChunk(transfer);
+            });
+    // Local read, but images run to hundreds of MB
+    watcher->setFuture(QtConcurrent::run([transfer]() {
+        return QFile::exists(transfer->partPath)
+                   ? hashPrefix(transfer->partPath, &transfer->hash)
+                   : qint64(0);
+    }));
+}
+
+void DiskImageCache::requestChunk(const TransferPtr &transfer)
+{
+    transfer->headersChecked = false;
+    transfer->payload = false;
+    transfer->replyFinished = false;
+    transfer->chunkStart = transfer->offset;
+    transfer->chunkEnd = transfer->offset + ChunkBytes - 1;
+    if (transfer->total > 0) {
+        transfer->chunkEnd = qMin(transfer->chunkEnd, transfer->total - 1);
+    }
+
+    QNetworkRequest request(transfer->file.url);
+    request.setRawHeader("Range", "bytes=" +
+                                      QByteArray::number(transfer->offset) +
+                                      '-' +
+                                      QByteArray::number(transfer->chunkEnd));
+    // Ranges of a compressed body would not line up with the file
+    request.setRawHeader("Accept-Encoding", "identity");
+    if (transfer->offset > 0 && !transfer->validator.isEmpty()) {
+        request.setRawHeader("If-Range", transfer->validator);
+    }
+
+    QNetworkReply *reply = m_networkManager->get(request);
+    reply->setReadBufferSize(ReadBufferBytes);
+    transfer->reply = reply;
+
+    connect(reply, &QNetworkReply::readyRead, this,
+            [this, transfer]() { pump(transfer, readBudget()); });
+    connect(reply, &QNetworkReply::finished, this, [this, transfer]() {
+        transfer->replyFinished = true;
+        pump(transfer, readBudget());
+    });
+}
+
+// Whether the body is file content
+bool DiskImageCache::checkHeaders(Transfer *transfer)
+{
+    QNetworkReply *reply = transfer->reply;
+    const int status =
+        reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    QByteArray validator = reply->rawHeader("ETag");
+    // Weak tags can't be used with If-Range
+    if (validator.isEmpty() || validator.startsWith("W/")) {
+        validator = reply->rawHeader("Last-Modified");
+    }
+
+    if (status == 206) {
+        static const QRegularExpression contentRange(
+            R"(^bytes (\d+)-(\d+)/(\d+|\*)$)");
+        const QRegularExpressionMatch match = contentRange.match(
+            QString::fromLatin1(reply->rawHeader("Content-Range")));
+        if (!match.hasMatch() ||
+            match.captured(1).toLongLong() != transfer->offset) {
+            qWarning() << "Unexpected Content-Range from"
+                       << transfer->file.url << "starting over";
+            restart(transfer);
+            return false;
+        }
+        if (match.captured(3) != "*") {
+            transfer->total = match.captured(3).toLongLong();
+        }
+    } else if (status == 200) {
+        // Range ignored, or If-Range found the file changed: the whole file
+        // follows
+        if (transfer->offset > 0) {
+            qDebug() << "Server sent" << transfer->file.url
+                     << "in full, discarding the partial download";
+            restart(transfer);
+        }
+        const QVariant length =
+            reply->header(QNetworkRequest::ContentLengthHeader);
+        transfer->total = length.isValid() ? length.toLongLong() : -1;
+        transfer->chunkEnd = std::numeric_limits<qint64>::max();
+    } else {
+        return false;
+    }
+
+    if (validator != transfer->validator) {
+        transfer->validator = validator;
+        writeValidator(transfer->partPath, validator);
+    }
+    return true;
+}
+
+void DiskImageCache::pump(const TransferPtr &transfer, qint64 budget)
+{
+    QNetworkReply *reply = transfer->reply;
+    if (!reply || transfer->fetch->stopped) {
+        return;
+    }
+    if (!transfer->headersChecked &&
+        reply->attribute(QNetworkRequest::HttpStatusCodeAttribute)
+            .isValid()) {
+        transfer->headersChecked = true;
+        transfer->payload = checkHeaders(transfer.get());
+    }
+
+    char buffer[64 * 1024];
+    qint64 pumped = 0;
+    while (pumped < budget) {
+        const qint64 n = reply->read(
+            buffer, qMin<qint64>(sizeof(buffer), budget - pumped));
+        if (n <= 0) {
+            break;
+        }
+        pumped += n;
+        if (!transfer->payload) {
+            continue;
+        }
+        if (transfer->output.write(buffer, n) != n) {
+            stop(transfer->fetch.get(),
+                 QString("Could not write %1: %2")
+                     .arg(transfer->partPath, transfer->output.errorString()));
+            return;
+        }
+        transfer->hash.addData(QByteArrayView(buffer, n));
+        transfer->offset += n;
+    }
+
+    if (m_bandwidthLimit > 0) {
+        m_tokens = qMax<qint64>(m_tokens - pumped, 0);
+    }
+    if (pumped > 0 && transfer->payload) {
+        emitProgress(transfer->fetch.get());
+    }
+    if (transfer->replyFinished && reply->bytesAvailable() == 0) {
+        onChunkFinished(transfer);
+    }
+}
+
+void DiskImageCache::onChunkFinished(const TransferPtr &transfer)
+{
+    QNetworkReply *reply = transfer->reply;
+    transfer->reply = nullptr;
+    reply->deleteLater();
+
+    const int status =
+        reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    if (status == 416 && transfer->offset > 0) {
+        // Asked past the end, the partial file may already be complete
+        const QByteArray range = reply->rawHeader("Content-Range");
+        const qint64 total = range.mid(range.indexOf('/') + 1).toLongLong();
+        if (total == transfer->offset) {
+            transfer->total = total;
+            complete(transfer);
+        } else {
+            restart(transfer.get());
+            requestChunk(transfer);
+        }
+        return;
+    }
+
+    const bool stalled =
+        transfer->payload && transfer->offset == transfer->chunkStart &&
+        transfer->offset != transfer->total;
+    if (reply->error() != QNetworkReply::NoError || !transfer->payload ||
+        stalled) {
+        const QString error = reply->error() != QNetworkReply::NoError
+                                  ? reply->errorString()
+                                  : QString("HTTP status %1").arg(status);
+        if (transfer->retries++ < MaxRetries) {
+            qDebug() << "Retrying" << transfer->file.url << "at"
+                     << transfer->offset << "-" << error;
+            QTimer::singleShot(transfer->retries * 1000, this,
+                               [this, transfer]() {
+                                   if (!transfer->fetch->stopped) {
+                                       requestChunk(transfer);
+                                   }
+                               });
+            return;
+        }
+        stop(transfer->fetch.get(), QString("Failed to download %1: %2")
+                                        .arg(transfer->file.name, error));
+        return;
+    }
+    transfer->retries = 0;
+
+    // No length given, a short range or a plain response ends the file
+    if (transfer->total < 0 && transfer->offset <= transfer->chunkEnd) {
+        transfer->total = transfer->offset;
+    }
+    if (transfer->total >= 0 && transfer->offset >= transfer->total) {
+        complete(transfer);
+    } else {
+        requestChunk(transfer);
+    }
+}
+
+qint64 DiskImageCache::readBudget() const
+{
+    return m_bandwidthLimit > 0 ? m_tokens
+                                : std::numeric_limits<qint64>::max();
+}
+
+void DiskImageCache::restart(Transfer *transfer)
+{
+    transfer->output.resize(0);
+    transfer->output.seek(0);
+    transfer->hash.reset();
+    transfer->offset = 0;
+    transfer->total = -1;
+    transfer->chunkStart = 0;
+}
+
+void DiskImageCache::complete(const TransferPtr &transfer)
+{
+    Fetch *fetch = transfer->fetch.get();
+    transfer->output.close();
+
+    if (transfer->offset != transfer->total) {
+        QFile::remove(transfer->partPath);
+        stop(fetch, QString("%1 is %2 bytes, expected %3")
+                        .arg(transfer->file.name)
+                        .arg(transfer->offset)
+                        .arg(transfer->total));
+        return;
+    }
+
+    const QByteArray sha256 = transfer->hash.result().toHex();
+    if (transfer->file.sha256.isEmpty()) {
+        fetch->checksummed = false;
+    } else if (sha256 != transfer->file.sha256) {
+        QFile::remove(transfer->partPath);
+        stop(fetch, QString("Checksum mismatch for %1: %2")
+                        .arg(transfer->file.name,
+                             QString::fromLatin1(sha256)));
+        return;
+    }
+
+    const QString object = objectPath(fetch->root, sha256);
+    if (QFile::exists(object)) {
+        QFile::remove(transfer->partPath);
+    } else if (!QFile::rename(transfer->partPath, object)) {
+        stop(fetch, QString("Could not store %1").arg(object));
+        return;
+    }
+    QFile::remove(transfer->partPath + ".validator");
+
+    const QString target =
+        imagePath(fetch->root, fetch->version, transfer->file.name);
+    if (!link(object, target)) {
+        stop(fetch, QString("Could not save file: %1").arg(target));
+        return;
+    }
+
+    File file = transfer->file;
+    file.sha256 = sha256;
+    file.size = transfer->offset;
+    fetch->files.append(file);
+    fetch->doneBytes += file.size;
+    m_active.removeIf(
+        [&](const TransferPtr &other) { return other == transfer; });
+
+    if (--fetch->pending == 0) {
+        manifest(fetch->root)
+            .insert(fetch->version,
+                    Image{fetch->files, QDateTime::currentDateTimeUtc(),
+                          fetch->checksummed});
+        saveManifest(fetch->root);
+        QDir(QDir(fetch->root).filePath(PartialDir)).rmdir(fetch->version);
+
+        const QString version = fetch->version;
+        qDebug() << "Developer disk image" << version << "cached"
+                 << (fetch->checksummed ? "and checksummed"
+                                        : "without a known checksum");
+        m_fetches.remove(version);
+        emit finished(version, true);
+    }
+    startNext();
+}
+
+void DiskImageCache::stop(Fetch *fetch, const QString &error)
+{
+    if (fetch->stopped) {
+        return;
+    }
+    fetch->stopped = true;
+
+    auto owned = [fetch](const TransferPtr &transfer) {
+        return transfer->fetch.get() == fetch;
+    };
+    for (const TransferPtr &transfer : m_active) {
+        if (!owned(transfer)) {
+            continue;
+        }
+        if (QNetworkReply *reply = transfer->reply) {
+            transfer->reply = nullptr;
+            disconnect(reply, nullptr, this, nullptr);
+            reply->abort();
+            reply->deleteLater();
+        }
+        transfer->output.close();
+    }
+    m_active.removeIf(owned);
+    m_queue.removeIf(owned);
+
+    // Keeps the fetch alive until the signal is out
+    const std::shared_ptr<Fetch> keep = m_fetches.take(fetch->version);
+    qWarning() << "Developer disk image" << fetch->version
+               << "not fetched:" << error;
+    emit finished(fetch->version, false, error);
+    startNext();
+}
+
+void DiskImageCache::emitProgress(Fetch *fetch)
+{
+    qint64 received = fetch->doneBytes;
+    qint64 total = fetch->doneBytes;
+    for (const TransferPtr &transfer : m_active) {
+        if (transfer->fetch.get() == fetch) {
+            received += transfer->offset;
+            total += qMax<qint64>(transfer->total, transfer->offset);
+        }
+    }
+    emit progress(fetch->version, received, total);
+}
+
+void DiskImageCache::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    m_bandwidthLimit = qMax<qint64>(bytesPerSecond, 0);
+    if (m_bandwidthLimit == 0) {
+        m_ticker.stop();
+        // Drain what was held back
+        const auto active = m_active;
+        for (const TransferPtr &transfer : active) {
+            pump(transfer, readBudget());
+        }
+    } else if (!m_active.isEmpty()) {
+        m_ticker.start();
+    }
+}
+
+/*
+ The budget is refilled every tick and handed out in equal shares, starting
+ with a different transfer each time. Whatever a share leaves unused goes
+ to the next readyRead. Unused budget does not carry over to the next tick.
+*/
+void DiskImageCache::onTick()
+{
+    if (m_active.isEmpty() || m_bandwidthLimit == 0) {
+        m_ticker.stop();
+        return;
+    }
+
+    const qint64 perTick = qMax<qint64>(m_bandwidthLimit / TicksPerSecond, 1);
+    m_tokens = perTick;
+    const auto active = m_active; // pumping may finish transfers
+    const qint64 share = qMax<qint64>(perTick / active.size(), 1);
+    for (int i = 0; i < active.size() && m_tokens > 0; ++i) {
+        pump(active.at((m_nextPump + i) % active.size()),
+             qMin(share, m_tokens));
+    }
+    m_nextPump++;
+}
+
+DiskImageCache::Manifest &DiskImageCache::manifest(const QString &root)
+{
+    auto it = m_manifests.find(root);
+    if (it != m_manifests.end()) {
+        return it.value();
+    }
+
+    Manifest images;
+    QFile file(QDir(root).filePath(ManifestName));
+    if (file.open(QIODevice::ReadOnly)) {
+        const QJsonObject entries =
+            QJsonDocument::fromJson(file.readAll())["images"].toObject();
+        for (auto entry = entries.begin(); entry != entries.end(); ++entry) {
+            const QJsonObject object = entry.value().toObject();
+            Image image;
+            image.verified = QDateTime::fromString(
+                object["verified"].toString(), Qt::ISODateWithMs);
+            image.checksummed = object["checksummed"].toBool();
+            for (const QJsonValue &value : object["files"].toArray()) {
+                const QJsonObject f = value.toObject();
+                image.files.append(
+                    File{f["name"].toString(), QUrl(f["url"].toString()),
+                         f["sha256"].toString().toLatin1(),
+                         f["size"].toInteger()});
+            }
+            images.insert(entry.key(), image);
+        }
+    }
+    return m_manifests.insert(root, images).value();
+}
+
+void DiskImageCache::saveManifest(const QString &root)
+{
+    QJsonObject entries;
+    const Manifest &images = manifest(root);
+    for (auto it = images.begin(); it != images.end(); ++it) {
+        QJsonArray files;
+        for (const File &file : it->files) {
+            files.append(QJsonObject{
+                {"name", file.name},
+                {"url", file.url.toString()},
+                {"sha256", QString::fromLatin1(file.sha256)},
+                {"size", file.size},
+            });
+        }
+        const QString verified = it->verified.toString(Qt::ISODateWithMs);
+        entries.insert(it.key(), QJsonObject{
+                                     {"verified", verified},
+                                     {"checksummed", it->checksummed},
+                                     {"files", files},
+                                 });
+    }
+
+    QSaveFile file(QDir(root).filePath(ManifestName));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write" << file.fileName();
+        return;
+    }
+    file.write(QJsonDocument(QJsonObject{{"images", entries}}).toJson());
+    file.commit();
+}
+
+bool DiskImageCache::isCached(const QString &root, const QString &version)
+{
+    const Manifest &images = manifest(root);
+    auto it = images.find(version);
+    if (it == images.end() || isFetching(version)) {
+        return false;
+    }
+
+    for (const File &file : it->files) {
+        const QString target = imagePath(root, version, file.name);
+        QFileInfo info(target);
+        if (!info.exists()) {
+            const QString object = objectPath(root, file.sha256);
+            if (QFileInfo(object).size() != file.size ||
+                !QDir().mkpath(info.absolutePath()) || !link(object, target)) {
+                return false;
+            }
+            qDebug() << "Restored" << target << "from the image cache";
+        } else if (info.size() != file.size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DiskImageCache::verify(const QString &root, const QString &version)
+{
+    if (!isCached(root, version)) {
+        return false;
+    }
+
+    Image &image = manifest(root)[version];
+    const QList<File> files = image.files;
+    bool rehashed = false;
+    for (const File &file : files) {
+        const QString target = imagePath(root, version, file.name);
+        if (QFileInfo(target).lastModified() <= image.verified) {
+            continue;
+        }
+
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        if (hashPrefix(target, &hash) != file.size ||
+            hash.result().toHex() != file.sha256) {
+            qWarning() << target << "does not match the verified image";
+            manifest(root).remove(version);
+            saveManifest(root);
+            return false;
+        }
+        rehashed = true;
+    }
+
+    if (rehashed) {
+        image.verified = QDateTime::currentDateTimeUtc();
+        saveManifest(root);
+    }
+    return true;
+}
+
+// Hard links share the object's storage, copies are the fallback where the
+// file system doesn't do links
+bool DiskImageCache::link(const QString &object, const QString &target)
+{
+    QFile::remove(target);
+    std::error_code error;
+    std::filesystem::create_hard_link(
+        std::filesystem::path(object.toStdU16String()),
+        std::filesystem::path(target.toStdU16String()), error);
+    return !error || QFile::copy(object, target);
+}
@@ -0,0 +1,158 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef DISKIMAGECACHE_H
+#define DISKIMAGECACHE_H
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QList>
+#include <QMap>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+#include <memory>
+
+/**
+ * @brief Content-addressed store for developer disk images.
+ *
+ * Files are downloaded in HTTP Range chunks into <root>/.partial and hashed
+ * while they stream to disk, so an interrupted download resumes where it
+ * stopped. Finished files move to <root>/objects/<sha256> and are linked
+ * into <root>/<version>, the layout mount_dev_image expects. Complete
+ * versions are recorded in <root>/manifest.json. Several versions can be
+ * fetched at once; all transfers share one bandwidth budget.
+ *
+ * A download is only checked against a digest the caller passes in. The
+ * image list has none, so "verified" in the manifest just means the files
+ * still hash to what was downloaded; "checksummed" says whether that
+ * download matched a known digest.
+ *
+ * Nothing here depends on the image list, any server that honours Range
+ * requests will do.
+ */
+class DiskImageCache : public QObject
+{
+    Q_OBJECT
+public:
+    struct File {
+        QString name;
+        QUrl url;
+        QByteArray sha256; // hex, expected digest if known
+        qint64 size = 0;
+    };
+
+    explicit DiskImageCache(QObject *parent = nullptr);
+
+    // Queues all files of a version under root, no-op if already queued
+    void fetch(const QString &root, const QString &version,
+               const QList<File> &files);
+    // Transfers stop, partial files are kept for the next fetch
+    void cancel(const QString &version);
+    bool isFetching(const QString &version) const;
+
+    // Manifest lookup with a size check, relinks files missing from the
+    // version directory if their objects are still around
+    bool isCached(const QString &root, const QString &version);
+    // Re-hashes files modified since they were verified, catches local
+    // changes, not a bad download
+    bool verify(const QString &root, const QString &version);
+
+    // Shared by all transfers, 0 means unlimited
+    void setBandwidthLimit(qint64 bytesPerSecond);
+    qint64 bandwidthLimit() const { return m_bandwidthLimit; }
+
+signals:
+    void progress(const QString &version, qint64 received, qint64 total);
+    void finished(const QString &version, bool success,
+                  const QString &errorMessage = QString());
+
+private:
+    struct Fetch;
+
+    struct Transfer {
+        std::shared_ptr<Fetch> fetch;
+        File file;
+        QString partPath;
+        QFile output;
+        QCryptographicHash hash{QCryptographicHash::Sha256};
+        QNetworkReply *reply = nullptr;
+        QByteArray validator; // ETag or Last-Modified, sent as If-Range
+        qint64 offset = 0;    // bytes written and hashed
+        qint64 total = -1;
+        qint64 chunkStart = 0;
+        qint64 chunkEnd = 0;
+        int retries = 0;
+        bool headersChecked = false;
+        bool payload = false;
+        bool replyFinished = false;
+    };
+
+    struct Fetch {
+        QString root;
+        QString version;
+        QList<File> files; // completed
+        qint64 doneBytes = 0;
+        int pending = 0;
+        bool checksummed = true; // every file matched an expected digest
+        bool stopped = false;
+    };
+
+    struct Image {
+        QList<File> files;
+        QDateTime verified;
+        bool checksummed = false;
+    };
+    using Manifest = QMap<QString, Image>;
+
+    using TransferPtr = std::shared_ptr<Transfer>;
+
+    void startNext();
+    void start(const TransferPtr &transfer);
+    void requestChunk(const TransferPtr &transfer);
+    bool checkHeaders(Transfer *transfer);
+    void pump(const TransferPtr &transfer, qint64 budget);
+    void onChunkFinished(const TransferPtr &transfer);
+    void restart(Transfer *transfer);
+    void complete(const TransferPtr &transfer);
+    void stop(Fetch *fetch, const QString &error);
+    void emitProgress(Fetch *fetch);
+    qint64 readBudget() const;
+    void onTick();
+
+    Manifest &manifest(const QString &root);
+    void saveManifest(const QString &root);
+    static bool link(const QString &object, const QString &target);
+
+    QNetworkAccessManager *m_networkManager;
+    QMap<QString, std::shared_ptr<Fetch>> m_fetches;
+    QList<TransferPtr> m_queue;
+    QList<TransferPtr> m_active;
+    QMap<QString, Manifest> m_manifests;
+
+    qint64 m_bandwidthLimit = 0;
+    qint64 m_tokens = 0;
+    int m_nextPump = 0;
+    QTimer m_ticker;
+};
+
+#endif // DISKIMAGECACHE_H
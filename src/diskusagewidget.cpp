@@ -20,10 +20,13 @@
 #include "diskusagewidget.h"
 #include "diskusagebar.h"
 #include "iDescriptor.h"
+#include "servicebroker.h"
+#include "storageanalyzerwidget.h"
 
 #include <QApplication>
 #include <QDebug>
 #include <QFutureWatcher>
+#include <QPushButton>
 #include <QVariantMap>
 #include <QtConcurrent/QtConcurrent>
 
@@ -194,6 +197,15 @@ void DiskUsageWidget::setupUI()
     m_legendLayout->addWidget(m_freeLabel);
     m_legendLayout->addStretch();
 
+    QPushButton *analyzeButton = new QPushButton("Analyze...", m_legendWidget);
+    analyzeButton->setStyleSheet("font-size: 10px;");
+    connect(analyzeButton, &QPushButton::clicked, this, [this]() {
+        auto *analyzer = new StorageAnalyzerWidget(m_device);
+        analyzer->setAttribute(Qt::WA_DeleteOnClose);
+        analyzer->show();
+    });
+    m_legendLayout->addWidget(analyzeButton);
+
     // Add the legend widget (not the layout) to the data layout
     m_dataLayout->addWidget(m_legendWidget);
 
@@ -413,38 +425,13 @@ void DiskUsageWidget::fetchData()
 
         // Apps usage
         uint64_t totalAppsSpace = 0;
-        instproxy_client_t instproxy = nullptr;
-        lockdownd_client_t lockdownClient = nullptr;
-        lockdownd_service_descriptor_t lockdowndService = nullptr;
-
-        if (lockdownd_client_new_with_handshake(m_device->device,
-                                                &lockdownClient, APP_LABEL) !=
-            LOCKDOWN_E_SUCCESS) {
-            result["error"] = "Could not connect to lockdown service.";
-            return result;
-        }
-
-        if (lockdownd_start_service(lockdownClient,
-                                    "com.apple.mobile.installation_proxy",
-                                    &lockdowndService) != LOCKDOWN_E_SUCCESS) {
-            result["error"] = "Could not start installation proxy service.";
-            lockdownd_client_free(lockdownClient);
-            return result;
-        }
-
-        if (instproxy_client_new(m_device->device, lockdowndService,
-                                 &instproxy) != INSTPROXY_E_SUCCESS) {
+        ServiceBroker *broker = ServiceBroker::sharedInstance();
+        ServiceLease<instproxy_client_t> instproxy(m_device->device);
+        if (!instproxy) {
             result["error"] = "Could not connect to installation proxy.";
-            lockdownd_service_descriptor_free(lockdowndService);
-            lockdownd_client_free(lockdownClient);
             return result;
         }
 
-        // The service descriptor is no longer needed after the client is
-        // created
-        lockdownd_service_descriptor_free(lockdowndService);
-        lockdowndService = nullptr;
-
         plist_t client_opts = instproxy_client_options_new();
         plist_dict_set_item(client_opts, "ApplicationType",
                             plist_new_string("User"));
@@ -457,7 +444,7 @@ void DiskUsageWidget::fetchData()
         plist_dict_set_item(client_opts, "ReturnAttributes", return_attrs);
 
         plist_t apps = nullptr;
-        if (instproxy_browse(instproxy, client_opts, &apps) ==
+        if (instproxy_browse(instproxy.get(), client_opts, &apps) ==
                 INSTPROXY_E_SUCCESS &&
             apps) {
             if (plist_get_node_type(apps) == PLIST_ARRAY) {
@@ -489,14 +476,16 @@ void DiskUsageWidget::fetchData()
         }
         result["appsUsage"] = QVariant::fromValue(totalAppsSpace);
         plist_free(client_opts);
-        instproxy_client_free(instproxy);
 
         // Media usage
         uint64_t mediaSpace = 0;
         plist_t node = nullptr;
-        if (lockdownd_get_value(lockdownClient, "com.apple.mobile.iTunes",
-                                nullptr, &node) == LOCKDOWN_E_SUCCESS &&
-            node) {
+        lockdownd_error_t lerr = broker->withLockdown(
+            m_device->device, [&node](lockdownd_client_t client) {
+                return lockdownd_get_value(client, "com.apple.mobile.iTunes",
+                                           nullptr, &node);
+            });
+        if (lerr == LOCKDOWN_E_SUCCESS && node) {
             plist_t mediaNode = plist_dict_get_item(node, "MediaLibrarySize");
             if (mediaNode && plist_get_node_type(mediaNode) == PLIST_UINT) {
                 plist_get_uint_val(mediaNode, &mediaSpace);
@@ -504,8 +493,6 @@ void DiskUsageWidget::fetchData()
             plist_free(node);
         }
         result["mediaUsage"] = QVariant::fromValue(mediaSpace);
-
-        lockdownd_client_free(lockdownClient);
         return result;
     });
     watcher->setFuture(future);
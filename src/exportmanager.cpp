@@ -19,14 +19,30 @@
 
 #include "exportmanager.h"
 #include "exportprogressdialog.h"
+#include "loggingcategories.h"
 #include "servicemanager.h"
+#include "tracer.h"
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QMutexLocker>
 #include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include <QtConcurrent/QtConcurrent>
 
+namespace
+{
+// Files transferred at once over SFTP, each on its own SSH connection
+constexpr int SftpParallelFiles = 3;
+// Smaller exports are dominated by setup time and say little about speed
+constexpr qint64 MinThroughputSampleBytes = 1024 * 1024;
+// Encoded HEICs read but not yet written out as JPEG
+constexpr qint64 TranscodeBudgetBytes = 256 * 1024 * 1024;
+} // namespace
+
 ExportManager *ExportManager::sharedInstance()
 {
     static ExportManager self;
@@ -60,15 +76,18 @@ ExportManager::~ExportManager()
 QUuid ExportManager::startExport(iDescriptorDevice *device,
                                  const QList<ExportItem> &items,
                                  const QString &destinationPath,
-                                 std::optional<afc_client_t> altAfc)
+                                 std::optional<afc_client_t> altAfc,
+                                 TransferBackend backend,
+                                 const QString &sftpPassword,
+                                 const ExportOptions &options)
 {
     if (!device || !device->mutex) {
-        qWarning() << "Invalid device provided to ExportManager";
+        qCWarning(lcExport) << "Invalid device provided to ExportManager";
         return QUuid();
     }
 
     if (items.isEmpty()) {
-        qWarning() << "No items provided for export";
+        qCWarning(lcExport) << "No items provided for export";
         return QUuid();
     }
 
@@ -76,8 +95,8 @@ QUuid ExportManager::startExport(iDescriptorDevice *device,
     QDir destDir(destinationPath);
     if (!destDir.exists()) {
         if (!destDir.mkpath(".")) {
-            qWarning() << "Could not create destination directory:"
-                       << destinationPath;
+            qCWarning(lcExport) << "Could not create destination directory:"
+                                << destinationPath;
             return QUuid();
         }
     }
@@ -89,6 +108,9 @@ QUuid ExportManager::startExport(iDescriptorDevice *device,
     job->items = items;
     job->destinationPath = destinationPath;
     job->altAfc = altAfc;
+    job->backend = backend;
+    job->sftpPassword = sftpPassword;
+    job->options = options;
     job->watcher = new QFutureWatcher<void>(this);
 
     const QUuid jobId = job->jobId;
@@ -112,8 +134,8 @@ QUuid ExportManager::startExport(iDescriptorDevice *device,
         QtConcurrent::run([this, jobPtr]() { executeExportJob(jobPtr); });
     jobPtr->watcher->setFuture(jobPtr->future);
 
-    qDebug() << "Started export job" << jobId << "for" << items.size()
-             << "items";
+    qCDebug(lcExport) << "Started export job" << jobId << "for" << items.size()
+                      << "items over" << SftpSession::backendName(backend);
     return jobId;
 }
 
@@ -123,7 +145,7 @@ void ExportManager::cancelExport(const QUuid &jobId)
     auto it = m_activeJobs.find(jobId);
     if (it != m_activeJobs.end()) {
         it.value()->cancelRequested = true;
-        qDebug() << "Cancellation requested for job" << jobId;
+        qCDebug(lcExport) << "Cancellation requested for job" << jobId;
     }
 }
 
@@ -145,53 +167,220 @@ void ExportManager::executeExportJob(ExportJob *job)
     summary.jobId = job->jobId;
     summary.totalItems = job->items.size();
     summary.destinationPath = job->destinationPath;
+    summary.udid = job->device->udid;
+    summary.backend = job->backend;
 
-    qDebug() << "Executing export job" << job->jobId << "with"
-             << job->items.size() << "items";
+    qCDebug(lcExport) << "Executing export job" << job->jobId << "with"
+                      << job->items.size() << "items";
 
-    for (int i = 0; i < job->items.size(); ++i) {
-        // Check for cancellation
-        if (job->cancelRequested.load()) {
-            summary.wasCancelled = true;
-            qDebug() << "Export job" << job->jobId << "was cancelled";
-            emit exportCancelled(job->jobId);
-            return;
-        }
+    QElapsedTimer clock;
+    clock.start();
 
-        const ExportItem &item = job->items.at(i);
+    if (job->backend == TransferBackend::Sftp) {
+        executeSftpExportJob(job, summary);
+    } else {
+        executeAfcExportJob(job, summary);
+    }
+    if (summary.wasCancelled) {
+        qCDebug(lcExport) << "Export job" << job->jobId << "was cancelled";
+        emit exportCancelled(job->jobId);
+        return;
+    }
 
-        emit exportProgress(job->jobId, i + 1, job->items.size(),
-                            item.suggestedFileName);
+    summary.elapsedMs = clock.elapsed();
+    recordThroughput(summary);
+
+    qCDebug(lcExport) << "Export job" << job->jobId << "completed - Success:"
+                      << summary.successfulItems << "Failed:"
+                      << summary.failedItems << "Bytes:"
+                      << summary.totalBytesTransferred << "in"
+                      << summary.elapsedMs << "ms";
+    if (summary.transcodedItems > 0) {
+        qCDebug(lcExport) << "Transfer stage:" << summary.transferMs
+                          << "ms, transcode stage:"
+                          << summary.transcodedItems << "items,"
+                          << summary.transcodeInputBytes << "->"
+                          << summary.transcodeOutputBytes << "bytes in"
+                          << summary.transcodeMs << "ms of worker time";
+    }
 
-        ExportResult result =
-            exportSingleItem(job->device, item, job->destinationPath,
-                             job->altAfc, job->cancelRequested, job->jobId);
+    emit exportFinished(job->jobId, summary);
+}
+
+/*
+ Items are read from the device one after the other. HEICs that get
+ transcoded are read into memory and handed to a CPU sized pool, so
+ decoding and encoding overlap with the next transfers. The encoded bytes
+ waiting for or in a transcoder are bounded, the transfer waits when the
+ pool falls behind.
+*/
+void ExportManager::executeAfcExportJob(ExportJob *job,
+                                        ExportJobSummary &summary)
+{
+    const bool transcode = job->options.transcodeHeic;
+    QMutex summaryMutex;
 
+    QThreadPool transcoders;
+    transcoders.setMaxThreadCount(QThread::idealThreadCount());
+    QMutex budgetMutex;
+    QWaitCondition budgetFreed;
+    qint64 inFlightBytes = 0;
+
+    auto record = [&](const ExportResult &result) {
+        QMutexLocker locker(&summaryMutex);
         if (result.success) {
             summary.successfulItems++;
             summary.totalBytesTransferred += result.bytesTransferred;
         } else {
             summary.failedItems++;
         }
+    };
 
-        emit itemExported(job->jobId, result);
-
-        // Check for cancellation again after potentially long file operation
+    QElapsedTimer transferClock;
+    for (int i = 0; i < job->items.size(); ++i) {
         if (job->cancelRequested.load()) {
-            summary.wasCancelled = true;
-            qDebug() << "Export job" << job->jobId
-                     << "was cancelled during execution";
-            emit exportCancelled(job->jobId);
-            return;
+            break;
+        }
+
+        const ExportItem &item = job->items.at(i);
+        emit exportProgress(job->jobId, i + 1, job->items.size(),
+                            item.suggestedFileName);
+
+        const bool heic =
+            transcode &&
+            item.sourcePathOnDevice.endsWith(".HEIC", Qt::CaseInsensitive);
+        if (heic) {
+            QMutexLocker locker(&budgetMutex);
+            while (inFlightBytes >= TranscodeBudgetBytes &&
+                   !job->cancelRequested.load()) {
+                budgetFreed.wait(&budgetMutex, 100);
+            }
+        }
+
+        QByteArray data;
+        transferClock.start();
+        std::optional<ExportResult> remuxed;
+        if (job->options.remuxMov &&
+            item.sourcePathOnDevice.endsWith(".MOV", Qt::CaseInsensitive)) {
+            remuxed = exportRemuxedItem(job->device, item,
+                                        job->destinationPath, job->altAfc,
+                                        job->cancelRequested, job->jobId);
+            if (!remuxed->success && !job->cancelRequested.load()) {
+                qCWarning(lcExport)
+                    << "Copying" << item.sourcePathOnDevice
+                    << "as is, remux failed:" << remuxed->errorMessage;
+                remuxed.reset();
+            }
+        }
+        ExportResult result =
+            remuxed ? *remuxed
+                    : exportSingleItem(job->device, item,
+                                       job->destinationPath, job->altAfc,
+                                       job->cancelRequested, job->jobId,
+                                       heic ? &data : nullptr);
+        {
+            QMutexLocker locker(&summaryMutex);
+            summary.transferMs += transferClock.elapsed();
         }
+
+        if (!heic || !result.success) {
+            record(result);
+            emit itemExported(job->jobId, result);
+            continue;
+        }
+
+        {
+            QMutexLocker locker(&budgetMutex);
+            inFlightBytes += data.size();
+        }
+        transcoders.start([&, item, data, result]() {
+            QElapsedTimer clock;
+            clock.start();
+            ExportResult out =
+                transcodeItem(item, data, result, job->destinationPath,
+                              job->options.jpegQuality);
+            {
+                QMutexLocker locker(&summaryMutex);
+                summary.transcodeMs += clock.elapsed();
+                if (out.success) {
+                    summary.transcodedItems++;
+                    summary.transcodeInputBytes += data.size();
+                    summary.transcodeOutputBytes +=
+                        QFileInfo(out.outputFilePath).size();
+                }
+            }
+            {
+                QMutexLocker locker(&budgetMutex);
+                inFlightBytes -= data.size();
+                budgetFreed.wakeAll();
+            }
+            record(out);
+            emit itemExported(job->jobId, out);
+        });
     }
+    transcoders.waitForDone();
 
-    qDebug() << "Export job" << job->jobId
-             << "completed - Success:" << summary.successfulItems
-             << "Failed:" << summary.failedItems
-             << "Bytes:" << summary.totalBytesTransferred;
+    summary.wasCancelled = job->cancelRequested.load();
+}
 
-    emit exportFinished(job->jobId, summary);
+/*
+ libssh sessions can't be shared between threads, so every worker opens its
+ own connection. Items are handed out one at a time so a few large files
+ don't hold the rest of the queue back.
+*/
+void ExportManager::executeSftpExportJob(ExportJob *job,
+                                         ExportJobSummary &summary)
+{
+    const int totalItems = job->items.size();
+    const int workerCount = qMin(SftpParallelFiles, totalItems);
+    std::atomic<int> nextItem{0};
+    std::atomic<int> startedItems{0};
+    QMutex summaryMutex;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(workerCount);
+    for (int worker = 0; worker < workerCount; ++worker) {
+        pool.start([&]() {
+            SftpSession session(job->device, job->sftpPassword);
+            QString connectError;
+            const bool connected = session.open(&connectError);
+
+            while (!job->cancelRequested.load()) {
+                const int i = nextItem++;
+                if (i >= totalItems) {
+                    break;
+                }
+                const ExportItem &item = job->items.at(i);
+                emit exportProgress(job->jobId, ++startedItems, totalItems,
+                                    item.suggestedFileName);
+
+                ExportResult result;
+                if (connected) {
+                    result = exportSingleItemSftp(
+                        job->device, session, item, job->destinationPath,
+                        job->cancelRequested, job->jobId);
+                } else {
+                    result.sourceFilePath = item.sourcePathOnDevice;
+                    result.errorMessage = connectError;
+                }
+
+                {
+                    QMutexLocker locker(&summaryMutex);
+                    if (result.success) {
+                        summary.successfulItems++;
+                        summary.totalBytesTransferred +=
+                            result.bytesTransferred;
+                    } else {
+                        summary.failedItems++;
+                    }
+                }
+                emit itemExported(job->jobId, result);
+            }
+        });
+    }
+    pool.waitForDone();
+
+    summary.wasCancelled = job->cancelRequested.load();
 }
 
 ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
@@ -199,16 +388,15 @@ ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
                                              const QString &destinationDir,
                                              std::optional<afc_client_t> altAfc,
                                              std::atomic<bool> &cancelRequested,
-                                             const QUuid &jobId)
+                                             const QUuid &jobId,
+                                             QByteArray *capture)
 {
+    TraceSpan span("export", "export_item", device);
+    span.setDetail(item.sourcePathOnDevice);
+
     ExportResult result;
     result.sourceFilePath = item.sourcePathOnDevice;
 
-    // Generate output path
-    QString outputPath = QDir(destinationDir).filePath(item.suggestedFileName);
-    outputPath = generateUniqueOutputPath(outputPath);
-    result.outputFilePath = outputPath;
-
     // Get file size first
     char **info = nullptr;
     afc_error_t infoResult = ServiceManager::safeAfcGetFileInfo(
@@ -239,14 +427,24 @@ ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
         return result;
     }
 
-    // Open local output file
-    QFile outputFile(outputPath);
-    if (!outputFile.open(QIODevice::WriteOnly)) {
-        result.errorMessage = QString("Failed to create local file: %1 (%2)")
-                                  .arg(outputPath)
-                                  .arg(outputFile.errorString());
-        ServiceManager::safeAfcFileClose(device, handle, altAfc);
-        return result;
+    // Open local output file, unless the caller takes the data. Created
+    // right away so transcode workers see the name as taken.
+    QFile outputFile;
+    if (!capture) {
+        QMutexLocker locker(&m_outputPathMutex);
+        result.outputFilePath = generateUniqueOutputPath(
+            QDir(destinationDir).filePath(item.suggestedFileName));
+        outputFile.setFileName(result.outputFilePath);
+        if (!outputFile.open(QIODevice::WriteOnly)) {
+            result.errorMessage =
+                QString("Failed to create local file: %1 (%2)")
+                    .arg(result.outputFilePath)
+                    .arg(outputFile.errorString());
+            ServiceManager::safeAfcFileClose(device, handle, altAfc);
+            return result;
+        }
+    } else if (totalFileSize > 0) {
+        capture->reserve(totalFileSize);
     }
 
     char buffer[8192];
@@ -256,8 +454,10 @@ ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
     while (true) {
         // Check for cancellation during file copy
         if (cancelRequested.load()) {
-            outputFile.close();
-            outputFile.remove(); // Clean up partial file
+            if (!capture) {
+                outputFile.close();
+                outputFile.remove(); // Clean up partial file
+            }
             ServiceManager::safeAfcFileClose(device, handle, altAfc);
             result.errorMessage = "Export cancelled by user";
             return result;
@@ -270,6 +470,12 @@ ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
             break; // End of file or error
         }
 
+        if (capture) {
+            capture->append(buffer, bytesRead);
+            totalBytes += bytesRead;
+            continue;
+        }
+
         qint64 bytesWritten = outputFile.write(buffer, bytesRead);
         if (bytesWritten != bytesRead) {
             result.errorMessage =
@@ -292,12 +498,16 @@ ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
     }
 
     // Clean up
-    outputFile.close();
+    if (!capture) {
+        outputFile.close();
+    }
     ServiceManager::safeAfcFileClose(device, handle, altAfc);
 
     if (totalBytes == 0) {
         result.errorMessage = "No data read from device file";
-        outputFile.remove(); // Clean up empty file
+        if (!capture) {
+            outputFile.remove(); // Clean up empty file
+        }
         return result;
     }
 
@@ -306,6 +516,175 @@ ExportResult ExportManager::exportSingleItem(iDescriptorDevice *device,
     return result;
 }
 
+ExportResult ExportManager::exportRemuxedItem(
+    iDescriptorDevice *device, const ExportItem &item,
+    const QString &destinationDir, std::optional<afc_client_t> altAfc,
+    std::atomic<bool> &cancelRequested, const QUuid &jobId)
+{
+    TraceSpan span("export", "remux_item", device);
+    span.setDetail(item.sourcePathOnDevice);
+
+    ExportResult result;
+    result.sourceFilePath = item.sourcePathOnDevice;
+
+    const QString fileName =
+        QFileInfo(item.suggestedFileName).completeBaseName() + ".MP4";
+    {
+        // The muxer opens the file itself, create it now to hold the name
+        QMutexLocker locker(&m_outputPathMutex);
+        result.outputFilePath = generateUniqueOutputPath(
+            QDir(destinationDir).filePath(fileName));
+        QFile placeholder(result.outputFilePath);
+        if (!placeholder.open(QIODevice::WriteOnly)) {
+            result.errorMessage =
+                QString("Failed to create local file: %1 (%2)")
+                    .arg(result.outputFilePath)
+                    .arg(placeholder.errorString());
+            return result;
+        }
+    }
+
+    // Called per packet, only report once the reader moved on a block
+    qint64 reported = 0;
+    auto progress = [&](qint64 done, qint64 total) {
+        if (done - reported >= 1024 * 1024 || done == total) {
+            reported = done;
+            emit fileTransferProgress(jobId, item.suggestedFileName, done,
+                                      total);
+        }
+        return !cancelRequested.load();
+    };
+
+    qint64 bytesRead = 0;
+    result.success = remux_mov_to_mp4(
+        device, item.sourcePathOnDevice.toUtf8().constData(),
+        result.outputFilePath, altAfc, progress, &result.errorMessage,
+        &bytesRead);
+    result.bytesTransferred = bytesRead;
+    return result;
+}
+
+// Runs on a transcode worker, result carries the transfer's outcome
+ExportResult ExportManager::transcodeItem(const ExportItem &item,
+                                          const QByteArray &data,
+                                          ExportResult result,
+                                          const QString &destinationDir,
+                                          int quality)
+{
+    TraceSpan span("export", "transcode_heic");
+    span.setDetail(item.sourcePathOnDevice);
+
+    QString error;
+    QByteArray jpeg = transcode_heic_to_jpeg(data, quality, &error);
+    QString fileName = item.suggestedFileName;
+    if (jpeg.isEmpty()) {
+        // Better the original than no photo at all
+        qCWarning(lcExport) << "Keeping HEIC for" << item.sourcePathOnDevice
+                            << "-" << error;
+        jpeg = data;
+    } else {
+        fileName = QFileInfo(fileName).completeBaseName() + ".JPG";
+    }
+
+    QFile outputFile;
+    {
+        QMutexLocker locker(&m_outputPathMutex);
+        result.outputFilePath = generateUniqueOutputPath(
+            QDir(destinationDir).filePath(fileName));
+        outputFile.setFileName(result.outputFilePath);
+        if (!outputFile.open(QIODevice::WriteOnly)) {
+            result.success = false;
+            result.errorMessage =
+                QString("Failed to create local file: %1 (%2)")
+                    .arg(result.outputFilePath)
+                    .arg(outputFile.errorString());
+            return result;
+        }
+    }
+
+    if (outputFile.write(jpeg) != jpeg.size()) {
+        result.success = false;
+        result.errorMessage = QString("Write error: %1 (%2)")
+                                  .arg(result.outputFilePath)
+                                  .arg(outputFile.errorString());
+        outputFile.close();
+        outputFile.remove();
+    }
+    return result;
+}
+
+ExportResult ExportManager::exportSingleItemSftp(
+    iDescriptorDevice *device, SftpSession &session, const ExportItem &item,
+    const QString &destinationDir, std::atomic<bool> &cancelRequested,
+    const QUuid &jobId)
+{
+    TraceSpan span("export", "export_item_sftp", device);
+    span.setDetail(item.sourcePathOnDevice);
+
+    ExportResult result;
+    result.sourceFilePath = item.sourcePathOnDevice;
+
+    {
+        // Create the file right away so the other workers see it as taken
+        QMutexLocker locker(&m_outputPathMutex);
+        result.outputFilePath = generateUniqueOutputPath(
+            QDir(destinationDir).filePath(item.suggestedFileName));
+        QFile placeholder(result.outputFilePath);
+        if (!placeholder.open(QIODevice::WriteOnly)) {
+            result.errorMessage =
+                QString("Failed to create local file: %1 (%2)")
+                    .arg(result.outputFilePath)
+                    .arg(placeholder.errorString());
+            return result;
+        }
+    }
+
+    qint64 lastReported = 0;
+    auto progress = [&](qint64 done, qint64 total) {
+        if (cancelRequested.load()) {
+            return false;
+        }
+        if (done - lastReported >= 64 * 1024 || done == total) {
+            lastReported = done;
+            emit fileTransferProgress(jobId, item.suggestedFileName, done,
+                                      total);
+        }
+        return true;
+    };
+
+    qint64 bytes = 0;
+    if (!session.download(item.sourcePathOnDevice, result.outputFilePath,
+                          progress, &result.errorMessage, &bytes)) {
+        QFile::remove(result.outputFilePath);
+        return result;
+    }
+
+    result.success = true;
+    result.bytesTransferred = bytes;
+    return result;
+}
+
+void ExportManager::recordThroughput(const ExportJobSummary &summary)
+{
+    if (summary.elapsedMs <= 0 ||
+        summary.totalBytesTransferred < MinThroughputSampleBytes) {
+        return;
+    }
+
+    const double bytesPerSecond =
+        summary.totalBytesTransferred * 1000.0 / summary.elapsedMs;
+    QMutexLocker locker(&m_throughputMutex);
+    m_throughput[summary.udid][static_cast<int>(summary.backend)] =
+        bytesPerSecond;
+}
+
+double ExportManager::measuredThroughput(const std::string &udid,
+                                         TransferBackend backend) const
+{
+    QMutexLocker locker(&m_throughputMutex);
+    return m_throughput.value(udid).value(static_cast<int>(backend), 0.0);
+}
+
 QString ExportManager::generateUniqueOutputPath(const QString &basePath) const
 {
     if (!QFile::exists(basePath)) {
@@ -352,6 +731,25 @@ void ExportManager::cleanupJob(const QUuid &jobId)
 
         delete it.value();
         m_activeJobs.erase(it);
-        qDebug() << "Cleaned up export job" << jobId;
+        qCDebug(lcExport) << "Cleaned up export job" << jobId;
+    }
+}
+
+void ExportManager::cancelJobsForDevice(const std::string &udid)
+{
+    QList<ExportJob *> jobs;
+    {
+        QMutexLocker locker(&m_jobsMutex);
+        for (ExportJob *job : m_activeJobs) {
+            if (job->device && job->device->udid == udid) {
+                job->cancelRequested = true;
+                jobs.append(job);
+            }
+        }
+    }
+
+    // cleanupJob runs on this thread as well, the jobs can't go away here
+    for (ExportJob *job : jobs) {
+        job->future.waitForFinished();
     }
 }
@@ -21,8 +21,10 @@
 #define EXPORTMANAGER_H
 
 #include "iDescriptor.h"
+#include "sftpsession.h"
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QHash>
 #include <QMap>
 #include <QMutex>
 #include <QObject>
@@ -46,6 +48,16 @@ struct ExportItem {
     }
 };
 
+struct ExportOptions {
+    // HEIC photos are written as JPEG, decoded and encoded on a CPU sized
+    // pool while the transfer moves on to the next item
+    bool transcodeHeic = false;
+    int jpegQuality = 90;
+    // MOV videos are rewritten as fast-start MP4 while being read, the
+    // streams are copied, not re-encoded
+    bool remuxMov = false;
+};
+
 struct ExportResult {
     QString sourceFilePath;
     QString outputFilePath;
@@ -62,6 +74,16 @@ struct ExportJobSummary {
     qint64 totalBytesTransferred = 0;
     QString destinationPath;
     bool wasCancelled = false;
+    std::string udid;
+    TransferBackend backend = TransferBackend::Afc;
+    qint64 elapsedMs = 0;
+
+    // Per stage, time is summed over the items of that stage
+    qint64 transferMs = 0;
+    int transcodedItems = 0;
+    qint64 transcodeInputBytes = 0;
+    qint64 transcodeOutputBytes = 0;
+    qint64 transcodeMs = 0;
 };
 
 class ExportManager : public QObject
@@ -76,9 +98,17 @@ public:
     ExportManager(const ExportManager &) = delete;
     ExportManager &operator=(const ExportManager &) = delete;
 
+    /*
+     TransferBackend::Sftp only works on jailbroken devices with OpenSSH,
+     source paths are then absolute paths on the device (same as AFC2) and
+     sftpPassword is the root password
+    */
     QUuid startExport(iDescriptorDevice *device, const QList<ExportItem> &items,
                       const QString &destinationPath,
-                      std::optional<afc_client_t> altAfc = std::nullopt);
+                      std::optional<afc_client_t> altAfc = std::nullopt,
+                      TransferBackend backend = TransferBackend::Afc,
+                      const QString &sftpPassword = QString(),
+                      const ExportOptions &options = ExportOptions());
 
     void cancelExport(const QUuid &jobId);
 
@@ -86,6 +116,15 @@ public:
 
     bool isJobRunning(const QUuid &jobId) const;
 
+    // Cancels every job on the device and waits for it to stop, call on
+    // removal before the device is freed
+    void cancelJobsForDevice(const std::string &udid);
+
+    // Bytes per second of the last export from this device with the given
+    // backend, 0 if there is no measurement yet
+    double measuredThroughput(const std::string &udid,
+                              TransferBackend backend) const;
+
 signals:
 
     void exportStarted(const QUuid &jobId, int totalItems,
@@ -114,19 +153,45 @@ private:
         QList<ExportItem> items;
         QString destinationPath;
         std::optional<afc_client_t> altAfc;
+        TransferBackend backend = TransferBackend::Afc;
+        QString sftpPassword;
+        ExportOptions options;
         std::atomic<bool> cancelRequested{false};
         QFuture<void> future;
         QFutureWatcher<void> *watcher = nullptr;
     };
 
     void executeExportJob(ExportJob *job);
+    void executeAfcExportJob(ExportJob *job, ExportJobSummary &summary);
+    void executeSftpExportJob(ExportJob *job, ExportJobSummary &summary);
 
     ExportResult exportSingleItem(iDescriptorDevice *device,
                                   const ExportItem &item,
                                   const QString &destinationDir,
                                   std::optional<afc_client_t> altAfc,
                                   std::atomic<bool> &cancelRequested,
-                                  const QUuid &jobId);
+                                  const QUuid &jobId,
+                                  QByteArray *capture = nullptr);
+
+    ExportResult exportRemuxedItem(iDescriptorDevice *device,
+                                   const ExportItem &item,
+                                   const QString &destinationDir,
+                                   std::optional<afc_client_t> altAfc,
+                                   std::atomic<bool> &cancelRequested,
+                                   const QUuid &jobId);
+
+    ExportResult transcodeItem(const ExportItem &item,
+                               const QByteArray &data, ExportResult result,
+                               const QString &destinationDir, int quality);
+
+    ExportResult exportSingleItemSftp(iDescriptorDevice *device,
+                                      SftpSession &session,
+                                      const ExportItem &item,
+                                      const QString &destinationDir,
+                                      std::atomic<bool> &cancelRequested,
+                                      const QUuid &jobId);
+
+    void recordThroughput(const ExportJobSummary &summary);
 
     QString generateUniqueOutputPath(const QString &basePath) const;
 
@@ -138,6 +203,14 @@ private:
     mutable QMutex m_jobsMutex;
     QMap<QUuid, ExportJob *> m_activeJobs;
 
+    // udid -> bytes per second, indexed by TransferBackend
+    mutable QMutex m_throughputMutex;
+    QMap<std::string, QHash<int, double>> m_throughput;
+
+    // Reserves a path so concurrent SFTP or transcode workers don't pick
+    // the same one
+    QMutex m_outputPathMutex;
+
     // Manager owns the dialog
     ExportProgressDialog *m_exportProgressDialog;
 };
@@ -329,9 +329,34 @@ void ExportProgressDialog::onExportFinished(const QUuid &jobId,
     }
 
     m_statusLabel->setText(message);
-    m_transferRateLabel->setText(
-        QString("Total: %1")
-            .arg(formatFileSize(summary.totalBytesTransferred)));
+    QString totals =
+        QString("Total: %1").arg(formatFileSize(summary.totalBytesTransferred));
+    if (summary.elapsedMs > 0 && summary.totalBytesTransferred > 0) {
+        totals += QString(" at %1 over %2")
+                      .arg(formatTransferRate(summary.totalBytesTransferred *
+                                              1000 / summary.elapsedMs))
+                      .arg(SftpSession::backendName(summary.backend));
+
+        // Compare against the last export from this device the other way
+        const TransferBackend other = summary.backend == TransferBackend::Sftp
+                                          ? TransferBackend::Afc
+                                          : TransferBackend::Sftp;
+        const double otherRate =
+            m_exportManager->measuredThroughput(summary.udid, other);
+        if (otherRate > 0) {
+            totals += QString(" (%1: %2)")
+                          .arg(SftpSession::backendName(other))
+                          .arg(formatTransferRate(
+                              static_cast<qint64>(otherRate)));
+        }
+    }
+    if (summary.transcodedItems > 0 && summary.transcodeMs > 0) {
+        totals += QString("\n%1 converted to JPEG at %2 per worker")
+                      .arg(summary.transcodedItems)
+                      .arg(formatTransferRate(summary.transcodeInputBytes *
+                                              1000 / summary.transcodeMs));
+    }
+    m_transferRateLabel->setText(totals);
     m_timeRemainingLabel->clear();
 
     // Show close button, hide cancel
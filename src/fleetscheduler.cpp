@@ -0,0 +1,460 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fleetscheduler.h"
+#include "appcontext.h"
+#include "devdiskmanager.h"
+#include "servicebroker.h"
+#include "settingsmanager.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+#include <libimobiledevice/lockdown.h>
+#include <mutex>
+
+void FleetScheduler::DeviceSlot::closeClients()
+{
+    if (screenshotClient) {
+        ServiceBroker::sharedInstance()->release(device->device,
+                                                 screenshotClient, !removed);
+        screenshotClient = nullptr;
+    }
+    if (locationClient) {
+        location_session_close(locationClient);
+        locationClient = nullptr;
+    }
+}
+
+FleetScheduler *FleetScheduler::sharedInstance()
+{
+    static FleetScheduler instance;
+    return &instance;
+}
+
+FleetScheduler::FleetScheduler(QObject *parent) : QObject(parent)
+{
+    qRegisterMetaType<FleetResult>("FleetResult");
+
+    // Emitted before the device is freed, see onDeviceRemoved
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            &FleetScheduler::onDeviceRemoved);
+}
+
+FleetScheduler::~FleetScheduler()
+{
+    if (m_cancelled) {
+        *m_cancelled = true;
+    }
+    m_pool.waitForDone();
+    for (const auto &slot : m_slots) {
+        slot->closeClients();
+    }
+}
+
+QString FleetScheduler::actionName(FleetAction action)
+{
+    switch (action) {
+    case FleetAction::Screenshot:
+        return "Take Screenshot";
+    case FleetAction::Restart:
+        return "Restart";
+    case FleetAction::Shutdown:
+        return "Shutdown";
+    case FleetAction::MountDevImage:
+        return "Mount Developer Disk Image";
+    case FleetAction::SetLocation:
+        return "Set Location";
+    case FleetAction::InstallApp:
+        return "Install App";
+    }
+    return QString();
+}
+
+QString FleetScheduler::statusName(FleetResult::Status status)
+{
+    switch (status) {
+    case FleetResult::Status::Queued:
+        return "Queued";
+    case FleetResult::Status::Running:
+        return "Running";
+    case FleetResult::Status::Succeeded:
+        return "Succeeded";
+    case FleetResult::Status::Failed:
+        return "Failed";
+    case FleetResult::Status::TimedOut:
+        return "Timed out";
+    case FleetResult::Status::Cancelled:
+        return "Cancelled";
+    }
+    return QString();
+}
+
+std::shared_ptr<FleetScheduler::DeviceSlot>
+FleetScheduler::slotFor(iDescriptorDevice *device)
+{
+    auto it = m_slots.find(device->udid);
+    if (it != m_slots.end()) {
+        return it.value();
+    }
+    auto slot = std::make_shared<DeviceSlot>();
+    slot->device = device;
+    m_slots.insert(device->udid, slot);
+    return slot;
+}
+
+void FleetScheduler::onDeviceRemoved(const std::string &udid)
+{
+    std::shared_ptr<DeviceSlot> slot = m_slots.take(udid);
+    if (!slot) {
+        return;
+    }
+
+    // Blocks until an action running on this device returns, the handle
+    // is freed right after this slot
+    QMutexLocker locker(&slot->mutex);
+    slot->removed = true;
+    slot->closeClients();
+}
+
+bool FleetScheduler::start(const QList<iDescriptorDevice *> &devices,
+                           const FleetJobOptions &options)
+{
+    if (m_running || devices.isEmpty()) {
+        return false;
+    }
+
+    m_options = options;
+    m_options.maxParallel = qMax(1, options.maxParallel);
+    m_options.retries = qMax(0, options.retries);
+    m_pool.setMaxThreadCount(m_options.maxParallel);
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_finished = 0;
+    m_tasks.clear();
+    ++m_runId;
+    m_running = true;
+
+    // DevDiskManager isn't thread safe, pick the images up front
+    QString imageRoot;
+    if (m_options.action == FleetAction::MountDevImage) {
+        imageRoot = SettingsManager::sharedInstance()->mkDevDiskImgPath();
+    }
+
+    for (iDescriptorDevice *device : devices) {
+        Task task;
+        task.slot = slotFor(device);
+        task.abandoned = std::make_shared<std::atomic<bool>>(false);
+        task.result.udid = device->udid;
+        task.result.deviceName =
+            QString::fromStdString(device->deviceInfo.deviceName);
+
+        if (m_options.action == FleetAction::MountDevImage) {
+            const unsigned int version =
+                device->deviceInfo.parsedDeviceVersion;
+            const QList<ImageInfo> images =
+                DevDiskManager::sharedInstance()->parseImageList(
+                    imageRoot, (version >> 16) & 0xFF, (version >> 8) & 0xFF,
+                    "", 0);
+            for (const ImageInfo &info : images) {
+                if (info.isDownloaded &&
+                    (info.compatibility == ImageCompatibility::Compatible ||
+                     info.compatibility ==
+                         ImageCompatibility::MaybeCompatible)) {
+                    task.imagePath = QDir(imageRoot).filePath(info.version);
+                    break;
+                }
+            }
+        }
+        m_tasks.append(task);
+    }
+
+    for (int i = 0; i < m_tasks.size(); ++i) {
+        Task &task = m_tasks[i];
+        emit resultChanged(task.result);
+
+        if (m_options.action == FleetAction::MountDevImage &&
+            task.imagePath.isEmpty()) {
+            FleetResult result = task.result;
+            result.status = FleetResult::Status::Failed;
+            result.message = "No compatible developer disk image downloaded";
+            finishTask(m_runId, i, result);
+            continue;
+        }
+
+        QtConcurrent::run(&m_pool, [this, run = m_runId, i,
+                                    slot = task.slot,
+                                    abandoned = task.abandoned,
+                                    cancelled = m_cancelled,
+                                    options = m_options,
+                                    imagePath = task.imagePath,
+                                    result = task.result]() {
+            runTask(run, i, slot, options, imagePath, result, cancelled,
+                    abandoned);
+        });
+    }
+    return true;
+}
+
+void FleetScheduler::cancel()
+{
+    // Queued devices are skipped, running ones finish their current call
+    if (m_cancelled) {
+        *m_cancelled = true;
+    }
+}
+
+void FleetScheduler::runTask(int run, int index,
+                             std::shared_ptr<DeviceSlot> slot,
+                             FleetJobOptions options, QString imagePath,
+                             FleetResult result,
+                             std::shared_ptr<std::atomic<bool>> cancelled,
+                             std::shared_ptr<std::atomic<bool>> abandoned)
+{
+    QElapsedTimer clock;
+    clock.start();
+
+    result.status = FleetResult::Status::Failed;
+    for (int attempt = 0; attempt <= options.retries; ++attempt) {
+        if (attempt > 0) {
+            // 0.5s, 1s, 2s, ... between attempts, capped at 8s
+            QThread::msleep(500u << qMin(attempt - 1, 4));
+        }
+        if (*cancelled) {
+            result.status = FleetResult::Status::Cancelled;
+            result.message = "Cancelled";
+            break;
+        }
+        if (*abandoned) {
+            // Already reported as timed out, nobody is listening anymore
+            return;
+        }
+
+        result.attempts = attempt + 1;
+        QMetaObject::invokeMethod(
+            this,
+            [this, run, index, attempt]() {
+                onAttemptStarted(run, index, attempt);
+            },
+            Qt::QueuedConnection);
+
+        QMutexLocker locker(&slot->mutex);
+        if (slot->removed) {
+            result.message = "Device disconnected";
+            break;
+        }
+        if (runAction(*slot, options, imagePath, result.deviceName,
+                      result.message)) {
+            result.status = FleetResult::Status::Succeeded;
+            break;
+        }
+        qDebug() << "Fleet:" << actionName(options.action) << "failed on"
+                 << slot->device->udid.c_str() << "attempt" << attempt + 1
+                 << ":" << result.message;
+    }
+
+    if (*abandoned) {
+        return;
+    }
+    result.elapsedMs = clock.elapsed();
+    QMetaObject::invokeMethod(
+        this, [this, run, index, result]() { finishTask(run, index, result); },
+        Qt::QueuedConnection);
+}
+
+bool FleetScheduler::runAction(DeviceSlot &slot,
+                               const FleetJobOptions &options,
+                               const QString &imagePath,
+                               const QString &deviceName, QString &message)
+{
+    iDescriptorDevice *device = slot.device;
+
+    switch (options.action) {
+    case FleetAction::Screenshot: {
+        if (!slot.screenshotClient) {
+            slot.screenshotClient =
+                ServiceBroker::sharedInstance()->acquire<screenshotr_client_t>(
+                    device->device);
+            if (!slot.screenshotClient) {
+                message = "Could not start screenshot service, is the "
+                          "developer disk image mounted?";
+                return false;
+            }
+        }
+
+        TakeScreenshotResult shot = take_screenshot(slot.screenshotClient);
+        if (!shot.success) {
+            // The connection may be stale, reconnect on the next attempt
+            ServiceBroker::sharedInstance()->release(
+                device->device, slot.screenshotClient, false);
+            slot.screenshotClient = nullptr;
+            message = "Failed to take screenshot";
+            return false;
+        }
+
+        QString baseName = deviceName.isEmpty()
+                               ? QString::fromStdString(device->udid)
+                               : deviceName;
+        baseName.replace(QRegularExpression("[^A-Za-z0-9_-]"), "_");
+        const QString filePath = QDir(options.outputDir)
+                                     .filePath(QString("%1_%2.png").arg(
+                                         baseName,
+                                         QDateTime::currentDateTime().toString(
+                                             "yyyyMMdd_HHmmss")));
+        if (!shot.img.save(filePath, "PNG")) {
+            message = "Could not write " + filePath;
+            return false;
+        }
+        message = filePath;
+        return true;
+    }
+    case FleetAction::Restart:
+        if (!restart(device->device)) {
+            message = "Restart request failed";
+            return false;
+        }
+        return true;
+    case FleetAction::Shutdown:
+        if (!shutdown(device->device)) {
+            message = "Shutdown request failed";
+            return false;
+        }
+        return true;
+    case FleetAction::MountDevImage: {
+        DevDiskManager *manager = DevDiskManager::sharedInstance();
+        if (manager->isImageMounted(device->udid)) {
+            message = "Already mounted";
+            return true;
+        }
+        mobile_image_mounter_error_t err =
+            mount_dev_image(device->device,
+                            device->deviceInfo.parsedDeviceVersion,
+                            imagePath.toUtf8().constData());
+        if (err != MOBILE_IMAGE_MOUNTER_E_SUCCESS) {
+            message = QString("Mount failed (%1)").arg(err);
+            return false;
+        }
+        manager->setImageMounted(device->udid, std::string());
+        message = QDir(imagePath).dirName();
+        return true;
+    }
+    case FleetAction::SetLocation:
+        if (!slot.locationClient) {
+            slot.locationClient = location_session_open(device->device);
+            if (!slot.locationClient) {
+                message = "Could not start location service, is the "
+                          "developer disk image mounted?";
+                return false;
+            }
+        }
+        if (!location_session_send(slot.locationClient, options.latitude,
+                                   options.longitude)) {
+            location_session_close(slot.locationClient);
+            slot.locationClient = nullptr;
+            message = "Failed to send location";
+            return false;
+        }
+        return true;
+    case FleetAction::InstallApp: {
+        // Shares the AFC connection with the rest of the app
+        std::lock_guard<std::recursive_mutex> lock(*device->mutex);
+        instproxy_error_t err = install_IPA(
+            device->device, device->afcClient,
+            options.ipaPath.toUtf8().constData());
+        if (err != INSTPROXY_E_SUCCESS) {
+            message = QString("Install failed (%1)").arg(err);
+            return false;
+        }
+        return true;
+    }
+    }
+    return false;
+}
+
+void FleetScheduler::onAttemptStarted(int run, int index, int attempt)
+{
+    if (run != m_runId || m_tasks[index].done) {
+        return;
+    }
+    Task &task = m_tasks[index];
+    if (attempt == 0) {
+        task.clock.start();
+    }
+    task.result.status = FleetResult::Status::Running;
+    task.result.attempts = attempt + 1;
+    emit resultChanged(task.result);
+
+    if (m_options.timeoutSeconds <= 0) {
+        return;
+    }
+    if (!task.timeoutTimer) {
+        task.timeoutTimer = new QTimer(this);
+        task.timeoutTimer->setSingleShot(true);
+        connect(task.timeoutTimer, &QTimer::timeout, this,
+                [this, index]() { onAttemptTimedOut(index); });
+    }
+    task.timeoutTimer->start(m_options.timeoutSeconds * 1000);
+}
+
+void FleetScheduler::onAttemptTimedOut(int index)
+{
+    if (m_tasks[index].done) {
+        return;
+    }
+    Task &task = m_tasks[index];
+
+    // The call itself can't be interrupted, drop whatever it returns
+    *task.abandoned = true;
+    FleetResult result = task.result;
+    result.status = FleetResult::Status::TimedOut;
+    result.elapsedMs = task.clock.isValid() ? task.clock.elapsed() : 0;
+    result.message =
+        QString("No response after %1s").arg(m_options.timeoutSeconds);
+    finishTask(m_runId, index, result);
+}
+
+void FleetScheduler::finishTask(int run, int index, const FleetResult &result)
+{
+    if (run != m_runId || m_tasks[index].done) {
+        return;
+    }
+    Task &task = m_tasks[index];
+    task.done = true;
+    task.result = result;
+    if (task.timeoutTimer) {
+        task.timeoutTimer->stop();
+    }
+
+    ++m_finished;
+    emit resultChanged(task.result);
+    emit progress(m_finished, m_tasks.size());
+
+    if (m_finished == m_tasks.size()) {
+        for (Task &t : m_tasks) {
+            if (t.timeoutTimer) {
+                t.timeoutTimer->deleteLater();
+                t.timeoutTimer = nullptr;
+            }
+        }
+        m_running = false;
+        emit runFinished();
+    }
+}
@@ -0,0 +1,161 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLEETSCHEDULER_H
+#define FLEETSCHEDULER_H
+
+#include "iDescriptor.h"
+#include <QElapsedTimer>
+#include <QMap>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+
+enum class FleetAction {
+    Screenshot,
+    Restart,
+    Shutdown,
+    MountDevImage,
+    SetLocation,
+    InstallApp
+};
+
+struct FleetJobOptions {
+    FleetAction action = FleetAction::Screenshot;
+    int maxParallel = 4;
+    int retries = 1;         // extra attempts after the first failure
+    int timeoutSeconds = 60; // per attempt
+    QString outputDir;       // Screenshot
+    QString ipaPath;         // InstallApp
+    double latitude = 0;     // SetLocation
+    double longitude = 0;
+};
+
+struct FleetResult {
+    enum class Status {
+        Queued,
+        Running,
+        Succeeded,
+        Failed,
+        TimedOut,
+        Cancelled
+    };
+
+    std::string udid;
+    QString deviceName;
+    Status status = Status::Queued;
+    int attempts = 0;
+    qint64 elapsedMs = 0;
+    QString message;
+};
+Q_DECLARE_METATYPE(FleetResult)
+
+/**
+ * @brief Runs one action across many devices with bounded parallelism
+ *
+ * Each device gets its own task on a private thread pool limited to
+ * maxParallel threads. Failed attempts are retried with a short backoff,
+ * an attempt running longer than the timeout is reported as timed out
+ * (libimobiledevice calls can't be interrupted, the call is left to
+ * finish in the background and its result dropped).
+ *
+ * Service clients that can be reused (screenshotr, simulatelocation) stay
+ * open per device across runs and are only dropped when a call on them
+ * fails or the device disconnects.
+ */
+class FleetScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FleetScheduler *sharedInstance();
+
+    static QString actionName(FleetAction action);
+    static QString statusName(FleetResult::Status status);
+
+    bool isRunning() const { return m_running; }
+
+    // Devices must be connected, returns false if a run is in progress
+    bool start(const QList<iDescriptorDevice *> &devices,
+               const FleetJobOptions &options);
+    void cancel();
+
+signals:
+    void resultChanged(const FleetResult &result);
+    void progress(int finished, int total);
+    void runFinished();
+
+private:
+    explicit FleetScheduler(QObject *parent = nullptr);
+    ~FleetScheduler();
+
+    // Per-device state shared between the GUI thread and worker tasks
+    struct DeviceSlot {
+        QMutex mutex; // held while an action runs on the device
+        iDescriptorDevice *device = nullptr;
+        bool removed = false;
+        screenshotr_client_t screenshotClient = nullptr;
+        service_client_t locationClient = nullptr;
+
+        void closeClients();
+    };
+
+    struct Task {
+        std::shared_ptr<DeviceSlot> slot;
+        // Set once the task timed out, the worker then drops its result
+        std::shared_ptr<std::atomic<bool>> abandoned;
+        FleetResult result;
+        QString imagePath; // MountDevImage, resolved up front
+        QElapsedTimer clock;
+        QTimer *timeoutTimer = nullptr;
+        bool done = false;
+    };
+
+    std::shared_ptr<DeviceSlot> slotFor(iDescriptorDevice *device);
+    void onDeviceRemoved(const std::string &udid);
+
+    void runTask(int run, int index, std::shared_ptr<DeviceSlot> slot,
+                 FleetJobOptions options, QString imagePath,
+                 FleetResult result,
+                 std::shared_ptr<std::atomic<bool>> cancelled,
+                 std::shared_ptr<std::atomic<bool>> abandoned);
+    bool runAction(DeviceSlot &slot, const FleetJobOptions &options,
+                   const QString &imagePath, const QString &deviceName,
+                   QString &message);
+
+    void onAttemptStarted(int run, int index, int attempt);
+    void onAttemptTimedOut(int index);
+    void finishTask(int run, int index, const FleetResult &result);
+
+    QMap<std::string, std::shared_ptr<DeviceSlot>> m_slots;
+    QThreadPool m_pool;
+    QList<Task> m_tasks;
+    FleetJobOptions m_options;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+    int m_runId = 0; // tells late results from an earlier run apart
+    int m_finished = 0;
+    bool m_running = false;
+};
+
+#endif // FLEETSCHEDULER_H
@@ -0,0 +1,399 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "fleetwidget.h"
+#include "appcontext.h"
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFormLayout>
+#include <QGroupBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QSet>
+#include <QStandardPaths>
+#include <QVBoxLayout>
+
+namespace
+{
+enum Column {
+    DeviceColumn,
+    UdidColumn,
+    StatusColumn,
+    AttemptsColumn,
+    TimeColumn,
+    MessageColumn,
+    ColumnCount
+};
+
+// Pages of m_actionOptions
+enum OptionsPage { NoOptionsPage, OutputDirPage, LocationPage, IpaPage };
+
+OptionsPage optionsPageFor(FleetAction action)
+{
+    switch (action) {
+    case FleetAction::Screenshot:
+        return OutputDirPage;
+    case FleetAction::SetLocation:
+        return LocationPage;
+    case FleetAction::InstallApp:
+        return IpaPage;
+    default:
+        return NoOptionsPage;
+    }
+}
+} // namespace
+
+FleetWidget::FleetWidget(QWidget *parent) : QWidget(parent)
+{
+    setupUI();
+
+    FleetScheduler *scheduler = FleetScheduler::sharedInstance();
+    connect(scheduler, &FleetScheduler::resultChanged, this,
+            &FleetWidget::onResultChanged);
+    connect(scheduler, &FleetScheduler::progress, this,
+            &FleetWidget::onProgress);
+    connect(scheduler, &FleetScheduler::runFinished, this,
+            &FleetWidget::onRunFinished);
+
+    connect(AppContext::sharedInstance(), &AppContext::deviceAdded, this,
+            &FleetWidget::refreshDevices);
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            &FleetWidget::refreshDevices);
+
+    refreshDevices();
+    setRunning(scheduler->isRunning());
+}
+
+void FleetWidget::setupUI()
+{
+    setWindowTitle("Fleet Operations - iDescriptor");
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(20, 20, 20, 20);
+    mainLayout->setSpacing(12);
+
+    QHBoxLayout *topLayout = new QHBoxLayout();
+
+    QGroupBox *devicesGroup = new QGroupBox("Devices");
+    QVBoxLayout *devicesLayout = new QVBoxLayout(devicesGroup);
+    m_deviceList = new QListWidget();
+    devicesLayout->addWidget(m_deviceList);
+    QHBoxLayout *selectLayout = new QHBoxLayout();
+    QPushButton *selectAllButton = new QPushButton("Select All");
+    QPushButton *selectNoneButton = new QPushButton("Select None");
+    selectLayout->addWidget(selectAllButton);
+    selectLayout->addWidget(selectNoneButton);
+    devicesLayout->addLayout(selectLayout);
+    topLayout->addWidget(devicesGroup, 1);
+
+    auto setAllChecked = [this](Qt::CheckState state) {
+        for (int i = 0; i < m_deviceList->count(); ++i) {
+            m_deviceList->item(i)->setCheckState(state);
+        }
+    };
+    connect(selectAllButton, &QPushButton::clicked, this,
+            [setAllChecked]() { setAllChecked(Qt::Checked); });
+    connect(selectNoneButton, &QPushButton::clicked, this,
+            [setAllChecked]() { setAllChecked(Qt::Unchecked); });
+
+    QGroupBox *actionGroup = new QGroupBox("Action");
+    QVBoxLayout *actionLayout = new QVBoxLayout(actionGroup);
+    m_actionCombo = new QComboBox();
+    for (FleetAction action :
+         {FleetAction::Screenshot, FleetAction::Restart, FleetAction::Shutdown,
+          FleetAction::MountDevImage, FleetAction::SetLocation,
+          FleetAction::InstallApp}) {
+        m_actionCombo->addItem(FleetScheduler::actionName(action),
+                               static_cast<int>(action));
+    }
+    actionLayout->addWidget(m_actionCombo);
+
+    m_actionOptions = new QStackedWidget();
+    m_actionOptions->addWidget(new QWidget());
+
+    QWidget *outputDirPage = new QWidget();
+    QHBoxLayout *outputDirLayout = new QHBoxLayout(outputDirPage);
+    outputDirLayout->setContentsMargins(0, 0, 0, 0);
+    m_outputDirEdit = new QLineEdit(
+        QStandardPaths::writableLocation(QStandardPaths::PicturesLocation));
+    QPushButton *outputDirButton = new QPushButton("Browse...");
+    outputDirLayout->addWidget(new QLabel("Save to"));
+    outputDirLayout->addWidget(m_outputDirEdit, 1);
+    outputDirLayout->addWidget(outputDirButton);
+    m_actionOptions->addWidget(outputDirPage);
+    connect(outputDirButton, &QPushButton::clicked, this, [this]() {
+        const QString dir = QFileDialog::getExistingDirectory(
+            this, "Save Screenshots To", m_outputDirEdit->text());
+        if (!dir.isEmpty()) {
+            m_outputDirEdit->setText(dir);
+        }
+    });
+
+    QWidget *locationPage = new QWidget();
+    QFormLayout *locationLayout = new QFormLayout(locationPage);
+    locationLayout->setContentsMargins(0, 0, 0, 0);
+    m_latitudeSpinBox = new QDoubleSpinBox();
+    m_latitudeSpinBox->setRange(-90.0, 90.0);
+    m_latitudeSpinBox->setDecimals(6);
+    m_longitudeSpinBox = new QDoubleSpinBox();
+    m_longitudeSpinBox->setRange(-180.0, 180.0);
+    m_longitudeSpinBox->setDecimals(6);
+    locationLayout->addRow("Latitude", m_latitudeSpinBox);
+    locationLayout->addRow("Longitude", m_longitudeSpinBox);
+    m_actionOptions->addWidget(locationPage);
+
+    QWidget *ipaPage = new QWidget();
+    QHBoxLayout *ipaLayout = new QHBoxLayout(ipaPage);
+    ipaLayout->setContentsMargins(0, 0, 0, 0);
+    m_ipaPathEdit = new QLineEdit();
+    m_ipaPathEdit->setPlaceholderText("Path to .ipa");
+    QPushButton *ipaButton = new QPushButton("Browse...");
+    ipaLayout->addWidget(m_ipaPathEdit, 1);
+    ipaLayout->addWidget(ipaButton);
+    m_actionOptions->addWidget(ipaPage);
+    connect(ipaButton, &QPushButton::clicked, this, [this]() {
+        const QString path = QFileDialog::getOpenFileName(
+            this, "Select IPA", QString(), "iOS Apps (*.ipa)");
+        if (!path.isEmpty()) {
+            m_ipaPathEdit->setText(path);
+        }
+    });
+
+    actionLayout->addWidget(m_actionOptions);
+
+    QFormLayout *limitsLayout = new QFormLayout();
+    m_parallelSpinBox = new QSpinBox();
+    m_parallelSpinBox->setRange(1, 32);
+    m_parallelSpinBox->setValue(4);
+    m_parallelSpinBox->setToolTip("Devices worked on at the same time");
+    m_retriesSpinBox = new QSpinBox();
+    m_retriesSpinBox->setRange(0, 5);
+    m_retriesSpinBox->setValue(1);
+    m_timeoutSpinBox = new QSpinBox();
+    m_timeoutSpinBox->setRange(0, 3600);
+    m_timeoutSpinBox->setValue(60);
+    m_timeoutSpinBox->setSuffix(" s");
+    m_timeoutSpinBox->setSpecialValueText("None");
+    m_timeoutSpinBox->setToolTip("Per attempt");
+    limitsLayout->addRow("Parallel devices", m_parallelSpinBox);
+    limitsLayout->addRow("Retries", m_retriesSpinBox);
+    limitsLayout->addRow("Timeout", m_timeoutSpinBox);
+    actionLayout->addLayout(limitsLayout);
+    actionLayout->addStretch();
+    topLayout->addWidget(actionGroup, 1);
+
+    mainLayout->addLayout(topLayout);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    m_progressBar = new QProgressBar();
+    m_progressBar->setValue(0);
+    m_startButton = new QPushButton("Start");
+    m_cancelButton = new QPushButton("Cancel");
+    buttonLayout->addWidget(m_progressBar, 1);
+    buttonLayout->addWidget(m_startButton);
+    buttonLayout->addWidget(m_cancelButton);
+    mainLayout->addLayout(buttonLayout);
+
+    m_statusLabel = new QLabel();
+    m_statusLabel->setStyleSheet("color: #666; font-size: 12px;");
+    mainLayout->addWidget(m_statusLabel);
+
+    m_resultsTable = new QTableWidget(0, ColumnCount);
+    m_resultsTable->setHorizontalHeaderLabels(
+        {"Device", "UDID", "Status", "Attempts", "Time", "Message"});
+    m_resultsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_resultsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_resultsTable->setAlternatingRowColors(true);
+    m_resultsTable->verticalHeader()->setVisible(false);
+    m_resultsTable->horizontalHeader()->setSectionResizeMode(
+        MessageColumn, QHeaderView::Stretch);
+    mainLayout->addWidget(m_resultsTable, 1);
+
+    connect(m_actionCombo, &QComboBox::currentIndexChanged, this,
+            &FleetWidget::onActionChanged);
+    connect(m_startButton, &QPushButton::clicked, this,
+            &FleetWidget::onStartClicked);
+    connect(m_cancelButton, &QPushButton::clicked,
+            FleetScheduler::sharedInstance(), &FleetScheduler::cancel);
+
+    onActionChanged(m_actionCombo->currentIndex());
+}
+
+void FleetWidget::refreshDevices()
+{
+    QSet<QString> checked;
+    for (int i = 0; i < m_deviceList->count(); ++i) {
+        QListWidgetItem *item = m_deviceList->item(i);
+        if (item->checkState() == Qt::Checked) {
+            checked.insert(item->data(Qt::UserRole).toString());
+        }
+    }
+
+    m_deviceList->clear();
+    for (iDescriptorDevice *device :
+         AppContext::sharedInstance()->getAllDevices()) {
+        const QString udid = QString::fromStdString(device->udid);
+        QListWidgetItem *item = new QListWidgetItem(
+            QString("%1 (%2)").arg(
+                QString::fromStdString(device->deviceInfo.deviceName), udid));
+        item->setData(Qt::UserRole, udid);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(checked.contains(udid) ? Qt::Checked
+                                                   : Qt::Unchecked);
+        m_deviceList->addItem(item);
+    }
+}
+
+void FleetWidget::onActionChanged(int index)
+{
+    const auto action =
+        static_cast<FleetAction>(m_actionCombo->itemData(index).toInt());
+    m_actionOptions->setCurrentIndex(optionsPageFor(action));
+}
+
+void FleetWidget::onStartClicked()
+{
+    QList<iDescriptorDevice *> devices;
+    for (int i = 0; i < m_deviceList->count(); ++i) {
+        QListWidgetItem *item = m_deviceList->item(i);
+        if (item->checkState() != Qt::Checked) {
+            continue;
+        }
+        iDescriptorDevice *device = AppContext::sharedInstance()->getDevice(
+            item->data(Qt::UserRole).toString().toStdString());
+        if (device) {
+            devices.append(device);
+        }
+    }
+    if (devices.isEmpty()) {
+        QMessageBox::warning(this, "No Devices",
+                             "Select at least one connected device.");
+        return;
+    }
+
+    FleetJobOptions options;
+    options.action = static_cast<FleetAction>(
+        m_actionCombo->currentData().toInt());
+    options.maxParallel = m_parallelSpinBox->value();
+    options.retries = m_retriesSpinBox->value();
+    options.timeoutSeconds = m_timeoutSpinBox->value();
+    options.outputDir = m_outputDirEdit->text();
+    options.ipaPath = m_ipaPathEdit->text();
+    options.latitude = m_latitudeSpinBox->value();
+    options.longitude = m_longitudeSpinBox->value();
+
+    if (options.action == FleetAction::Screenshot &&
+        !QDir().mkpath(options.outputDir)) {
+        QMessageBox::warning(this, "Invalid Folder",
+                             "Could not create " + options.outputDir);
+        return;
+    }
+    if (options.action == FleetAction::InstallApp &&
+        !QFileInfo::exists(options.ipaPath)) {
+        QMessageBox::warning(this, "No IPA", "Select an .ipa file first.");
+        return;
+    }
+    if (options.action == FleetAction::Restart ||
+        options.action == FleetAction::Shutdown) {
+        const auto answer = QMessageBox::question(
+            this, FleetScheduler::actionName(options.action),
+            QString("%1 %2 device(s)?")
+                .arg(FleetScheduler::actionName(options.action))
+                .arg(devices.size()));
+        if (answer != QMessageBox::Yes) {
+            return;
+        }
+    }
+
+    m_resultsTable->setRowCount(0);
+    m_rows.clear();
+    m_progressBar->setRange(0, devices.size());
+    m_progressBar->setValue(0);
+
+    setRunning(true);
+    if (!FleetScheduler::sharedInstance()->start(devices, options)) {
+        setRunning(false);
+        m_statusLabel->setText("Another fleet operation is still running");
+    }
+}
+
+void FleetWidget::onResultChanged(const FleetResult &result)
+{
+    int row = m_rows.value(result.udid, -1);
+    if (row < 0) {
+        row = m_resultsTable->rowCount();
+        m_resultsTable->insertRow(row);
+        m_rows.insert(result.udid, row);
+        for (int column = 0; column < ColumnCount; ++column) {
+            m_resultsTable->setItem(row, column, new QTableWidgetItem());
+        }
+        m_resultsTable->item(row, DeviceColumn)->setText(result.deviceName);
+        m_resultsTable->item(row, UdidColumn)
+            ->setText(QString::fromStdString(result.udid));
+    }
+
+    m_resultsTable->item(row, StatusColumn)
+        ->setText(FleetScheduler::statusName(result.status));
+    m_resultsTable->item(row, AttemptsColumn)
+        ->setText(result.attempts ? QString::number(result.attempts)
+                                  : QString());
+    m_resultsTable->item(row, TimeColumn)
+        ->setText(result.elapsedMs
+                      ? QString("%1 s").arg(result.elapsedMs / 1000.0, 0,
+                                            'f', 1)
+                      : QString());
+    m_resultsTable->item(row, MessageColumn)->setText(result.message);
+    m_resultsTable->item(row, MessageColumn)->setToolTip(result.message);
+}
+
+void FleetWidget::onProgress(int finished, int total)
+{
+    m_progressBar->setRange(0, total);
+    m_progressBar->setValue(finished);
+    m_statusLabel->setText(
+        QString("%1 of %2 devices done").arg(finished).arg(total));
+}
+
+void FleetWidget::onRunFinished()
+{
+    int succeeded = 0;
+    for (int row = 0; row < m_resultsTable->rowCount(); ++row) {
+        if (m_resultsTable->item(row, StatusColumn)->text() ==
+            FleetScheduler::statusName(FleetResult::Status::Succeeded)) {
+            ++succeeded;
+        }
+    }
+    m_statusLabel->setText(QString("Finished, %1 of %2 succeeded")
+                               .arg(succeeded)
+                               .arg(m_resultsTable->rowCount()));
+    setRunning(false);
+}
+
+void FleetWidget::setRunning(bool running)
+{
+    m_startButton->setEnabled(!running);
+    m_cancelButton->setEnabled(running);
+    m_actionCombo->setEnabled(!running);
+    m_actionOptions->setEnabled(!running);
+    m_parallelSpinBox->setEnabled(!running);
+    m_retriesSpinBox->setEnabled(!running);
+    m_timeoutSpinBox->setEnabled(!running);
+}
@@ -0,0 +1,79 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FLEETWIDGET_H
+#define FLEETWIDGET_H
+
+#include "fleetscheduler.h"
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QStackedWidget>
+#include <QTableWidget>
+#include <QWidget>
+
+/**
+ * @brief Runs one action on several connected devices at once
+ *
+ * Front end for FleetScheduler, results stream into the table as each
+ * device finishes.
+ */
+class FleetWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit FleetWidget(QWidget *parent = nullptr);
+
+private slots:
+    void refreshDevices();
+    void onActionChanged(int index);
+    void onStartClicked();
+    void onResultChanged(const FleetResult &result);
+    void onProgress(int finished, int total);
+    void onRunFinished();
+
+private:
+    void setupUI();
+    void setRunning(bool running);
+
+    QListWidget *m_deviceList;
+    QComboBox *m_actionCombo;
+    QStackedWidget *m_actionOptions;
+    QLineEdit *m_outputDirEdit;
+    QLineEdit *m_ipaPathEdit;
+    QDoubleSpinBox *m_latitudeSpinBox;
+    QDoubleSpinBox *m_longitudeSpinBox;
+    QSpinBox *m_parallelSpinBox;
+    QSpinBox *m_retriesSpinBox;
+    QSpinBox *m_timeoutSpinBox;
+    QPushButton *m_startButton;
+    QPushButton *m_cancelButton;
+    QProgressBar *m_progressBar;
+    QLabel *m_statusLabel;
+    QTableWidget *m_resultsTable;
+    QMap<std::string, int> m_rows; // udid -> results table row
+};
+
+#endif // FLEETWIDGET_H
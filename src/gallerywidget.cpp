@@ -21,11 +21,17 @@
 #include "exportmanager.h"
 #include "iDescriptor.h"
 #include "mediapreviewdialog.h"
+#include "photolibraryindex.h"
 #include "photomodel.h"
 #include "servicemanager.h"
+#include "settingsmanager.h"
+#include "tracer.h"
 #include <QComboBox>
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QDir>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QFutureWatcher>
 #include <QHBoxLayout>
 #include <QItemSelectionModel>
@@ -54,6 +60,7 @@ GalleryWidget::GalleryWidget(iDescriptorDevice *device, QWidget *parent)
       m_albumListView(nullptr), m_photoGalleryWidget(nullptr),
       m_listView(nullptr), m_backButton(nullptr)
 {
+    m_coverPool.setMaxThreadCount(MaxCoverJobs);
 }
 /*Load is called when the tab is active*/
 void GalleryWidget::load()
@@ -90,6 +97,20 @@ void GalleryWidget::setupUI()
     // Start with album selection view and load albums
     m_stackedWidget->setCurrentWidget(m_albumSelectionWidget);
     setControlsEnabled(false); // Disable controls until album is selected
+
+    connect(PhotoLibraryIndex::sharedInstance(),
+            &PhotoLibraryIndex::libraryChanged, this,
+            [this](const QString &udid) {
+                if (udid.toStdString() != m_device->udid) {
+                    return;
+                }
+                updateLibraryAlbums();
+                if (m_model) {
+                    m_model->setLibrary(
+                        PhotoLibraryIndex::sharedInstance()->library(
+                            m_device->udid));
+                }
+            });
     loadAlbumList();
 }
 
@@ -120,6 +141,12 @@ void GalleryWidget::setupControlsLayout()
                               static_cast<int>(PhotoModel::ImagesOnly));
     m_filterComboBox->addItem("Videos Only",
                               static_cast<int>(PhotoModel::VideosOnly));
+    m_filterComboBox->addItem("Favorites",
+                              static_cast<int>(PhotoModel::FavoritesOnly));
+    m_filterComboBox->addItem("Live Photos",
+                              static_cast<int>(PhotoModel::LivePhotosOnly));
+    m_filterComboBox->addItem("Screenshots",
+                              static_cast<int>(PhotoModel::ScreenshotsOnly));
     m_filterComboBox->setCurrentIndex(0);   // Default to All
     m_filterComboBox->setMinimumWidth(100); // Ensure text fits
     m_filterComboBox->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
@@ -239,8 +266,9 @@ void GalleryWidget::onExportSelected()
     qDebug() << "Starting export of selected files:" << exportItems.size()
              << "items to" << exportDir;
 
-    ExportManager::sharedInstance()->startExport(m_device, exportItems,
-                                                 exportDir);
+    ExportManager::sharedInstance()->startExport(
+        m_device, exportItems, exportDir, std::nullopt, TransferBackend::Afc,
+        QString(), galleryExportOptions());
 }
 
 void GalleryWidget::onExportAll()
@@ -287,8 +315,19 @@ void GalleryWidget::onExportAll()
              << "items to" << exportDir;
 
     // Start export and the manager will show its own dialog
-    ExportManager::sharedInstance()->startExport(m_device, exportItems,
-                                                 exportDir);
+    ExportManager::sharedInstance()->startExport(
+        m_device, exportItems, exportDir, std::nullopt, TransferBackend::Afc,
+        QString(), galleryExportOptions());
+}
+
+ExportOptions GalleryWidget::galleryExportOptions() const
+{
+    SettingsManager *settings = SettingsManager::sharedInstance();
+    ExportOptions options;
+    options.transcodeHeic = settings->convertHeicOnExport();
+    options.jpegQuality = settings->jpegExportQuality();
+    options.remuxMov = settings->remuxMovOnExport();
+    return options;
 }
 
 QString GalleryWidget::selectExportDirectory()
@@ -383,21 +422,7 @@ void GalleryWidget::setupPhotoGalleryView()
 
     // Connect double-click to open preview dialog
     connect(m_listView, &QListView::doubleClicked, this,
-            [this](const QModelIndex &index) {
-                if (!index.isValid())
-                    return;
-
-                QString filePath =
-                    m_model->data(index, Qt::UserRole).toString();
-                if (filePath.isEmpty())
-                    return;
-
-                qDebug() << "Opening preview for" << filePath;
-                auto *previewDialog = new MediaPreviewDialog(
-                    m_device, m_device->afcClient, filePath, this);
-                previewDialog->setAttribute(Qt::WA_DeleteOnClose);
-                previewDialog->show();
-            });
+            &GalleryWidget::openPreview);
 
     connect(m_listView, &QListView::customContextMenuRequested, this,
             &GalleryWidget::onPhotoContextMenu);
@@ -417,7 +442,7 @@ void GalleryWidget::loadAlbumList()
     qDebug() << "DCIM directory read successfully, found"
              << dcimTree.entries.size() << "entries";
 
-    auto *albumModel = new QStandardItemModel(this);
+    m_albumModel = new QStandardItemModel(this);
 
     for (const MediaEntry &entry : dcimTree.entries) {
         QString albumName = QString::fromStdString(entry.name);
@@ -436,13 +461,51 @@ void GalleryWidget::loadAlbumList()
             item->setData(fullPath, Qt::UserRole); // Store full path
 
             item->setIcon(QIcon::fromTheme("folder"));
-            albumModel->appendRow(item);
+            m_albumModel->appendRow(item);
 
             loadAlbumThumbnailAsync(fullPath, item);
         }
     }
 
-    m_albumListView->setModel(albumModel);
+    m_albumListView->setModel(m_albumModel);
+
+    // Albums from the last index right away, refreshed if the library moved
+    updateLibraryAlbums();
+    PhotoLibraryIndex::sharedInstance()->refresh(m_device);
+}
+
+void GalleryWidget::updateLibraryAlbums()
+{
+    if (!m_albumModel) {
+        return;
+    }
+
+    // DCIM folders stay, library albums are rebuilt
+    for (int row = m_albumModel->rowCount() - 1; row >= 0; --row) {
+        if (m_albumModel->item(row)
+                ->data(Qt::UserRole)
+                .toString()
+                .startsWith(PhotoLibraryAlbumPrefix)) {
+            m_albumModel->removeRow(row);
+        }
+    }
+
+    auto library = PhotoLibraryIndex::sharedInstance()->library(m_device->udid);
+    if (!library) {
+        return;
+    }
+    for (const PhotoLibraryAlbum &album : library->albums) {
+        if (album.assets.isEmpty()) {
+            continue;
+        }
+        auto *item = new QStandardItem(album.title);
+        item->setData(QString(PhotoLibraryAlbumPrefix) +
+                          QString::number(album.id),
+                      Qt::UserRole);
+        item->setIcon(QIcon::fromTheme("folder-pictures",
+                                       QIcon::fromTheme("folder")));
+        m_albumModel->appendRow(item);
+    }
 }
 
 void GalleryWidget::onAlbumSelected(const QString &albumPath)
@@ -452,6 +515,8 @@ void GalleryWidget::onAlbumSelected(const QString &albumPath)
     // Create model if not exists
     if (!m_model) {
         m_model = new PhotoModel(m_device, getCurrentFilterType(), this);
+        m_model->setLibrary(
+            PhotoLibraryIndex::sharedInstance()->library(m_device->udid));
         m_listView->setModel(m_model);
 
         // Update export button states based on selection
@@ -502,86 +567,100 @@ void GalleryWidget::setControlsEnabled(bool enabled)
     Check out:
     https://github.com/ScottKjr3347/iOS_Local_PL_Photos.sqlite_Queries
 */
-QIcon GalleryWidget::loadAlbumThumbnail(const QString &albumPath)
+QImage GalleryWidget::loadAlbumThumbnail(iDescriptorDevice *device,
+                                         const QString &albumPath,
+                                         const QString &cachePath)
 {
-    // Get album directory contents
-    AFCFileTree albumTree =
-        ServiceManager::safeGetFileTree(m_device, albumPath.toStdString());
-
-    if (!albumTree.success) {
+    TraceSpan span("gallery", "album_cover", device);
+    span.setDetail(albumPath);
+
+    // Names only, a cover doesn't need a stat per file
+    char **files = nullptr;
+    if (ServiceManager::safeAfcReadDirectory(
+            device, albumPath.toUtf8().constData(), &files) !=
+            AFC_E_SUCCESS ||
+        !files) {
         qDebug() << "Failed to read album directory:" << albumPath;
-        return QIcon();
+        return QImage();
     }
 
-    // Find the first image file
-    QString firstImagePath;
-    for (const MediaEntry &entry : albumTree.entries) {
-        QString fileName = QString::fromStdString(entry.name);
-
-        if (!entry.isDir && (fileName.endsWith(".JPG", Qt::CaseInsensitive) ||
-                             fileName.endsWith(".PNG", Qt::CaseInsensitive) ||
-                             fileName.endsWith(".HEIC", Qt::CaseInsensitive))) {
-            firstImagePath = albumPath + "/" + fileName;
-            break;
+    QStringList images;
+    for (int i = 0; files[i]; ++i) {
+        QString fileName = QString::fromUtf8(files[i]);
+        if (fileName.endsWith(".JPG", Qt::CaseInsensitive) ||
+            fileName.endsWith(".PNG", Qt::CaseInsensitive) ||
+            fileName.endsWith(".HEIC", Qt::CaseInsensitive)) {
+            images.append(fileName);
         }
     }
+    afc_dictionary_free(files);
 
-    if (firstImagePath.isEmpty()) {
+    if (images.isEmpty()) {
         qDebug() << "No images found in album:" << albumPath;
-        return QIcon();
+        return QImage();
     }
 
-    // Load the thumbnail using ServiceManager
-    QByteArray imageData = ServiceManager::safeReadAfcFileToByteArray(
-        m_device, firstImagePath.toUtf8().constData());
+    // AFC listing order isn't stable, the lowest name is, which keeps the
+    // cached cover valid while new photos are added
+    std::sort(images.begin(), images.end());
+    const QString coverName = images.first();
 
-    if (imageData.isEmpty()) {
-        qDebug() << "Could not read image data for thumbnail:"
-                 << firstImagePath;
-        return QIcon();
+    QImage cached(cachePath);
+    if (!cached.isNull() && cached.text("Source") == coverName) {
+        return cached;
     }
 
-    QPixmap thumbnail;
-
-    if (firstImagePath.endsWith(".HEIC", Qt::CaseInsensitive)) {
-        qDebug() << "Loading HEIC thumbnail from:" << firstImagePath;
-        thumbnail = load_heic(imageData);
-    } else {
-        // Load regular image formats
-        if (!thumbnail.loadFromData(imageData)) {
-            qDebug() << "Could not decode image data for thumbnail:"
-                     << firstImagePath;
-            return QIcon();
-        }
-    }
+    // Same path as the grid thumbnails, HEICs decode their embedded
+    // thumbnail instead of the full image
+    QImage thumbnail = PhotoModel::loadThumbnailFromDevice(
+        device, albumPath + "/" + coverName, QSize(120, 120));
 
     if (thumbnail.isNull()) {
-        qDebug() << "Failed to load thumbnail from:" << firstImagePath;
-        return QIcon();
+        qDebug() << "Failed to load thumbnail from:" << coverName;
+        return QImage();
+    }
+
+    thumbnail.setText("Source", coverName);
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+    if (!thumbnail.save(cachePath, "PNG")) {
+        qDebug() << "Could not cache album cover:" << cachePath;
     }
+    return thumbnail;
+}
 
-    return QIcon(thumbnail);
+QString GalleryWidget::albumCoverCachePath(const QString &albumPath) const
+{
+    const QByteArray key =
+        QCryptographicHash::hash(albumPath.toUtf8(), QCryptographicHash::Sha1)
+            .toHex();
+    return QString("%1/covers/%2/%3.png")
+        .arg(SettingsManager::homePath(),
+             QString::fromStdString(m_device->udid), QString::fromLatin1(key));
 }
 
 void GalleryWidget::loadAlbumThumbnailAsync(const QString &albumPath,
                                             QStandardItem *item)
 {
     // Create a future watcher to handle the async result
-    auto *watcher = new QFutureWatcher<QIcon>(this);
+    auto *watcher = new QFutureWatcher<QImage>(this);
 
     // Connect the finished signal to update the item icon
-    connect(watcher, &QFutureWatcher<QIcon>::finished, this, [watcher, item]() {
-        QIcon result = watcher->result();
-        if (!result.isNull()) {
-            item->setIcon(result);
-        }
-        // The item keeps the folder icon if thumbnail loading fails
-        watcher->deleteLater();
-    });
+    connect(watcher, &QFutureWatcher<QImage>::finished, this,
+            [watcher, item]() {
+                QImage result = watcher->result();
+                if (!result.isNull()) {
+                    item->setIcon(QIcon(QPixmap::fromImage(result)));
+                }
+                // The item keeps the folder icon if thumbnail loading fails
+                watcher->deleteLater();
+            });
 
-    // Start the async operation
-    QFuture<QIcon> future = QtConcurrent::run(
-        [this, albumPath]() { return loadAlbumThumbnail(albumPath); });
+    // Queued on the bounded cover pool, not the global one
+    QFuture<QImage> future = QtConcurrent::run(
+        &m_coverPool, [device = m_device, albumPath,
+                       cachePath = albumCoverCachePath(albumPath)]() {
+            return loadAlbumThumbnail(device, albumPath, cachePath);
+        });
 
     watcher->setFuture(future);
 }
@@ -606,21 +685,8 @@ void GalleryWidget::onPhotoContextMenu(const QPoint &pos)
 
     exportAction->setEnabled(m_listView->selectionModel()->hasSelection());
 
-    connect(previewAction, &QAction::triggered, this, [this, index]() {
-        // Re-use the double-click logic
-        if (!index.isValid())
-            return;
-
-        QString filePath = m_model->data(index, Qt::UserRole).toString();
-        if (filePath.isEmpty())
-            return;
-
-        qDebug() << "Opening preview for" << filePath;
-        auto *previewDialog = new MediaPreviewDialog(
-            m_device, m_device->afcClient, filePath, this);
-        previewDialog->setAttribute(Qt::WA_DeleteOnClose);
-        previewDialog->show();
-    });
+    connect(previewAction, &QAction::triggered, this,
+            [this, index]() { openPreview(index); });
 
     connect(exportAction, &QAction::triggered, this,
             &GalleryWidget::onExportSelected);
@@ -628,7 +694,38 @@ void GalleryWidget::onPhotoContextMenu(const QPoint &pos)
     contextMenu.exec(m_listView->viewport()->mapToGlobal(pos));
 }
 
+void GalleryWidget::openPreview(const QModelIndex &index)
+{
+    if (!index.isValid())
+        return;
+
+    QString filePath = m_model->data(index, Qt::UserRole).toString();
+    if (filePath.isEmpty())
+        return;
+
+    qDebug() << "Opening preview for" << filePath;
+    auto *previewDialog = new MediaPreviewDialog(
+        m_device, m_device->afcClient, filePath, this);
+    previewDialog->setAttribute(Qt::WA_DeleteOnClose);
+
+    // Images can be browsed with Left/Right, reusing our thumbnails
+    if (m_model->getFileType(index) == PhotoInfo::Image) {
+        QStringList imagePaths;
+        for (int row = 0; row < m_model->rowCount(); ++row) {
+            const QModelIndex rowIndex = m_model->index(row);
+            if (m_model->getFileType(rowIndex) == PhotoInfo::Image) {
+                imagePaths.append(m_model->getFilePath(rowIndex));
+            }
+        }
+        previewDialog->setAlbum(imagePaths, m_model);
+    }
+    previewDialog->show();
+}
+
 GalleryWidget::~GalleryWidget()
 {
     qDebug() << "GalleryWidget destructor called";
+    // Covers that haven't started yet are not needed anymore
+    m_coverPool.clear();
+    m_coverPool.waitForDone();
 }
\ No newline at end of file
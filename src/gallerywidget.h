@@ -20,8 +20,10 @@
 #ifndef GALLERYWIDGET_H
 #define GALLERYWIDGET_H
 
+#include "exportmanager.h"
 #include "iDescriptor.h"
 #include "photomodel.h"
+#include <QThreadPool>
 #include <QWidget>
 
 QT_BEGIN_NAMESPACE
@@ -33,9 +35,9 @@ class QVBoxLayout;
 class QStackedWidget;
 class QLabel;
 class QStandardItem;
+class QStandardItemModel;
 QT_END_NAMESPACE
 
-class ExportManager;
 class ExportProgressDialog;
 
 class GalleryWidget : public QWidget
@@ -62,17 +64,28 @@ private:
     void setupAlbumSelectionView();
     void setupPhotoGalleryView();
     void loadAlbumList();
+    void updateLibraryAlbums();
     void setControlsEnabled(bool enabled);
     QString selectExportDirectory();
-    QIcon loadAlbumThumbnail(const QString &albumPath);
+    ExportOptions galleryExportOptions() const;
+    static QImage loadAlbumThumbnail(iDescriptorDevice *device,
+                                     const QString &albumPath,
+                                     const QString &cachePath);
+    QString albumCoverCachePath(const QString &albumPath) const;
     void loadAlbumThumbnailAsync(const QString &albumPath, QStandardItem *item);
     void onPhotoContextMenu(const QPoint &pos);
+    void openPreview(const QModelIndex &index);
     PhotoModel::FilterType getCurrentFilterType() const;
 
     iDescriptorDevice *m_device;
     bool m_loaded = false;
     QString m_currentAlbumPath;
 
+    // Covers share the device link with everything else, only a couple at
+    // a time
+    static constexpr int MaxCoverJobs = 2;
+    QThreadPool m_coverPool;
+
     // UI components
     QVBoxLayout *m_mainLayout;
     QHBoxLayout *m_controlsLayout;
@@ -81,6 +94,7 @@ private:
     // Album selection view
     QWidget *m_albumSelectionWidget;
     QListView *m_albumListView;
+    QStandardItemModel *m_albumModel = nullptr;
 
     // Photo gallery view
     QWidget *m_photoGalleryWidget;
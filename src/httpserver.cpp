@@ -28,7 +28,16 @@
 #include <QMimeDatabase>
 #include <QNetworkInterface>
 #include <QRandomGenerator>
+#include <QSet>
 #include <QUrl>
+#include <QUrlQuery>
+#include <cstring>
+
+// Bundles are plain (uncompressed) ustar archives built from 512 byte blocks
+static const qint64 TAR_BLOCK_SIZE = 512;
+static const qint64 BUNDLE_CHUNK_SIZE = 256 * 1024;
+// Only read more from disk once the socket has drained below this
+static const qint64 BUNDLE_MAX_BUFFERED = 1024 * 1024;
 
 HttpServer::HttpServer(QObject *parent)
     : QObject(parent), server(new QTcpServer(this)), port(8080)
@@ -37,12 +46,25 @@ HttpServer::HttpServer(QObject *parent)
             &HttpServer::onNewConnection);
 }
 
-HttpServer::~HttpServer() { stop(); }
+HttpServer::~HttpServer()
+{
+    stop();
+    qDeleteAll(activeBundles);
+    activeBundles.clear();
+}
 
 void HttpServer::start(const QStringList &files)
 {
     fileList = files;
 
+    fileIndex.clear();
+    for (const QString &file : fileList) {
+        const QString name = QFileInfo(file).fileName();
+        if (!fileIndex.contains(name)) {
+            fileIndex.insert(name, file);
+        }
+    }
+
     // Generate unique JSON filename
     QString timestamp =
         QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss");
@@ -84,6 +106,13 @@ void HttpServer::onReadyRead()
         return;
 
     QByteArray data = socket->readAll();
+
+    // Anything written now would land in the middle of the tar stream
+    if (activeBundles.contains(socket)) {
+        qWarning() << "Ignoring request while a bundle is in flight";
+        return;
+    }
+
     QString request = QString::fromUtf8(data);
 
     // Parse HTTP request
@@ -110,6 +139,7 @@ void HttpServer::onDisconnected()
 {
     QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
     if (socket) {
+        cleanupBundle(socket);
         socket->deleteLater();
     }
 }
@@ -122,21 +152,21 @@ void HttpServer::handleRequest(QTcpSocket *socket, const QString &path)
         return;
     }
 
+    // Serve all (or ?files=a,b,c selected) files as one tar stream
+    const int queryStart = path.indexOf('?');
+    const QString route = queryStart == -1 ? path : path.left(queryStart);
+    if (route == "/bundle") {
+        sendBundle(socket,
+                   queryStart == -1 ? QString() : path.mid(queryStart + 1));
+        return;
+    }
+
     // Serve files from /serve/ directory
     if (path.startsWith("/serve/")) {
         QString encodedFileName = path.mid(7); // Remove "/serve/"
         QString fileName = QUrl::fromPercentEncoding(encodedFileName.toUtf8());
 
-        // Find the file in our list
-        QString targetFile;
-        for (const QString &file : fileList) {
-            QFileInfo info(file);
-            if (info.fileName() == fileName) {
-                targetFile = file;
-                break;
-            }
-        }
-
+        const QString targetFile = fileIndex.value(fileName);
         if (!targetFile.isEmpty()) {
             sendFile(socket, targetFile);
             return;
@@ -208,6 +238,208 @@ void HttpServer::sendJsonManifest(QTcpSocket *socket)
     sendResponse(socket, 200, "application/json", jsonContent.toUtf8());
 }
 
+void HttpServer::sendBundle(QTcpSocket *socket, const QString &query)
+{
+    QStringList names;
+    const QString selection =
+        QUrlQuery(query).queryItemValue("files", QUrl::FullyEncoded);
+    if (selection.isEmpty()) {
+        for (const QString &file : fileList) {
+            names.append(QFileInfo(file).fileName());
+        }
+    } else {
+        // Names are percent-encoded individually, so a literal ',' can only
+        // be a separator
+        for (const QString &encoded :
+             selection.split(',', Qt::SkipEmptyParts)) {
+            names.append(QUrl::fromPercentEncoding(encoded.toUtf8()));
+        }
+    }
+
+    QList<BundleEntry> entries;
+    QSet<QString> seen;
+    qint64 contentLength = 2 * TAR_BLOCK_SIZE; // end-of-archive marker
+    for (const QString &name : names) {
+        if (seen.contains(name)) {
+            continue;
+        }
+        seen.insert(name);
+
+        const QString filePath = fileIndex.value(name);
+        QFileInfo info(filePath);
+        if (filePath.isEmpty() || !info.isFile()) {
+            sendResponse(socket, 404, "text/plain",
+                         QString("File not found: %1").arg(name).toUtf8());
+            return;
+        }
+
+        BundleEntry entry{name, filePath, info.size()};
+        contentLength += tarEntrySize(entry);
+        entries.append(entry);
+    }
+
+    QString response = "HTTP/1.1 200 OK\r\n";
+    response += "Content-Type: application/x-tar\r\n";
+    response += QString("Content-Length: %1\r\n").arg(contentLength);
+    response +=
+        QString("Content-Disposition: attachment; filename=\"%1.tar\"\r\n")
+            .arg(QFileInfo(jsonFileName).completeBaseName());
+    response += "Access-Control-Allow-Origin: *\r\n";
+    response += "Connection: close\r\n";
+    response += "\r\n";
+    socket->write(response.toUtf8());
+
+    BundleContext *context = new BundleContext();
+    context->socket = socket;
+    context->entries = entries;
+    activeBundles.insert(socket, context);
+
+    connect(socket, &QTcpSocket::bytesWritten, this, [this, socket]() {
+        BundleContext *context = activeBundles.value(socket);
+        if (context) {
+            streamNextBundleChunk(context);
+        }
+    });
+
+    streamNextBundleChunk(context);
+}
+
+void HttpServer::streamNextBundleChunk(BundleContext *context)
+{
+    QTcpSocket *socket = context->socket;
+
+    while (socket->bytesToWrite() < BUNDLE_MAX_BUFFERED) {
+        if (!context->file.isOpen()) {
+            if (context->index >= context->entries.size()) {
+                socket->write(QByteArray(2 * TAR_BLOCK_SIZE, '\0'));
+                cleanupBundle(socket);
+                socket->disconnectFromHost();
+                return;
+            }
+
+            const BundleEntry &entry = context->entries.at(context->index);
+            context->file.setFileName(entry.path);
+            if (!context->file.open(QIODevice::ReadOnly)) {
+                // Headers are already sent, cutting the stream short is the
+                // only way left to tell the client the archive is incomplete
+                qWarning() << "Bundle: failed to open" << entry.path;
+                cleanupBundle(socket);
+                socket->abort();
+                return;
+            }
+            context->entryBytesSent = 0;
+            socket->write(tarEntryHeader(entry));
+        }
+
+        const BundleEntry &entry = context->entries.at(context->index);
+        const qint64 remaining = entry.size - context->entryBytesSent;
+        if (remaining > 0) {
+            const QByteArray chunk =
+                context->file.read(qMin(BUNDLE_CHUNK_SIZE, remaining));
+            if (chunk.isEmpty()) {
+                qWarning() << "Bundle: file shrank while streaming"
+                           << entry.path;
+                cleanupBundle(socket);
+                socket->abort();
+                return;
+            }
+            socket->write(chunk);
+            context->entryBytesSent += chunk.size();
+            continue;
+        }
+
+        const qint64 padding =
+            (TAR_BLOCK_SIZE - entry.size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+        if (padding > 0) {
+            socket->write(QByteArray(padding, '\0'));
+        }
+        context->file.close();
+        emit downloadProgress(entry.name, static_cast<int>(entry.size),
+                              static_cast<int>(entry.size));
+        ++context->index;
+    }
+}
+
+void HttpServer::cleanupBundle(QTcpSocket *socket)
+{
+    BundleContext *context = activeBundles.take(socket);
+    if (!context) {
+        return;
+    }
+    disconnect(socket, &QTcpSocket::bytesWritten, this, nullptr);
+    delete context;
+}
+
+QByteArray HttpServer::tarHeader(const QString &name, qint64 size,
+                                 char typeFlag)
+{
+    QByteArray header(TAR_BLOCK_SIZE, '\0');
+    char *h = header.data();
+
+    const QByteArray nameBytes = name.toUtf8();
+    memcpy(h, nameBytes.constData(), qMin<qsizetype>(nameBytes.size(), 99));
+    memcpy(h + 100, "0000644", 7); // mode
+    memcpy(h + 108, "0000000", 7); // uid
+    memcpy(h + 116, "0000000", 7); // gid
+
+    if (size <= 077777777777LL) {
+        qsnprintf(h + 124, 12, "%011llo",
+                  static_cast<unsigned long long>(size));
+    } else {
+        // GNU base-256 encoding for entries of 8 GiB and larger
+        h[124] = static_cast<char>(0x80);
+        quint64 value = static_cast<quint64>(size);
+        for (int i = 11; i >= 4; --i) {
+            h[124 + i] = static_cast<char>(value & 0xff);
+            value >>= 8;
+        }
+    }
+
+    qsnprintf(h + 136, 12, "%011llo",
+              static_cast<unsigned long long>(
+                  QDateTime::currentSecsSinceEpoch()));
+    h[156] = typeFlag;
+    memcpy(h + 257, "ustar", 6);
+    memcpy(h + 263, "00", 2);
+
+    // Checksum is computed with the checksum field itself set to spaces
+    memset(h + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (int i = 0; i < TAR_BLOCK_SIZE; ++i) {
+        checksum += static_cast<unsigned char>(h[i]);
+    }
+    qsnprintf(h + 148, 8, "%06o", checksum);
+
+    return header;
+}
+
+QByteArray HttpServer::tarEntryHeader(const BundleEntry &entry)
+{
+    const QByteArray nameBytes = entry.name.toUtf8();
+    if (nameBytes.size() < 100) {
+        return tarHeader(entry.name, entry.size);
+    }
+
+    // Names that don't fit the 100 byte field go in a GNU long name record
+    QByteArray longName = nameBytes;
+    longName.append('\0');
+    const qint64 padding =
+        (TAR_BLOCK_SIZE - longName.size() % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+
+    QByteArray result = tarHeader("././@LongLink", longName.size(), 'L');
+    result += longName;
+    result += QByteArray(padding, '\0');
+    result += tarHeader(entry.name, entry.size);
+    return result;
+}
+
+qint64 HttpServer::tarEntrySize(const BundleEntry &entry)
+{
+    const qint64 padding =
+        (TAR_BLOCK_SIZE - entry.size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+    return tarEntryHeader(entry).size() + entry.size + padding;
+}
+
 QString HttpServer::generateJsonManifest() const
 {
     QString serverIP = getLocalIP();
@@ -218,6 +450,7 @@ QString HttpServer::generateJsonManifest() const
     for (const QString &file : fileList) {
         QFileInfo info(file);
         QJsonObject item;
+        item["name"] = info.fileName();
         item["path"] = QString("http://%1:%2/serve/%3")
                            .arg(serverIP)
                            .arg(port)
@@ -227,6 +460,8 @@ QString HttpServer::generateJsonManifest() const
     }
 
     manifest["items"] = items;
+    manifest["bundle"] =
+        QString("http://%1:%2/bundle").arg(serverIP).arg(port);
 
     QJsonDocument doc(manifest);
     return doc.toJson();
@@ -20,6 +20,8 @@
 #ifndef HTTPSERVER_H
 #define HTTPSERVER_H
 
+#include <QFile>
+#include <QHash>
 #include <QMap>
 #include <QObject>
 #include <QStringList>
@@ -51,17 +53,46 @@ private slots:
     void onDisconnected();
 
 private:
+    struct BundleEntry {
+        QString name;
+        QString path;
+        qint64 size;
+    };
+
+    /*
+     * State of one in-flight /bundle response. The archive is produced on
+     * the fly from disk and written only when the socket has drained, so no
+     * temporary file or full in-memory copy is ever made.
+     */
+    struct BundleContext {
+        QTcpSocket *socket;
+        QList<BundleEntry> entries;
+        int index = 0;
+        QFile file;
+        qint64 entryBytesSent = 0;
+    };
+
     QTcpServer *server;
     QStringList fileList;
+    // file name -> absolute path, first occurrence wins
+    QHash<QString, QString> fileIndex;
     int port;
     QString jsonFileName;
     QMap<QString, int> downloadTracker;
+    QHash<QTcpSocket *, BundleContext *> activeBundles;
 
     void handleRequest(QTcpSocket *socket, const QString &path);
     void sendResponse(QTcpSocket *socket, int statusCode,
                       const QString &contentType, const QByteArray &data);
     void sendFile(QTcpSocket *socket, const QString &filePath);
     void sendJsonManifest(QTcpSocket *socket);
+    void sendBundle(QTcpSocket *socket, const QString &query);
+    void streamNextBundleChunk(BundleContext *context);
+    void cleanupBundle(QTcpSocket *socket);
+    static QByteArray tarHeader(const QString &name, qint64 size,
+                                char typeFlag = '0');
+    static QByteArray tarEntryHeader(const BundleEntry &entry);
+    static qint64 tarEntrySize(const BundleEntry &entry);
     QString generateJsonManifest() const;
     QString getMimeType(const QString &filePath) const;
     QString getLocalIP() const;
@@ -257,6 +257,8 @@ enum class iDescriptorTool {
     */
     NetworkDevices,
     iFuse,
+    PerformanceDiagnostics,
+    FleetOperations,
     Unknown
 };
 
@@ -19,21 +19,27 @@
 
 #pragma once
 #include <QDebug>
+#include <QHash>
 #include <QImage>
 #include <QJsonObject>
 #include <QNetworkAccessManager>
 #include <QRegularExpression>
+#include <QVariant>
 #include <QtCore/QObject>
 #include <libimobiledevice/afc.h>
+#include <libimobiledevice/diagnostics_relay.h>
 #include <libimobiledevice/installation_proxy.h>
 #include <libimobiledevice/libimobiledevice.h>
 #include <libimobiledevice/lockdown.h>
 #include <libimobiledevice/mobile_image_mounter.h>
 #include <libimobiledevice/screenshotr.h>
+#include <libimobiledevice/service.h>
 #ifdef ENABLE_RECOVERY_DEVICE_SUPPORT
 #include <libirecovery.h>
 #endif
+#include <functional>
 #include <mutex>
+#include <optional>
 #include <pugixml.hpp>
 #include <string>
 #include <unordered_map>
@@ -327,24 +333,32 @@ iDescriptorInitDeviceResult init_idescriptor_device(const char *udid);
 iDescriptorInitDeviceResultRecovery
 init_idescriptor_recovery_device(uint64_t ecid);
 #endif
-bool set_location(idevice_t device, char *lat, char *lon);
+bool set_location(idevice_t device, double latitude, double longitude);
+
+// Long-lived com.apple.dt.simulatelocation connection, see RoutePlayer
+service_client_t location_session_open(idevice_t device);
+bool location_session_send(service_client_t service, double latitude,
+                           double longitude);
+bool location_session_reset(service_client_t service);
+void location_session_close(service_client_t service);
 
 bool shutdown(idevice_t device);
 
 TakeScreenshotResult take_screenshot(screenshotr_client_t shotr);
 
-mobile_image_mounter_error_t mount_dev_image(idevice_t device,
-                                             unsigned int device_version,
-                                             const char *image_dir_path);
+// progress(sent, total) runs on the calling thread, false aborts the upload
+mobile_image_mounter_error_t mount_dev_image(
+    idevice_t device, unsigned int device_version, const char *image_dir_path,
+    const std::function<bool(uint64_t, uint64_t)> &progress = nullptr);
 struct GetMountedImageResult {
     bool success;
     std::string sig;
     std::string message;
 };
 
-plist_t _get_mounted_image(const char *udid);
+plist_t _get_mounted_image(idevice_t device);
 
-bool restart(std::string udid);
+bool restart(idevice_t device);
 
 enum class ImageCompatibility {
     Compatible,      // Exact match or known compatible version
@@ -402,9 +416,9 @@ bool is_product_type_newer(const std::string &productType,
 bool is_product_type_older(const std::string &productType,
                            const std::string &otherProductType);
 
-bool query_mobile_gestalt(iDescriptorDevice *id_device, const QStringList &keys,
-                          uint32_t &xml_size, char *&xml_data);
-;
+bool query_mobile_gestalt(diagnostics_relay_client_t client,
+                          const QStringList &keys,
+                          QHash<QString, QVariant> &values);
 
 std::string safeGetXML(const char *key, pugi::xml_node dict);
 
@@ -435,7 +449,19 @@ struct NetworkDevice {
     }
 };
 
-QPixmap load_heic(const QByteArray &data);
+QImage load_heic(const QByteArray &data, const QSize &targetSize = QSize());
+
+// Empty on failure, Exif is kept with the orientation reset to upright
+QByteArray transcode_heic_to_jpeg(const QByteArray &data, int quality,
+                                  QString *error = nullptr);
+
+// QuickTime on the device to a fast-start MP4 without re-encoding, read
+// once over AFC. progress(bytesRead, total) returns false to cancel.
+bool remux_mov_to_mp4(iDescriptorDevice *device, const char *devicePath,
+                      const QString &outputPath,
+                      std::optional<afc_client_t> altAfc,
+                      const std::function<bool(qint64, qint64)> &progress,
+                      QString *error = nullptr, qint64 *bytesRead = nullptr);
 
 QByteArray read_afc_file_to_byte_array(afc_client_t afcClient,
                                        const char *path);
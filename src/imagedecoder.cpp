@@ -0,0 +1,115 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "imagedecoder.h"
+#include "iDescriptor.h"
+#include "loggingcategories.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QImageReader>
+#include <QMutexLocker>
+
+QMutex ImageDecoder::m_fullDecodeMutex;
+QWaitCondition ImageDecoder::m_fullDecodeCondition;
+int ImageDecoder::m_activeFullDecodes = 0;
+
+namespace
+{
+// A single 48 MP RGB888 decode is ~150 MB
+constexpr int MaxFullDecodes = 2;
+} // namespace
+
+QImage ImageDecoder::decode(const QByteArray &data, const QString &fileName,
+                            const QSize &targetSize)
+{
+    if (data.isEmpty()) {
+        return QImage();
+    }
+
+    if (fileName.endsWith(".HEIC", Qt::CaseInsensitive) ||
+        fileName.endsWith(".HEIF", Qt::CaseInsensitive)) {
+        return load_heic(data, targetSize);
+    }
+
+    return decodeWithQt(data, targetSize);
+}
+
+QImage ImageDecoder::decodeWithQt(const QByteArray &data,
+                                  const QSize &targetSize)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+    if (!reader.canRead()) {
+        qCDebug(lcGallery) << "ImageDecoder: unsupported image data"
+                           << reader.errorString();
+        return QImage();
+    }
+
+    const QSize sourceSize = reader.size();
+    if (targetSize.isValid() && sourceSize.isValid() &&
+        (sourceSize.width() > targetSize.width() ||
+         sourceSize.height() > targetSize.height())) {
+        // Lets the JPEG decoder use its scaled IDCT instead of decoding at
+        // full size and shrinking afterwards
+        reader.setScaledSize(
+            sourceSize.scaled(targetSize, Qt::KeepAspectRatio));
+        QImage image = reader.read();
+        if (image.isNull()) {
+            qCDebug(lcGallery) << "ImageDecoder: scaled decode failed"
+                               << reader.errorString();
+        }
+        return image;
+    }
+
+    FullDecodeSlot slot;
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qCDebug(lcGallery) << "ImageDecoder: decode failed"
+                           << reader.errorString();
+        return QImage();
+    }
+
+    // The reader couldn't report a size up front, scale after the fact
+    if (targetSize.isValid() && (image.width() > targetSize.width() ||
+                                 image.height() > targetSize.height())) {
+        return image.scaled(targetSize, Qt::KeepAspectRatio,
+                            Qt::SmoothTransformation);
+    }
+    return image;
+}
+
+ImageDecoder::FullDecodeSlot::FullDecodeSlot()
+{
+    QMutexLocker locker(&m_fullDecodeMutex);
+    while (m_activeFullDecodes >= MaxFullDecodes) {
+        m_fullDecodeCondition.wait(&m_fullDecodeMutex);
+    }
+    ++m_activeFullDecodes;
+}
+
+ImageDecoder::FullDecodeSlot::~FullDecodeSlot()
+{
+    QMutexLocker locker(&m_fullDecodeMutex);
+    --m_activeFullDecodes;
+    m_fullDecodeCondition.wakeOne();
+}
@@ -0,0 +1,76 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEDECODER_H
+#define IMAGEDECODER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+#include <QWaitCondition>
+
+/**
+ * @brief Thread-safe image decoding for worker threads
+ *
+ * Everything here produces QImage only, so it can be called from
+ * QtConcurrent workers. Conversion to QPixmap must happen on the GUI thread
+ * once the result is delivered (e.g. in a QFutureWatcher::finished handler).
+ *
+ * Decodes of full-resolution images are gated by a process-wide limit so a
+ * burst of 48 MP photos can't decode all at once and blow up peak memory.
+ */
+class ImageDecoder
+{
+public:
+    /**
+     * @brief Decode image data, downscaled to fit targetSize
+     * @param data Encoded image (HEIC, JPEG, PNG, ...)
+     * @param fileName Used to pick the decoder by extension
+     * @param targetSize Bounding box of the result, invalid for full size
+     * @return Decoded image or a null QImage on failure
+     */
+    static QImage decode(const QByteArray &data, const QString &fileName,
+                         const QSize &targetSize = QSize());
+
+    /**
+     * @brief RAII slot for one full-resolution decode
+     *
+     * Blocks in the constructor until a slot is available.
+     */
+    class FullDecodeSlot
+    {
+    public:
+        FullDecodeSlot();
+        ~FullDecodeSlot();
+        FullDecodeSlot(const FullDecodeSlot &) = delete;
+        FullDecodeSlot &operator=(const FullDecodeSlot &) = delete;
+    };
+
+private:
+    static QImage decodeWithQt(const QByteArray &data,
+                               const QSize &targetSize);
+
+    static QMutex m_fullDecodeMutex;
+    static QWaitCondition m_fullDecodeCondition;
+    static int m_activeFullDecodes;
+};
+
+#endif // IMAGEDECODER_H
@@ -0,0 +1,218 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "imagetilesource.h"
+#include "imagedecoder.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QImageIOHandler>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <libheif/heif.h>
+
+// Tile size used when the image has no native tiling of its own
+static const int DEFAULT_TILE_SIZE = 512;
+
+ImageTileSource::ImageTileSource(const QByteArray &data,
+                                 const QString &fileName)
+    : m_data(data), m_fileName(fileName),
+      m_tileSize(DEFAULT_TILE_SIZE, DEFAULT_TILE_SIZE)
+{
+    if (m_fileName.endsWith(".HEIC", Qt::CaseInsensitive) ||
+        m_fileName.endsWith(".HEIF", Qt::CaseInsensitive)) {
+        initHeic();
+    } else {
+        initQt();
+    }
+}
+
+ImageTileSource::~ImageTileSource()
+{
+    if (m_heifHandle) {
+        heif_image_handle_release(m_heifHandle);
+    }
+    if (m_heifContext) {
+        heif_context_free(m_heifContext);
+    }
+}
+
+void ImageTileSource::initHeic()
+{
+    m_heifContext = heif_context_alloc();
+    if (!m_heifContext) {
+        return;
+    }
+
+    // m_data outlives the context, no need for libheif to copy it
+    heif_error err = heif_context_read_from_memory_without_copy(
+        m_heifContext, m_data.constData(), m_data.size(), nullptr);
+    if (err.code != heif_error_Ok) {
+        qWarning() << "ImageTileSource: failed to read HEIC:" << err.message;
+        return;
+    }
+
+    err = heif_context_get_primary_image_handle(m_heifContext, &m_heifHandle);
+    if (err.code != heif_error_Ok) {
+        qWarning() << "ImageTileSource: no primary image:" << err.message;
+        m_heifHandle = nullptr;
+        return;
+    }
+
+    m_imageSize = QSize(heif_image_handle_get_width(m_heifHandle),
+                        heif_image_handle_get_height(m_heifHandle));
+    m_mode = Mode::Backing;
+
+#if LIBHEIF_HAVE_VERSION(1, 19, 0)
+    heif_image_tiling tiling;
+    err = heif_image_handle_get_image_tiling(m_heifHandle, 1, &tiling);
+    if (err.code == heif_error_Ok && tiling.num_columns * tiling.num_rows > 1) {
+        m_mode = Mode::HeicTiles;
+        m_tileSize = QSize(tiling.tile_width, tiling.tile_height);
+    }
+#endif
+}
+
+void ImageTileSource::initQt()
+{
+    QBuffer buffer;
+    buffer.setData(m_data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+    QSize size = reader.size();
+    if (!size.isValid()) {
+        return;
+    }
+
+    // Clip rects are in stored orientation, so only take that path when no
+    // EXIF transform has to be applied on top
+    const QImageIOHandler::Transformations transformation =
+        reader.transformation();
+    if (transformation.testFlag(QImageIOHandler::TransformationRotate90)) {
+        size.transpose();
+    }
+    m_imageSize = size;
+
+    m_mode = (transformation == QImageIOHandler::TransformationNone &&
+              reader.supportsOption(QImageIOHandler::ClipRect))
+                 ? Mode::ClipRect
+                 : Mode::Backing;
+}
+
+QRect ImageTileSource::tileRect(int column, int row) const
+{
+    return QRect(QPoint(column * m_tileSize.width(), row * m_tileSize.height()),
+                 m_tileSize) &
+           QRect(QPoint(0, 0), m_imageSize);
+}
+
+QImage ImageTileSource::decodeTile(int column, int row)
+{
+    const QRect rect = tileRect(column, row);
+    if (rect.isEmpty()) {
+        return QImage();
+    }
+
+    switch (m_mode) {
+    case Mode::HeicTiles:
+        return decodeHeicTile(column, row);
+    case Mode::ClipRect:
+        return decodeClipRect(rect);
+    case Mode::Backing:
+    default:
+        return decodeFromBacking(rect);
+    }
+}
+
+QImage ImageTileSource::decodeHeicTile(int column, int row)
+{
+#if LIBHEIF_HAVE_VERSION(1, 19, 0)
+    heif_image *img = nullptr;
+    {
+        // libheif doesn't promise a context is safe to decode from
+        // concurrently
+        QMutexLocker locker(&m_mutex);
+        heif_error err = heif_image_handle_decode_image_tile(
+            m_heifHandle, &img, heif_colorspace_RGB,
+            heif_chroma_interleaved_RGB, nullptr, column, row);
+        if (err.code != heif_error_Ok) {
+            qWarning() << "ImageTileSource: tile decode failed:"
+                       << err.message;
+            return QImage();
+        }
+    }
+
+    int stride;
+    const uint8_t *data =
+        heif_image_get_plane_readonly(img, heif_channel_interleaved, &stride);
+    if (!data) {
+        heif_image_release(img);
+        return QImage();
+    }
+
+    QImage tile(
+        data, heif_image_get_width(img, heif_channel_interleaved),
+        heif_image_get_height(img, heif_channel_interleaved), stride,
+        QImage::Format_RGB888,
+        [](void *info) { heif_image_release(static_cast<heif_image *>(info)); },
+        img);
+
+    // Edge tiles are coded at full tile size
+    const QRect rect = tileRect(column, row);
+    if (tile.size() != rect.size()) {
+        return tile.copy(QRect(QPoint(0, 0), rect.size()));
+    }
+    return tile;
+#else
+    Q_UNUSED(column)
+    Q_UNUSED(row)
+    return QImage();
+#endif
+}
+
+QImage ImageTileSource::decodeClipRect(const QRect &rect) const
+{
+    // Each call gets its own reader, QByteArray copies are shared read-only
+    QBuffer buffer;
+    buffer.setData(m_data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer);
+    reader.setClipRect(rect);
+    QImage tile = reader.read();
+    if (tile.isNull()) {
+        qWarning() << "ImageTileSource: clip decode failed:"
+                   << reader.errorString();
+    }
+    return tile;
+}
+
+QImage ImageTileSource::decodeFromBacking(const QRect &rect)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_backing.isNull()) {
+        // Counts against ImageDecoder's full decode limit
+        m_backing = ImageDecoder::decode(m_data, m_fileName);
+        if (m_backing.isNull()) {
+            return QImage();
+        }
+    }
+    return m_backing.copy(rect);
+}
@@ -0,0 +1,78 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGETILESOURCE_H
+#define IMAGETILESOURCE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QSize>
+#include <QString>
+
+struct heif_context;
+struct heif_image_handle;
+
+/**
+ * @brief Decodes full-resolution tiles of an encoded image on demand
+ *
+ * Keeps only the encoded bytes around and decodes the region that is asked
+ * for, so zooming into a 48 MP photo doesn't need the whole image in memory:
+ * - HEIC grid images decode their native tiles (libheif >= 1.19)
+ * - Formats with clip-rect support (e.g. JPEG) decode just the region
+ * - Anything else is decoded once and tiles are cut from that
+ *
+ * decodeTile() may be called from several worker threads at once.
+ */
+class ImageTileSource
+{
+public:
+    ImageTileSource(const QByteArray &data, const QString &fileName);
+    ~ImageTileSource();
+
+    bool isValid() const { return m_imageSize.isValid(); }
+    QSize imageSize() const { return m_imageSize; }
+    QSize tileSize() const { return m_tileSize; }
+
+    QRect tileRect(int column, int row) const;
+    QImage decodeTile(int column, int row);
+
+private:
+    enum class Mode { HeicTiles, ClipRect, Backing };
+
+    void initHeic();
+    void initQt();
+    QImage decodeHeicTile(int column, int row);
+    QImage decodeClipRect(const QRect &rect) const;
+    QImage decodeFromBacking(const QRect &rect);
+
+    QByteArray m_data;
+    QString m_fileName;
+    QSize m_imageSize;
+    QSize m_tileSize;
+    Mode m_mode = Mode::Backing;
+
+    QMutex m_mutex;
+    heif_context *m_heifContext = nullptr;
+    heif_image_handle *m_heifHandle = nullptr;
+    QImage m_backing;
+};
+
+#endif // IMAGETILESOURCE_H
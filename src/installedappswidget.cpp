@@ -22,6 +22,7 @@
 #include "iDescriptor-ui.h"
 #include "iDescriptor.h"
 #include "qprocessindicator.h"
+#include "servicebroker.h"
 #include "zlineedit.h"
 #include <QAction>
 #include <QApplication>
@@ -304,37 +305,13 @@ void InstalledAppsWidget::fetchInstalledApps()
         // result["apps"] = apps;
         // return result;
 
-        instproxy_client_t instproxy = nullptr;
-        lockdownd_client_t lockdownClient = nullptr;
-        lockdownd_service_descriptor_t lockdowndService = nullptr;
+        ServiceLease<instproxy_client_t> instproxy(m_device->device);
+        if (!instproxy) {
+            result["error"] = "Could not connect to installation proxy";
+            return result;
+        }
 
         try {
-            if (lockdownd_client_new_with_handshake(
-                    m_device->device, &lockdownClient, APP_LABEL) !=
-                LOCKDOWN_E_SUCCESS) {
-                result["error"] = "Could not connect to lockdown service";
-                return result;
-            }
-
-            if (lockdownd_start_service(
-                    lockdownClient, "com.apple.mobile.installation_proxy",
-                    &lockdowndService) != LOCKDOWN_E_SUCCESS) {
-                result["error"] = "Could not start installation proxy service";
-                lockdownd_client_free(lockdownClient);
-                return result;
-            }
-
-            if (instproxy_client_new(m_device->device, lockdowndService,
-                                     &instproxy) != INSTPROXY_E_SUCCESS) {
-                result["error"] = "Could not connect to installation proxy";
-                lockdownd_service_descriptor_free(lockdowndService);
-                lockdownd_client_free(lockdownClient);
-                return result;
-            }
-
-            lockdownd_service_descriptor_free(lockdowndService);
-            lockdowndService = nullptr;
-
             // Get both User and System apps
             QStringList appTypes = {"User", "System"};
 
@@ -361,8 +338,8 @@ void InstalledAppsWidget::fetchInstalledApps()
                                     return_attrs);
 
                 plist_t apps_plist = nullptr;
-                if (instproxy_browse(instproxy, client_opts, &apps_plist) ==
-                        INSTPROXY_E_SUCCESS &&
+                if (instproxy_browse(instproxy.get(), client_opts,
+                                     &apps_plist) == INSTPROXY_E_SUCCESS &&
                     apps_plist) {
                     if (plist_get_node_type(apps_plist) == PLIST_ARRAY) {
                         for (uint32_t i = 0;
@@ -444,20 +421,11 @@ void InstalledAppsWidget::fetchInstalledApps()
                 plist_free(client_opts);
             }
 
-            instproxy_client_free(instproxy);
-            lockdownd_client_free(lockdownClient);
-
             result["apps"] = apps;
             result["success"] = true;
 
         } catch (const std::exception &e) {
-            if (instproxy)
-                instproxy_client_free(instproxy);
-            if (lockdownClient)
-                lockdownd_client_free(lockdownClient);
-            if (lockdowndService)
-                lockdownd_service_descriptor_free(lockdowndService);
-
+            instproxy.invalidate();
             result["error"] = QString("Exception: %1").arg(e.what());
         }
 
@@ -644,22 +612,17 @@ void InstalledAppsWidget::loadAppContainer(const QString &bundleId)
         QVariantMap result;
 
         afc_client_t afcClient = nullptr;
-        lockdownd_client_t lockdownClient = nullptr;
         lockdownd_service_descriptor_t lockdowndService = nullptr;
         house_arrest_client_t houseArrestClient = nullptr;
         try {
-            if (lockdownd_client_new_with_handshake(
-                    m_device->device, &lockdownClient, APP_LABEL) !=
-                LOCKDOWN_E_SUCCESS) {
-                result["error"] = "Could not connect to lockdown service";
-                return result;
-            }
-
-            if (lockdownd_start_service(
-                    lockdownClient, "com.apple.mobile.house_arrest",
+            // house_arrest is vended per app, only the lockdown session is
+            // shared
+            if (ServiceBroker::sharedInstance()->startService(
+                    m_device->device, HOUSE_ARREST_SERVICE_NAME,
                     &lockdowndService) != LOCKDOWN_E_SUCCESS) {
                 result["error"] = "Could not start house arrest service";
-                lockdownd_client_free(lockdownClient);
+                if (lockdowndService)
+                    lockdownd_service_descriptor_free(lockdowndService);
                 return result;
             }
 
@@ -668,7 +631,6 @@ void InstalledAppsWidget::loadAppContainer(const QString &bundleId)
                 HOUSE_ARREST_E_SUCCESS) {
                 result["error"] = "Could not connect to house arrest";
                 lockdownd_service_descriptor_free(lockdowndService);
-                lockdownd_client_free(lockdownClient);
                 return result;
             }
 
@@ -683,7 +645,6 @@ void InstalledAppsWidget::loadAppContainer(const QString &bundleId)
                     bundleId.toUtf8().constData()) != HOUSE_ARREST_E_SUCCESS) {
                 result["error"] = "Could not send VendDocuments command";
                 house_arrest_client_free(houseArrestClient);
-                lockdownd_client_free(lockdownClient);
                 return result;
             }
 
@@ -694,7 +655,6 @@ void InstalledAppsWidget::loadAppContainer(const QString &bundleId)
                 !dict) {
                 result["error"] = "App container not available for this app";
                 house_arrest_client_free(houseArrestClient);
-                lockdownd_client_free(lockdownClient);
                 return result;
             }
 
@@ -712,7 +672,6 @@ void InstalledAppsWidget::loadAppContainer(const QString &bundleId)
                 }
                 plist_free(dict);
                 house_arrest_client_free(houseArrestClient);
-                lockdownd_client_free(lockdownClient);
                 return result;
             }
 
@@ -724,7 +683,6 @@ void InstalledAppsWidget::loadAppContainer(const QString &bundleId)
                 result["error"] =
                     "Could not create AFC client for app container";
                 house_arrest_client_free(houseArrestClient);
-                lockdownd_client_free(lockdownClient);
                 return result;
             }
 
@@ -735,7 +693,6 @@ void InstalledAppsWidget::loadAppContainer(const QString &bundleId)
                 result["error"] = "Could not read app container directory";
                 afc_client_free(afcClient);
                 house_arrest_client_free(houseArrestClient);
-                lockdownd_client_free(lockdownClient);
                 return result;
             }
 
@@ -757,15 +714,11 @@ void InstalledAppsWidget::loadAppContainer(const QString &bundleId)
                 reinterpret_cast<void *>(houseArrestClient));
             result["success"] = true;
 
-            lockdownd_client_free(lockdownClient);
-
         } catch (const std::exception &e) {
             if (afcClient)
                 afc_client_free(afcClient);
             if (houseArrestClient)
                 house_arrest_client_free(houseArrestClient);
-            if (lockdownClient)
-                lockdownd_client_free(lockdownClient);
             if (lockdowndService)
                 lockdownd_service_descriptor_free(lockdowndService);
 
@@ -22,6 +22,7 @@
 #include "devdiskimagehelper.h"
 #include "devdiskmanager.h"
 #include "iDescriptor.h"
+#include "servicebroker.h"
 #include <QDebug>
 #include <QLabel>
 #include <QMessageBox>
@@ -55,6 +56,11 @@ LiveScreenWidget::LiveScreenWidget(iDescriptorDevice *device, QWidget *parent)
     connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
             [this, device](const std::string &removed_uuid) {
                 if (device->udid == removed_uuid) {
+                    // The handle is freed right after this signal
+                    if (m_timer) {
+                        m_timer->stop();
+                    }
+                    releaseScreenshotClient(false);
                     this->close();
                     this->deleteLater();
                 }
@@ -122,88 +128,41 @@ LiveScreenWidget::~LiveScreenWidget()
         m_timer->stop();
     }
 
+    releaseScreenshotClient(true);
+}
+
+void LiveScreenWidget::releaseScreenshotClient(bool reusable)
+{
     if (m_shotrClient) {
-        screenshotr_client_free(m_shotrClient);
+        ServiceBroker::sharedInstance()->release(m_device->device,
+                                                 m_shotrClient, reusable);
         m_shotrClient = nullptr;
     }
 }
 
 bool LiveScreenWidget::initializeScreenshotService(bool notify)
 {
-    lockdownd_client_t lockdownClient = nullptr;
-    lockdownd_service_descriptor_t service = nullptr;
-
-    try {
-        m_statusLabel->setText("Connecting to screenshot service...");
-
-        lockdownd_error_t ldret = lockdownd_client_new_with_handshake(
-            m_device->device, &lockdownClient, APP_LABEL);
-
-        if (ldret != LOCKDOWN_E_SUCCESS) {
-            m_statusLabel->setText("Failed to connect to lockdown service");
-            if (notify)
-                QMessageBox::critical(this, "Connection Failed",
-                                      "Could not connect to lockdown service.\n"
-                                      "Error code: " +
-                                          QString::number(ldret));
-            return false;
-        }
-
-        lockdownd_error_t lerr = lockdownd_start_service(
-            lockdownClient, SCREENSHOTR_SERVICE_NAME, &service);
-
-        lockdownd_client_free(lockdownClient);
-        lockdownClient = nullptr;
-
-        if (lerr != LOCKDOWN_E_SUCCESS) {
-            m_statusLabel->setText("Failed to start screenshot service");
-            qDebug() << lerr << "lockdownd_start_service";
-            if (notify)
-                QMessageBox::critical(
-                    this, "Service Failed",
-                    "Could not start screenshot service on device.\n"
-                    "Please ensure the developer disk image is properly "
-                    "mounted.");
-            if (service) {
-                lockdownd_service_descriptor_free(service);
-            }
-            return false;
-        }
+    m_statusLabel->setText("Connecting to screenshot service...");
+    releaseScreenshotClient(true);
 
-        screenshotr_error_t screrr =
-            screenshotr_client_new(m_device->device, service, &m_shotrClient);
-
-        lockdownd_service_descriptor_free(service);
-        service = nullptr;
-        qDebug() << screrr << "screenshotr_client_new";
-        if (screrr != SCREENSHOTR_E_SUCCESS) {
-            m_statusLabel->setText("Failed to create screenshot client");
-            if (notify)
-                QMessageBox::critical(this, "Client Failed",
-                                      "Could not create screenshot client.\n"
-                                      "Error code: " +
-                                          QString::number(screrr));
-            return false;
-        }
-
-        // Successfully initialized, start capturing
-        m_statusLabel->setText("Capturing");
-        startCapturing();
-        return true;
-    } catch (const std::exception &e) {
-        m_statusLabel->setText("Exception occurred");
+    // Reuses an idle screenshotr connection if the device has one
+    m_shotrClient = ServiceBroker::sharedInstance()
+                        ->acquire<screenshotr_client_t>(m_device->device);
+    if (!m_shotrClient) {
+        m_statusLabel->setText("Failed to start screenshot service");
         if (notify)
             QMessageBox::critical(
-                this, "Exception",
-                QString("Exception occurred: %1").arg(e.what()));
-
-        if (lockdownClient) {
-            lockdownd_client_free(lockdownClient);
-        }
-        if (service) {
-            lockdownd_service_descriptor_free(service);
-        }
+                this, "Service Failed",
+                "Could not start screenshot service on device.\n"
+                "Please ensure the developer disk image is properly "
+                "mounted.");
+        return false;
     }
+
+    // Successfully initialized, start capturing
+    m_statusLabel->setText("Capturing");
+    startCapturing();
+    return true;
 }
 
 void LiveScreenWidget::startCapturing()
@@ -39,6 +39,7 @@ private:
     bool initializeScreenshotService(bool notify);
     void updateScreenshot();
     void startCapturing();
+    void releaseScreenshotClient(bool reusable);
 
     iDescriptorDevice *m_device;
     QTimer *m_timer;
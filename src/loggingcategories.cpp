@@ -0,0 +1,29 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "loggingcategories.h"
+
+// Info and above stay visible, debug needs to be enabled explicitly
+Q_LOGGING_CATEGORY(lcAfc, "idescriptor.afc", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcGallery, "idescriptor.gallery", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcExport, "idescriptor.export", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcStream, "idescriptor.stream", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcAirplay, "idescriptor.airplay", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcDeviceInit, "idescriptor.device-init", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcLockdown, "idescriptor.lockdown", QtInfoMsg)
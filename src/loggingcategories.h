@@ -0,0 +1,43 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOGGINGCATEGORIES_H
+#define LOGGINGCATEGORIES_H
+
+#include <QLoggingCategory>
+
+/*
+ * Per-subsystem logging categories. Debug output is off by default and
+ * can be enabled at runtime, e.g.
+ *
+ *   QT_LOGGING_RULES="idescriptor.gallery.debug=true" iDescriptor
+ *
+ * or everything at once with --debug-logging. Release builds define
+ * QT_NO_DEBUG_OUTPUT, which compiles qCDebug() out entirely so hot paths
+ * don't even format their arguments.
+ */
+Q_DECLARE_LOGGING_CATEGORY(lcAfc)
+Q_DECLARE_LOGGING_CATEGORY(lcGallery)
+Q_DECLARE_LOGGING_CATEGORY(lcExport)
+Q_DECLARE_LOGGING_CATEGORY(lcStream)
+Q_DECLARE_LOGGING_CATEGORY(lcAirplay)
+Q_DECLARE_LOGGING_CATEGORY(lcDeviceInit)
+Q_DECLARE_LOGGING_CATEGORY(lcLockdown)
+
+#endif // LOGGINGCATEGORIES_H
@@ -22,6 +22,7 @@
 #include <QApplication>
 #include <QDebug>
 #include <QDir>
+#include <QLoggingCategory>
 #include <QMessageBox>
 #include <QStyleFactory>
 #include <QtGlobal>
@@ -37,6 +38,11 @@ int main(int argc, char *argv[])
     QCoreApplication::setApplicationName("iDescriptor");
     QCoreApplication::setApplicationVersion(APP_VERSION);
 
+    // Same as QT_LOGGING_RULES="idescriptor.*.debug=true"
+    if (a.arguments().contains("--debug-logging")) {
+        QLoggingCategory::setFilterRules("idescriptor.*.debug=true");
+    }
+
     if (a.arguments().contains("--reset-settings")) {
         SettingsManager::sharedInstance()->clear();
         QMessageBox::information(nullptr, "Settings Reset",
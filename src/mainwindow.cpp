@@ -26,6 +26,7 @@
 
 #include "appswidget.h"
 #include "devicemanagerwidget.h"
+#include "exportmanager.h"
 #include "iDescriptor-ui.h"
 #include "iDescriptor.h"
 #include "jailbrokenwidget.h"
@@ -161,6 +162,11 @@ MainWindow::MainWindow(QWidget *parent)
     connect(m_deviceManager, &DeviceManagerWidget::updateNoDevicesConnected,
             this, &MainWindow::updateNoDevicesConnected);
 
+    // Emitted before the device is freed, exports using it have to stop
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved,
+            ExportManager::sharedInstance(),
+            &ExportManager::cancelJobsForDevice, Qt::DirectConnection);
+
     m_ZTabWidget->addTab(m_mainStackedWidget, "iDevice");
     auto *appsWidgetTab =
         m_ZTabWidget->addTab(AppsWidget::sharedInstance(), "Apps");
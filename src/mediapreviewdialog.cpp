@@ -18,8 +18,12 @@
  */
 
 #include "mediapreviewdialog.h"
+#include "imagedecoder.h"
+#include "imagetilesource.h"
 #include "mediastreamermanager.h"
 #include "photomodel.h"
+#include "servicemanager.h"
+#include "tiledimageitem.h"
 #include <QApplication>
 #include <QAudioOutput>
 #include <QCoreApplication>
@@ -54,14 +58,16 @@ MediaPreviewDialog::MediaPreviewDialog(iDescriptorDevice *device,
     : QDialog(parent), m_device(device), m_filePath(filePath),
       m_isVideo(isVideoFile(filePath)), m_mainLayout(nullptr),
       m_controlsLayout(nullptr), m_imageView(nullptr), m_imageScene(nullptr),
-      m_pixmapItem(nullptr), m_videoWidget(nullptr), m_mediaPlayer(nullptr),
+      m_imageItem(nullptr), m_videoWidget(nullptr), m_mediaPlayer(nullptr),
       m_videoControlsLayout(nullptr), m_playPauseBtn(nullptr),
       m_stopBtn(nullptr), m_repeatBtn(nullptr), m_timelineSlider(nullptr),
       m_timeLabel(nullptr), m_volumeSlider(nullptr), m_volumeLabel(nullptr),
       m_progressTimer(nullptr), m_loadingLabel(nullptr), m_statusLabel(nullptr),
       m_zoomInBtn(nullptr), m_zoomOutBtn(nullptr), m_zoomResetBtn(nullptr),
-      m_fitToWindowBtn(nullptr), m_zoomFactor(1.0), m_isRepeatEnabled(true),
-      m_isDraggingTimeline(false), m_videoDuration(0), m_afcClient(afcClient)
+      m_fitToWindowBtn(nullptr), m_prevBtn(nullptr), m_nextBtn(nullptr),
+      m_zoomFactor(1.0), m_fullImageLoaded(false), m_albumIndex(-1),
+      m_isRepeatEnabled(true), m_isDraggingTimeline(false), m_videoDuration(0),
+      m_afcClient(afcClient)
 {
     setWindowTitle(QFileInfo(filePath).fileName() + " - iDescriptor");
 
@@ -74,8 +80,12 @@ MediaPreviewDialog::MediaPreviewDialog(iDescriptorDevice *device,
     const QSize screenSize = QApplication::primaryScreen()->size();
     resize(screenSize);
 
+    // Keep the current photo and its neighbours around for quick browsing
+    m_loadedImages.setMaxCost(4);
+
     setupUI();
-    loadMedia();
+    // Deferred so setAlbum() can hand over a thumbnail before loading starts
+    QTimer::singleShot(0, this, &MediaPreviewDialog::loadMedia);
     connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this, [this](const std::string &udid) {
         if (udid == m_device->udid) {
             close();
@@ -139,12 +149,21 @@ void MediaPreviewDialog::setupImageView()
     m_zoomOutBtn = new QPushButton("Zoom Out", this);
     m_zoomResetBtn = new QPushButton("100%", this);
     m_fitToWindowBtn = new QPushButton("Fit to Window", this);
+    m_prevBtn = new QPushButton("Previous", this);
+    m_nextBtn = new QPushButton("Next", this);
+    m_prevBtn->setToolTip("Previous image (Left)");
+    m_nextBtn->setToolTip("Next image (Right)");
+    // Only shown once setAlbum() gives us something to browse
+    m_prevBtn->setVisible(false);
+    m_nextBtn->setVisible(false);
 
     m_controlsLayout->addWidget(m_zoomInBtn);
     m_controlsLayout->addWidget(m_zoomOutBtn);
     m_controlsLayout->addWidget(m_zoomResetBtn);
     m_controlsLayout->addWidget(m_fitToWindowBtn);
     m_controlsLayout->addStretch();
+    m_controlsLayout->addWidget(m_prevBtn);
+    m_controlsLayout->addWidget(m_nextBtn);
 
     m_mainLayout->addLayout(m_controlsLayout);
 
@@ -157,6 +176,10 @@ void MediaPreviewDialog::setupImageView()
             &MediaPreviewDialog::zoomReset);
     connect(m_fitToWindowBtn, &QPushButton::clicked, this,
             &MediaPreviewDialog::fitToWindow);
+    connect(m_prevBtn, &QPushButton::clicked, this,
+            &MediaPreviewDialog::showPreviousImage);
+    connect(m_nextBtn, &QPushButton::clicked, this,
+            &MediaPreviewDialog::showNextImage);
 }
 
 void MediaPreviewDialog::setupVideoView()
@@ -209,26 +232,167 @@ void MediaPreviewDialog::loadMedia()
     loadImage();
 }
 
+void MediaPreviewDialog::setAlbum(const QStringList &imagePaths,
+                                  PhotoModel *thumbnailSource)
+{
+    m_albumPaths = imagePaths;
+    m_albumIndex = imagePaths.indexOf(m_filePath);
+    m_thumbnailSource = thumbnailSource;
+
+    const bool browsable =
+        !m_isVideo && m_albumIndex >= 0 && m_albumPaths.size() > 1;
+    if (m_prevBtn && m_nextBtn) {
+        m_prevBtn->setVisible(browsable);
+        m_nextBtn->setVisible(browsable);
+    }
+}
+
+// Runs on a worker thread
+MediaPreviewDialog::LoadedImage MediaPreviewDialog::loadPreviewImage(
+    iDescriptorDevice *device, afc_client_t afcClient, const QString &filePath,
+    const QSize &previewSize)
+{
+    LoadedImage loaded;
+    const QByteArray imageData = ServiceManager::safeReadAfcFileToByteArray(
+        device, filePath.toUtf8().constData(), afcClient);
+    if (imageData.isEmpty()) {
+        qDebug() << "Could not read from device:" << filePath;
+        return loaded;
+    }
+
+    loaded.preview = ImageDecoder::decode(imageData, filePath, previewSize);
+
+    // Only the encoded bytes are kept, tiles are decoded when zoomed in
+    auto tileSource = std::make_shared<ImageTileSource>(imageData, filePath);
+    if (tileSource->isValid()) {
+        loaded.tileSource = tileSource;
+    }
+    return loaded;
+}
+
+QSize MediaPreviewDialog::previewSize() const
+{
+    const QScreen *currentScreen = screen();
+    if (!currentScreen) {
+        return QSize(1920, 1080);
+    }
+    return currentScreen->size() * currentScreen->devicePixelRatio();
+}
+
 void MediaPreviewDialog::loadImage()
 {
-    auto future = QtConcurrent::run(
-        [this]() { return PhotoModel::loadImage(m_device, m_filePath); });
-
-    auto *watcher = new QFutureWatcher<QPixmap>(this);
-    connect(watcher, &QFutureWatcher<QPixmap>::finished, this,
-            [this, watcher]() {
-                QPixmap pixmap = watcher->result();
-                if (!pixmap.isNull()) {
-                    m_originalPixmap = pixmap;
-                    onImageLoaded();
-                } else {
-                    onImageLoadFailed();
-                }
+    m_fullImageLoaded = false;
+
+    // Whatever the gallery already decoded goes up right away
+    const QPixmap thumbnail =
+        m_thumbnailSource ? m_thumbnailSource->cachedThumbnail(m_filePath)
+                          : QPixmap();
+    if (!thumbnail.isNull()) {
+        ensureImageItem(thumbnail.size());
+        m_imageItem->setPreview(thumbnail);
+        m_loadingLabel->hide();
+        m_imageView->setVisible(true);
+        fitToWindow();
+    }
+    m_statusLabel->setText(
+        QString("Loading %1...").arg(QFileInfo(m_filePath).fileName()));
+
+    // Then the screen-sized decode, possibly already prefetched
+    if (LoadedImage *loaded = m_loadedImages.object(m_filePath)) {
+        applyLoadedImage(*loaded);
+    } else {
+        requestImage(m_filePath);
+    }
+
+    if (m_albumIndex > 0) {
+        requestImage(m_albumPaths.at(m_albumIndex - 1));
+    }
+    if (m_albumIndex >= 0 && m_albumIndex + 1 < m_albumPaths.size()) {
+        requestImage(m_albumPaths.at(m_albumIndex + 1));
+    }
+}
+
+void MediaPreviewDialog::requestImage(const QString &filePath)
+{
+    if (m_pendingLoads.contains(filePath) ||
+        m_loadedImages.contains(filePath)) {
+        return;
+    }
+    m_pendingLoads.insert(filePath);
+
+    auto *watcher = new QFutureWatcher<LoadedImage>(this);
+    connect(watcher, &QFutureWatcher<LoadedImage>::finished, this,
+            [this, watcher, filePath]() {
+                const LoadedImage loaded = watcher->result();
                 watcher->deleteLater();
+                m_pendingLoads.remove(filePath);
+
+                const bool isCurrent = filePath == m_filePath;
+                if (loaded.preview.isNull()) {
+                    if (isCurrent) {
+                        onImageLoadFailed();
+                    }
+                    return;
+                }
+
+                m_loadedImages.insert(filePath, new LoadedImage(loaded));
+                if (isCurrent && !m_fullImageLoaded) {
+                    applyLoadedImage(loaded);
+                }
             });
-    watcher->setFuture(future);
+
+    watcher->setFuture(QtConcurrent::run(
+        [device = m_device, afcClient = m_afcClient, filePath,
+         size = previewSize()]() {
+            return loadPreviewImage(device, afcClient, filePath, size);
+        }));
+}
+
+void MediaPreviewDialog::ensureImageItem(const QSize &imageSize)
+{
+    if (!m_imageItem) {
+        m_imageItem = new TiledImageItem(imageSize);
+        m_imageScene->addItem(m_imageItem);
+    } else {
+        m_imageItem->setImageSize(imageSize);
+    }
+    m_imageSize = imageSize;
+    m_imageScene->setSceneRect(QRectF(QPointF(0, 0), imageSize));
+}
+
+void MediaPreviewDialog::applyLoadedImage(const LoadedImage &loaded)
+{
+    const QSize fullSize = loaded.tileSource
+                               ? loaded.tileSource->imageSize()
+                               : loaded.preview.size();
+    ensureImageItem(fullSize);
+    m_imageItem->setPreview(QPixmap::fromImage(loaded.preview));
+    m_imageItem->setTileSource(loaded.tileSource);
+    m_fullImageLoaded = true;
+    onImageLoaded();
 }
 
+void MediaPreviewDialog::showImageAt(int index)
+{
+    if (index < 0 || index >= m_albumPaths.size() || index == m_albumIndex) {
+        return;
+    }
+
+    m_albumIndex = index;
+    m_filePath = m_albumPaths.at(index);
+    setWindowTitle(QFileInfo(m_filePath).fileName() + " - iDescriptor");
+
+    if (m_imageItem) {
+        m_imageItem->setTileSource(nullptr);
+        m_imageItem->setPreview(QPixmap());
+    }
+    loadImage();
+}
+
+void MediaPreviewDialog::showPreviousImage() { showImageAt(m_albumIndex - 1); }
+
+void MediaPreviewDialog::showNextImage() { showImageAt(m_albumIndex + 1); }
+
 void MediaPreviewDialog::loadVideo()
 {
     m_videoWidget->setVisible(true);
@@ -254,18 +418,14 @@ void MediaPreviewDialog::onImageLoaded()
     m_loadingLabel->hide();
     m_imageView->setVisible(true);
 
-    // Add pixmap to scene
-    m_pixmapItem = m_imageScene->addPixmap(m_originalPixmap);
-    m_imageScene->setSceneRect(m_originalPixmap.rect());
-
     // Fit to window initially
     fitToWindow();
 
     // Update status
     m_statusLabel->setText(QString("Image: %1 (%2x%3)")
                                .arg(QFileInfo(m_filePath).fileName())
-                               .arg(m_originalPixmap.width())
-                               .arg(m_originalPixmap.height()));
+                               .arg(m_imageSize.width())
+                               .arg(m_imageSize.height()));
 }
 
 void MediaPreviewDialog::onImageLoadFailed()
@@ -314,6 +474,14 @@ void MediaPreviewDialog::keyPressEvent(QKeyEvent *event)
             fitToWindow();
             event->accept();
             return;
+        case Qt::Key_Left:
+            showPreviousImage();
+            event->accept();
+            return;
+        case Qt::Key_Right:
+            showNextImage();
+            event->accept();
+            return;
         }
     }
 
@@ -368,9 +536,9 @@ void MediaPreviewDialog::resizeEvent(QResizeEvent *event)
 
     // Auto-fit when window is resized if we're close to fit-to-window size
     if (!m_isVideo && m_imageView && m_imageView->isVisible() &&
-        !m_originalPixmap.isNull()) {
+        !m_imageSize.isEmpty()) {
         const QSize viewSize = m_imageView->viewport()->size();
-        const QSize pixmapSize = m_originalPixmap.size();
+        const QSize pixmapSize = m_imageSize;
         const double fitScale =
             qMin(static_cast<double>(viewSize.width()) / pixmapSize.width(),
                  static_cast<double>(viewSize.height()) / pixmapSize.height());
@@ -388,7 +556,7 @@ void MediaPreviewDialog::zoomOut() { zoom(1.0 / 1.25); }
 
 void MediaPreviewDialog::zoomReset()
 {
-    if (m_imageView && m_originalPixmap.isNull() == false) {
+    if (m_imageView && !m_imageSize.isEmpty()) {
         m_imageView->resetTransform();
         m_zoomFactor = 1.0;
         updateZoomStatus();
@@ -397,11 +565,11 @@ void MediaPreviewDialog::zoomReset()
 
 void MediaPreviewDialog::fitToWindow()
 {
-    if (!m_imageView || m_originalPixmap.isNull())
+    if (!m_imageView || m_imageSize.isEmpty())
         return;
 
     const QSize viewSize = m_imageView->viewport()->size();
-    const QSize pixmapSize = m_originalPixmap.size();
+    const QSize pixmapSize = m_imageSize;
 
     const double scaleX =
         static_cast<double>(viewSize.width()) / pixmapSize.width();
@@ -438,11 +606,12 @@ void MediaPreviewDialog::zoom(double factor)
 
 void MediaPreviewDialog::updateZoomStatus()
 {
-    if (!m_isVideo && !m_originalPixmap.isNull()) {
+    // Until the real image is in, the scene is only thumbnail sized
+    if (!m_isVideo && m_fullImageLoaded) {
         m_statusLabel->setText(QString("Image: %1 (%2x%3) - Zoom: %4%")
                                    .arg(QFileInfo(m_filePath).fileName())
-                                   .arg(m_originalPixmap.width())
-                                   .arg(m_originalPixmap.height())
+                                   .arg(m_imageSize.width())
+                                   .arg(m_imageSize.height())
                                    .arg(qRound(m_zoomFactor * 100)));
     }
 }
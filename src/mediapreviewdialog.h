@@ -22,6 +22,7 @@
 
 #include "iDescriptor-ui.h"
 #include "iDescriptor.h"
+#include <QCache>
 #include <QCoreApplication>
 #include <QDialog>
 #include <QGraphicsPixmapItem>
@@ -30,19 +31,29 @@
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QMediaPlayer>
+#include <QPointer>
 #include <QPushButton>
+#include <QSet>
 #include <QSlider>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QVideoWidget>
 #include <QtGlobal>
 #include <libimobiledevice/afc.h>
+#include <memory>
+
+class ImageTileSource;
+class PhotoModel;
+class TiledImageItem;
 
 /**
  * @brief A dialog for previewing images and videos from iOS devices
  *
  * Features:
  * - Image viewing with zoom and pan using QGraphicsView
+ * - Progressive image loading: cached thumbnail, then a screen-sized decode,
+ *   then full-resolution tiles on demand while zooming
+ * - Browsing an album with Left/Right, neighbours are prefetched
  * - Video streaming with timeline scrubbing support
  * - Asynchronous loading from device
  * - Proper memory management
@@ -57,6 +68,14 @@ public:
                                 QWidget *parent = nullptr);
     ~MediaPreviewDialog();
 
+    /**
+     * @brief Enable Left/Right browsing through the images of an album
+     * @param imagePaths Image paths of the album in display order
+     * @param thumbnailSource Model whose thumbnail cache is shown instantly
+     * while the real image loads, may be null
+     */
+    void setAlbum(const QStringList &imagePaths, PhotoModel *thumbnailSource);
+
 protected:
     void wheelEvent(QWheelEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
@@ -66,6 +85,8 @@ protected:
 private slots:
     void onImageLoaded();
     void onImageLoadFailed();
+    void showPreviousImage();
+    void showNextImage();
     void zoomIn();
     void zoomOut();
     void zoomReset();
@@ -85,6 +106,16 @@ private slots:
     void onMediaPlayerPositionChanged(qint64 position);
 
 private:
+    struct LoadedImage {
+        QImage preview;
+        std::shared_ptr<ImageTileSource> tileSource;
+    };
+
+    static LoadedImage loadPreviewImage(iDescriptorDevice *device,
+                                        afc_client_t afcClient,
+                                        const QString &filePath,
+                                        const QSize &previewSize);
+
     void setupUI();
     void setupImageView();
     void setupVideoView();
@@ -92,6 +123,11 @@ private:
     void loadMedia();
     void loadImage();
     void loadVideo();
+    void showImageAt(int index);
+    void applyLoadedImage(const LoadedImage &loaded);
+    void requestImage(const QString &filePath);
+    void ensureImageItem(const QSize &imageSize);
+    QSize previewSize() const;
     void zoom(double factor);
     void updateZoomStatus();
     void updateVideoTimeDisplay();
@@ -110,7 +146,7 @@ private:
     // Image viewing components
     QGraphicsView *m_imageView;
     QGraphicsScene *m_imageScene;
-    QGraphicsPixmapItem *m_pixmapItem;
+    TiledImageItem *m_imageItem;
 
     // Video viewing components
     QVideoWidget *m_videoWidget;
@@ -136,10 +172,22 @@ private:
     QPushButton *m_zoomOutBtn;
     QPushButton *m_zoomResetBtn;
     QPushButton *m_fitToWindowBtn;
+    QPushButton *m_prevBtn;
+    QPushButton *m_nextBtn;
 
     // State
     double m_zoomFactor;
-    QPixmap m_originalPixmap;
+    // Full-resolution size of the shown image, the scene is laid out in it
+    QSize m_imageSize;
+    bool m_fullImageLoaded;
+
+    // Album browsing
+    QStringList m_albumPaths;
+    int m_albumIndex;
+    QPointer<PhotoModel> m_thumbnailSource;
+    // Loaded images of the current and neighbouring photos, LRU
+    QCache<QString, LoadedImage> m_loadedImages;
+    QSet<QString> m_pendingLoads;
 
     // Video state
     bool m_isRepeatEnabled;
@@ -21,7 +21,9 @@
 #include <QtGlobal>
 
 #include "iDescriptor.h"
+#include "loggingcategories.h"
 #include "servicemanager.h"
+#include "tracer.h"
 #include <QDebug>
 #include <QFileInfo>
 #include <QHostAddress>
@@ -38,9 +40,11 @@ MediaStreamer::MediaStreamer(iDescriptorDevice *device, afc_client_t afcClient,
 {
     // Listen on localhost with automatic port assignment
     if (!listen(QHostAddress::LocalHost, 0)) {
-        qWarning() << "MediaStreamer failed to start:" << errorString();
+        qCWarning(lcStream) << "MediaStreamer failed to start:"
+                            << errorString();
     } else {
-        qDebug() << "MediaStreamer listening on" << getUrl().toString();
+        qCDebug(lcStream) << "MediaStreamer listening on"
+                          << getUrl().toString();
     }
 }
 
@@ -75,7 +79,7 @@ void MediaStreamer::incomingConnection(qintptr socketDescriptor)
 {
     auto *socket = new QTcpSocket(this);
     if (!socket->setSocketDescriptor(socketDescriptor)) {
-        qWarning() << "Failed to set socket descriptor";
+        qCWarning(lcStream) << "Failed to set socket descriptor";
         socket->deleteLater();
         return;
     }
@@ -98,12 +102,13 @@ void MediaStreamer::incomingConnection(qintptr socketDescriptor)
             QOverload<QAbstractSocket::SocketError>::of(
                 &QAbstractSocket::errorOccurred),
             this, [this, socket](QAbstractSocket::SocketError error) {
-                qWarning() << "Socket error:" << error << socket->errorString();
+                qCWarning(lcStream) << "Socket error:" << error
+                                    << socket->errorString();
                 socket->deleteLater();
             });
 
-    qDebug() << "MediaStreamer: Client connected from"
-             << socket->peerAddress().toString();
+    qCDebug(lcStream) << "MediaStreamer: Client connected from"
+                      << socket->peerAddress().toString();
 }
 
 void MediaStreamer::handleClientDisconnected()
@@ -117,7 +122,7 @@ void MediaStreamer::handleClientDisconnected()
         m_activeConnections.removeAll(socket);
     }
 
-    qDebug() << "MediaStreamer: Client disconnected";
+    qCDebug(lcStream) << "MediaStreamer: Client disconnected";
     socket->deleteLater();
 }
 
@@ -276,7 +281,7 @@ void MediaStreamer::streamFileRange(QTcpSocket *socket, qint64 startByte,
     context->bytesRemaining = endByte - startByte + 1;
     context->afcHandle = 0;
 
-    qDebug() << "m_filepath" << m_filePath;
+    qCDebug(lcStream) << "m_filepath" << m_filePath;
     // Open file on device using ServiceManager
     const QByteArray pathBytes = m_filePath.toUtf8();
     afc_error_t openResult = ServiceManager::safeAfcFileOpen(
@@ -284,7 +289,7 @@ void MediaStreamer::streamFileRange(QTcpSocket *socket, qint64 startByte,
         m_afcClient);
 
     if (openResult != AFC_E_SUCCESS || context->afcHandle == 0) {
-        qWarning() << "Failed to open file on device:" << m_filePath;
+        qCWarning(lcStream) << "Failed to open file on device:" << m_filePath;
         delete context;
         socket->disconnectFromHost();
         return;
@@ -295,7 +300,7 @@ void MediaStreamer::streamFileRange(QTcpSocket *socket, qint64 startByte,
         afc_error_t seekResult = ServiceManager::safeAfcFileSeek(
             m_device, context->afcHandle, startByte, SEEK_SET, m_afcClient);
         if (seekResult != AFC_E_SUCCESS) {
-            qWarning() << "Failed to seek in file:" << m_filePath;
+            qCWarning(lcStream) << "Failed to seek in file:" << m_filePath;
             ServiceManager::safeAfcFileClose(m_device, context->afcHandle,
                                              m_afcClient);
             delete context;
@@ -304,8 +309,9 @@ void MediaStreamer::streamFileRange(QTcpSocket *socket, qint64 startByte,
         }
     }
 
-    qDebug() << "Starting non-blocking stream for range" << startByte << "-"
-             << endByte << "(" << context->bytesRemaining << "bytes)";
+    qCDebug(lcStream) << "Starting non-blocking stream for range" << startByte
+                      << "-" << endByte << "(" << context->bytesRemaining
+                      << "bytes)";
 
     // Store context as socket property for cleanup
     socket->setProperty("streamingContext",
@@ -357,7 +363,7 @@ qint64 MediaStreamer::getFileSize()
         m_device, pathBytes.constData(), &info, m_afcClient);
 
     if (result != AFC_E_SUCCESS || !info) {
-        qWarning() << "Failed to get file info for:" << m_filePath;
+        qCWarning(lcStream) << "Failed to get file info for:" << m_filePath;
         return -1;
     }
 
@@ -411,8 +417,8 @@ void MediaStreamer::streamNextChunk(StreamingContext *context)
     }
 
     if (context->bytesRemaining <= 0) {
-        qDebug() << "Streaming completed for"
-                 << QFileInfo(context->filePath).fileName();
+        qCDebug(lcStream) << "Streaming completed for"
+                          << QFileInfo(context->filePath).fileName();
         cleanupStreamingContext(context);
         return;
     }
@@ -427,6 +433,14 @@ void MediaStreamer::streamNextChunk(StreamingContext *context)
     const uint32_t bytesToRead = static_cast<uint32_t>(
         qMin(static_cast<qint64>(CHUNK_SIZE), context->bytesRemaining));
 
+    TraceSpan span("stream", "chunk", m_device);
+    if (span.isActive()) {
+        span.setDetail(QString("%1 bytes at %2")
+                           .arg(bytesToRead)
+                           .arg(context->endByte + 1 -
+                                context->bytesRemaining));
+    }
+
     auto buffer = std::make_unique<char[]>(bytesToRead);
     uint32_t bytesRead = 0;
 
@@ -435,14 +449,14 @@ void MediaStreamer::streamNextChunk(StreamingContext *context)
         m_afcClient);
 
     if (readResult != AFC_E_SUCCESS || bytesRead == 0) {
-        qWarning() << "AFC read error or EOF during streaming";
+        qCWarning(lcStream) << "AFC read error or EOF during streaming";
         cleanupStreamingContext(context);
         return;
     }
 
     const qint64 bytesWritten = context->socket->write(buffer.get(), bytesRead);
     if (bytesWritten == -1) {
-        qWarning() << "Socket write error";
+        qCWarning(lcStream) << "Socket write error";
         cleanupStreamingContext(context);
         return;
     }
@@ -451,8 +465,8 @@ void MediaStreamer::streamNextChunk(StreamingContext *context)
 
     // If we're done, clean up
     if (context->bytesRemaining <= 0) {
-        qDebug() << "Streaming completed for"
-                 << QFileInfo(context->filePath).fileName();
+        qCDebug(lcStream) << "Streaming completed for"
+                          << QFileInfo(context->filePath).fileName();
         cleanupStreamingContext(context);
         return;
     }
@@ -503,7 +517,7 @@ void MediaStreamer::cleanupStreamingContext(StreamingContext *context)
         context->socket = nullptr; // Prevent further access
     }
 
-    qDebug() << "Streaming context cleaned up for"
-             << QFileInfo(context->filePath).fileName();
+    qCDebug(lcStream) << "Streaming context cleaned up for"
+                      << QFileInfo(context->filePath).fileName();
     delete context;
 }
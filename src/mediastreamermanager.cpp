@@ -18,6 +18,7 @@
  */
 
 #include "mediastreamermanager.h"
+#include "loggingcategories.h"
 #include "mediastreamer.h"
 #include <QDebug>
 #include <QMutexLocker>
@@ -42,13 +43,15 @@ QUrl MediaStreamerManager::getStreamUrl(iDescriptorDevice *device,
         // Verify the streamer is still valid and listening
         if (it->streamer && it->streamer->isListening()) {
             it->refCount++;
-            qDebug() << "MediaStreamerManager: Reusing existing streamer for"
-                     << filePath << "refCount:" << it->refCount;
+            qCDebug(lcStream)
+                << "MediaStreamerManager: Reusing existing streamer for"
+                << filePath << "refCount:" << it->refCount;
             return it->streamer->getUrl();
         } else {
             // Clean up invalid streamer
-            qDebug() << "MediaStreamerManager: Cleaning up invalid streamer for"
-                     << filePath;
+            qCDebug(lcStream)
+                << "MediaStreamerManager: Cleaning up invalid streamer for"
+                << filePath;
             if (it->streamer) {
                 it->streamer->deleteLater();
             }
@@ -59,8 +62,9 @@ QUrl MediaStreamerManager::getStreamUrl(iDescriptorDevice *device,
     // Create new streamer without a QObject parent
     auto *streamer = new MediaStreamer(device, afcClient, filePath, nullptr);
     if (!streamer->isListening()) {
-        qWarning() << "MediaStreamerManager: Failed to create streamer for"
-                   << filePath;
+        qCWarning(lcStream)
+            << "MediaStreamerManager: Failed to create streamer for"
+            << filePath;
         delete streamer;
         return QUrl();
     }
@@ -72,8 +76,8 @@ QUrl MediaStreamerManager::getStreamUrl(iDescriptorDevice *device,
     info.refCount = 1;
     m_streamers[filePath] = info;
 
-    qDebug() << "MediaStreamerManager: Created new streamer for" << filePath
-             << "at" << streamer->getUrl().toString();
+    qCDebug(lcStream) << "MediaStreamerManager: Created new streamer for"
+                      << filePath << "at" << streamer->getUrl().toString();
 
     return streamer->getUrl();
 }
@@ -84,14 +88,14 @@ void MediaStreamerManager::releaseStreamer(const QString &filePath)
     auto it = m_streamers.find(filePath);
     if (it != m_streamers.end()) {
         it->refCount--;
-        qDebug() << "MediaStreamerManager: Released streamer for" << filePath
-                 << "refCount:" << it->refCount;
+        qCDebug(lcStream) << "MediaStreamerManager: Released streamer for"
+                          << filePath << "refCount:" << it->refCount;
 
         // If no more references, delete it immediately.
         // deleteLater() will not work in a thread without an event loop.
         if (it->refCount <= 0) {
-            qDebug() << "MediaStreamerManager: Deleting streamer for"
-                     << filePath;
+            qCDebug(lcStream) << "MediaStreamerManager: Deleting streamer for"
+                              << filePath;
             delete it->streamer;
             m_streamers.erase(it);
         }
@@ -103,8 +107,8 @@ void MediaStreamerManager::cleanup()
     QMutexLocker locker(&m_streamersMutex);
     auto it = m_streamers.begin();
     while (it != m_streamers.end()) {
-        qDebug() << "MediaStreamerManager: Cleaning up streamer for"
-                 << it.key();
+        qCDebug(lcStream) << "MediaStreamerManager: Cleaning up streamer for"
+                          << it.key();
         if (it->streamer) {
             delete it->streamer;
         }
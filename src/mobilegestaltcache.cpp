@@ -0,0 +1,142 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mobilegestaltcache.h"
+#include "appcontext.h"
+#include "servicebroker.h"
+#include <QDebug>
+#include <QMutexLocker>
+
+MobileGestaltCache *MobileGestaltCache::sharedInstance()
+{
+    static MobileGestaltCache instance;
+    return &instance;
+}
+
+MobileGestaltCache::MobileGestaltCache(QObject *parent) : QObject(parent)
+{
+    // Emitted before the device is freed, answers are kept for reconnects
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            &MobileGestaltCache::onDeviceRemoved);
+}
+
+MobileGestaltCache::~MobileGestaltCache()
+{
+    for (diagnostics_relay_client_t client : m_sessions) {
+        diagnostics_relay_client_free(client);
+    }
+}
+
+QMap<QString, QVariant>
+MobileGestaltCache::query(iDescriptorDevice *device, const QStringList &keys,
+                          bool *ok)
+{
+    if (ok)
+        *ok = true;
+    if (!device) {
+        if (ok)
+            *ok = false;
+        return {};
+    }
+
+    QMutexLocker locker(&m_mutex);
+    const QString cacheKey = QString::fromStdString(device->udid) + '/' +
+                             QString::fromStdString(
+                                 device->deviceInfo.buildVersion);
+    Answers &answers = m_answers[cacheKey];
+
+    QStringList missing;
+    for (const QString &key : keys) {
+        if (!answers.values.contains(key) && !answers.unknown.contains(key)) {
+            missing.append(key);
+        }
+    }
+
+    if (!missing.isEmpty()) {
+        bool success = query_mobile_gestalt(session(device), missing,
+                                            answers.values);
+        if (!success) {
+            // The session may have gone stale, retry once on a fresh one
+            closeSession(device->udid);
+            success = query_mobile_gestalt(session(device), missing,
+                                           answers.values);
+        }
+
+        if (success) {
+            for (const QString &key : missing) {
+                if (!answers.values.contains(key)) {
+                    answers.unknown.insert(key);
+                }
+            }
+        } else {
+            qDebug() << "MobileGestalt query failed.";
+            if (ok)
+                *ok = false;
+        }
+    }
+
+    QMap<QString, QVariant> results;
+    for (const QString &key : keys) {
+        auto it = answers.values.constFind(key);
+        if (it != answers.values.constEnd()) {
+            results.insert(key, it.value());
+        }
+    }
+    return results;
+}
+
+// Callers hold m_mutex
+diagnostics_relay_client_t
+MobileGestaltCache::session(iDescriptorDevice *device)
+{
+    const QString udid = QString::fromStdString(device->udid);
+    auto it = m_sessions.constFind(udid);
+    if (it != m_sessions.constEnd()) {
+        return it.value();
+    }
+
+    // Held until the device goes away, so it's freed here rather than
+    // going back to the broker
+    diagnostics_relay_client_t client =
+        ServiceBroker::sharedInstance()->acquire<diagnostics_relay_client_t>(
+            device->device);
+    if (!client) {
+        qDebug() << "Failed to start diagnostics service";
+        return nullptr;
+    }
+    m_sessions.insert(udid, client);
+    return client;
+}
+
+void MobileGestaltCache::onDeviceRemoved(const std::string &udid)
+{
+    QMutexLocker locker(&m_mutex);
+    closeSession(udid);
+}
+
+// Callers hold m_mutex
+void MobileGestaltCache::closeSession(const std::string &udid)
+{
+    diagnostics_relay_client_t client =
+        m_sessions.take(QString::fromStdString(udid));
+    if (client) {
+        diagnostics_relay_goodbye(client);
+        diagnostics_relay_client_free(client);
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOBILEGESTALTCACHE_H
+#define MOBILEGESTALTCACHE_H
+
+#include "iDescriptor.h"
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QVariant>
+
+/**
+ * @brief Per-device MobileGestalt answers, cached per iOS build
+ *
+ * Gestalt values only change with the OS, so answers are kept per
+ * (UDID, build version) for the lifetime of the app and only keys that
+ * were never asked before reach the device. Keys the device doesn't know
+ * are remembered as well so they aren't re-queried either. Each device
+ * keeps one diagnostics_relay session open until it disconnects.
+ */
+class MobileGestaltCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MobileGestaltCache *sharedInstance();
+
+    /**
+     * @brief Values for every requested key the device knows about
+     * @param ok Set to false if the device could not be queried
+     */
+    QMap<QString, QVariant> query(iDescriptorDevice *device,
+                                  const QStringList &keys,
+                                  bool *ok = nullptr);
+
+private:
+    explicit MobileGestaltCache(QObject *parent = nullptr);
+    ~MobileGestaltCache();
+
+    struct Answers {
+        QHash<QString, QVariant> values;
+        QSet<QString> unknown;
+    };
+
+    void onDeviceRemoved(const std::string &udid);
+    diagnostics_relay_client_t session(iDescriptorDevice *device);
+    void closeSession(const std::string &udid);
+
+    QMutex m_mutex;
+    // Keyed by UDID + build version
+    QHash<QString, Answers> m_answers;
+    QHash<QString, diagnostics_relay_client_t> m_sessions;
+};
+
+#endif // MOBILEGESTALTCACHE_H
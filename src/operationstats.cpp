@@ -0,0 +1,389 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "operationstats.h"
+#include "iDescriptor.h"
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QStringList>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <string>
+#include <vector>
+
+std::atomic<bool> OperationStats::s_enabled{false};
+
+namespace
+{
+
+constexpr int SUB_BUCKET_BITS = 4;
+constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+// Values are nanoseconds, anything past ~2^45 ns (~10 h) is clamped
+constexpr int MAX_SHIFT = 40;
+constexpr int BUCKETS = SUB_BUCKETS * (MAX_SHIFT + 2);
+
+int bucketIndex(quint64 value)
+{
+    if (value < SUB_BUCKETS) {
+        return static_cast<int>(value);
+    }
+    const int shift = 63 - std::countl_zero(value) - SUB_BUCKET_BITS;
+    const int top = static_cast<int>(value >> shift);
+    return std::min(SUB_BUCKETS + shift * SUB_BUCKETS + top - SUB_BUCKETS,
+                    BUCKETS - 1);
+}
+
+// Midpoint of the values that land in a bucket
+double bucketValue(int index)
+{
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const int shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    const quint64 top = SUB_BUCKETS + (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return (top << shift) + ((1ull << shift) - 1) / 2.0;
+}
+
+/*
+ * Only the owning thread writes, so plain load+store is enough and no
+ * read-modify-write is needed. Readers may see a sample half recorded,
+ * which is fine for statistics.
+ */
+struct Histogram {
+    std::atomic<quint64> counts[BUCKETS] = {};
+    std::atomic<quint64> sum{0};
+    std::atomic<quint64> max{0};
+
+    void record(quint64 value)
+    {
+        auto &bucket = counts[bucketIndex(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+        if (value > max.load(std::memory_order_relaxed)) {
+            max.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void clear()
+    {
+        for (auto &bucket : counts) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        sum.store(0, std::memory_order_relaxed);
+        max.store(0, std::memory_order_relaxed);
+    }
+};
+
+struct Entry {
+    int deviceId;
+    DeviceOperation operation;
+    Histogram lockWait;
+    Histogram operationTime;
+    std::atomic<quint64> bytes{0};
+    Entry *next = nullptr;
+};
+
+// Histograms of one thread, handed to a new thread once its owner exits
+struct ThreadBlock {
+    std::atomic<Entry *> entries{nullptr};
+    std::atomic<bool> inUse{true};
+    ThreadBlock *next = nullptr;
+
+    // Owner thread only, entries are published with a release store
+    Entry *entry(int deviceId, DeviceOperation operation)
+    {
+        Entry *head = entries.load(std::memory_order_relaxed);
+        for (Entry *e = head; e; e = e->next) {
+            if (e->deviceId == deviceId && e->operation == operation) {
+                return e;
+            }
+        }
+        auto *created = new Entry;
+        created->deviceId = deviceId;
+        created->operation = operation;
+        created->next = head;
+        entries.store(created, std::memory_order_release);
+        return created;
+    }
+};
+
+std::atomic<ThreadBlock *> threadBlocks{nullptr};
+
+ThreadBlock *acquireThreadBlock()
+{
+    for (ThreadBlock *block = threadBlocks.load(std::memory_order_acquire);
+         block; block = block->next) {
+        bool expected = false;
+        if (block->inUse.compare_exchange_strong(expected, true)) {
+            return block;
+        }
+    }
+
+    auto *block = new ThreadBlock;
+    block->next = threadBlocks.load(std::memory_order_relaxed);
+    while (!threadBlocks.compare_exchange_weak(block->next, block,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+    }
+    return block;
+}
+
+struct ThreadState {
+    ThreadBlock *block = nullptr;
+    // Last device seen, devices are looked up on nearly every call
+    const iDescriptorDevice *device = nullptr;
+    std::string udid;
+    int deviceId = -1;
+
+    ~ThreadState()
+    {
+        if (block) {
+            block->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadState threadState;
+
+// Device ids are never recycled, udids map to the same id after reconnects
+QMutex deviceIdsMutex;
+QHash<QString, int> deviceIds;
+QStringList deviceUdids;
+
+int deviceIdFor(const iDescriptorDevice *device)
+{
+    ThreadState &state = threadState;
+    if (state.device == device && state.udid == device->udid) {
+        return state.deviceId;
+    }
+
+    const QString udid = QString::fromStdString(device->udid);
+    int id;
+    {
+        QMutexLocker locker(&deviceIdsMutex);
+        id = deviceIds.value(udid, -1);
+        if (id < 0) {
+            id = deviceUdids.size();
+            deviceIds.insert(udid, id);
+            deviceUdids.append(udid);
+        }
+    }
+
+    state.device = device;
+    state.udid = device->udid;
+    state.deviceId = id;
+    return id;
+}
+
+struct MergedEntry {
+    std::vector<quint64> lockWait = std::vector<quint64>(BUCKETS);
+    std::vector<quint64> operationTime = std::vector<quint64>(BUCKETS);
+    quint64 lockWaitSum = 0;
+    quint64 operationSum = 0;
+    quint64 lockWaitMax = 0;
+    quint64 operationMax = 0;
+    quint64 bytes = 0;
+};
+
+void mergeHistogram(const Histogram &histogram, std::vector<quint64> &counts,
+                    quint64 &sum, quint64 &max)
+{
+    for (int i = 0; i < BUCKETS; ++i) {
+        counts[i] += histogram.counts[i].load(std::memory_order_relaxed);
+    }
+    sum += histogram.sum.load(std::memory_order_relaxed);
+    max = std::max(max, histogram.max.load(std::memory_order_relaxed));
+}
+
+OperationStats::Distribution distribution(const std::vector<quint64> &counts,
+                                          quint64 sum, quint64 max)
+{
+    OperationStats::Distribution result;
+    for (quint64 count : counts) {
+        result.count += count;
+    }
+    if (result.count == 0) {
+        return result;
+    }
+
+    auto percentile = [&counts, &result](double fraction) {
+        const quint64 rank =
+            std::max<quint64>(1, std::ceil(fraction * result.count));
+        quint64 seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return bucketValue(i) / 1000.0;
+            }
+        }
+        return bucketValue(BUCKETS - 1) / 1000.0;
+    };
+
+    result.meanUs = sum / 1000.0 / result.count;
+    result.p50Us = percentile(0.50);
+    result.p90Us = percentile(0.90);
+    result.p99Us = percentile(0.99);
+    result.maxUs = max / 1000.0;
+    return result;
+}
+
+QJsonObject distributionJson(const OperationStats::Distribution &d)
+{
+    return {{"count", qint64(d.count)}, {"mean_us", d.meanUs},
+            {"p50_us", d.p50Us},        {"p90_us", d.p90Us},
+            {"p99_us", d.p99Us},        {"max_us", d.maxUs}};
+}
+
+} // namespace
+
+void OperationStats::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+int OperationStats::deviceId(const iDescriptorDevice *device)
+{
+    return device ? deviceIdFor(device) : -1;
+}
+
+void OperationStats::record(int deviceId, DeviceOperation operation,
+                            qint64 lockWaitNs, qint64 operationNs,
+                            quint64 bytes)
+{
+    if (deviceId < 0) {
+        return;
+    }
+
+    ThreadState &state = threadState;
+    if (!state.block) {
+        state.block = acquireThreadBlock();
+    }
+
+    Entry *entry = state.block->entry(deviceId, operation);
+    entry->lockWait.record(std::max<qint64>(lockWaitNs, 0));
+    entry->operationTime.record(std::max<qint64>(operationNs, 0));
+    if (bytes > 0) {
+        entry->bytes.store(entry->bytes.load(std::memory_order_relaxed) +
+                               bytes,
+                           std::memory_order_relaxed);
+    }
+}
+
+QList<OperationStats::Summary> OperationStats::summaries()
+{
+    // Keyed by (device id, operation), which also gives the sort order
+    QMap<QPair<int, int>, MergedEntry> merged;
+    for (ThreadBlock *block = threadBlocks.load(std::memory_order_acquire);
+         block; block = block->next) {
+        for (Entry *e = block->entries.load(std::memory_order_acquire); e;
+             e = e->next) {
+            MergedEntry &target =
+                merged[{e->deviceId, static_cast<int>(e->operation)}];
+            mergeHistogram(e->lockWait, target.lockWait, target.lockWaitSum,
+                           target.lockWaitMax);
+            mergeHistogram(e->operationTime, target.operationTime,
+                           target.operationSum, target.operationMax);
+            target.bytes += e->bytes.load(std::memory_order_relaxed);
+        }
+    }
+
+    QStringList udids;
+    {
+        QMutexLocker locker(&deviceIdsMutex);
+        udids = deviceUdids;
+    }
+
+    QList<Summary> result;
+    for (auto it = merged.cbegin(); it != merged.cend(); ++it) {
+        Summary summary;
+        summary.udid = udids.value(it.key().first);
+        summary.operation = static_cast<DeviceOperation>(it.key().second);
+        summary.bytes = it->bytes;
+        summary.lockWait =
+            distribution(it->lockWait, it->lockWaitSum, it->lockWaitMax);
+        summary.operationTime = distribution(
+            it->operationTime, it->operationSum, it->operationMax);
+        if (summary.operationTime.count > 0) {
+            result.append(summary);
+        }
+    }
+    return result;
+}
+
+QJsonObject OperationStats::snapshot()
+{
+    QJsonObject devices;
+    for (const Summary &summary : summaries()) {
+        QJsonObject device = devices.value(summary.udid).toObject();
+        device[operationName(summary.operation)] = QJsonObject{
+            {"bytes", qint64(summary.bytes)},
+            {"lock_wait", distributionJson(summary.lockWait)},
+            {"operation", distributionJson(summary.operationTime)}};
+        devices[summary.udid] = device;
+    }
+    return {{"enabled", isEnabled()}, {"devices", devices}};
+}
+
+void OperationStats::reset()
+{
+    for (ThreadBlock *block = threadBlocks.load(std::memory_order_acquire);
+         block; block = block->next) {
+        for (Entry *e = block->entries.load(std::memory_order_acquire); e;
+             e = e->next) {
+            e->lockWait.clear();
+            e->operationTime.clear();
+            e->bytes.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+const char *OperationStats::operationName(DeviceOperation operation)
+{
+    switch (operation) {
+    case DeviceOperation::ReadDirectory:
+        return "readdir";
+    case DeviceOperation::GetFileInfo:
+        return "stat";
+    case DeviceOperation::Open:
+        return "open";
+    case DeviceOperation::Read:
+        return "read";
+    case DeviceOperation::Write:
+        return "write";
+    case DeviceOperation::Seek:
+        return "seek";
+    case DeviceOperation::Tell:
+        return "tell";
+    case DeviceOperation::Close:
+        return "close";
+    case DeviceOperation::ReadFile:
+        return "read_file";
+    case DeviceOperation::FileTree:
+        return "file_tree";
+    case DeviceOperation::Other:
+    case DeviceOperation::Count:
+        break;
+    }
+    return "other";
+}
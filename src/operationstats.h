@@ -0,0 +1,147 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPERATIONSTATS_H
+#define OPERATIONSTATS_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <atomic>
+
+struct iDescriptorDevice;
+
+enum class DeviceOperation {
+    ReadDirectory,
+    GetFileInfo,
+    Open,
+    Read,
+    Write,
+    Seek,
+    Tell,
+    Close,
+    ReadFile,
+    FileTree,
+    Other,
+    Count
+};
+
+/**
+ * @brief Lock-wait vs. operation-time histograms for device operations
+ *
+ * ServiceManager records, per device and operation type, how long a call
+ * waited for the device mutex, how long the libimobiledevice call itself
+ * took and how many bytes it moved. Samples go into log-linear histograms
+ * (16 sub-buckets per power of two, ~6% resolution) owned by the recording
+ * thread, so recording never takes a lock. Readers merge all threads.
+ *
+ * Disabled by default, a disabled Scope costs a single relaxed load.
+ */
+class OperationStats
+{
+public:
+    struct Distribution {
+        quint64 count = 0;
+        double meanUs = 0;
+        double p50Us = 0;
+        double p90Us = 0;
+        double p99Us = 0;
+        double maxUs = 0;
+    };
+
+    struct Summary {
+        QString udid;
+        DeviceOperation operation;
+        quint64 bytes = 0;
+        Distribution lockWait;
+        Distribution operationTime;
+    };
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    // Stable id for the device's udid, -1 for null. Dereferences device.
+    static int deviceId(const iDescriptorDevice *device);
+    static void record(int deviceId, DeviceOperation operation,
+                       qint64 lockWaitNs, qint64 operationNs, quint64 bytes);
+
+    // Merged view over all threads, sorted by device and operation
+    static QList<Summary> summaries();
+    static QJsonObject snapshot();
+    static void reset();
+
+    static const char *operationName(DeviceOperation operation);
+
+    /**
+     * @brief Times one ServiceManager call, records on destruction
+     *
+     * Create it before taking the device mutex and call lockAcquired()
+     * right after. Calls that never got the lock are not recorded. The
+     * device is only touched in lockAcquired(), the destructor may run
+     * after the mutex is released and the device is gone.
+     */
+    class Scope
+    {
+    public:
+        Scope(const iDescriptorDevice *device, DeviceOperation operation)
+            : m_device(device), m_operation(operation),
+              m_active(isEnabled())
+        {
+            if (m_active) {
+                m_timer.start();
+            }
+        }
+        ~Scope()
+        {
+            if (m_active && m_lockWaitNs >= 0) {
+                record(m_deviceId, m_operation, m_lockWaitNs,
+                       m_timer.nsecsElapsed() - m_lockWaitNs, m_bytes);
+            }
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        void lockAcquired()
+        {
+            if (m_active) {
+                m_lockWaitNs = m_timer.nsecsElapsed();
+                m_deviceId = deviceId(m_device);
+            }
+        }
+        void addBytes(quint64 bytes) { m_bytes += bytes; }
+
+    private:
+        const iDescriptorDevice *m_device;
+        DeviceOperation m_operation;
+        bool m_active;
+        QElapsedTimer m_timer;
+        int m_deviceId = -1;
+        qint64 m_lockWaitNs = -1;
+        quint64 m_bytes = 0;
+    };
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+#endif // OPERATIONSTATS_H
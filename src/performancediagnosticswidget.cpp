@@ -0,0 +1,282 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "performancediagnosticswidget.h"
+#include "operationstats.h"
+#include "servicebroker.h"
+#include "tracer.h"
+#include <QApplication>
+#include <QClipboard>
+#include <QDateTime>
+#include <QFile>
+#include <QFileDialog>
+#include <QGroupBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QJsonDocument>
+#include <QLocale>
+#include <QMessageBox>
+#include <QSet>
+#include <QVBoxLayout>
+
+namespace
+{
+enum Column {
+    OperationColumn,
+    CountColumn,
+    BytesColumn,
+    WaitP50Column,
+    WaitP99Column,
+    CallP50Column,
+    CallP99Column,
+    ColumnCount
+};
+
+QString formatMicroseconds(double us)
+{
+    if (us >= 1000.0) {
+        return QString("%1 ms").arg(us / 1000.0, 0, 'f', 2);
+    }
+    return QString("%1 µs").arg(us, 0, 'f', 1);
+}
+} // namespace
+
+PerformanceDiagnosticsWidget::PerformanceDiagnosticsWidget(QWidget *parent)
+    : QWidget(parent), m_refreshTimer(new QTimer(this))
+{
+    setupUI();
+
+    m_refreshTimer->setInterval(1000);
+    connect(m_refreshTimer, &QTimer::timeout, this,
+            &PerformanceDiagnosticsWidget::refresh);
+    m_refreshTimer->start();
+    refresh();
+}
+
+void PerformanceDiagnosticsWidget::setupUI()
+{
+    setWindowTitle("Performance Diagnostics - iDescriptor");
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(20, 20, 20, 20);
+    mainLayout->setSpacing(12);
+
+    m_recordCheckBox = new QCheckBox("Record device operation timings");
+    m_recordCheckBox->setChecked(OperationStats::isEnabled());
+    connect(m_recordCheckBox, &QCheckBox::toggled, this,
+            &PerformanceDiagnosticsWidget::onRecordingToggled);
+    mainLayout->addWidget(m_recordCheckBox);
+
+    m_statusLabel = new QLabel();
+    m_statusLabel->setWordWrap(true);
+    m_statusLabel->setStyleSheet("color: #666; font-size: 12px;");
+    mainLayout->addWidget(m_statusLabel);
+
+    m_statsTree = new QTreeWidget();
+    m_statsTree->setColumnCount(ColumnCount);
+    m_statsTree->setHeaderLabels({"Device / Operation", "Calls", "Bytes",
+                                  "Lock wait p50", "Lock wait p99",
+                                  "Call p50", "Call p99"});
+    m_statsTree->setRootIsDecorated(true);
+    m_statsTree->setAlternatingRowColors(true);
+    m_statsTree->header()->setSectionResizeMode(OperationColumn,
+                                                QHeaderView::Stretch);
+    mainLayout->addWidget(m_statsTree, 1);
+
+    QHBoxLayout *buttonLayout = new QHBoxLayout();
+    m_resetButton = new QPushButton("Reset");
+    m_copyJsonButton = new QPushButton("Copy JSON");
+    m_saveJsonButton = new QPushButton("Save JSON...");
+    buttonLayout->addWidget(m_resetButton);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_copyJsonButton);
+    buttonLayout->addWidget(m_saveJsonButton);
+    mainLayout->addLayout(buttonLayout);
+
+    QGroupBox *brokerGroup = new QGroupBox("Lockdown Sessions");
+    QVBoxLayout *brokerLayout = new QVBoxLayout(brokerGroup);
+    m_brokerLabel = new QLabel();
+    m_brokerLabel->setWordWrap(true);
+    m_brokerLabel->setToolTip(
+        "Every handshake is a full TLS session setup, idle service clients "
+        "are reused until their timeout runs out");
+    brokerLayout->addWidget(m_brokerLabel);
+    mainLayout->addWidget(brokerGroup);
+
+    QGroupBox *traceGroup = new QGroupBox("Tracing");
+    QHBoxLayout *traceLayout = new QHBoxLayout(traceGroup);
+    m_traceCheckBox = new QCheckBox("Trace device operations");
+    m_traceCheckBox->setChecked(Tracer::isEnabled());
+    m_traceCheckBox->setToolTip(
+        "Keeps the most recent spans in memory, open saved traces in "
+        "ui.perfetto.dev or chrome://tracing");
+    m_traceSecondsSpinBox = new QSpinBox();
+    m_traceSecondsSpinBox->setRange(0, 3600);
+    m_traceSecondsSpinBox->setValue(30);
+    m_traceSecondsSpinBox->setSpecialValueText("Everything");
+    m_traceSecondsSpinBox->setSuffix(" s");
+    m_saveTraceButton = new QPushButton("Save Trace...");
+    traceLayout->addWidget(m_traceCheckBox);
+    traceLayout->addStretch();
+    traceLayout->addWidget(new QLabel("Last"));
+    traceLayout->addWidget(m_traceSecondsSpinBox);
+    traceLayout->addWidget(m_saveTraceButton);
+    mainLayout->addWidget(traceGroup);
+
+    connect(m_traceCheckBox, &QCheckBox::toggled, this,
+            &PerformanceDiagnosticsWidget::onTracingToggled);
+    connect(m_saveTraceButton, &QPushButton::clicked, this,
+            &PerformanceDiagnosticsWidget::onSaveTraceClicked);
+    connect(m_resetButton, &QPushButton::clicked, this,
+            &PerformanceDiagnosticsWidget::onResetClicked);
+    connect(m_copyJsonButton, &QPushButton::clicked, this,
+            &PerformanceDiagnosticsWidget::onCopyJsonClicked);
+    connect(m_saveJsonButton, &QPushButton::clicked, this,
+            &PerformanceDiagnosticsWidget::onSaveJsonClicked);
+}
+
+void PerformanceDiagnosticsWidget::refresh()
+{
+    m_statusLabel->setText(
+        OperationStats::isEnabled()
+            ? "Recording. A high lock wait next to a short call means "
+              "operations are queueing behind each other, a long call "
+              "points at the USB or Wi-Fi link."
+            : "Recording is off, enable it and use the app to collect "
+              "timings.");
+
+    // Always counted, independent of the recording switch
+    const ServiceBrokerStats broker = ServiceBroker::sharedInstance()->stats();
+    const QLocale locale;
+    m_brokerLabel->setText(
+        QString("Handshakes: %1 (reconnects: %2) · Service starts: %3 · "
+                "Client cache hits: %4, misses: %5")
+            .arg(locale.toString(broker.handshakes),
+                 locale.toString(broker.reconnects),
+                 locale.toString(broker.serviceStarts),
+                 locale.toString(broker.cacheHits),
+                 locale.toString(broker.cacheMisses)));
+
+    const QList<OperationStats::Summary> summaries =
+        OperationStats::summaries();
+
+    // Rebuilt every tick, keep the user's expanded devices expanded
+    QSet<QString> collapsed;
+    for (int i = 0; i < m_statsTree->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *item = m_statsTree->topLevelItem(i);
+        if (!item->isExpanded()) {
+            collapsed.insert(item->text(OperationColumn));
+        }
+    }
+    m_statsTree->clear();
+
+    QTreeWidgetItem *deviceItem = nullptr;
+    for (const OperationStats::Summary &summary : summaries) {
+        if (!deviceItem || deviceItem->text(OperationColumn) != summary.udid) {
+            deviceItem = new QTreeWidgetItem(m_statsTree);
+            deviceItem->setText(OperationColumn, summary.udid);
+            deviceItem->setFirstColumnSpanned(true);
+            deviceItem->setExpanded(!collapsed.contains(summary.udid));
+        }
+
+        auto *item = new QTreeWidgetItem(deviceItem);
+        item->setText(OperationColumn,
+                      OperationStats::operationName(summary.operation));
+        item->setText(CountColumn,
+                      locale.toString(summary.operationTime.count));
+        item->setText(BytesColumn,
+                      summary.bytes > 0
+                          ? locale.formattedDataSize(summary.bytes)
+                          : QString("-"));
+        item->setText(WaitP50Column,
+                      formatMicroseconds(summary.lockWait.p50Us));
+        item->setText(WaitP99Column,
+                      formatMicroseconds(summary.lockWait.p99Us));
+        item->setText(CallP50Column,
+                      formatMicroseconds(summary.operationTime.p50Us));
+        item->setText(CallP99Column,
+                      formatMicroseconds(summary.operationTime.p99Us));
+        for (int column = CountColumn; column < ColumnCount; ++column) {
+            item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+        }
+    }
+}
+
+void PerformanceDiagnosticsWidget::onRecordingToggled(bool enabled)
+{
+    OperationStats::setEnabled(enabled);
+    refresh();
+}
+
+void PerformanceDiagnosticsWidget::onResetClicked()
+{
+    OperationStats::reset();
+    refresh();
+}
+
+void PerformanceDiagnosticsWidget::onCopyJsonClicked()
+{
+    QApplication::clipboard()->setText(
+        QJsonDocument(OperationStats::snapshot()).toJson());
+}
+
+void PerformanceDiagnosticsWidget::onSaveJsonClicked()
+{
+    const QString fileName = QFileDialog::getSaveFileName(
+        this, "Save Operation Statistics",
+        QString("idescriptor-operations-%1.json")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")),
+        "JSON Files (*.json)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, "Error",
+                             "Could not write " + fileName + ".");
+        return;
+    }
+    file.write(QJsonDocument(OperationStats::snapshot()).toJson());
+}
+
+void PerformanceDiagnosticsWidget::onTracingToggled(bool enabled)
+{
+    Tracer::setEnabled(enabled);
+}
+
+void PerformanceDiagnosticsWidget::onSaveTraceClicked()
+{
+    const QString fileName = QFileDialog::getSaveFileName(
+        this, "Save Trace",
+        QString("idescriptor-trace-%1.json")
+            .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss")),
+        "Trace Files (*.json)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, "Error",
+                             "Could not write " + fileName + ".");
+        return;
+    }
+    file.write(Tracer::toJson(m_traceSecondsSpinBox->value()));
+}
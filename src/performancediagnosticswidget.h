@@ -0,0 +1,71 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERFORMANCEDIAGNOSTICSWIDGET_H
+#define PERFORMANCEDIAGNOSTICSWIDGET_H
+
+#include <QCheckBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTimer>
+#include <QTreeWidget>
+#include <QWidget>
+
+/**
+ * @brief Live view of the ServiceManager operation statistics
+ *
+ * Shows, per device and operation, how much time went into waiting for the
+ * device mutex compared to the call itself, and can export the same data as
+ * a JSON snapshot. Also toggles Tracer and saves its ring buffer as a
+ * Chrome trace, and shows the ServiceBroker session/cache counters.
+ */
+class PerformanceDiagnosticsWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PerformanceDiagnosticsWidget(QWidget *parent = nullptr);
+
+private slots:
+    void refresh();
+    void onRecordingToggled(bool enabled);
+    void onResetClicked();
+    void onCopyJsonClicked();
+    void onSaveJsonClicked();
+    void onTracingToggled(bool enabled);
+    void onSaveTraceClicked();
+
+private:
+    void setupUI();
+
+    QCheckBox *m_recordCheckBox;
+    QLabel *m_statusLabel;
+    QTreeWidget *m_statsTree;
+    QPushButton *m_resetButton;
+    QPushButton *m_copyJsonButton;
+    QPushButton *m_saveJsonButton;
+    QLabel *m_brokerLabel;
+    QCheckBox *m_traceCheckBox;
+    QSpinBox *m_traceSecondsSpinBox;
+    QPushButton *m_saveTraceButton;
+    QTimer *m_refreshTimer;
+};
+
+#endif // PERFORMANCEDIAGNOSTICSWIDGET_H
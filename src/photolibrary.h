@@ -0,0 +1,81 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PHOTOLIBRARY_H
+#define PHOTOLIBRARY_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+
+// Album views are selected with album paths carrying this prefix and the
+// album's primary key, e.g. "album:42"
+inline constexpr char PhotoLibraryAlbumPrefix[] = "album:";
+
+struct PhotoLibraryAsset {
+    QString path; // e.g. /DCIM/100APPLE/IMG_0001.HEIC
+    QDateTime created;
+    int width = 0;
+    int height = 0;
+    bool video = false;
+    bool favorite = false;
+    bool livePhoto = false;
+    bool burst = false;
+    bool screenshot = false;
+    bool hidden = false;
+    bool trashed = false;
+};
+
+struct PhotoLibraryAlbum {
+    qint64 id = 0;
+    QString title;
+    QList<int> assets; // indexes into PhotoLibrary::assets
+};
+
+/**
+ * @brief Asset metadata read from a device's Photos.sqlite
+ *
+ * Immutable once built, shared between threads with std::shared_ptr.
+ */
+struct PhotoLibrary {
+    QVector<PhotoLibraryAsset> assets;
+    QHash<QString, int> byPath;
+    QList<PhotoLibraryAlbum> albums;
+    QString sourceKey; // DB + WAL mtimes it was built from
+
+    const PhotoLibraryAsset *find(const QString &path) const
+    {
+        auto it = byPath.constFind(path);
+        return it == byPath.constEnd() ? nullptr : &assets[*it];
+    }
+
+    const PhotoLibraryAlbum *album(qint64 id) const
+    {
+        for (const PhotoLibraryAlbum &album : albums) {
+            if (album.id == id) {
+                return &album;
+            }
+        }
+        return nullptr;
+    }
+};
+
+#endif // PHOTOLIBRARY_H
@@ -0,0 +1,428 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "photolibraryindex.h"
+#include "appcontext.h"
+#include "loggingcategories.h"
+#include "servicemanager.h"
+#include "settingsmanager.h"
+#include "tracer.h"
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+constexpr uint32_t ChunkSize = 1024 * 1024;
+// Core Data timestamps count from 2001-01-01 UTC
+constexpr qint64 CoreDataEpoch = 978307200;
+constexpr int KindVideo = 1;
+constexpr int SubtypeLivePhoto = 2;
+constexpr int SubtypeScreenshot = 10;
+constexpr int AlbumKindRegular = 2;
+
+const char *const RemoteDb = "/PhotoData/Photos.sqlite";
+const char *const RemoteWal = "/PhotoData/Photos.sqlite-wal";
+
+QStringList tableNames(const QSqlDatabase &db)
+{
+    QStringList names;
+    QSqlQuery query("SELECT name FROM sqlite_master WHERE type = 'table'", db);
+    while (query.next()) {
+        names.append(query.value(0).toString());
+    }
+    return names;
+}
+
+QSet<QString> columnNames(const QSqlDatabase &db, const QString &table)
+{
+    QSet<QString> names;
+    QSqlQuery query(QString("PRAGMA table_info(%1)").arg(table), db);
+    while (query.next()) {
+        names.insert(query.value(1).toString());
+    }
+    return names;
+}
+
+// Column names move between iOS releases, missing ones read as NULL
+QString column(const QSet<QString> &columns, const char *name)
+{
+    return columns.contains(name) ? QString(name) : QString("NULL");
+}
+
+bool readAssets(const QSqlDatabase &db, const QStringList &tables,
+                PhotoLibrary &library, QHash<qint64, int> &byPk)
+{
+    // ZGENERICASSET before iOS 14
+    const QString table =
+        tables.contains("ZASSET") ? "ZASSET" : "ZGENERICASSET";
+    if (!tables.contains(table)) {
+        return false;
+    }
+
+    const QSet<QString> cols = columnNames(db, table);
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec(QString("SELECT Z_PK, ZDIRECTORY, ZFILENAME, "
+                            "ZDATECREATED, %1, %2, %3, %4, %5, %6, %7, %8 "
+                            "FROM %9")
+                        .arg(column(cols, "ZWIDTH"), column(cols, "ZHEIGHT"),
+                             column(cols, "ZKIND"),
+                             column(cols, "ZKINDSUBTYPE"),
+                             column(cols, "ZAVALANCHEUUID"),
+                             column(cols, "ZFAVORITE"),
+                             column(cols, "ZHIDDEN"),
+                             column(cols, "ZTRASHEDSTATE"), table))) {
+        return false;
+    }
+
+    while (query.next()) {
+        const QString directory = query.value(1).toString();
+        const QString fileName = query.value(2).toString();
+        if (directory.isEmpty() || fileName.isEmpty()) {
+            continue;
+        }
+
+        PhotoLibraryAsset asset;
+        asset.path = "/" + directory + "/" + fileName;
+        if (!query.value(3).isNull()) {
+            asset.created = QDateTime::fromMSecsSinceEpoch(
+                qint64((CoreDataEpoch + query.value(3).toDouble()) * 1000),
+                Qt::UTC);
+        }
+        asset.width = query.value(4).toInt();
+        asset.height = query.value(5).toInt();
+        asset.video = query.value(6).toInt() == KindVideo;
+        asset.livePhoto = query.value(7).toInt() == SubtypeLivePhoto;
+        asset.screenshot = query.value(7).toInt() == SubtypeScreenshot;
+        asset.burst = !query.value(8).isNull();
+        asset.favorite = query.value(9).toInt() != 0;
+        asset.hidden = query.value(10).toInt() != 0;
+        asset.trashed = query.value(11).toInt() != 0;
+
+        byPk.insert(query.value(0).toLongLong(), library.assets.size());
+        library.byPath.insert(asset.path, library.assets.size());
+        library.assets.append(asset);
+    }
+    return true;
+}
+
+void readAlbums(const QSqlDatabase &db, const QStringList &tables,
+                PhotoLibrary &library, const QHash<qint64, int> &assetByPk)
+{
+    if (!tables.contains("ZGENERICALBUM")) {
+        return;
+    }
+
+    const QSet<QString> cols = columnNames(db, "ZGENERICALBUM");
+    QSqlQuery albums(db);
+    if (!albums.exec(QString("SELECT Z_PK, ZTITLE FROM ZGENERICALBUM "
+                             "WHERE ZKIND = %1 AND ZTITLE IS NOT NULL "
+                             "AND COALESCE(%2, 0) = 0 ORDER BY ZTITLE")
+                         .arg(AlbumKindRegular)
+                         .arg(column(cols, "ZTRASHEDSTATE")))) {
+        return;
+    }
+
+    QHash<qint64, int> albumByPk;
+    while (albums.next()) {
+        PhotoLibraryAlbum album;
+        album.id = albums.value(0).toLongLong();
+        album.title = albums.value(1).toString();
+        albumByPk.insert(album.id, library.albums.size());
+        library.albums.append(album);
+    }
+
+    // The album/asset join table is numbered by entity, e.g. Z_26ASSETS
+    // with Z_26ALBUMS and Z_3ASSETS, and the numbers change between releases
+    static const QRegularExpression joinTable("^Z_\\d+ASSETS$");
+    static const QRegularExpression albumColumn("^Z_\\d+ALBUMS$");
+    for (const QString &table : tables) {
+        if (!joinTable.match(table).hasMatch()) {
+            continue;
+        }
+        QString albumCol;
+        QString assetCol;
+        for (const QString &col : columnNames(db, table)) {
+            if (albumColumn.match(col).hasMatch()) {
+                albumCol = col;
+            } else if (joinTable.match(col).hasMatch()) {
+                assetCol = col;
+            }
+        }
+        if (albumCol.isEmpty() || assetCol.isEmpty()) {
+            continue;
+        }
+
+        QSqlQuery members(db);
+        members.setForwardOnly(true);
+        if (!members.exec(QString("SELECT %1, %2 FROM %3")
+                              .arg(albumCol, assetCol, table))) {
+            continue;
+        }
+        while (members.next()) {
+            auto album = albumByPk.constFind(members.value(0).toLongLong());
+            auto asset = assetByPk.constFind(members.value(1).toLongLong());
+            if (album != albumByPk.constEnd() &&
+                asset != assetByPk.constEnd()) {
+                library.albums[*album].assets.append(*asset);
+            }
+        }
+        break;
+    }
+}
+} // namespace
+
+PhotoLibraryIndex *PhotoLibraryIndex::sharedInstance()
+{
+    static PhotoLibraryIndex instance;
+    return &instance;
+}
+
+PhotoLibraryIndex::PhotoLibraryIndex(QObject *parent) : QObject(parent)
+{
+    // Emitted before the device is freed, a running copy has to stop first.
+    // Libraries are kept for reconnects.
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            &PhotoLibraryIndex::onDeviceRemoved, Qt::DirectConnection);
+}
+
+std::shared_ptr<const PhotoLibrary>
+PhotoLibraryIndex::library(const std::string &udid)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_libraries.value(udid);
+}
+
+void PhotoLibraryIndex::refresh(iDescriptorDevice *device)
+{
+    if (!device) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    std::shared_ptr<Job> &job = m_jobs[device->udid];
+    if (job && !job->future.isFinished()) {
+        return;
+    }
+    job = std::make_shared<Job>();
+    job->future = QtConcurrent::run(
+        [this, device, job = job]() { run(device, job); });
+}
+
+void PhotoLibraryIndex::onDeviceRemoved(const std::string &udid)
+{
+    std::shared_ptr<Job> job;
+    {
+        QMutexLocker locker(&m_mutex);
+        job = m_jobs.take(udid);
+    }
+    if (job) {
+        job->cancelled = true;
+        job->future.waitForFinished();
+    }
+}
+
+// mtimes of the DB and WAL plus the WAL size, any write changes one of them
+QString PhotoLibraryIndex::sourceKey(iDescriptorDevice *device)
+{
+    QStringList parts;
+    for (const char *path : {RemoteDb, RemoteWal}) {
+        char **info = nullptr;
+        if (ServiceManager::safeAfcGetFileInfo(device, path, &info) !=
+                AFC_E_SUCCESS ||
+            !info) {
+            parts.append("-");
+            continue;
+        }
+        QString mtime;
+        QString size;
+        for (int i = 0; info[i] && info[i + 1]; i += 2) {
+            if (strcmp(info[i], "st_mtime") == 0) {
+                mtime = info[i + 1];
+            } else if (strcmp(info[i], "st_size") == 0) {
+                size = info[i + 1];
+            }
+        }
+        afc_dictionary_free(info);
+        parts.append(mtime + ":" + size);
+    }
+    // No DB, no library (or no access to it)
+    return parts.first() == "-" ? QString() : parts.join('/');
+}
+
+bool PhotoLibraryIndex::download(iDescriptorDevice *device,
+                                 const QString &remote, const QString &local,
+                                 const Job &job)
+{
+    uint64_t handle = 0;
+    afc_error_t err = ServiceManager::safeAfcFileOpen(
+        device, remote.toUtf8().constData(), AFC_FOPEN_RDONLY, &handle);
+    if (err == AFC_E_OBJECT_NOT_FOUND) {
+        // No WAL on the device, a stale local one must not be replayed
+        QFile::remove(local);
+        return true;
+    }
+    if (err != AFC_E_SUCCESS || handle == 0) {
+        qCDebug(lcGallery) << "PhotoLibraryIndex: could not open" << remote
+                           << "error" << err;
+        return false;
+    }
+
+    QSaveFile file(local);
+    bool ok = file.open(QIODevice::WriteOnly);
+    QByteArray buffer(ChunkSize, Qt::Uninitialized);
+    while (ok && !job.cancelled) {
+        uint32_t bytesRead = 0;
+        if (ServiceManager::safeAfcFileRead(device, handle, buffer.data(),
+                                            ChunkSize, &bytesRead) !=
+            AFC_E_SUCCESS) {
+            ok = false;
+            break;
+        }
+        if (bytesRead == 0) {
+            break;
+        }
+        ok = file.write(buffer.constData(), bytesRead) == bytesRead;
+    }
+    ServiceManager::safeAfcFileClose(device, handle);
+
+    if (!ok || job.cancelled) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+void PhotoLibraryIndex::run(iDescriptorDevice *device,
+                            std::shared_ptr<Job> job)
+{
+    TraceSpan span("gallery", "photo_library_index", device);
+    const QString udid = QString::fromStdString(device->udid);
+
+    QString key = sourceKey(device);
+    if (key.isEmpty()) {
+        qCDebug(lcGallery) << "PhotoLibraryIndex: no Photos.sqlite on" << udid;
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        auto current = m_libraries.value(device->udid);
+        if (current && current->sourceKey == key) {
+            return;
+        }
+    }
+
+    const QString dir = SettingsManager::homePath() + "/photos/" + udid;
+    const QString dbPath = dir + "/Photos.sqlite";
+    QFile keyFile(dir + "/source");
+    QString localKey;
+    if (keyFile.open(QIODevice::ReadOnly)) {
+        localKey = QString::fromUtf8(keyFile.readAll());
+        keyFile.close();
+    }
+
+    if (localKey != key || !QFile::exists(dbPath)) {
+        span.setDetail("download");
+        QDir().mkpath(dir);
+        // The local copy no longer matches whatever key was saved
+        keyFile.remove();
+        // Photos may write while we copy, retry once if the DB moved on
+        bool stable = false;
+        for (int attempt = 0; attempt < 2 && !stable; ++attempt) {
+            if (!download(device, RemoteDb, dbPath, *job) ||
+                !download(device, RemoteWal, dbPath + "-wal", *job)) {
+                return;
+            }
+            const QString after = sourceKey(device);
+            stable = after == key;
+            key = after;
+        }
+        // The shared memory index belongs to the old WAL
+        QFile::remove(dbPath + "-shm");
+        if (!stable) {
+            // DB and WAL may be torn, leave it to the next run
+            qCDebug(lcGallery)
+                << "PhotoLibraryIndex: Photos.sqlite kept changing on" << udid;
+            return;
+        }
+
+        QSaveFile saved(keyFile.fileName());
+        if (saved.open(QIODevice::WriteOnly)) {
+            saved.write(key.toUtf8());
+            saved.commit();
+        }
+    }
+
+    if (job->cancelled) {
+        return;
+    }
+
+    std::shared_ptr<PhotoLibrary> library =
+        query(dbPath, "photolibrary-" + udid);
+    if (!library) {
+        return;
+    }
+    library->sourceKey = key;
+
+    qCDebug(lcGallery) << "PhotoLibraryIndex:" << library->assets.size()
+                       << "assets," << library->albums.size() << "albums on"
+                       << udid;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_libraries.insert(device->udid, library);
+    }
+    emit libraryChanged(udid);
+}
+
+std::shared_ptr<PhotoLibrary>
+PhotoLibraryIndex::query(const QString &dbPath, const QString &connection)
+{
+    std::shared_ptr<PhotoLibrary> library;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(dbPath);
+        if (!db.open()) {
+            qCDebug(lcGallery) << "PhotoLibraryIndex: could not open" << dbPath;
+        } else {
+            const QStringList tables = tableNames(db);
+            auto result = std::make_shared<PhotoLibrary>();
+            QHash<qint64, int> byPk;
+            if (readAssets(db, tables, *result, byPk)) {
+                readAlbums(db, tables, *result, byPk);
+                library = std::move(result);
+            } else {
+                qCDebug(lcGallery)
+                    << "PhotoLibraryIndex: unknown Photos.sqlite schema";
+            }
+            db.close();
+        }
+    }
+    // Connections are per thread, nothing may reference it past this point
+    QSqlDatabase::removeDatabase(connection);
+    return library;
+}
@@ -0,0 +1,77 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PHOTOLIBRARYINDEX_H
+#define PHOTOLIBRARYINDEX_H
+
+#include "iDescriptor.h"
+#include "photolibrary.h"
+#include <QFuture>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief Per-device index of the Photos library
+ *
+ * Copies /PhotoData/Photos.sqlite and its WAL over AFC into
+ * ~/.idescriptor/photos/<udid> and queries the copy locally, so dates,
+ * dimensions, subtypes, favorites and albums cost no per-file stats. The
+ * copy is only refreshed when the DB or WAL mtime on the device changes.
+ */
+class PhotoLibraryIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PhotoLibraryIndex *sharedInstance();
+
+    // Last library built for the device, null until the first refresh
+    std::shared_ptr<const PhotoLibrary> library(const std::string &udid);
+
+    // Async, libraryChanged is emitted if anything new was loaded
+    void refresh(iDescriptorDevice *device);
+
+signals:
+    void libraryChanged(const QString &udid);
+
+private:
+    explicit PhotoLibraryIndex(QObject *parent = nullptr);
+
+    struct Job {
+        QFuture<void> future;
+        std::atomic<bool> cancelled{false};
+    };
+
+    void run(iDescriptorDevice *device, std::shared_ptr<Job> job);
+    void onDeviceRemoved(const std::string &udid);
+    static QString sourceKey(iDescriptorDevice *device);
+    static bool download(iDescriptorDevice *device, const QString &remote,
+                         const QString &local, const Job &job);
+    static std::shared_ptr<PhotoLibrary> query(const QString &dbPath,
+                                               const QString &connection);
+
+    QMutex m_mutex;
+    QMap<std::string, std::shared_ptr<const PhotoLibrary>> m_libraries;
+    QMap<std::string, std::shared_ptr<Job>> m_jobs;
+};
+
+#endif // PHOTOLIBRARYINDEX_H
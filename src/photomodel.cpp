@@ -19,8 +19,11 @@
 
 #include "photomodel.h"
 #include "iDescriptor.h"
+#include "imagedecoder.h"
+#include "loggingcategories.h"
 #include "mediastreamermanager.h"
 #include "servicemanager.h"
+#include "tracer.h"
 #include <QDebug>
 #include <QEventLoop>
 #include <QIcon>
@@ -74,15 +77,15 @@ void PhotoModel::clear()
 
 PhotoModel::~PhotoModel()
 {
-    qDebug() << "PhotoModel destructor called";
+    qCDebug(lcGallery) << "PhotoModel destructor called";
     clear();
 }
 
-QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
-                                                 const QString &filePath,
-                                                 const QSize &requestedSize)
+QImage PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
+                                                const QString &filePath,
+                                                const QSize &requestedSize)
 {
-    QPixmap thumbnail;
+    QImage thumbnail;
 
     uint64_t fileHandle = 0;
 
@@ -90,7 +93,8 @@ QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
         device, filePath.toUtf8().constData(), AFC_FOPEN_RDONLY, &fileHandle);
 
     if (openResult != AFC_E_SUCCESS || fileHandle == 0) {
-        qWarning() << "Failed to open video file for thumbnail:" << filePath;
+        qCWarning(lcGallery) << "Failed to open video file for thumbnail:"
+                             << filePath;
         return {};
     }
 
@@ -112,7 +116,8 @@ QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
 
     if (fileSize == 0) {
         ServiceManager::safeAfcFileClose(device, fileHandle);
-        qWarning() << "Invalid video file size for thumbnail:" << filePath;
+        qCWarning(lcGallery) << "Invalid video file size for thumbnail:"
+                             << filePath;
         return {};
     }
 
@@ -120,7 +125,7 @@ QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
     AVFormatContext *formatCtx = avformat_alloc_context();
     if (!formatCtx) {
         ServiceManager::safeAfcFileClose(device, fileHandle);
-        qWarning() << "Failed to allocate format context";
+        qCWarning(lcGallery) << "Failed to allocate format context";
         return {};
     }
 
@@ -227,7 +232,7 @@ QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
 
     // Open input
     if (avformat_open_input(&formatCtx, nullptr, nullptr, nullptr) < 0) {
-        qWarning() << "Failed to open video format";
+        qCWarning(lcGallery) << "Failed to open video format";
         av_free(avioCtx->buffer);
         avio_context_free(&avioCtx);
         avformat_free_context(formatCtx);
@@ -236,7 +241,7 @@ QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
 
     // Find stream info
     if (avformat_find_stream_info(formatCtx, nullptr) < 0) {
-        qWarning() << "Failed to find stream info";
+        qCWarning(lcGallery) << "Failed to find stream info";
         avformat_close_input(&formatCtx);
         av_free(avioCtx->buffer);
         avio_context_free(&avioCtx);
@@ -258,7 +263,7 @@ QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
     }
 
     if (videoStreamIndex == -1 || !codec) {
-        qWarning() << "No video stream found";
+        qCWarning(lcGallery) << "No video stream found";
         avformat_close_input(&formatCtx);
         av_free(avioCtx->buffer);
         avio_context_free(&avioCtx);
@@ -347,13 +352,10 @@ QPixmap PhotoModel::generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
                                rgbFrame->height, rgbFrame->linesize[0],
                                QImage::Format_RGB888);
 
-                    // Create a deep copy since AVFrame will be freed
-                    QImage imgCopy = img.copy();
-
-                    // Scale to requested size
-                    thumbnail = QPixmap::fromImage(
-                        imgCopy.scaled(requestedSize, Qt::KeepAspectRatio,
-                                       Qt::SmoothTransformation));
+                    // scaled() makes a deep copy, so the AVFrame can be
+                    // freed afterwards
+                    thumbnail = img.scaled(requestedSize, Qt::KeepAspectRatio,
+                                           Qt::SmoothTransformation);
                 }
 
                 av_frame_free(&rgbFrame);
@@ -401,18 +403,19 @@ QVariant PhotoModel::data(const QModelIndex &index, int role) const
         return info.filePath;
 
     case Qt::DecorationRole: {
-        qDebug() << "DecorationRole requested for index:" << index.row();
+        qCDebug(lcGallery) << "DecorationRole requested for index:"
+                           << index.row();
 
         // Check memory cache first
         if (QPixmap *cached = m_thumbnailCache.object(info.filePath)) {
-            qDebug() << "Cache HIT for:" << info.fileName;
+            qCDebug(lcGallery) << "Cache HIT for:" << info.fileName;
             return QIcon(*cached);
         }
 
         // Prevent duplicate requests
         if (m_loadingPaths.contains(info.filePath) ||
             m_activeLoaders.contains(info.filePath)) {
-            qDebug() << "Already loading:" << info.fileName;
+            qCDebug(lcGallery) << "Already loading:" << info.fileName;
             // Return appropriate placeholder based on file type
             if (info.fileName.endsWith(".MOV", Qt::CaseInsensitive) ||
                 info.fileName.endsWith(".MP4", Qt::CaseInsensitive) ||
@@ -426,7 +429,7 @@ QVariant PhotoModel::data(const QModelIndex &index, int role) const
 
         // Start async loading for both images and videos
         if (!m_loadingPaths.contains(info.filePath)) {
-            qDebug() << "Starting load for:" << info.fileName;
+            qCDebug(lcGallery) << "Starting load for:" << info.fileName;
             emit const_cast<PhotoModel *>(this)->thumbnailNeedsToBeLoaded(
                 index.row());
         }
@@ -464,13 +467,15 @@ void PhotoModel::requestThumbnail(int index)
 
     m_loadingPaths.insert(info.filePath);
 
-    auto *watcher = new QFutureWatcher<QPixmap>();
+    auto *watcher = new QFutureWatcher<QImage>();
     m_activeLoaders[info.filePath] = watcher;
 
-    connect(watcher, &QFutureWatcher<QPixmap>::finished, this,
+    connect(watcher, &QFutureWatcher<QImage>::finished, this,
             [this, watcher, filePath = info.filePath]() {
-                qDebug() << "Thumbnail load finished for:" << filePath;
-                QPixmap thumbnail = watcher->result();
+                qCDebug(lcGallery) << "Thumbnail load finished for:"
+                                   << filePath;
+                // Workers only produce QImage, QPixmap is GUI thread only
+                QPixmap thumbnail = QPixmap::fromImage(watcher->result());
 
                 m_loadingPaths.remove(filePath);
                 m_activeLoaders.remove(filePath);
@@ -487,8 +492,8 @@ void PhotoModel::requestThumbnail(int index)
                         }
                     }
                 } else {
-                    qDebug() << "Failed to load thumbnail for:"
-                             << QFileInfo(filePath).fileName();
+                    qCDebug(lcGallery) << "Failed to load thumbnail for:"
+                                       << QFileInfo(filePath).fileName();
                 }
 
                 watcher->deleteLater();
@@ -498,25 +503,29 @@ void PhotoModel::requestThumbnail(int index)
                    info.fileName.endsWith(".MP4", Qt::CaseInsensitive) ||
                    info.fileName.endsWith(".M4V", Qt::CaseInsensitive);
 
-    QFuture<QPixmap> future;
+    QFuture<QImage> future;
     if (isVideo) {
         future = QtConcurrent::run([this, info]() {
+            TraceSpan span("gallery", "video_thumbnail", m_device);
+            span.setDetail(info.filePath);
             // Acquire semaphore FIRST to limit concurrent video processing
-            qDebug() << "Waiting for semaphore for:" << info.fileName;
+            qCDebug(lcGallery) << "Waiting for semaphore for:" << info.fileName;
             m_videoThumbnailSemaphore.acquire();
-            qDebug() << "Acquired semaphore for:" << info.fileName;
+            qCDebug(lcGallery) << "Acquired semaphore for:" << info.fileName;
 
             // Generate video thumbnail using FFmpeg directly (no QMediaPlayer)
-            QPixmap thumbnail = generateVideoThumbnailFFmpeg(
+            QImage thumbnail = generateVideoThumbnailFFmpeg(
                 m_device, info.filePath, m_thumbnailSize);
 
             // Release semaphore
-            qDebug() << "Releasing semaphore for:" << info.fileName;
+            qCDebug(lcGallery) << "Releasing semaphore for:" << info.fileName;
             m_videoThumbnailSemaphore.release();
             return thumbnail;
         });
     } else {
         future = QtConcurrent::run([info, this]() {
+            TraceSpan span("gallery", "thumbnail", m_device);
+            span.setDetail(info.filePath);
             return loadThumbnailFromDevice(m_device, info.filePath,
                                            m_thumbnailSize);
         });
@@ -526,79 +535,42 @@ void PhotoModel::requestThumbnail(int index)
 }
 
 // Static function that runs in worker thread
-QPixmap PhotoModel::loadThumbnailFromDevice(iDescriptorDevice *device,
-                                            const QString &filePath,
-                                            const QSize &size)
+QImage PhotoModel::loadThumbnailFromDevice(iDescriptorDevice *device,
+                                           const QString &filePath,
+                                           const QSize &size)
 {
     // Load from device using ServiceManager
     QByteArray imageData = ServiceManager::safeReadAfcFileToByteArray(
         device, filePath.toUtf8().constData());
 
     if (imageData.isEmpty()) {
-        qDebug() << "Could not read from device:" << filePath;
-        return {}; // Return empty pixmap on error
-    }
-
-    if (filePath.endsWith(".HEIC", Qt::CaseInsensitive)) {
-        qDebug() << "Loading HEIC image from data for:" << filePath;
-        QPixmap img = load_heic(imageData);
-        return img.isNull() ? QPixmap()
-                            : img.scaled(size, Qt::KeepAspectRatio,
-                                         Qt::SmoothTransformation);
-    }
-
-    // Use QImageReader for efficient, low-memory scaled loading
-    QBuffer buffer(&imageData);
-    buffer.open(QIODevice::ReadOnly);
-
-    QImageReader reader(&buffer);
-    if (reader.canRead()) {
-        // This is the key optimization: it decodes a smaller image directly,
-        // saving a massive amount of memory.
-        reader.setScaledSize(size);
-        QImage image = reader.read();
-        if (!image.isNull()) {
-            return QPixmap::fromImage(image);
-        }
-        qDebug() << "QImageReader failed to decode" << filePath
-                 << "Error:" << reader.errorString();
+        qCDebug(lcGallery) << "Could not read from device:" << filePath;
+        return {}; // Return empty image on error
     }
 
-    // Fallback for formats QImageReader might struggle with
-    QPixmap original;
-    if (original.loadFromData(imageData)) {
-        return original.scaled(size, Qt::KeepAspectRatio,
-                               Qt::SmoothTransformation);
+    QImage image = ImageDecoder::decode(imageData, filePath, size);
+    if (image.isNull()) {
+        qCDebug(lcGallery) << "Could not decode image data for:" << filePath;
     }
-
-    qDebug() << "Could not decode image data for:" << filePath;
-    return {};
+    return image;
 }
 
-QPixmap PhotoModel::loadImage(iDescriptorDevice *device,
-                              const QString &filePath)
+QImage PhotoModel::loadImage(iDescriptorDevice *device,
+                             const QString &filePath)
 {
     QByteArray imageData = ServiceManager::safeReadAfcFileToByteArray(
         device, filePath.toUtf8().constData());
 
     if (imageData.isEmpty()) {
-        qDebug() << "Could not read from device:" << filePath;
-        return QPixmap(); // Return empty pixmap on error
-    }
-
-    if (filePath.endsWith(".HEIC")) {
-        qDebug() << "Loading HEIC image from data for:" << filePath;
-        QPixmap img = load_heic(imageData);
-        return img.isNull() ? QPixmap() : img;
+        qCDebug(lcGallery) << "Could not read from device:" << filePath;
+        return QImage(); // Return empty image on error
     }
 
-    QPixmap original;
-    if (!original.loadFromData(imageData)) {
-        qDebug() << "Could not decode image data for:" << filePath;
-        return QPixmap();
+    QImage image = ImageDecoder::decode(imageData, filePath);
+    if (image.isNull()) {
+        qCDebug(lcGallery) << "Could not decode image data for:" << filePath;
     }
-
-    return original;
+    return image;
 }
 
 void PhotoModel::populatePhotoPaths()
@@ -606,12 +578,17 @@ void PhotoModel::populatePhotoPaths()
     // TODO:beginResetModel called on PhotoModel(0x600002d12a40) without calling
     // endResetModel first
     if (m_albumPath.isEmpty()) {
-        qDebug() << "No album path set, skipping population";
+        qCDebug(lcGallery) << "No album path set, skipping population";
         return;
     }
 
     m_allPhotos.clear();
 
+    if (m_albumPath.startsWith(PhotoLibraryAlbumPrefix)) {
+        populateLibraryAlbum();
+        return;
+    }
+
     QByteArray albumPathBytes = m_albumPath.toUtf8();
     const char *albumPathCStr = albumPathBytes.constData();
 
@@ -619,8 +596,8 @@ void PhotoModel::populatePhotoPaths()
     afc_error_t infoResult =
         ServiceManager::safeAfcGetFileInfo(m_device, albumPathCStr, &albumInfo);
     if (infoResult != AFC_E_SUCCESS) {
-        qDebug() << "Album path does not exist or cannot be accessed:"
-                 << m_albumPath << "Error:" << infoResult;
+        qCDebug(lcGallery) << "Album path does not exist or cannot be accessed:"
+                           << m_albumPath << "Error:" << infoResult;
         return;
     }
     if (albumInfo) {
@@ -630,16 +607,16 @@ void PhotoModel::populatePhotoPaths()
     // Fix: Store the QByteArray to keep the C string valid
     QByteArray photoDirBytes = m_albumPath.toUtf8();
     const char *photoDir = photoDirBytes.constData();
-    qDebug() << "Photo directory:" << m_albumPath;
-    qDebug() << "Photo directory C string:" << photoDir;
+    qCDebug(lcGallery) << "Photo directory:" << m_albumPath;
+    qCDebug(lcGallery) << "Photo directory C string:" << photoDir;
 
     // Use ServiceManager for thread-safe AFC operations
     char **files = nullptr;
     afc_error_t readResult =
         ServiceManager::safeAfcReadDirectory(m_device, photoDir, &files);
     if (readResult != AFC_E_SUCCESS) {
-        qDebug() << "Failed to read photo directory:" << photoDir
-                 << "Error:" << readResult;
+        qCDebug(lcGallery) << "Failed to read photo directory:" << photoDir
+                           << "Error:" << readResult;
         return;
     }
 
@@ -658,7 +635,13 @@ void PhotoModel::populatePhotoPaths()
                 info.fileName = fileName;
                 info.thumbnailRequested = false;
                 info.fileType = determineFileType(fileName);
-                info.dateTime = extractDateTimeFromFile(info.filePath);
+                const PhotoLibraryAsset *asset =
+                    m_library ? m_library->find(info.filePath) : nullptr;
+                if (asset && asset->created.isValid()) {
+                    applyLibraryAsset(info, *asset);
+                } else {
+                    info.dateTime = extractDateTimeFromFile(info.filePath);
+                }
 
                 m_allPhotos.append(info);
             }
@@ -669,8 +652,10 @@ void PhotoModel::populatePhotoPaths()
     // Apply initial filtering and sorting, which will also reset the model
     applyFilterAndSort();
 
-    qDebug() << "Loaded" << m_allPhotos.size() << "media files from device";
-    qDebug() << "After filtering:" << m_photos.size() << "items shown";
+    qCDebug(lcGallery) << "Loaded" << m_allPhotos.size()
+                       << "media files from device";
+    qCDebug(lcGallery) << "After filtering:" << m_photos.size()
+                       << "items shown";
 }
 
 // Sorting and filtering methods
@@ -712,8 +697,8 @@ void PhotoModel::applyFilterAndSort()
 
     endResetModel();
 
-    qDebug() << "Applied filter and sort - showing" << m_photos.size() << "of"
-             << m_allPhotos.size() << "items";
+    qCDebug(lcGallery) << "Applied filter and sort - showing" << m_photos.size()
+                       << "of" << m_allPhotos.size() << "items";
 }
 
 void PhotoModel::sortPhotos(QList<PhotoInfo> &photos) const
@@ -737,6 +722,12 @@ bool PhotoModel::matchesFilter(const PhotoInfo &info) const
         return info.fileType == PhotoInfo::Image;
     case VideosOnly:
         return info.fileType == PhotoInfo::Video;
+    case FavoritesOnly:
+        return info.favorite;
+    case LivePhotosOnly:
+        return info.livePhoto;
+    case ScreenshotsOnly:
+        return info.screenshot;
     default:
         return true;
     }
@@ -789,6 +780,14 @@ QStringList PhotoModel::getFilteredFilePaths() const
     return paths;
 }
 
+QPixmap PhotoModel::cachedThumbnail(const QString &filePath) const
+{
+    if (QPixmap *cached = m_thumbnailCache.object(filePath)) {
+        return *cached;
+    }
+    return QPixmap();
+}
+
 // Helper methods
 QDateTime PhotoModel::extractDateTimeFromFile(const QString &filePath) const
 {
@@ -877,7 +876,7 @@ PhotoInfo::FileType PhotoModel::determineFileType(const QString &fileName) const
 void PhotoModel::setAlbumPath(const QString &albumPath)
 {
     if (m_albumPath != albumPath) {
-        qDebug() << "Setting new album path:" << albumPath;
+        qCDebug(lcGallery) << "Setting new album path:" << albumPath;
         clear();
 
         m_albumPath = albumPath;
@@ -885,4 +884,64 @@ void PhotoModel::setAlbumPath(const QString &albumPath)
     }
 }
 
-void PhotoModel::refreshPhotos() { populatePhotoPaths(); }
\ No newline at end of file
+void PhotoModel::refreshPhotos() { populatePhotoPaths(); }
+
+void PhotoModel::setLibrary(std::shared_ptr<const PhotoLibrary> library)
+{
+    m_library = std::move(library);
+    if (m_albumPath.isEmpty()) {
+        return;
+    }
+
+    if (m_albumPath.startsWith(PhotoLibraryAlbumPrefix)) {
+        m_allPhotos.clear();
+        populateLibraryAlbum();
+        return;
+    }
+
+    // Replaces the stat based dates of photos listed before the index was
+    // ready
+    for (PhotoInfo &info : m_allPhotos) {
+        const PhotoLibraryAsset *asset =
+            m_library ? m_library->find(info.filePath) : nullptr;
+        if (asset && asset->created.isValid()) {
+            applyLibraryAsset(info, *asset);
+        }
+    }
+    applyFilterAndSort();
+}
+
+void PhotoModel::populateLibraryAlbum()
+{
+    const qint64 id = m_albumPath.section(':', 1).toLongLong();
+    const PhotoLibraryAlbum *album = m_library ? m_library->album(id) : nullptr;
+    if (!album) {
+        qCDebug(lcGallery) << "Album not in the Photos library:" << m_albumPath;
+    }
+
+    for (int index : album ? album->assets : QList<int>()) {
+        const PhotoLibraryAsset &asset = m_library->assets[index];
+        if (asset.trashed) {
+            continue;
+        }
+        PhotoInfo info;
+        info.filePath = asset.path;
+        info.fileName = asset.path.section('/', -1);
+        info.fileType = asset.video ? PhotoInfo::Video : PhotoInfo::Image;
+        applyLibraryAsset(info, asset);
+        m_allPhotos.append(info);
+    }
+
+    applyFilterAndSort();
+}
+
+void PhotoModel::applyLibraryAsset(PhotoInfo &info,
+                                   const PhotoLibraryAsset &asset)
+{
+    info.dateTime = asset.created;
+    info.width = asset.width;
+    info.height = asset.height;
+    info.favorite = asset.favorite;
+    info.livePhoto = asset.livePhoto;
+    info.screenshot = asset.screenshot;
+}
\ No newline at end of file
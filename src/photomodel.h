@@ -21,6 +21,7 @@
 #define PHOTOMODEL_H
 
 #include "iDescriptor.h"
+#include "photolibrary.h"
 #include <QAbstractListModel>
 #include <QCache>
 #include <QCryptographicHash>
@@ -30,6 +31,7 @@
 #include <QSemaphore>
 #include <QSize>
 #include <QStandardPaths>
+#include <memory>
 
 struct PhotoInfo {
     QString filePath;
@@ -39,6 +41,13 @@ struct PhotoInfo {
 
     enum FileType { Image, Video };
     FileType fileType;
+
+    // From the Photos library index, when there is one
+    int width = 0;
+    int height = 0;
+    bool favorite = false;
+    bool livePhoto = false;
+    bool screenshot = false;
 };
 
 class PhotoModel : public QAbstractListModel
@@ -48,7 +57,15 @@ class PhotoModel : public QAbstractListModel
 public:
     enum SortOrder { NewestFirst, OldestFirst };
 
-    enum FilterType { All, ImagesOnly, VideosOnly };
+    enum FilterType {
+        All,
+        ImagesOnly,
+        VideosOnly,
+        // Need the Photos library index, match nothing without it
+        FavoritesOnly,
+        LivePhotosOnly,
+        ScreenshotsOnly
+    };
 
     explicit PhotoModel(iDescriptorDevice *device, FilterType filterType,
                         QObject *parent = nullptr);
@@ -59,10 +76,14 @@ public:
     QVariant data(const QModelIndex &index,
                   int role = Qt::DisplayRole) const override;
 
-    // Album management
+    // Album management, paths starting with PhotoLibraryAlbumPrefix are
+    // albums from the Photos library instead of DCIM folders
     void setAlbumPath(const QString &albumPath);
     void refreshPhotos();
 
+    // Dates and metadata come from here instead of per-file stats
+    void setLibrary(std::shared_ptr<const PhotoLibrary> library);
+
     // Sorting and filtering
     void setSortOrder(SortOrder order);
     SortOrder sortOrder() const { return m_sortOrder; }
@@ -79,12 +100,16 @@ public:
     QStringList getAllFilePaths() const;
     QStringList getFilteredFilePaths() const;
 
-    static QPixmap loadImage(iDescriptorDevice *device,
-                             const QString &filePath);
-    // Static helper methods
-    static QPixmap loadThumbnailFromDevice(iDescriptorDevice *device,
-                                           const QString &filePath,
-                                           const QSize &size);
+    // Already decoded thumbnail, null if it isn't in the cache
+    QPixmap cachedThumbnail(const QString &filePath) const;
+
+    // Static helper methods, safe to run on worker threads. They return
+    // QImage, convert to QPixmap only once back on the GUI thread.
+    static QImage loadImage(iDescriptorDevice *device,
+                            const QString &filePath);
+    static QImage loadThumbnailFromDevice(iDescriptorDevice *device,
+                                          const QString &filePath,
+                                          const QSize &size);
     void clear();
 signals:
     void thumbnailNeedsToBeLoaded(int index);
@@ -99,11 +124,12 @@ private:
     QString m_albumPath;
     QList<PhotoInfo> m_allPhotos; // All photos from device
     QList<PhotoInfo> m_photos;    // Currently filtered/sorted photos
+    std::shared_ptr<const PhotoLibrary> m_library;
 
     // Thumbnail management
     QSize m_thumbnailSize;
     mutable QCache<QString, QPixmap> m_thumbnailCache;
-    mutable QHash<QString, QFutureWatcher<QPixmap> *> m_activeLoaders;
+    mutable QHash<QString, QFutureWatcher<QImage> *> m_activeLoaders;
     mutable QSet<QString> m_loadingPaths;
 
     // Sorting and filtering
@@ -112,6 +138,9 @@ private:
 
     // Helper methods
     void populatePhotoPaths();
+    void populateLibraryAlbum();
+    static void applyLibraryAsset(PhotoInfo &info,
+                                  const PhotoLibraryAsset &asset);
     void applyFilterAndSort();
     void sortPhotos(QList<PhotoInfo> &photos) const;
     bool matchesFilter(const PhotoInfo &info) const;
@@ -119,9 +148,9 @@ private:
     QDateTime extractDateTimeFromFile(const QString &filePath) const;
     PhotoInfo::FileType determineFileType(const QString &fileName) const;
 
-    static QPixmap generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
-                                                const QString &filePath,
-                                                const QSize &requestedSize);
+    static QImage generateVideoThumbnailFFmpeg(iDescriptorDevice *device,
+                                               const QString &filePath,
+                                               const QSize &requestedSize);
     static QSemaphore m_videoThumbnailSemaphore;
 };
 
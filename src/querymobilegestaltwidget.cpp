@@ -18,6 +18,7 @@
  */
 
 #include "querymobilegestaltwidget.h"
+#include "mobilegestaltcache.h"
 #include <QApplication>
 #include <QDebug>
 #include <QJsonDocument>
@@ -1133,34 +1134,6 @@ void QueryMobileGestaltWidget::displayResults(
 QMap<QString, QVariant>
 QueryMobileGestaltWidget::queryMobileGestalt(const QStringList &keys)
 {
-    char *xml = nullptr;
-    uint32_t xmlLength = 0;
-    bool res = query_mobile_gestalt(m_device, keys, xmlLength, xml);
-    if (!res) {
-        qDebug() << "MobileGestalt query failed.";
-        return {};
-    }
-    pugi::xml_document infoXml;
-    pugi::xml_parse_result result = infoXml.load_string(xml);
-    if (xml)
-        free(xml);
-
-    if (!result) {
-        qDebug() << "Failed to parse XML:" << result.description();
-        return {};
-    }
-    pugi::xml_node dictNode =
-        infoXml.child("plist").child("dict").child("key").next_sibling("dict");
-    if (!dictNode) {
-        qDebug() << "No MobileGestalt <dict> node found in XML.";
-        return {};
-    }
-    QMap<QString, QVariant> results;
-    for (const QString &key : keys) {
-        std::string value = safeGetXML(key.toStdString().c_str(), dictNode);
-        if (!value.empty()) {
-            results.insert(key, QString::fromStdString(value));
-        }
-    }
-    return results;
-}
\ No newline at end of file
+    // Only keys never asked before for this device and build hit the device
+    return MobileGestaltCache::sharedInstance()->query(m_device, keys);
+}
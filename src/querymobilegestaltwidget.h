@@ -73,7 +73,7 @@ private:
     QStringList mobileGestaltKeys;
     QList<QCheckBox *> keyCheckboxes;
 
-    // Mock query function for demonstration
+    // Served from MobileGestaltCache
     QMap<QString, QVariant> queryMobileGestalt(const QStringList &keys);
 };
 
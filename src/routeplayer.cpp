@@ -0,0 +1,286 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "routeplayer.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QXmlStreamReader>
+#include <algorithm>
+#include <cmath>
+
+RoutePlayer::RoutePlayer(iDescriptorDevice *device, QObject *parent)
+    : QThread(parent), m_device(device)
+{
+}
+
+RoutePlayer::~RoutePlayer()
+{
+    stop();
+    wait();
+}
+
+static void appendKmlCoordinates(const QString &text,
+                                 QList<QGeoCoordinate> &points)
+{
+    // "lon,lat[,alt]" tuples separated by whitespace
+    static const QRegularExpression whitespace("\\s+");
+    const QStringList tuples = text.split(whitespace, Qt::SkipEmptyParts);
+    for (const QString &tuple : tuples) {
+        const QStringList parts = tuple.split(',');
+        if (parts.size() < 2) {
+            continue;
+        }
+        QGeoCoordinate coord(parts[1].toDouble(), parts[0].toDouble());
+        if (coord.isValid()) {
+            points.append(coord);
+        }
+    }
+}
+
+QList<QGeoCoordinate> RoutePlayer::loadTrack(const QString &filePath,
+                                             QString *error)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = file.errorString();
+        return {};
+    }
+
+    QList<QGeoCoordinate> points;
+    QXmlStreamReader xml(&file);
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+
+        const QStringView name = xml.name();
+        if (name == u"trkpt" || name == u"rtept" || name == u"wpt") {
+            // GPX
+            const QXmlStreamAttributes attrs = xml.attributes();
+            QGeoCoordinate coord(attrs.value("lat").toDouble(),
+                                 attrs.value("lon").toDouble());
+            if (coord.isValid()) {
+                points.append(coord);
+            }
+        } else if (name == u"coordinates") {
+            // KML LineString / Point
+            appendKmlCoordinates(
+                xml.readElementText(QXmlStreamReader::SkipChildElements),
+                points);
+        } else if (name == u"coord") {
+            // KML gx:Track, "lon lat alt"
+            const QStringList parts =
+                xml.readElementText().split(' ', Qt::SkipEmptyParts);
+            if (parts.size() >= 2) {
+                QGeoCoordinate coord(parts[1].toDouble(),
+                                     parts[0].toDouble());
+                if (coord.isValid()) {
+                    points.append(coord);
+                }
+            }
+        }
+    }
+
+    if (xml.hasError()) {
+        if (error)
+            *error = xml.errorString();
+        return {};
+    }
+    if (points.isEmpty() && error) {
+        *error = "No track points found in " + QFileInfo(filePath).fileName();
+    }
+    return points;
+}
+
+void RoutePlayer::setRoute(const QList<QGeoCoordinate> &points)
+{
+    QMutexLocker locker(&m_mutex);
+    m_points.clear();
+    m_cumulative.clear();
+    m_points.reserve(points.size());
+    m_cumulative.reserve(points.size());
+
+    double total = 0;
+    for (const QGeoCoordinate &point : points) {
+        // Consecutive duplicates would make zero length segments
+        if (!m_points.isEmpty() && m_points.last() == point) {
+            continue;
+        }
+        if (!m_points.isEmpty()) {
+            total += m_points.last().distanceTo(point);
+        }
+        m_points.append(point);
+        m_cumulative.append(total);
+    }
+    m_distance = 0;
+}
+
+double RoutePlayer::routeLength() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cumulative.isEmpty() ? 0 : m_cumulative.last();
+}
+
+void RoutePlayer::setSpeed(double metersPerSecond)
+{
+    QMutexLocker locker(&m_mutex);
+    m_speed = qMax(0.0, metersPerSecond);
+}
+
+void RoutePlayer::setUpdateRate(int hz)
+{
+    QMutexLocker locker(&m_mutex);
+    m_updateRate = qBound(1, hz, 50);
+    m_waitCondition.wakeAll();
+}
+
+void RoutePlayer::setLoop(bool loop)
+{
+    QMutexLocker locker(&m_mutex);
+    m_loop = loop;
+}
+
+void RoutePlayer::setPaused(bool paused)
+{
+    QMutexLocker locker(&m_mutex);
+    m_paused = paused;
+    m_waitCondition.wakeAll();
+}
+
+bool RoutePlayer::isPaused() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_paused;
+}
+
+void RoutePlayer::seek(double fraction)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_cumulative.isEmpty()) {
+        return;
+    }
+    m_distance = qBound(0.0, fraction, 1.0) * m_cumulative.last();
+    m_waitCondition.wakeAll();
+}
+
+void RoutePlayer::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_shouldStop = true;
+    m_waitCondition.wakeAll();
+}
+
+// Callers hold m_mutex
+QGeoCoordinate RoutePlayer::positionAt(double distance) const
+{
+    if (m_points.size() == 1 || distance <= 0) {
+        return m_points.first();
+    }
+    if (distance >= m_cumulative.last()) {
+        return m_points.last();
+    }
+
+    // First point past the distance, the segment ends there
+    const auto it = std::upper_bound(m_cumulative.cbegin(),
+                                     m_cumulative.cend(), distance);
+    const int end = static_cast<int>(it - m_cumulative.cbegin());
+    const QGeoCoordinate &a = m_points[end - 1];
+    const QGeoCoordinate &b = m_points[end];
+    const double t = (distance - m_cumulative[end - 1]) /
+                     (m_cumulative[end] - m_cumulative[end - 1]);
+
+    // Segments are short, linear interpolation is accurate enough
+    return QGeoCoordinate(a.latitude() + (b.latitude() - a.latitude()) * t,
+                          a.longitude() + (b.longitude() - a.longitude()) * t);
+}
+
+void RoutePlayer::run()
+{
+    service_client_t service = nullptr;
+    {
+        std::lock_guard<std::recursive_mutex> lock(*m_device->mutex);
+        service = location_session_open(m_device->device);
+    }
+    if (!service) {
+        emit playbackError("Could not start the location simulation service. "
+                           "Is the developer disk image mounted?");
+        return;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    qint64 lastTick = clock.elapsed();
+
+    QMutexLocker locker(&m_mutex);
+    while (!m_shouldStop && !m_points.isEmpty()) {
+        // Advance by real elapsed time so slow sends don't slow the route
+        const qint64 now = clock.elapsed();
+        if (!m_paused) {
+            m_distance += m_speed * (now - lastTick) / 1000.0;
+        }
+        lastTick = now;
+
+        const double length = m_cumulative.last();
+        bool finished = false;
+        if (m_distance >= length) {
+            if (m_loop && length > 0) {
+                m_distance = std::fmod(m_distance, length);
+            } else {
+                m_distance = length;
+                finished = true;
+            }
+        }
+
+        const QGeoCoordinate position = positionAt(m_distance);
+        const double progress = length > 0 ? m_distance / length : 1.0;
+        const bool paused = m_paused;
+        const int interval = 1000 / m_updateRate;
+        locker.unlock();
+
+        if (!paused || finished) {
+            if (!location_session_send(service, position.latitude(),
+                                       position.longitude())) {
+                emit playbackError("Lost connection to the location "
+                                   "simulation service.");
+                break;
+            }
+            emit positionChanged(position.latitude(), position.longitude(),
+                                 progress);
+        }
+
+        if (finished) {
+            emit playbackFinished();
+            break;
+        }
+
+        locker.relock();
+        if (m_shouldStop) {
+            break;
+        }
+        m_waitCondition.wait(&m_mutex, interval);
+    }
+
+    // The last position stays on the device after the service goes away
+    location_session_close(service);
+}
@@ -0,0 +1,97 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef ROUTEPLAYER_H
+#define ROUTEPLAYER_H
+
+#include "iDescriptor.h"
+#include <QGeoCoordinate>
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+/**
+ * @brief Streams an interpolated route to the device's simulated location
+ *
+ * Positions are interpolated along the track at the configured speed and
+ * sent at the configured rate over one com.apple.dt.simulatelocation
+ * connection that stays open for the whole playback, instead of a
+ * lockdown handshake per point. Playback can be paused, seeked and looped
+ * while it runs, all setters are thread safe.
+ */
+class RoutePlayer : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit RoutePlayer(iDescriptorDevice *device, QObject *parent = nullptr);
+    ~RoutePlayer() override;
+
+    /**
+     * @brief Reads track points from a GPX (trkpt/rtept/wpt) or KML
+     * (LineString coordinates, gx:Track) file
+     * @return Empty list and error set on failure
+     */
+    static QList<QGeoCoordinate> loadTrack(const QString &filePath,
+                                           QString *error = nullptr);
+
+    void setRoute(const QList<QGeoCoordinate> &points);
+    double routeLength() const; // meters
+
+    void setSpeed(double metersPerSecond);
+    void setUpdateRate(int hz);
+    void setLoop(bool loop);
+
+    void setPaused(bool paused);
+    bool isPaused() const;
+    // 0.0 is the start of the route, 1.0 the end
+    void seek(double fraction);
+
+    void stop();
+
+signals:
+    void positionChanged(double latitude, double longitude, double progress);
+    void playbackFinished();
+    void playbackError(const QString &message);
+
+protected:
+    void run() override;
+
+private:
+    QGeoCoordinate positionAt(double distance) const;
+
+    iDescriptorDevice *m_device;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_waitCondition;
+    bool m_shouldStop = false;
+    bool m_paused = false;
+    bool m_loop = false;
+    double m_speed = 1.4; // walking pace
+    int m_updateRate = 10;
+    double m_distance = 0; // meters travelled along the route
+
+    QVector<QGeoCoordinate> m_points;
+    // m_cumulative[i] is the distance from the start to m_points[i]
+    QVector<double> m_cumulative;
+};
+
+#endif // ROUTEPLAYER_H
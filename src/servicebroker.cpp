@@ -0,0 +1,559 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "servicebroker.h"
+#include "appcontext.h"
+#include "loggingcategories.h"
+#include "tracer.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QMutexLocker>
+
+namespace
+{
+// A session nobody used for this long is closed by the sweep
+constexpr qint64 LockdownIdleMs = 120 * 1000;
+// A session idle for this long is checked before it is trusted again
+constexpr qint64 LockdownProbeMs = 10 * 1000;
+constexpr int SweepIntervalMs = 5000;
+
+// Errors that mean the session itself is gone, not that the request failed
+bool isSessionError(lockdownd_error_t err)
+{
+    switch (err) {
+    case LOCKDOWN_E_SESSION_INACTIVE:
+    case LOCKDOWN_E_NO_RUNNING_SESSION:
+    case LOCKDOWN_E_MUX_ERROR:
+    case LOCKDOWN_E_SSL_ERROR:
+    case LOCKDOWN_E_RECEIVE_TIMEOUT:
+    case LOCKDOWN_E_PLIST_ERROR:
+    case LOCKDOWN_E_NOT_ENOUGH_DATA:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+ The device refused the request because of the session, so it never ran
+ and can be sent again. Connection errors may hit after the request went
+ out and would replay things like enter_recovery.
+*/
+bool isSessionRejected(lockdownd_error_t err)
+{
+    return err == LOCKDOWN_E_SESSION_INACTIVE ||
+           err == LOCKDOWN_E_NO_RUNNING_SESSION;
+}
+} // namespace
+
+ServiceBrokerStats &
+ServiceBrokerStats::operator+=(const ServiceBrokerStats &other)
+{
+    handshakes += other.handshakes;
+    reconnects += other.reconnects;
+    serviceStarts += other.serviceStarts;
+    cacheHits += other.cacheHits;
+    cacheMisses += other.cacheMisses;
+    return *this;
+}
+
+ServiceBroker *ServiceBroker::sharedInstance()
+{
+    static ServiceBroker instance;
+    return &instance;
+}
+
+ServiceBroker::ServiceBroker(QObject *parent) : QObject(parent)
+{
+    m_sweepTimer = new QTimer(this);
+    m_sweepTimer->setInterval(SweepIntervalMs);
+    connect(m_sweepTimer, &QTimer::timeout, this, &ServiceBroker::sweep);
+
+    // First use may come from a worker thread, the sweep timer needs the
+    // GUI event loop. The timer moves along with its parent.
+    if (QCoreApplication::instance()) {
+        moveToThread(QCoreApplication::instance()->thread());
+    }
+    QMetaObject::invokeMethod(
+        this, [this]() { m_sweepTimer->start(); }, Qt::QueuedConnection);
+
+    // Emitted before the device is freed, has to run synchronously
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            &ServiceBroker::onDeviceRemoved, Qt::DirectConnection);
+}
+
+ServiceBroker::~ServiceBroker()
+{
+    const auto entries = m_entries.values();
+    for (const auto &entry : entries) {
+        dropEntry(entry);
+    }
+}
+
+QString ServiceBroker::serviceName(BrokerService service)
+{
+    switch (service) {
+    case BrokerService::InstallationProxy:
+        return "installation_proxy";
+    case BrokerService::DiagnosticsRelay:
+        return "diagnostics_relay";
+    case BrokerService::ImageMounter:
+        return "mobile_image_mounter";
+    case BrokerService::Screenshot:
+        return "screenshotr";
+    }
+    return QString();
+}
+
+// Installation proxy keeps its connection well, screenshotr is the first
+// to be dropped by the device
+qint64 ServiceBroker::ttlMs(BrokerService service)
+{
+    switch (service) {
+    case BrokerService::InstallationProxy:
+        return 60 * 1000;
+    case BrokerService::DiagnosticsRelay:
+    case BrokerService::ImageMounter:
+        return 30 * 1000;
+    case BrokerService::Screenshot:
+        return 15 * 1000;
+    }
+    return 0;
+}
+
+std::shared_ptr<ServiceBroker::Entry> ServiceBroker::entryFor(idevice_t device)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(device);
+    if (it != m_entries.constEnd()) {
+        return it.value();
+    }
+    if (m_removedHandles.contains(device)) {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<Entry>();
+    char *udid = nullptr;
+    if (idevice_get_udid(device, &udid) == IDEVICE_E_SUCCESS && udid) {
+        entry->udid = udid;
+        free(udid);
+    }
+    m_entries.insert(device, entry);
+    return entry;
+}
+
+void ServiceBroker::count(Entry &entry, quint64 ServiceBrokerStats::*field)
+{
+    QMutexLocker locker(&m_mutex);
+    ++(entry.stats.*field);
+}
+
+lockdownd_error_t ServiceBroker::withLockdown(
+    idevice_t device,
+    const std::function<lockdownd_error_t(lockdownd_client_t)> &fn)
+{
+    if (!device) {
+        return LOCKDOWN_E_INVALID_ARG;
+    }
+    std::shared_ptr<Entry> entry = entryFor(device);
+    if (!entry) {
+        return LOCKDOWN_E_MUX_ERROR;
+    }
+    return withSession(device, entry, fn);
+}
+
+lockdownd_error_t ServiceBroker::withSession(
+    idevice_t device, const std::shared_ptr<Entry> &entry,
+    const std::function<lockdownd_error_t(lockdownd_client_t)> &fn)
+{
+    QMutexLocker locker(&entry->lockdownMutex);
+    if (entry->removed) {
+        return LOCKDOWN_E_MUX_ERROR;
+    }
+
+    // Catch a session dropped while idle (sleep, timeout) with a harmless
+    // request, fn itself is only retried if it provably didn't run
+    const qint64 idleMs =
+        QDateTime::currentMSecsSinceEpoch() - entry->lockdownLastUsed;
+    if (entry->lockdown && idleMs > LockdownProbeMs) {
+        const lockdownd_error_t probe =
+            lockdownd_query_type(entry->lockdown, nullptr);
+        if (isSessionError(probe)) {
+            qCDebug(lcLockdown)
+                << "Idle lockdown session lost for"
+                << QString::fromStdString(entry->udid) << probe;
+            lockdownd_client_free(entry->lockdown);
+            entry->lockdown = nullptr;
+            count(*entry, &ServiceBrokerStats::reconnects);
+        }
+    }
+
+    lockdownd_error_t err = LOCKDOWN_E_UNKNOWN_ERROR;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (!entry->lockdown) {
+            TraceSpan span("lockdown", "handshake", entry->udid.c_str());
+            err = lockdownd_client_new_with_handshake(
+                device, &entry->lockdown, APP_LABEL);
+            count(*entry, &ServiceBrokerStats::handshakes);
+            if (err != LOCKDOWN_E_SUCCESS) {
+                qCDebug(lcLockdown)
+                    << "Lockdown handshake failed for"
+                    << QString::fromStdString(entry->udid) << err;
+                entry->lockdown = nullptr;
+                return err;
+            }
+        }
+
+        err = fn(entry->lockdown);
+        entry->lockdownLastUsed = QDateTime::currentMSecsSinceEpoch();
+        if (!isSessionError(err)) {
+            break;
+        }
+
+        // The device dropped the session, the next call reconnects
+        qCDebug(lcLockdown) << "Lockdown session lost for"
+                            << QString::fromStdString(entry->udid) << err;
+        lockdownd_client_free(entry->lockdown);
+        entry->lockdown = nullptr;
+        count(*entry, &ServiceBrokerStats::reconnects);
+        if (!isSessionRejected(err) || attempt > 0) {
+            break;
+        }
+    }
+    return err;
+}
+
+lockdownd_error_t
+ServiceBroker::startService(idevice_t device, const char *name,
+                            lockdownd_service_descriptor_t *service)
+{
+    if (!device) {
+        return LOCKDOWN_E_INVALID_ARG;
+    }
+
+    std::shared_ptr<Entry> entry = entryFor(device);
+    if (!entry) {
+        return LOCKDOWN_E_MUX_ERROR;
+    }
+    return withSession(device, entry, [&](lockdownd_client_t client) {
+        TraceSpan span("lockdown", "start_service", entry->udid.c_str());
+        span.setDetail(name);
+        count(*entry, &ServiceBrokerStats::serviceStarts);
+        return lockdownd_start_service(client, name, service);
+    });
+}
+
+void *ServiceBroker::acquireClient(idevice_t device, BrokerService service,
+                                   bool fresh)
+{
+    if (!device) {
+        return nullptr;
+    }
+
+    std::shared_ptr<Entry> entry = entryFor(device);
+    if (!entry) {
+        return nullptr;
+    }
+    if (!fresh) {
+        QMutexLocker locker(&m_mutex);
+        QList<IdleClient> &idle = entry->idle[static_cast<int>(service)];
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        // Newest first, older ones are the likeliest to have gone stale
+        while (!idle.isEmpty()) {
+            IdleClient candidate = idle.takeLast();
+            if (candidate.expiresAt > now) {
+                ++entry->stats.cacheHits;
+                return candidate.client;
+            }
+            locker.unlock();
+            freeClient(service, candidate.client);
+            locker.relock();
+        }
+        ++entry->stats.cacheMisses;
+    }
+
+    void *client = connectClient(device, service);
+    if (!client) {
+        qCDebug(lcLockdown) << "Could not connect" << serviceName(service)
+                            << "for" << QString::fromStdString(entry->udid);
+    }
+    return client;
+}
+
+void *ServiceBroker::connectClient(idevice_t device, BrokerService service)
+{
+    const char *name = nullptr;
+    switch (service) {
+    case BrokerService::InstallationProxy:
+        name = INSTPROXY_SERVICE_NAME;
+        break;
+    case BrokerService::DiagnosticsRelay:
+        name = DIAGNOSTICS_RELAY_SERVICE_NAME;
+        break;
+    case BrokerService::ImageMounter:
+        name = MOBILE_IMAGE_MOUNTER_SERVICE_NAME;
+        break;
+    case BrokerService::Screenshot:
+        name = SCREENSHOTR_SERVICE_NAME;
+        break;
+    }
+
+    lockdownd_service_descriptor_t descriptor = nullptr;
+    lockdownd_error_t err = startService(device, name, &descriptor);
+    if (err == LOCKDOWN_E_INVALID_SERVICE &&
+        service == BrokerService::DiagnosticsRelay) {
+        // Pre iOS 5 name
+        err = startService(device, "com.apple.iosdiagnostics.relay",
+                           &descriptor);
+    }
+    if (err != LOCKDOWN_E_SUCCESS || !descriptor || descriptor->port == 0) {
+        if (descriptor) {
+            lockdownd_service_descriptor_free(descriptor);
+        }
+        return nullptr;
+    }
+
+    void *client = nullptr;
+    bool ok = false;
+    switch (service) {
+    case BrokerService::InstallationProxy: {
+        instproxy_client_t c = nullptr;
+        ok = instproxy_client_new(device, descriptor, &c) ==
+             INSTPROXY_E_SUCCESS;
+        client = c;
+        break;
+    }
+    case BrokerService::DiagnosticsRelay: {
+        diagnostics_relay_client_t c = nullptr;
+        ok = diagnostics_relay_client_new(device, descriptor, &c) ==
+             DIAGNOSTICS_RELAY_E_SUCCESS;
+        client = c;
+        break;
+    }
+    case BrokerService::ImageMounter: {
+        mobile_image_mounter_client_t c = nullptr;
+        ok = mobile_image_mounter_new(device, descriptor, &c) ==
+             MOBILE_IMAGE_MOUNTER_E_SUCCESS;
+        client = c;
+        break;
+    }
+    case BrokerService::Screenshot: {
+        screenshotr_client_t c = nullptr;
+        ok = screenshotr_client_new(device, descriptor, &c) ==
+             SCREENSHOTR_E_SUCCESS;
+        client = c;
+        break;
+    }
+    }
+    lockdownd_service_descriptor_free(descriptor);
+    return ok ? client : nullptr;
+}
+
+void ServiceBroker::freeClient(BrokerService service, void *client)
+{
+    if (!client) {
+        return;
+    }
+
+    switch (service) {
+    case BrokerService::InstallationProxy:
+        instproxy_client_free(static_cast<instproxy_client_t>(client));
+        break;
+    case BrokerService::DiagnosticsRelay: {
+        auto c = static_cast<diagnostics_relay_client_t>(client);
+        diagnostics_relay_goodbye(c);
+        diagnostics_relay_client_free(c);
+        break;
+    }
+    case BrokerService::ImageMounter: {
+        auto c = static_cast<mobile_image_mounter_client_t>(client);
+        mobile_image_mounter_hangup(c);
+        mobile_image_mounter_free(c);
+        break;
+    }
+    case BrokerService::Screenshot:
+        screenshotr_client_free(static_cast<screenshotr_client_t>(client));
+        break;
+    }
+}
+
+void ServiceBroker::releaseClient(idevice_t device, BrokerService service,
+                                  void *client, bool reusable)
+{
+    if (!client) {
+        return;
+    }
+
+    if (reusable) {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.constFind(device);
+        if (it != m_entries.constEnd()) {
+            QList<IdleClient> &idle =
+                it.value()->idle[static_cast<int>(service)];
+            if (idle.size() < MaxIdlePerService) {
+                idle.append({client, QDateTime::currentMSecsSinceEpoch() +
+                                         ttlMs(service)});
+                return;
+            }
+        }
+    }
+    freeClient(service, client);
+}
+
+// Frees the session and every idle client, waits for a caller that is
+// still using the session
+void ServiceBroker::dropEntry(const std::shared_ptr<Entry> &entry)
+{
+    QList<IdleClient> idle[ServiceCount];
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < ServiceCount; ++i) {
+            idle[i].swap(entry->idle[i]);
+        }
+        m_removedStats += entry->stats;
+        entry->stats = ServiceBrokerStats();
+    }
+    for (int i = 0; i < ServiceCount; ++i) {
+        for (const IdleClient &c : idle[i]) {
+            freeClient(static_cast<BrokerService>(i), c.client);
+        }
+    }
+
+    QMutexLocker locker(&entry->lockdownMutex);
+    entry->removed = true;
+    if (entry->lockdown) {
+        lockdownd_client_free(entry->lockdown);
+        entry->lockdown = nullptr;
+    }
+}
+
+void ServiceBroker::registerDevice(idevice_t device)
+{
+    QMutexLocker locker(&m_mutex);
+    m_removedHandles.remove(device);
+}
+
+void ServiceBroker::forgetDevice(idevice_t device)
+{
+    std::shared_ptr<Entry> entry;
+    {
+        QMutexLocker locker(&m_mutex);
+        entry = m_entries.take(device);
+        m_removedHandles.insert(device);
+    }
+    if (entry) {
+        dropEntry(entry);
+    }
+}
+
+void ServiceBroker::onDeviceRemoved(const std::string &udid)
+{
+    std::shared_ptr<Entry> entry;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it.value()->udid == udid) {
+                entry = it.value();
+                m_removedHandles.insert(it.key());
+                m_entries.erase(it);
+                break;
+            }
+        }
+    }
+    if (!entry) {
+        return;
+    }
+
+    const ServiceBrokerStats s = stats(*entry);
+    qCDebug(lcLockdown) << "Broker for" << QString::fromStdString(udid)
+                        << "handshakes:" << s.handshakes
+                        << "service starts:" << s.serviceStarts
+                        << "hits:" << s.cacheHits
+                        << "misses:" << s.cacheMisses;
+    dropEntry(entry);
+}
+
+void ServiceBroker::sweep()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<QPair<BrokerService, void *>> expired;
+    QList<std::shared_ptr<Entry>> idleSessions;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (const auto &entry : std::as_const(m_entries)) {
+            for (int i = 0; i < ServiceCount; ++i) {
+                QList<IdleClient> &idle = entry->idle[i];
+                for (auto it = idle.begin(); it != idle.end();) {
+                    if (it->expiresAt <= now) {
+                        expired.append({static_cast<BrokerService>(i),
+                                        it->client});
+                        it = idle.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+            }
+            idleSessions.append(entry);
+        }
+    }
+
+    for (const auto &c : expired) {
+        freeClient(c.first, c.second);
+    }
+
+    // Never wait here, a session that is busy is obviously not idle
+    for (const auto &entry : idleSessions) {
+        if (!entry->lockdownMutex.tryLock()) {
+            continue;
+        }
+        if (entry->lockdown &&
+            now - entry->lockdownLastUsed > LockdownIdleMs) {
+            lockdownd_client_free(entry->lockdown);
+            entry->lockdown = nullptr;
+        }
+        entry->lockdownMutex.unlock();
+    }
+}
+
+ServiceBrokerStats ServiceBroker::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    ServiceBrokerStats total = m_removedStats;
+    for (const auto &entry : m_entries) {
+        total += entry->stats;
+    }
+    return total;
+}
+
+ServiceBrokerStats ServiceBroker::stats(const Entry &entry) const
+{
+    QMutexLocker locker(&m_mutex);
+    return entry.stats;
+}
+
+ServiceBrokerStats ServiceBroker::stats(const std::string &udid) const
+{
+    QMutexLocker locker(&m_mutex);
+    for (const auto &entry : m_entries) {
+        if (entry->udid == udid) {
+            return entry->stats;
+        }
+    }
+    return ServiceBrokerStats();
+}
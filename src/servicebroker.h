@@ -0,0 +1,216 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVICEBROKER_H
+#define SERVICEBROKER_H
+
+#include "iDescriptor.h"
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QTimer>
+#include <functional>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Lockdown/service counters, totals or for one device
+ */
+struct ServiceBrokerStats {
+    quint64 handshakes = 0;    // lockdown TLS sessions opened
+    quint64 reconnects = 0;    // sessions dropped and reopened mid-call
+    quint64 serviceStarts = 0; // lockdownd_start_service round trips
+    quint64 cacheHits = 0;     // clients handed out from the idle pool
+    quint64 cacheMisses = 0;   // clients that needed a new connection
+
+    ServiceBrokerStats &operator+=(const ServiceBrokerStats &other);
+};
+
+// Long-lived clients the broker keeps around between uses
+enum class BrokerService {
+    InstallationProxy,
+    DiagnosticsRelay,
+    ImageMounter,
+    Screenshot
+};
+
+template <typename Client> struct BrokerServiceOf;
+template <> struct BrokerServiceOf<instproxy_client_t> {
+    static constexpr BrokerService value = BrokerService::InstallationProxy;
+};
+template <> struct BrokerServiceOf<diagnostics_relay_client_t> {
+    static constexpr BrokerService value = BrokerService::DiagnosticsRelay;
+};
+template <> struct BrokerServiceOf<mobile_image_mounter_client_t> {
+    static constexpr BrokerService value = BrokerService::ImageMounter;
+};
+template <> struct BrokerServiceOf<screenshotr_client_t> {
+    static constexpr BrokerService value = BrokerService::Screenshot;
+};
+
+/**
+ * @brief Per-device lockdown session and service client broker
+ *
+ * Keeps one authenticated lockdown session per device instead of doing a
+ * full TLS handshake for every service start, and reopens it when the
+ * device dropped it. Clients of the services in BrokerService go back to a
+ * small idle pool when released and are reused until their TTL runs out.
+ * Everything a device owns is freed from deviceRemoved(), before the
+ * idevice_t goes away. Calls with a removed handle fail until it is
+ * registered again.
+ *
+ * Callers never free the device. Acquired clients are plain clients, a
+ * caller that keeps one for good may free it itself instead of releasing
+ * it, but never after the device is removed.
+ */
+class ServiceBroker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ServiceBroker *sharedInstance();
+
+    // Starts a service over the shared session, the caller frees service
+    lockdownd_error_t startService(idevice_t device, const char *name,
+                                   lockdownd_service_descriptor_t *service);
+
+    // Runs fn with the shared session held, for get_value and friends
+    lockdownd_error_t
+    withLockdown(idevice_t device,
+                 const std::function<lockdownd_error_t(lockdownd_client_t)>
+                     &fn);
+
+    // An idle client if one is cached, a new one otherwise, null on error
+    template <typename Client> Client acquire(idevice_t device)
+    {
+        return static_cast<Client>(
+            acquireClient(device, BrokerServiceOf<Client>::value, false));
+    }
+
+    // Always a new connection, for reconnects that need fresh server state
+    template <typename Client> Client acquireFresh(idevice_t device)
+    {
+        return static_cast<Client>(
+            acquireClient(device, BrokerServiceOf<Client>::value, true));
+    }
+
+    // Pass reusable = false if the client failed or the device is going
+    // away, it's freed instead of going back to the pool
+    template <typename Client>
+    void release(idevice_t device, Client client, bool reusable = true)
+    {
+        releaseClient(device, BrokerServiceOf<Client>::value, client,
+                      reusable);
+    }
+
+    // A handle fresh from idevice_new, may reuse a removed handle's address
+    void registerDevice(idevice_t device);
+    // Drops everything for a handle that is about to be freed
+    void forgetDevice(idevice_t device);
+
+    ServiceBrokerStats stats() const;
+    ServiceBrokerStats stats(const std::string &udid) const;
+
+    static QString serviceName(BrokerService service);
+
+private:
+    explicit ServiceBroker(QObject *parent = nullptr);
+    ~ServiceBroker();
+
+    static constexpr int ServiceCount = 4;
+    static constexpr int MaxIdlePerService = 2;
+
+    struct IdleClient {
+        void *client = nullptr;
+        qint64 expiresAt = 0;
+    };
+
+    struct Entry {
+        std::string udid;
+        QMutex lockdownMutex; // held while the session is in use
+        lockdownd_client_t lockdown = nullptr;
+        qint64 lockdownLastUsed = 0;
+        bool removed = false;
+        QList<IdleClient> idle[ServiceCount];
+        ServiceBrokerStats stats;
+    };
+
+    std::shared_ptr<Entry> entryFor(idevice_t device);
+    lockdownd_error_t
+    withSession(idevice_t device, const std::shared_ptr<Entry> &entry,
+                const std::function<lockdownd_error_t(lockdownd_client_t)>
+                    &fn);
+    ServiceBrokerStats stats(const Entry &entry) const;
+    void count(Entry &entry, quint64 ServiceBrokerStats::*field);
+    void *acquireClient(idevice_t device, BrokerService service, bool fresh);
+    void releaseClient(idevice_t device, BrokerService service, void *client,
+                       bool reusable);
+    void *connectClient(idevice_t device, BrokerService service);
+    static void freeClient(BrokerService service, void *client);
+    static qint64 ttlMs(BrokerService service);
+
+    void dropEntry(const std::shared_ptr<Entry> &entry);
+    void onDeviceRemoved(const std::string &udid);
+    void sweep();
+
+    mutable QMutex m_mutex; // guards m_entries, idle pools and stats
+    QMap<idevice_t, std::shared_ptr<Entry>> m_entries;
+    // Removed handles, late callers must not recreate an entry for them
+    QSet<idevice_t> m_removedHandles;
+    ServiceBrokerStats m_removedStats; // devices that already left
+    QTimer *m_sweepTimer;
+};
+
+/**
+ * @brief Scoped broker client, released back to the pool when it goes
+ * out of scope
+ */
+template <typename Client> class ServiceLease
+{
+public:
+    explicit ServiceLease(idevice_t device)
+        : m_device(device),
+          m_client(ServiceBroker::sharedInstance()->acquire<Client>(device))
+    {
+    }
+    ~ServiceLease()
+    {
+        if (m_client) {
+            ServiceBroker::sharedInstance()->release<Client>(
+                m_device, m_client, m_reusable);
+        }
+    }
+    ServiceLease(const ServiceLease &) = delete;
+    ServiceLease &operator=(const ServiceLease &) = delete;
+
+    Client get() const { return m_client; }
+    explicit operator bool() const { return m_client != nullptr; }
+
+    // The client errored or the device will disconnect, don't pool it
+    void invalidate() { m_reusable = false; }
+
+private:
+    idevice_t m_device;
+    Client m_client;
+    bool m_reusable = true;
+};
+
+#endif // SERVICEBROKER_H
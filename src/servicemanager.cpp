@@ -29,7 +29,7 @@ ServiceManager::safeAfcReadDirectory(iDescriptorDevice *device,
         [path, dirs](afc_client_t client) {
             return afc_read_directory(client, path, dirs);
         },
-        altAfc);
+        altAfc, DeviceOperation::ReadDirectory);
 }
 
 afc_error_t
@@ -42,7 +42,7 @@ ServiceManager::safeAfcGetFileInfo(iDescriptorDevice *device, const char *path,
         [path, info](afc_client_t client) {
             return afc_get_file_info(client, path, info);
         },
-        altAfc);
+        altAfc, DeviceOperation::GetFileInfo);
 }
 
 afc_error_t
@@ -55,7 +55,7 @@ ServiceManager::safeAfcGetFileInfoPlist(iDescriptorDevice *device,
         [path, info](afc_client_t client) {
             return afc_get_file_info_plist(client, path, info);
         },
-        altAfc);
+        altAfc, DeviceOperation::GetFileInfo);
 }
 
 afc_error_t ServiceManager::safeAfcFileOpen(iDescriptorDevice *device,
@@ -69,7 +69,7 @@ afc_error_t ServiceManager::safeAfcFileOpen(iDescriptorDevice *device,
         [path, mode, handle](afc_client_t client) {
             return afc_file_open(client, path, mode, handle);
         },
-        altAfc);
+        altAfc, DeviceOperation::Open);
 }
 
 afc_error_t ServiceManager::safeAfcFileRead(iDescriptorDevice *device,
@@ -83,7 +83,7 @@ afc_error_t ServiceManager::safeAfcFileRead(iDescriptorDevice *device,
         [handle, data, length, bytes_read](afc_client_t client) {
             return afc_file_read(client, handle, data, length, bytes_read);
         },
-        altAfc);
+        altAfc, DeviceOperation::Read, bytes_read);
 }
 
 afc_error_t ServiceManager::safeAfcFileWrite(iDescriptorDevice *device,
@@ -97,7 +97,7 @@ afc_error_t ServiceManager::safeAfcFileWrite(iDescriptorDevice *device,
         [handle, data, length, bytes_written](afc_client_t client) {
             return afc_file_write(client, handle, data, length, bytes_written);
         },
-        altAfc);
+        altAfc, DeviceOperation::Write, bytes_written);
 }
 
 afc_error_t ServiceManager::safeAfcFileClose(iDescriptorDevice *device,
@@ -109,7 +109,7 @@ afc_error_t ServiceManager::safeAfcFileClose(iDescriptorDevice *device,
         [handle](afc_client_t client) {
             return afc_file_close(client, handle);
         },
-        altAfc);
+        altAfc, DeviceOperation::Close);
 }
 
 afc_error_t ServiceManager::safeAfcFileSeek(iDescriptorDevice *device,
@@ -122,7 +122,7 @@ afc_error_t ServiceManager::safeAfcFileSeek(iDescriptorDevice *device,
         [handle, offset, whence](afc_client_t client) {
             return afc_file_seek(client, handle, offset, whence);
         },
-        altAfc);
+        altAfc, DeviceOperation::Seek);
 }
 
 afc_error_t ServiceManager::safeAfcFileTell(iDescriptorDevice *device,
@@ -134,7 +134,7 @@ afc_error_t ServiceManager::safeAfcFileTell(iDescriptorDevice *device,
         [handle, position](afc_client_t client) {
             return afc_file_tell(client, handle, position);
         },
-        altAfc);
+        altAfc, DeviceOperation::Tell);
 }
 
 QByteArray
@@ -147,7 +147,7 @@ ServiceManager::safeReadAfcFileToByteArray(iDescriptorDevice *device,
         [path](afc_client_t client) -> QByteArray {
             return read_afc_file_to_byte_array(client, path);
         },
-        altAfc);
+        altAfc, DeviceOperation::ReadFile);
 }
 
 AFCFileTree ServiceManager::safeGetFileTree(iDescriptorDevice *device,
@@ -159,5 +159,5 @@ AFCFileTree ServiceManager::safeGetFileTree(iDescriptorDevice *device,
         [path](afc_client_t client) -> AFCFileTree {
             return get_file_tree(client, path.c_str());
         },
-        altAfc);
+        altAfc, DeviceOperation::FileTree);
 }
\ No newline at end of file
@@ -21,11 +21,15 @@
 #define SERVICEMANAGER_H
 
 #include "iDescriptor.h"
+#include "loggingcategories.h"
+#include "operationstats.h"
+#include "tracer.h"
 #include <QDebug>
 #include <functional>
 #include <libimobiledevice/afc.h>
 #include <mutex>
 #include <optional>
+#include <type_traits>
 
 /**
  * @brief Centralized manager for device service operations with thread safety
@@ -34,6 +38,10 @@
  * crashes when devices are unplugged during active operations. It uses a
  * per-device recursive mutex to ensure that device cleanup waits for all
  * operations to complete.
+ *
+ * When OperationStats is enabled, every wrapper records how long it waited
+ * for the device mutex separately from the time spent in the call itself.
+ * AFC calls also show up as "afc" spans when Tracer is enabled.
  */
 class ServiceManager
 {
@@ -41,13 +49,17 @@ public:
     template <typename T>
     static T executeOperation(iDescriptorDevice *device,
                               std::function<T(afc_client_t)> operation,
-                              std::optional<afc_client_t> altAfc = std::nullopt)
+                              std::optional<afc_client_t> altAfc = std::nullopt,
+                              DeviceOperation type = DeviceOperation::Other)
     {
         if (!device || !device->mutex) {
             return T{}; // Return default-constructed value for the type
         }
 
+        TraceSpan trace("afc", OperationStats::operationName(type), device);
+        OperationStats::Scope stats(device, type);
         std::lock_guard<std::recursive_mutex> lock(*device->mutex);
+        stats.lockAcquired();
 
         // Double-check device is still valid after acquiring lock
         if (!device->afcClient) {
@@ -62,7 +74,11 @@ public:
 
         // Determine which client to use
         afc_client_t client = altAfc ? *altAfc : device->afcClient;
-        return operation(client);
+        T result = operation(client);
+        if constexpr (std::is_same_v<T, QByteArray>) {
+            stats.addBytes(result.size());
+        }
+        return result;
     }
 
     template <typename T>
@@ -74,7 +90,9 @@ public:
             return T{}; // Return default-constructed value for the type
         }
 
+        OperationStats::Scope stats(device, DeviceOperation::Other);
         std::lock_guard<std::recursive_mutex> lock(*device->mutex);
+        stats.lockAcquired();
 
         // Double-check device is still valid after acquiring lock
         if (!device->afcClient) {
@@ -98,7 +116,9 @@ public:
             return failureValue;
         }
 
+        OperationStats::Scope stats(device, DeviceOperation::Other);
         std::lock_guard<std::recursive_mutex> lock(*device->mutex);
+        stats.lockAcquired();
 
         // Double-check device is still valid after acquiring lock
         if (!device->afcClient) {
@@ -122,7 +142,9 @@ public:
             return;
         }
 
+        OperationStats::Scope stats(device, DeviceOperation::Other);
         std::lock_guard<std::recursive_mutex> lock(*device->mutex);
+        stats.lockAcquired();
 
         // Double-check device is still valid after acquiring lock
         if (!device->afcClient) {
@@ -138,17 +160,24 @@ public:
         operation();
     }
 
+    // bytesMoved is read after the call, for reads and writes
     static afc_error_t
     executeAfcOperation(iDescriptorDevice *device,
                         std::function<afc_error_t(afc_client_t)> operation,
-                        std::optional<afc_client_t> altAfc = std::nullopt)
+                        std::optional<afc_client_t> altAfc = std::nullopt,
+                        DeviceOperation type = DeviceOperation::Other,
+                        const uint32_t *bytesMoved = nullptr)
     {
         try {
             if (!device || !device->mutex) {
                 return AFC_E_UNKNOWN_ERROR;
             }
 
+            TraceSpan trace("afc", OperationStats::operationName(type),
+                            device);
+            OperationStats::Scope stats(device, type);
             std::lock_guard<std::recursive_mutex> lock(*device->mutex);
+            stats.lockAcquired();
 
             // Double-check device is still valid after acquiring lock
             if (!device->afcClient) {
@@ -163,9 +192,13 @@ public:
 
             // Determine which client to use
             afc_client_t client = altAfc ? *altAfc : device->afcClient;
-            return operation(client);
+            afc_error_t result = operation(client);
+            if (bytesMoved && result == AFC_E_SUCCESS) {
+                stats.addBytes(*bytesMoved);
+            }
+            return result;
         } catch (const std::exception &e) {
-            qDebug() << "Exception in executeAfcOperation:" << e.what();
+            qCDebug(lcAfc) << "Exception in executeAfcOperation:" << e.what();
             return AFC_E_UNKNOWN_ERROR;
         }
     }
@@ -168,6 +168,20 @@ void SettingsManager::setConnectionTimeout(int seconds)
     m_settings->sync();
 }
 
+int SettingsManager::batterySampleInterval() const
+{
+    return m_settings->value("batterySampleInterval", 10).toInt();
+}
+
+void SettingsManager::setBatterySampleInterval(int seconds)
+{
+    if (batterySampleInterval() == seconds)
+        return;
+    m_settings->setValue("batterySampleInterval", seconds);
+    m_settings->sync();
+    emit batterySampleIntervalChanged(seconds);
+}
+
 bool SettingsManager::showKeychainDialog() const
 {
     return m_settings->value("showKeychainDialog", true).toBool();
@@ -191,6 +205,50 @@ void SettingsManager::setDefaultJailbrokenRootPassword(const QString &password)
     m_settings->sync();
 }
 
+bool SettingsManager::convertHeicOnExport() const
+{
+    return m_settings->value("convertHeicOnExport", false).toBool();
+}
+
+void SettingsManager::setConvertHeicOnExport(bool enabled)
+{
+    m_settings->setValue("convertHeicOnExport", enabled);
+    m_settings->sync();
+}
+
+int SettingsManager::jpegExportQuality() const
+{
+    return m_settings->value("jpegExportQuality", 90).toInt();
+}
+
+void SettingsManager::setJpegExportQuality(int quality)
+{
+    m_settings->setValue("jpegExportQuality", quality);
+    m_settings->sync();
+}
+
+bool SettingsManager::remuxMovOnExport() const
+{
+    return m_settings->value("remuxMovOnExport", false).toBool();
+}
+
+void SettingsManager::setRemuxMovOnExport(bool enabled)
+{
+    m_settings->setValue("remuxMovOnExport", enabled);
+    m_settings->sync();
+}
+
+int SettingsManager::diskImageDownloadLimit() const
+{
+    return m_settings->value("diskImageDownloadLimit", 0).toInt();
+}
+
+void SettingsManager::setDiskImageDownloadLimit(int kilobytesPerSecond)
+{
+    m_settings->setValue("diskImageDownloadLimit", kilobytesPerSecond);
+    m_settings->sync();
+}
+
 void SettingsManager::doIfEnabled(Setting setting, std::function<void()> action)
 {
     bool shouldExecute = false;
@@ -233,8 +291,13 @@ void SettingsManager::resetToDefaults()
     setUseUnsecureBackend(false);
     setTheme("System Default");
     setConnectionTimeout(30);
+    setBatterySampleInterval(10);
     setShowKeychainDialog(true);
     setDefaultJailbrokenRootPassword("alpine");
+    setConvertHeicOnExport(false);
+    setJpegExportQuality(90);
+    setRemuxMovOnExport(false);
+    setDiskImageDownloadLimit(0);
 }
 
 void SettingsManager::saveFavoritePlace(const QString &path,
@@ -86,12 +86,28 @@ public:
     int connectionTimeout() const;
     void setConnectionTimeout(int seconds);
 
+    int batterySampleInterval() const;
+    void setBatterySampleInterval(int seconds);
+
     bool showKeychainDialog() const;
     void setShowKeychainDialog(bool show);
 
     QString defaultJailbrokenRootPassword() const;
     void setDefaultJailbrokenRootPassword(const QString &password);
 
+    bool convertHeicOnExport() const;
+    void setConvertHeicOnExport(bool enabled);
+
+    int jpegExportQuality() const;
+    void setJpegExportQuality(int quality);
+
+    bool remuxMovOnExport() const;
+    void setRemuxMovOnExport(bool enabled);
+
+    // KB/s shared by all disk image downloads, 0 for no limit
+    int diskImageDownloadLimit() const;
+    void setDiskImageDownloadLimit(int kilobytesPerSecond);
+
     // Utility method for conditional execution
     void doIfEnabled(Setting setting, std::function<void()> action);
 
@@ -102,6 +118,7 @@ public:
 signals:
     void favoritePlacesChanged();
     void recentLocationsChanged();
+    void batterySampleIntervalChanged(int seconds);
 
 private:
     QDialog *m_dialog;
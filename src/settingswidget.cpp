@@ -70,6 +70,18 @@ void SettingsWidget::setupUI()
     downloadLayout->addWidget(browseButton);
     generalLayout->addLayout(downloadLayout);
 
+    // Developer disk image download speed
+    auto *limitLayout = new QHBoxLayout();
+    limitLayout->addWidget(new QLabel("Disk Image Download Limit:"));
+    m_diskImageDownloadLimit = new QSpinBox();
+    m_diskImageDownloadLimit->setRange(0, 1024 * 1024);
+    m_diskImageDownloadLimit->setSingleStep(256);
+    m_diskImageDownloadLimit->setSuffix(" KB/s");
+    m_diskImageDownloadLimit->setSpecialValueText("Unlimited");
+    limitLayout->addWidget(m_diskImageDownloadLimit);
+    limitLayout->addStretch();
+    generalLayout->addLayout(limitLayout);
+
     // Unmount iFuse drives on exit (not implemented on macOS)
     // TODO: Implement
 #ifndef __APPLE__
@@ -120,8 +132,42 @@ void SettingsWidget::setupUI()
     timeoutLayout->addStretch();
     deviceLayout->addLayout(timeoutLayout);
 
+    // Battery telemetry sampling rate
+    auto *sampleLayout = new QHBoxLayout();
+    sampleLayout->addWidget(new QLabel("Battery Sample Interval:"));
+    m_batterySampleInterval = new QSpinBox();
+    m_batterySampleInterval->setRange(2, 300);
+    m_batterySampleInterval->setSuffix(" seconds");
+    sampleLayout->addWidget(m_batterySampleInterval);
+    sampleLayout->addStretch();
+    deviceLayout->addLayout(sampleLayout);
+
     scrollLayout->addWidget(deviceGroup);
 
+    // === EXPORT SETTINGS ===
+    auto *exportGroup = new QGroupBox("Export");
+    auto *exportLayout = new QVBoxLayout(exportGroup);
+
+    m_convertHeicOnExport = new QCheckBox(
+        "Convert HEIC photos to JPEG when exporting from Gallery");
+    exportLayout->addWidget(m_convertHeicOnExport);
+
+    auto *qualityLayout = new QHBoxLayout();
+    qualityLayout->addWidget(new QLabel("JPEG Quality:"));
+    m_jpegExportQuality = new QSpinBox();
+    m_jpegExportQuality->setRange(50, 100);
+    qualityLayout->addWidget(m_jpegExportQuality);
+    qualityLayout->addStretch();
+    exportLayout->addLayout(qualityLayout);
+
+    m_remuxMovOnExport =
+        new QCheckBox("Remux MOV videos to MP4 when exporting from Gallery");
+    m_remuxMovOnExport->setToolTip(
+        "Streams are copied as they are, the video is not re-encoded");
+    exportLayout->addWidget(m_remuxMovOnExport);
+
+    scrollLayout->addWidget(exportGroup);
+
     // === SECURITY SETTINGS ===
     auto *securityGroup = new QGroupBox("Security");
     auto *securityLayout = new QVBoxLayout(securityGroup);
@@ -219,6 +265,11 @@ void SettingsWidget::loadSettings()
     }
 
     m_connectionTimeout->setValue(sm->connectionTimeout());
+    m_batterySampleInterval->setValue(sm->batterySampleInterval());
+    m_convertHeicOnExport->setChecked(sm->convertHeicOnExport());
+    m_jpegExportQuality->setValue(sm->jpegExportQuality());
+    m_remuxMovOnExport->setChecked(sm->remuxMovOnExport());
+    m_diskImageDownloadLimit->setValue(sm->diskImageDownloadLimit());
     m_useUnsecureBackend->setChecked(sm->useUnsecureBackend());
     m_defaultJailbrokenRootPassword->setText(
         sm->defaultJailbrokenRootPassword());
@@ -244,6 +295,18 @@ void SettingsWidget::connectSignals()
             this, &SettingsWidget::onSettingChanged);
     connect(m_connectionTimeout, QOverload<int>::of(&QSpinBox::valueChanged),
             this, &SettingsWidget::onSettingChanged);
+    connect(m_batterySampleInterval,
+            QOverload<int>::of(&QSpinBox::valueChanged), this,
+            &SettingsWidget::onSettingChanged);
+    connect(m_convertHeicOnExport, &QCheckBox::toggled, this,
+            &SettingsWidget::onSettingChanged);
+    connect(m_jpegExportQuality, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &SettingsWidget::onSettingChanged);
+    connect(m_remuxMovOnExport, &QCheckBox::toggled, this,
+            &SettingsWidget::onSettingChanged);
+    connect(m_diskImageDownloadLimit,
+            QOverload<int>::of(&QSpinBox::valueChanged), this,
+            &SettingsWidget::onSettingChanged);
 
     connect(m_useUnsecureBackend, &QCheckBox::toggled, this, [this]() {
         // since this is unsafe if its being enabled, show a warning
@@ -342,6 +405,11 @@ void SettingsWidget::saveSettings()
 
     sm->setTheme(m_themeCombo->currentText());
     sm->setConnectionTimeout(m_connectionTimeout->value());
+    sm->setBatterySampleInterval(m_batterySampleInterval->value());
+    sm->setConvertHeicOnExport(m_convertHeicOnExport->isChecked());
+    sm->setJpegExportQuality(m_jpegExportQuality->value());
+    sm->setRemuxMovOnExport(m_remuxMovOnExport->isChecked());
+    sm->setDiskImageDownloadLimit(m_diskImageDownloadLimit->value());
     sm->setDefaultJailbrokenRootPassword(
         m_defaultJailbrokenRootPassword->text());
 
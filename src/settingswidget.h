@@ -62,6 +62,13 @@ private:
     QCheckBox *m_useUnsecureBackend;
     // Device Connection
     QSpinBox *m_connectionTimeout;
+    QSpinBox *m_batterySampleInterval;
+
+    // Export
+    QCheckBox *m_convertHeicOnExport;
+    QSpinBox *m_jpegExportQuality;
+    QCheckBox *m_remuxMovOnExport;
+    QSpinBox *m_diskImageDownloadLimit;
 
     // Jailbroken
     QLineEdit *m_defaultJailbrokenRootPassword;
@@ -0,0 +1,440 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "sftpsession.h"
+#include "loggingcategories.h"
+#include <QFile>
+#include <QScopeGuard>
+#include <deque>
+#include <fcntl.h>
+#ifdef WIN32
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+/*
+ OpenSSH's sftp-server answers reads up to 64 KiB in full, staying at or
+ below that means only the last request of a file can come back short
+*/
+constexpr uint32_t ChunkSize = 32 * 1024;
+// Requests kept in flight per file, 16 x 32 KiB covers the usbmux latency
+constexpr size_t MaxInFlight = 16;
+constexpr int SshPort = 22;
+
+// Outstanding reads on one file, answered in the order they were sent
+class ReadPipeline
+{
+public:
+    explicit ReadPipeline(sftp_file file) : m_file(file) {}
+    ~ReadPipeline()
+    {
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+        for (sftp_aio aio : m_inFlight) {
+            sftp_aio_free(aio);
+        }
+#endif
+    }
+
+    size_t size() const { return m_inFlight.size(); }
+    bool isEmpty() const { return m_inFlight.empty(); }
+
+    bool request()
+    {
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+        sftp_aio aio = nullptr;
+        if (sftp_aio_begin_read(m_file, ChunkSize, &aio) == SSH_ERROR) {
+            return false;
+        }
+        m_inFlight.push_back(aio);
+#else
+        int id = sftp_async_read_begin(m_file, ChunkSize);
+        if (id < 0) {
+            return false;
+        }
+        m_inFlight.push_back(static_cast<uint32_t>(id));
+#endif
+        return true;
+    }
+
+    // Waits for the oldest request, 0 at end of file, -1 on error
+    qint64 next(char *buffer)
+    {
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+        sftp_aio aio = m_inFlight.front();
+        m_inFlight.pop_front();
+        // Frees the aio handle whatever the outcome
+        ssize_t nbytes = sftp_aio_wait_read(&aio, buffer, ChunkSize);
+#else
+        const uint32_t id = m_inFlight.front();
+        m_inFlight.pop_front();
+        int nbytes = sftp_async_read(m_file, buffer, ChunkSize, id);
+#endif
+        return nbytes == SSH_ERROR ? -1 : static_cast<qint64>(nbytes);
+    }
+
+private:
+    sftp_file m_file;
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+    std::deque<sftp_aio> m_inFlight;
+#else
+    // sftp_async_read is the only way to pipeline before libssh 0.11
+    std::deque<uint32_t> m_inFlight;
+#endif
+};
+} // namespace
+
+SftpSession::SftpSession(iDescriptorDevice *device, const QString &password)
+    : m_device(device), m_password(password.toUtf8())
+{
+}
+
+SftpSession::~SftpSession() { close(); }
+
+QString SftpSession::backendName(TransferBackend backend)
+{
+    switch (backend) {
+    case TransferBackend::Afc:
+        return "AFC";
+    case TransferBackend::Sftp:
+        return "SFTP";
+    }
+    return QString();
+}
+
+QString SftpSession::lastError() const
+{
+    if (m_sftp && sftp_get_error(m_sftp) != SSH_FX_OK) {
+        return QString("SFTP error %1: %2")
+            .arg(sftp_get_error(m_sftp))
+            .arg(ssh_get_error(m_session));
+    }
+    return QString::fromUtf8(ssh_get_error(m_session));
+}
+
+bool SftpSession::open(QString *error)
+{
+    auto fail = [this, error](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        qCWarning(lcExport) << "SFTP:" << message;
+        close();
+        return false;
+    };
+
+    if (isOpen()) {
+        return true;
+    }
+
+    if (idevice_connect(m_device->device, SshPort, &m_connection) !=
+        IDEVICE_E_SUCCESS) {
+        return fail("Could not reach the SSH server on the device, is "
+                    "OpenSSH installed?");
+    }
+
+    int fd = -1;
+    if (idevice_connection_get_fd(m_connection, &fd) != IDEVICE_E_SUCCESS) {
+        return fail("Could not get the connection socket");
+    }
+
+    m_session = ssh_new();
+    if (!m_session) {
+        return fail("Failed to create SSH session");
+    }
+
+    // libssh closes the socket it's given, keep the original for
+    // idevice_disconnect
+#ifdef WIN32
+    WSAPROTOCOL_INFOW info;
+    socket_t sshFd = INVALID_SOCKET;
+    if (WSADuplicateSocketW(static_cast<SOCKET>(fd), GetCurrentProcessId(),
+                            &info) == 0) {
+        sshFd = WSASocketW(FROM_PROTOCOL_INFO, FROM_PROTOCOL_INFO,
+                           FROM_PROTOCOL_INFO, &info, 0,
+                           WSA_FLAG_OVERLAPPED);
+    }
+    if (sshFd == INVALID_SOCKET) {
+        return fail("Could not duplicate the connection socket");
+    }
+#else
+    socket_t sshFd = dup(fd);
+    if (sshFd < 0) {
+        return fail("Could not duplicate the connection socket");
+    }
+#endif
+    ssh_options_set(m_session, SSH_OPTIONS_FD, &sshFd);
+    ssh_options_set(m_session, SSH_OPTIONS_HOST, m_device->udid.c_str());
+    ssh_options_set(m_session, SSH_OPTIONS_USER, "root");
+    int strictHostCheck = 0;
+    ssh_options_set(m_session, SSH_OPTIONS_STRICTHOSTKEYCHECK,
+                    &strictHostCheck);
+    // Skip compression, the link is local and most exports are media
+    ssh_options_set(m_session, SSH_OPTIONS_COMPRESSION, "no");
+
+    if (ssh_connect(m_session) != SSH_OK) {
+        return fail(QString("SSH connection failed: %1").arg(lastError()));
+    }
+
+    if (ssh_userauth_password(m_session, nullptr, m_password.constData()) !=
+        SSH_AUTH_SUCCESS) {
+        return fail(
+            QString("SSH authentication failed: %1").arg(lastError()));
+    }
+
+    sftp_session sftp = sftp_new(m_session);
+    if (!sftp) {
+        return fail(QString("Failed to start SFTP: %1").arg(lastError()));
+    }
+    if (sftp_init(sftp) != SSH_OK) {
+        sftp_free(sftp);
+        return fail(QString("Failed to start SFTP: %1").arg(lastError()));
+    }
+    m_sftp = sftp;
+    return true;
+}
+
+void SftpSession::close()
+{
+    if (m_sftp) {
+        sftp_free(m_sftp);
+        m_sftp = nullptr;
+    }
+    if (m_session) {
+        ssh_disconnect(m_session);
+        ssh_free(m_session);
+        m_session = nullptr;
+    }
+    if (m_connection) {
+        idevice_disconnect(m_connection);
+        m_connection = nullptr;
+    }
+}
+
+bool SftpSession::download(const QString &remotePath,
+                           const QString &localPath,
+                           const ProgressCallback &progress, QString *error,
+                           qint64 *bytesTransferred)
+{
+    auto setError = [error](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    if (!isOpen()) {
+        return setError("SFTP session is not open");
+    }
+
+    sftp_file file = sftp_open(m_sftp, remotePath.toUtf8().constData(),
+                               O_RDONLY, 0);
+    if (!file) {
+        return setError(QString("Failed to open %1: %2")
+                            .arg(remotePath, lastError()));
+    }
+    auto closeFile = qScopeGuard([file]() { sftp_close(file); });
+
+    qint64 totalSize = -1;
+    if (sftp_attributes attributes = sftp_fstat(file)) {
+        totalSize = static_cast<qint64>(attributes->size);
+        sftp_attributes_free(attributes);
+    }
+
+    QFile output(localPath);
+    if (!output.open(QIODevice::WriteOnly)) {
+        return setError(QString("Failed to create local file: %1 (%2)")
+                            .arg(localPath, output.errorString()));
+    }
+
+    QByteArray buffer(ChunkSize, Qt::Uninitialized);
+    qint64 requested = 0;
+    qint64 received = 0;
+    bool eof = false;
+    bool ok = true;
+
+    ReadPipeline pipeline(file);
+    auto moreToRequest = [&]() {
+        return !eof && (totalSize < 0 || requested < totalSize);
+    };
+    while (ok && (moreToRequest() || !pipeline.isEmpty())) {
+        while (moreToRequest() && pipeline.size() < MaxInFlight) {
+            if (!pipeline.request()) {
+                ok = setError(QString("Read request failed: %1")
+                                  .arg(lastError()));
+                break;
+            }
+            requested += ChunkSize;
+        }
+        if (!ok || pipeline.isEmpty()) {
+            break;
+        }
+
+        const qint64 nbytes = pipeline.next(buffer.data());
+        if (nbytes < 0) {
+            ok = setError(QString("Read failed: %1").arg(lastError()));
+            break;
+        }
+        if (nbytes == 0) {
+            eof = true;
+            continue;
+        }
+        if (output.write(buffer.constData(), nbytes) != nbytes) {
+            ok = setError(QString("Write error: %1").arg(output.errorString()));
+            break;
+        }
+        received += nbytes;
+
+        // Anything short of a full chunk before the end would leave a hole
+        if (nbytes < static_cast<qint64>(ChunkSize) && totalSize >= 0 &&
+            received < totalSize) {
+            ok = setError("Server returned a short read");
+            break;
+        }
+
+        if (progress && !progress(received, totalSize)) {
+            ok = setError("Export cancelled by user");
+            break;
+        }
+    }
+
+    output.close();
+    if (!ok) {
+        output.remove();
+        return false;
+    }
+    if (totalSize >= 0 && received != totalSize) {
+        output.remove();
+        return setError(QString("Expected %1 bytes, got %2")
+                            .arg(totalSize)
+                            .arg(received));
+    }
+    if (bytesTransferred) {
+        *bytesTransferred = received;
+    }
+    return true;
+}
+
+bool SftpSession::upload(const QString &localPath, const QString &remotePath,
+                         const ProgressCallback &progress, QString *error,
+                         qint64 *bytesTransferred)
+{
+    auto setError = [error](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    if (!isOpen()) {
+        return setError("SFTP session is not open");
+    }
+
+    QFile input(localPath);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return setError(QString("Failed to open local file: %1 (%2)")
+                            .arg(localPath, input.errorString()));
+    }
+    const qint64 totalSize = input.size();
+
+    sftp_file file =
+        sftp_open(m_sftp, remotePath.toUtf8().constData(),
+                  O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (!file) {
+        return setError(QString("Failed to create %1: %2")
+                            .arg(remotePath, lastError()));
+    }
+    auto closeFile = qScopeGuard([file]() { sftp_close(file); });
+
+    QByteArray buffer(ChunkSize, Qt::Uninitialized);
+    qint64 sent = 0;
+    bool ok = true;
+
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 11, 0)
+    // The data is copied into the request, the buffer can be reused
+    std::deque<sftp_aio> inFlight;
+    qint64 queued = 0;
+    while (ok && (queued < totalSize || !inFlight.empty())) {
+        while (queued < totalSize && inFlight.size() < MaxInFlight) {
+            const qint64 nread = input.read(buffer.data(), ChunkSize);
+            if (nread <= 0) {
+                ok = setError(
+                    QString("Read error: %1").arg(input.errorString()));
+                break;
+            }
+            sftp_aio aio = nullptr;
+            if (sftp_aio_begin_write(file, buffer.constData(), nread, &aio) ==
+                SSH_ERROR) {
+                ok = setError(QString("Write request failed: %1")
+                                  .arg(lastError()));
+                break;
+            }
+            inFlight.push_back(aio);
+            queued += nread;
+        }
+        if (!ok || inFlight.empty()) {
+            break;
+        }
+
+        sftp_aio aio = inFlight.front();
+        inFlight.pop_front();
+        ssize_t nbytes = sftp_aio_wait_write(&aio);
+        if (nbytes == SSH_ERROR) {
+            ok = setError(QString("Write failed: %1").arg(lastError()));
+            break;
+        }
+        sent += nbytes;
+        if (progress && !progress(sent, totalSize)) {
+            ok = setError("Import cancelled by user");
+            break;
+        }
+    }
+    for (sftp_aio aio : inFlight) {
+        sftp_aio_free(aio);
+    }
+#else
+    // No pipelined writes before libssh 0.11
+    while (ok && sent < totalSize) {
+        const qint64 nread = input.read(buffer.data(), ChunkSize);
+        if (nread <= 0) {
+            ok = setError(QString("Read error: %1").arg(input.errorString()));
+            break;
+        }
+        if (sftp_write(file, buffer.constData(), nread) != nread) {
+            ok = setError(QString("Write failed: %1").arg(lastError()));
+            break;
+        }
+        sent += nread;
+        if (progress && !progress(sent, totalSize)) {
+            ok = setError("Import cancelled by user");
+            break;
+        }
+    }
+#endif
+
+    if (!ok) {
+        return false;
+    }
+    if (bytesTransferred) {
+        *bytesTransferred = sent;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SFTPSESSION_H
+#define SFTPSESSION_H
+
+#include "iDescriptor.h"
+#include <QByteArray>
+#include <QString>
+#include <functional>
+#include <libssh/libssh.h>
+#include <libssh/sftp.h>
+
+enum class TransferBackend { Afc, Sftp };
+
+/**
+ * @brief SFTP connection to the SSH server of a jailbroken device
+ *
+ * Tunnelled to port 22 through usbmuxd with idevice_connect, so unlike the
+ * terminal it doesn't need iproxy. Reads and writes keep several requests
+ * in flight per file instead of waiting for each round trip.
+ *
+ * Like libssh itself an instance isn't thread safe, use one per thread.
+ */
+class SftpSession
+{
+public:
+    // Return false to abort the transfer
+    using ProgressCallback = std::function<bool(qint64 done, qint64 total)>;
+
+    // Logs in as root with the given password
+    SftpSession(iDescriptorDevice *device, const QString &password);
+    ~SftpSession();
+
+    SftpSession(const SftpSession &) = delete;
+    SftpSession &operator=(const SftpSession &) = delete;
+
+    bool open(QString *error = nullptr);
+    bool isOpen() const { return m_sftp != nullptr; }
+    void close();
+
+    bool download(const QString &remotePath, const QString &localPath,
+                  const ProgressCallback &progress, QString *error = nullptr,
+                  qint64 *bytesTransferred = nullptr);
+    bool upload(const QString &localPath, const QString &remotePath,
+                const ProgressCallback &progress, QString *error = nullptr,
+                qint64 *bytesTransferred = nullptr);
+
+    static QString backendName(TransferBackend backend);
+
+private:
+    QString lastError() const;
+
+    iDescriptorDevice *m_device;
+    QByteArray m_password;
+    idevice_connection_t m_connection = nullptr;
+    ssh_session m_session = nullptr;
+    sftp_session m_sftp = nullptr;
+};
+
+#endif // SFTPSESSION_H
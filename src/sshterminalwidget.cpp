@@ -37,12 +37,34 @@
 #include <libssh/libssh.h>
 #include <qtermwidget6/qtermwidget.h>
 #include <unistd.h>
+#ifndef WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#endif
+
+namespace
+{
+// Bytes pulled off the channel per read call
+constexpr int ReadChunkSize = 64 * 1024;
+/*
+ Upper bound for one wakeup, with a command flooding output (dmesg, find /)
+ the rest is picked up on the next event loop pass so the terminal still
+ gets to paint and handle input in between
+*/
+constexpr int MaxBytesPerWakeup = 1024 * 1024;
+} // namespace
 
 SSHTerminalWidget::SSHTerminalWidget(const ConnectionInfo &connectionInfo,
                                      QWidget *parent)
     : QWidget(parent), m_connectionInfo(connectionInfo), m_sshSession(nullptr),
-      m_sshChannel(nullptr), m_iproxyProcess(nullptr), m_sshConnected(false),
-      m_isInitialized(false), m_currentState(TerminalState::Loading)
+      m_sshChannel(nullptr), m_sshNotifier(nullptr),
+      m_readBuffer(ReadChunkSize, Qt::Uninitialized), m_drainScheduled(false),
+#ifndef WIN32
+      m_ptyNotifier(nullptr),
+#endif
+      m_iproxyProcess(nullptr), m_sshConnected(false), m_isInitialized(false),
+      m_currentState(TerminalState::Loading)
 {
     setWindowTitle(QString("SSH Terminal / %1 - iDescriptor")
                        .arg(m_connectionInfo.deviceName));
@@ -53,11 +75,6 @@ SSHTerminalWidget::SSHTerminalWidget(const ConnectionInfo &connectionInfo,
     // Initialize SSH
     ssh_init();
 
-    // Setup timer for checking SSH data
-    m_sshTimer = new QTimer(this);
-    connect(m_sshTimer, &QTimer::timeout, this,
-            &SSHTerminalWidget::checkSshData);
-
     // Start connection process
     initializeConnection();
 }
@@ -201,11 +218,6 @@ void SSHTerminalWidget::onRetryClicked()
     // Reinitialize SSH
     ssh_init();
 
-    // Setup timer again
-    m_sshTimer = new QTimer(this);
-    connect(m_sshTimer, &QTimer::timeout, this,
-            &SSHTerminalWidget::checkSshData);
-
     // Update loading message and start connection
     m_loadingLabel->setText("Connecting to SSH server...");
     setState(TerminalState::Loading);
@@ -364,8 +376,9 @@ void SSHTerminalWidget::startSSH(const QString &host, uint16_t port)
     ssh_options_set(m_sshSession, SSH_OPTIONS_STRICTHOSTKEYCHECK,
                     &stricthostcheck);
 
-    // Set log level for debugging
-    int log_level = SSH_LOG_PROTOCOL;
+    // Protocol level logging writes a line per packet, which throttles
+    // large outputs, keep it to warnings
+    int log_level = SSH_LOG_WARNING;
     ssh_options_set(m_sshSession, SSH_OPTIONS_LOG_VERBOSITY, &log_level);
 
     qDebug() << "SSH session configured, attempting connection...";
@@ -451,8 +464,15 @@ void SSHTerminalWidget::startSSH(const QString &host, uint16_t port)
     // Connect terminal to SSH
     connectLibsshToTerminal();
 
-    // Start timer to check for SSH data
-    m_sshTimer->start(50); // Check every 50ms
+    // Wake up only when the server sends something
+    m_sshNotifier = new QSocketNotifier(
+        static_cast<qintptr>(ssh_get_fd(m_sshSession)), QSocketNotifier::Read,
+        this);
+    connect(m_sshNotifier, &QSocketNotifier::activated, this,
+            &SSHTerminalWidget::drainChannel);
+
+    // The prompt may already be sitting in libssh's buffers
+    scheduleDrain();
 
     m_sshConnected = true;
     setState(TerminalState::Connected);
@@ -465,55 +485,134 @@ void SSHTerminalWidget::connectLibsshToTerminal()
     if (!m_terminal)
         return;
 
+#ifndef WIN32
+    // Never block the GUI thread on a full PTY, see deliverToTerminal
+    const int ptyFd = m_terminal->getPtySlaveFd();
+    fcntl(ptyFd, F_SETFL, fcntl(ptyFd, F_GETFL) | O_NONBLOCK);
+    m_ptyNotifier = new QSocketNotifier(ptyFd, QSocketNotifier::Write, this);
+    m_ptyNotifier->setEnabled(false);
+    connect(m_ptyNotifier, &QSocketNotifier::activated, this,
+            &SSHTerminalWidget::onPtyWritable);
+#endif
+
     // Connect terminal input to SSH channel
     connect(m_terminal, &QTermWidget::sendData, this,
             [this](const char *data, int size) {
                 if (m_sshChannel && ssh_channel_is_open(m_sshChannel)) {
                     ssh_channel_write(m_sshChannel, data, size);
+                    /*
+                     A blocking write can read incoming packets into
+                     libssh's buffers while it waits, the socket then
+                     won't signal for them
+                    */
+                    scheduleDrain();
                 }
             });
 }
 
-void SSHTerminalWidget::checkSshData()
+void SSHTerminalWidget::scheduleDrain()
+{
+    if (m_drainScheduled)
+        return;
+    m_drainScheduled = true;
+    QTimer::singleShot(0, this, &SSHTerminalWidget::drainChannel);
+}
+
+void SSHTerminalWidget::drainChannel()
 {
+    m_drainScheduled = false;
     if (!m_sshChannel || !ssh_channel_is_open(m_sshChannel))
         return;
 
-    // Check if SSH channel has data to read
-    if (ssh_channel_poll(m_sshChannel, 0) > 0) {
-        char buffer[4096];
-        int nbytes = ssh_channel_read_nonblocking(m_sshChannel, buffer,
-                                                  sizeof(buffer), 0);
-        if (nbytes > 0) {
-#ifdef WIN32
-            m_terminal->receiveData(buffer, nbytes);
-#else
-            // Write data to terminal's PTY
-            write(m_terminal->getPtySlaveFd(), buffer, nbytes);
+    char *buffer = m_readBuffer.data();
+    int budget = MaxBytesPerWakeup;
+    while (budget > 0) {
+#ifndef WIN32
+        if (!m_pendingOutput.isEmpty()) {
+            // The PTY is full, onPtyWritable picks up from here
+            return;
+        }
 #endif
+        int received = 0;
+        for (int isStderr = 0; isStderr <= 1; ++isStderr) {
+            int nbytes = ssh_channel_read_nonblocking(
+                m_sshChannel, buffer, ReadChunkSize, isStderr);
+            if (nbytes == SSH_ERROR) {
+                qDebug() << "SSH read failed:" << ssh_get_error(m_sshSession);
+                disconnectSSH();
+                return;
+            }
+            if (nbytes > 0) {
+                deliverToTerminal(buffer, nbytes);
+                received += nbytes;
+            }
         }
+        if (received == 0)
+            break;
+        budget -= received;
+    }
+
+    // Check if channel is closed
+    if (ssh_channel_is_eof(m_sshChannel)) {
+        disconnectSSH();
+        return;
+    }
+
+    if (budget <= 0) {
+        scheduleDrain();
     }
+}
 
-    // Check for stderr data
-    if (ssh_channel_poll(m_sshChannel, 1) > 0) {
-        char buffer[4096];
-        int nbytes = ssh_channel_read_nonblocking(m_sshChannel, buffer,
-                                                  sizeof(buffer), 1);
-        if (nbytes > 0) {
-            // Write stderr data to terminal's PTY
+void SSHTerminalWidget::deliverToTerminal(const char *data, int size)
+{
 #ifdef WIN32
-            m_terminal->receiveData(buffer, nbytes);
+    m_terminal->receiveData(data, size);
 #else
-            write(m_terminal->getPtySlaveFd(), buffer, nbytes);
-#endif
+    if (!m_pendingOutput.isEmpty()) {
+        // Queue behind earlier output, e.g. stderr after a stashed stdout
+        m_pendingOutput.append(data, size);
+        return;
+    }
+
+    ssize_t written = write(m_terminal->getPtySlaveFd(), data, size);
+    if (written < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            qDebug() << "Failed to write to terminal PTY:" << strerror(errno);
+            return;
         }
+        written = 0;
+    }
+    if (written < size) {
+        // Stop reading from the network until the terminal catches up,
+        // the server then gets throttled by the SSH/TCP window
+        m_pendingOutput.append(data + written, size - written);
+        m_sshNotifier->setEnabled(false);
+        m_ptyNotifier->setEnabled(true);
     }
+#endif
+}
 
-    // Check if channel is closed
-    if (ssh_channel_is_eof(m_sshChannel)) {
-        disconnectSSH();
+#ifndef WIN32
+void SSHTerminalWidget::onPtyWritable()
+{
+    ssize_t written =
+        write(m_terminal->getPtySlaveFd(), m_pendingOutput.constData(),
+              m_pendingOutput.size());
+    if (written < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return;
+        qDebug() << "Failed to write to terminal PTY:" << strerror(errno);
+        written = m_pendingOutput.size();
     }
+    m_pendingOutput.remove(0, written);
+    if (!m_pendingOutput.isEmpty())
+        return;
+
+    m_ptyNotifier->setEnabled(false);
+    m_sshNotifier->setEnabled(true);
+    scheduleDrain();
 }
+#endif
 
 void SSHTerminalWidget::disconnectSSH()
 {
@@ -523,11 +622,20 @@ void SSHTerminalWidget::disconnectSSH()
 
 void SSHTerminalWidget::cleanup()
 {
-    if (m_sshTimer) {
-        m_sshTimer->stop();
-        m_sshTimer->deleteLater();
-        m_sshTimer = nullptr;
+    // Notifiers must go before the fds they watch are closed
+    if (m_sshNotifier) {
+        m_sshNotifier->setEnabled(false);
+        m_sshNotifier->deleteLater();
+        m_sshNotifier = nullptr;
+    }
+#ifndef WIN32
+    if (m_ptyNotifier) {
+        m_ptyNotifier->setEnabled(false);
+        m_ptyNotifier->deleteLater();
+        m_ptyNotifier = nullptr;
     }
+    m_pendingOutput.clear();
+#endif
 
     if (m_sshChannel) {
         ssh_channel_close(m_sshChannel);
@@ -23,6 +23,7 @@
 #include <QLabel>
 #include <QProcess>
 #include <QPushButton>
+#include <QSocketNotifier>
 #include <QStackedWidget>
 #include <QString>
 #include <QTimer>
@@ -56,7 +57,10 @@ public:
 
 private slots:
     void onRetryClicked();
-    void checkSshData();
+    void drainChannel();
+#ifndef WIN32
+    void onPtyWritable();
+#endif
 
 private:
     void setupUI();
@@ -73,6 +77,8 @@ private:
     void startSSH(const QString &host, uint16_t port);
     void disconnectSSH();
     void connectLibsshToTerminal();
+    void scheduleDrain();
+    void deliverToTerminal(const char *data, int size);
     void cleanup();
 
     // UI Components
@@ -98,7 +104,15 @@ private:
     // SSH components
     ssh_session m_sshSession;
     ssh_channel m_sshChannel;
-    QTimer *m_sshTimer;
+    QSocketNotifier *m_sshNotifier;
+    QByteArray m_readBuffer;
+    bool m_drainScheduled;
+#ifndef WIN32
+    // Output the terminal's PTY couldn't take yet, while it's non-empty
+    // nothing more is read from the channel
+    QSocketNotifier *m_ptyNotifier;
+    QByteArray m_pendingOutput;
+#endif
     QProcess *m_iproxyProcess;
 
     // State tracking
@@ -0,0 +1,634 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "storageanalyzer.h"
+#include "appcontext.h"
+#include "loggingcategories.h"
+#include "servicebroker.h"
+#include "settingsmanager.h"
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+constexpr quint32 SaveMagic = 0x49445341; // "IDSA"
+constexpr quint16 SaveVersion = 1;
+constexpr int UpdateIntervalMs = 250;
+// Kept beyond what the UI shows so rescans that reuse saved directories
+// still have candidates when bigger files disappear
+constexpr int SavedLargestCount = StorageAnalyzer::LargestFileCount * 2;
+
+bool biggerFirst(const StorageFile &a, const StorageFile &b)
+{
+    return a.size > b.size;
+}
+} // namespace
+
+int StorageAnalyzer::Tree::addDir(int parent, const QString &name)
+{
+    DirNode node;
+    node.name = name;
+    node.parent = parent;
+    const int id = nodes.size();
+    if (parent >= 0) {
+        node.nextSibling = nodes[parent].firstChild;
+        nodes[parent].firstChild = id;
+    }
+    nodes.append(node);
+    return id;
+}
+
+// Sizes go up the whole chain right away, parents never wait for children
+void StorageAnalyzer::Tree::addFiles(int id, quint64 bytes, quint32 files)
+{
+    nodes[id].ownBytes += bytes;
+    nodes[id].ownFiles += files;
+    for (int p = id; p >= 0; p = nodes[p].parent) {
+        nodes[p].totalBytes += bytes;
+        nodes[p].totalFiles += files;
+    }
+}
+
+void StorageAnalyzer::Tree::offerFiles(const QList<StorageFile> &files)
+{
+    for (const StorageFile &file : files) {
+        if (largest.size() >= SavedLargestCount &&
+            file.size <= largest.last().size) {
+            continue;
+        }
+        auto pos = std::upper_bound(largest.begin(), largest.end(), file,
+                                    biggerFirst);
+        largest.insert(pos, file);
+        if (largest.size() > SavedLargestCount) {
+            largest.removeLast();
+        }
+    }
+}
+
+QString StorageAnalyzer::Tree::path(int id) const
+{
+    QStringList parts;
+    for (int p = id; p > RootNode; p = nodes[p].parent) {
+        parts.prepend(nodes[p].name);
+    }
+    return "/" + parts.join('/');
+}
+
+StorageAnalyzer::StorageAnalyzer(iDescriptorDevice *device, Root root,
+                                 QObject *parent)
+    : QObject(parent), m_device(device), m_root(root),
+      m_udid(QString::fromStdString(device->udid)),
+      m_updateTimer(new QTimer(this))
+{
+    m_updateTimer->setInterval(UpdateIntervalMs);
+    connect(m_updateTimer, &QTimer::timeout, this, [this]() {
+        if (m_dirty.exchange(false)) {
+            emit updated();
+        }
+    });
+
+    // Emitted before the device is freed, the workers' AFC connections
+    // have to be gone by then
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            &StorageAnalyzer::onDeviceRemoved, Qt::DirectConnection);
+}
+
+StorageAnalyzer::~StorageAnalyzer()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+QString StorageAnalyzer::rootName(Root root)
+{
+    return root == Root::Media ? "Media" : "Entire filesystem";
+}
+
+QString StorageAnalyzer::savePath() const
+{
+    return SettingsManager::homePath() + "/storage/" + m_udid +
+           (m_root == Root::Media ? "-media" : "-fs") + ".scan";
+}
+
+bool StorageAnalyzer::loadSaved()
+{
+    Tree tree;
+    if (!load(savePath(), tree)) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_treeMutex);
+    m_saved = std::move(tree);
+    m_hasSaved = true;
+    return true;
+}
+
+void StorageAnalyzer::start(bool fullScan, int workers)
+{
+    if (m_running || !m_device) {
+        return;
+    }
+
+    ++m_runId;
+    m_running = true;
+    m_fullScan = fullScan;
+    m_cancelled = false;
+    m_failed = false;
+    m_dirty = false;
+    m_dirsScanned = 0;
+    m_filesStatted = 0;
+
+    {
+        QMutexLocker locker(&m_treeMutex);
+        m_scan = Tree();
+        m_scan.addDir(-1, "/");
+
+        // Read-only while the workers run
+        m_savedDirs.clear();
+        if (m_hasSaved && !fullScan) {
+            const QVector<DirNode> &nodes = m_saved.nodes;
+            for (int id = 0; id < nodes.size(); ++id) {
+                SavedDir saved;
+                saved.mtime = nodes[id].mtime;
+                saved.ownBytes = nodes[id].ownBytes;
+                saved.ownFiles = nodes[id].ownFiles;
+                for (int c = nodes[id].firstChild; c >= 0;
+                     c = nodes[c].nextSibling) {
+                    saved.subdirs.append(nodes[c].name);
+                }
+                m_savedDirs.insert(m_saved.path(id), saved);
+            }
+            for (const StorageFile &file : std::as_const(m_saved.largest)) {
+                QString dir = file.path.section('/', 0, -2);
+                auto it = m_savedDirs.find(dir.isEmpty() ? "/" : dir);
+                if (it != m_savedDirs.end()) {
+                    it->files.append(file);
+                }
+            }
+        }
+    }
+
+    workers = qMax(1, workers);
+    m_workers.clear();
+    for (int i = 0; i < workers; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    m_workers[0]->queue.push_back({RootNode, "/"});
+    m_pending = 1;
+    m_activeWorkers = workers;
+    m_pool.setMaxThreadCount(workers);
+
+    const int run = m_runId;
+    for (int i = 0; i < workers; ++i) {
+        QtConcurrent::run(&m_pool, [this, i, run]() { runWorker(i, run); });
+    }
+    m_updateTimer->start();
+}
+
+void StorageAnalyzer::cancel()
+{
+    m_cancelled = true;
+    QMutexLocker locker(&m_idleMutex);
+    m_workAvailable.wakeAll();
+}
+
+afc_client_t StorageAnalyzer::connectAfc()
+{
+    afc_client_t afc = nullptr;
+    if (m_root == Root::Filesystem) {
+        return afc2_client_new(m_device->device, &afc) == AFC_E_SUCCESS
+                   ? afc
+                   : nullptr;
+    }
+
+    lockdownd_service_descriptor_t service = nullptr;
+    if (ServiceBroker::sharedInstance()->startService(
+            m_device->device, AFC_SERVICE_NAME, &service) !=
+        LOCKDOWN_E_SUCCESS) {
+        if (service) {
+            lockdownd_service_descriptor_free(service);
+        }
+        return nullptr;
+    }
+    afc_error_t err = afc_client_new(m_device->device, service, &afc);
+    lockdownd_service_descriptor_free(service);
+    return err == AFC_E_SUCCESS ? afc : nullptr;
+}
+
+void StorageAnalyzer::runWorker(int index, int run)
+{
+    Worker &worker = *m_workers[index];
+    worker.afc = connectAfc();
+    if (!worker.afc) {
+        // The others steal whatever was queued here, but the result isn't
+        // trusted enough to be saved for reuse
+        qCDebug(lcAfc) << "StorageAnalyzer: worker" << index
+                       << "could not open an AFC connection";
+        m_failed = true;
+    }
+
+    while (worker.afc && !m_cancelled) {
+        WorkItem item;
+        if (takeWork(index, item)) {
+            scanDirectory(worker, item, m_fullScan);
+            if (--m_pending == 0) {
+                QMutexLocker locker(&m_idleMutex);
+                m_workAvailable.wakeAll();
+            }
+            continue;
+        }
+        if (m_pending == 0) {
+            break;
+        }
+
+        // Someone is still listing a directory that may add work
+        QMutexLocker locker(&m_idleMutex);
+        m_workAvailable.wait(&m_idleMutex, 20);
+    }
+
+    if (worker.afc) {
+        afc_client_free(worker.afc);
+        worker.afc = nullptr;
+    }
+
+    if (m_activeWorkers.fetch_sub(1) == 1) {
+        const bool success = !m_cancelled && !m_failed && m_pending == 0;
+        QMetaObject::invokeMethod(
+            this, [this, run, success]() { finishScan(run, success); },
+            Qt::QueuedConnection);
+    }
+}
+
+// Own queue from the back, everybody else's from the front, which is where
+// the shallow directories with the biggest subtrees are
+bool StorageAnalyzer::takeWork(int index, WorkItem &item)
+{
+    const int count = static_cast<int>(m_workers.size());
+    for (int k = 0; k < count; ++k) {
+        Worker &victim = *m_workers[(index + k) % count];
+        QMutexLocker locker(&victim.mutex);
+        if (victim.queue.empty()) {
+            continue;
+        }
+        if (k == 0) {
+            item = victim.queue.back();
+            victim.queue.pop_back();
+        } else {
+            item = victim.queue.front();
+            victim.queue.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void StorageAnalyzer::scanDirectory(Worker &worker, const WorkItem &item,
+                                    bool fullScan)
+{
+    const QByteArray path = item.path.toUtf8();
+    const QString prefix = item.path.endsWith('/') ? item.path
+                                                   : item.path + '/';
+
+    qint64 mtime = 0;
+    char **info = nullptr;
+    if (afc_get_file_info(worker.afc, path.constData(), &info) ==
+            AFC_E_SUCCESS &&
+        info) {
+        for (int i = 0; info[i] && info[i + 1]; i += 2) {
+            if (strcmp(info[i], "st_mtime") == 0) {
+                mtime = strtoll(info[i + 1], nullptr, 10);
+            }
+        }
+        afc_dictionary_free(info);
+    }
+
+    QStringList subdirs;
+    QList<StorageFile> files;
+    quint64 bytes = 0;
+    quint32 fileCount = 0;
+
+    auto saved = fullScan ? m_savedDirs.constEnd()
+                          : m_savedDirs.constFind(item.path);
+    if (saved != m_savedDirs.constEnd() && mtime != 0 &&
+        saved->mtime == mtime) {
+        subdirs = saved->subdirs;
+        files = saved->files;
+        bytes = saved->ownBytes;
+        fileCount = saved->ownFiles;
+    } else {
+        char **entries = nullptr;
+        const afc_error_t err =
+            afc_read_directory(worker.afc, path.constData(), &entries);
+        if (err != AFC_E_SUCCESS || !entries) {
+            // Mostly permission errors on AFC2, the rest of the tree is fine.
+            // Anything else leaves a hole that must not be saved.
+            if (err != AFC_E_SUCCESS && err != AFC_E_PERM_DENIED &&
+                err != AFC_E_OBJECT_NOT_FOUND) {
+                qCDebug(lcAfc) << "StorageAnalyzer: reading" << item.path
+                               << "failed:" << err;
+                m_failed = true;
+            }
+            entries = nullptr;
+        }
+
+        for (int i = 0; entries && entries[i] && !m_cancelled; ++i) {
+            if (strcmp(entries[i], ".") == 0 || strcmp(entries[i], "..") == 0) {
+                continue;
+            }
+            const QString name = QString::fromUtf8(entries[i]);
+            const QString childPath = prefix + name;
+            const QByteArray child = childPath.toUtf8();
+
+            char **childInfo = nullptr;
+            if (afc_get_file_info(worker.afc, child.constData(),
+                                  &childInfo) != AFC_E_SUCCESS ||
+                !childInfo) {
+                continue;
+            }
+            ++m_filesStatted;
+
+            const char *type = nullptr;
+            quint64 size = 0;
+            for (int j = 0; childInfo[j] && childInfo[j + 1]; j += 2) {
+                if (strcmp(childInfo[j], "st_ifmt") == 0) {
+                    type = childInfo[j + 1];
+                } else if (strcmp(childInfo[j], "st_size") == 0) {
+                    size = strtoull(childInfo[j + 1], nullptr, 10);
+                }
+            }
+
+            // Symlinks are skipped, following them would count things twice
+            if (type && strcmp(type, "S_IFDIR") == 0) {
+                if (!(m_root == Root::Filesystem && item.id == RootNode &&
+                      name == "dev")) {
+                    subdirs.append(name);
+                }
+            } else if (type && strcmp(type, "S_IFREG") == 0) {
+                bytes += size;
+                ++fileCount;
+                files.append({childPath, size});
+            }
+            afc_dictionary_free(childInfo);
+        }
+        if (entries) {
+            afc_dictionary_free(entries);
+        }
+    }
+
+    // Only this directory's biggest files can make the global list
+    if (files.size() > SavedLargestCount) {
+        std::partial_sort(files.begin(), files.begin() + SavedLargestCount,
+                          files.end(), biggerFirst);
+        files.erase(files.begin() + SavedLargestCount, files.end());
+    }
+
+    std::vector<WorkItem> work;
+    {
+        QMutexLocker locker(&m_treeMutex);
+        m_scan.nodes[item.id].mtime = mtime;
+        m_scan.addFiles(item.id, bytes, fileCount);
+        for (const QString &name : std::as_const(subdirs)) {
+            work.push_back({m_scan.addDir(item.id, name), prefix + name});
+        }
+        m_scan.nodes[item.id].complete = true;
+        m_scan.offerFiles(files);
+    }
+    ++m_dirsScanned;
+    m_dirty = true;
+
+    if (!work.empty()) {
+        // Before this directory is counted as done, so pending never
+        // touches zero early
+        m_pending += static_cast<int>(work.size());
+        {
+            QMutexLocker locker(&worker.mutex);
+            for (WorkItem &next : work) {
+                worker.queue.push_back(std::move(next));
+            }
+        }
+        QMutexLocker locker(&m_idleMutex);
+        m_workAvailable.wakeAll();
+    }
+}
+
+void StorageAnalyzer::finishScan(int run, bool success)
+{
+    if (run != m_runId) {
+        return;
+    }
+
+    m_updateTimer->stop();
+    m_running = false;
+    m_workers.clear();
+
+    if (success) {
+        Tree finished;
+        {
+            QMutexLocker locker(&m_treeMutex);
+            m_scan.scannedAt = QDateTime::currentDateTime();
+            m_saved = std::move(m_scan);
+            m_scan = Tree();
+            m_hasSaved = true;
+            finished = m_saved;
+        }
+        const QString path = savePath();
+        QtConcurrent::run([path, finished]() {
+            QDir().mkpath(QFileInfo(path).absolutePath());
+            if (!save(path, finished)) {
+                qCDebug(lcAfc) << "StorageAnalyzer: could not save" << path;
+            }
+        });
+    }
+
+    qCDebug(lcAfc) << "StorageAnalyzer:" << (success ? "finished" : "stopped")
+                   << "after" << m_dirsScanned.load() << "directories,"
+                   << m_filesStatted.load() << "stats";
+    emit updated();
+    emit finished(success);
+}
+
+void StorageAnalyzer::onDeviceRemoved(const std::string &udid)
+{
+    if (!m_device || m_device->udid != udid) {
+        return;
+    }
+
+    // Waits for in-flight AFC calls, the handle is freed after this slot
+    cancel();
+    m_pool.waitForDone();
+    m_device = nullptr;
+}
+
+const StorageAnalyzer::Tree &StorageAnalyzer::shownTree() const
+{
+    // Without a saved result the live scan is shown as it grows
+    return m_hasSaved ? m_saved : m_scan;
+}
+
+StorageDirInfo StorageAnalyzer::dir(int id) const
+{
+    QMutexLocker locker(&m_treeMutex);
+    const Tree &tree = shownTree();
+    StorageDirInfo info;
+    if (id < 0 || id >= tree.nodes.size()) {
+        return info;
+    }
+    const DirNode &node = tree.nodes[id];
+    info.id = id;
+    info.name = node.name;
+    info.totalBytes = node.totalBytes;
+    info.totalFiles = node.totalFiles;
+    info.ownBytes = node.ownBytes;
+    info.ownFiles = node.ownFiles;
+    info.complete = node.complete;
+    return info;
+}
+
+QList<StorageDirInfo> StorageAnalyzer::children(int id) const
+{
+    QMutexLocker locker(&m_treeMutex);
+    const Tree &tree = shownTree();
+    QList<StorageDirInfo> result;
+    if (id < 0 || id >= tree.nodes.size()) {
+        return result;
+    }
+    for (int c = tree.nodes[id].firstChild; c >= 0;
+         c = tree.nodes[c].nextSibling) {
+        const DirNode &node = tree.nodes[c];
+        StorageDirInfo info;
+        info.id = c;
+        info.name = node.name;
+        info.totalBytes = node.totalBytes;
+        info.totalFiles = node.totalFiles;
+        info.ownBytes = node.ownBytes;
+        info.ownFiles = node.ownFiles;
+        info.complete = node.complete;
+        result.append(info);
+    }
+    return result;
+}
+
+int StorageAnalyzer::parentOf(int id) const
+{
+    QMutexLocker locker(&m_treeMutex);
+    const Tree &tree = shownTree();
+    return id >= 0 && id < tree.nodes.size() ? tree.nodes[id].parent : -1;
+}
+
+QString StorageAnalyzer::pathOf(int id) const
+{
+    QMutexLocker locker(&m_treeMutex);
+    const Tree &tree = shownTree();
+    return id >= 0 && id < tree.nodes.size() ? tree.path(id) : QString();
+}
+
+QList<StorageFile> StorageAnalyzer::largestFiles() const
+{
+    QMutexLocker locker(&m_treeMutex);
+    return shownTree().largest.mid(0, LargestFileCount);
+}
+
+QDateTime StorageAnalyzer::scannedAt() const
+{
+    QMutexLocker locker(&m_treeMutex);
+    return shownTree().scannedAt;
+}
+
+bool StorageAnalyzer::save(const QString &path, const Tree &tree)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << SaveMagic << SaveVersion << tree.scannedAt
+        << qint32(tree.nodes.size());
+    for (const DirNode &node : tree.nodes) {
+        out << node.name << qint32(node.parent) << qint64(node.mtime)
+            << quint64(node.ownBytes) << quint32(node.ownFiles);
+    }
+    out << qint32(tree.largest.size());
+    for (const StorageFile &f : tree.largest) {
+        out << f.path << quint64(f.size);
+    }
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool StorageAnalyzer::load(const QString &path, Tree &tree)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint32 count = 0;
+    in >> magic >> version >> tree.scannedAt >> count;
+    if (magic != SaveMagic || version != SaveVersion || count <= 0) {
+        return false;
+    }
+
+    tree.nodes.reserve(count);
+    for (qint32 i = 0; i < count; ++i) {
+        QString name;
+        qint32 parent = -1;
+        qint64 mtime = 0;
+        quint64 ownBytes = 0;
+        quint32 ownFiles = 0;
+        in >> name >> parent >> mtime >> ownBytes >> ownFiles;
+        // Parents are always written before their children
+        if (in.status() != QDataStream::Ok || parent >= i ||
+            (i > 0 && parent < 0)) {
+            return false;
+        }
+        const int id = tree.addDir(i == 0 ? -1 : parent, name);
+        DirNode &node = tree.nodes[id];
+        node.mtime = mtime;
+        node.ownBytes = node.totalBytes = ownBytes;
+        node.ownFiles = ownFiles;
+        node.totalFiles = ownFiles;
+        node.complete = true;
+    }
+
+    // Bottom-up, children always have higher ids than their parent
+    for (int id = tree.nodes.size() - 1; id > RootNode; --id) {
+        DirNode &parent = tree.nodes[tree.nodes[id].parent];
+        parent.totalBytes += tree.nodes[id].totalBytes;
+        parent.totalFiles += tree.nodes[id].totalFiles;
+    }
+
+    qint32 largest = 0;
+    in >> largest;
+    for (qint32 i = 0; i < largest && in.status() == QDataStream::Ok; ++i) {
+        StorageFile f;
+        in >> f.path >> f.size;
+        tree.largest.append(f);
+    }
+    return in.status() == QDataStream::Ok;
+}
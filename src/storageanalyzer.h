@@ -0,0 +1,199 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STORAGEANALYZER_H
+#define STORAGEANALYZER_H
+
+#include "iDescriptor.h"
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <memory>
+
+struct StorageFile {
+    QString path;
+    quint64 size = 0;
+};
+
+// One directory as the UI sees it, sizes include everything below it
+struct StorageDirInfo {
+    int id = -1;
+    QString name;
+    quint64 totalBytes = 0;
+    quint64 totalFiles = 0;
+    quint64 ownBytes = 0; // files directly in this directory
+    quint32 ownFiles = 0;
+    bool complete = false;
+};
+
+/**
+ * @brief Sizes an AFC (or AFC2) filesystem with a parallel directory walker
+ *
+ * Every worker owns its own AFC connection, so directory listings and stats
+ * really run concurrently instead of queueing on the device mutex. Workers
+ * keep a local deque of directories, take from its back (depth first) and
+ * steal from the front of the others when they run dry.
+ *
+ * Only directories become tree nodes, files are folded into their parent's
+ * size as soon as the directory is listed and the size is added to every
+ * ancestor, so partial results are always consistent. The largest files
+ * are tracked separately.
+ *
+ * Finished scans are saved per device. A rescan compares each directory's
+ * mtime with the saved one and reuses the saved listing if it's unchanged,
+ * which skips the per-file stats that make up most of a full scan. Files
+ * rewritten in place don't touch their directory's mtime, those only show
+ * up with a full scan.
+ */
+class StorageAnalyzer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Root {
+        Media,     // /var/mobile/Media over AFC
+        Filesystem // / over AFC2, jailbroken devices only
+    };
+
+    static constexpr int RootNode = 0;
+    static constexpr int DefaultWorkers = 4;
+    static constexpr int LargestFileCount = 100;
+
+    StorageAnalyzer(iDescriptorDevice *device, Root root,
+                    QObject *parent = nullptr);
+    ~StorageAnalyzer() override;
+
+    // Loads the last saved scan, true if there was one
+    bool loadSaved();
+    void start(bool fullScan = false, int workers = DefaultWorkers);
+    void cancel();
+    bool isRunning() const { return m_running; }
+
+    // Safe to call while a scan runs
+    StorageDirInfo dir(int id) const;
+    QList<StorageDirInfo> children(int id) const;
+    int parentOf(int id) const;
+    QString pathOf(int id) const;
+    QList<StorageFile> largestFiles() const;
+    QDateTime scannedAt() const;
+    quint64 directoriesScanned() const { return m_dirsScanned; }
+    quint64 filesStatted() const { return m_filesStatted; }
+
+    static QString rootName(Root root);
+
+signals:
+    // Throttled, new partial results are available
+    void updated();
+    void finished(bool success);
+
+private:
+    struct DirNode {
+        QString name;
+        int parent = -1;
+        int firstChild = -1;
+        int nextSibling = -1;
+        qint64 mtime = 0;
+        quint64 ownBytes = 0;
+        quint32 ownFiles = 0;
+        quint64 totalBytes = 0;
+        quint64 totalFiles = 0;
+        bool complete = false;
+    };
+
+    struct Tree {
+        QVector<DirNode> nodes;
+        QList<StorageFile> largest; // biggest first
+        QDateTime scannedAt;
+
+        int addDir(int parent, const QString &name);
+        void addFiles(int id, quint64 bytes, quint32 files);
+        void offerFiles(const QList<StorageFile> &files);
+        QString path(int id) const;
+    };
+
+    // What a rescan needs from the previous result for one directory
+    struct SavedDir {
+        qint64 mtime = 0;
+        quint64 ownBytes = 0;
+        quint32 ownFiles = 0;
+        QStringList subdirs;
+        QList<StorageFile> files; // from the saved largest files list
+    };
+
+    struct WorkItem {
+        int id;
+        QString path;
+    };
+
+    struct Worker {
+        QMutex mutex;
+        std::deque<WorkItem> queue;
+        afc_client_t afc = nullptr;
+    };
+
+    afc_client_t connectAfc();
+    void runWorker(int index, int run);
+    bool takeWork(int index, WorkItem &item);
+    void scanDirectory(Worker &worker, const WorkItem &item, bool fullScan);
+    void finishScan(int run, bool success);
+    void onDeviceRemoved(const std::string &udid);
+
+    const Tree &shownTree() const;
+    QString savePath() const;
+    static bool save(const QString &path, const Tree &tree);
+    static bool load(const QString &path, Tree &tree);
+
+    iDescriptorDevice *m_device;
+    Root m_root;
+    QString m_udid;
+
+    mutable QMutex m_treeMutex;
+    Tree m_scan;  // being built
+    Tree m_saved; // last finished scan, shown until the rescan completes
+    bool m_hasSaved = false;
+    QHash<QString, SavedDir> m_savedDirs;
+
+    QThreadPool m_pool;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    QMutex m_idleMutex;
+    QWaitCondition m_workAvailable;
+    std::atomic<int> m_pending{0}; // directories queued or being scanned
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<bool> m_failed{false}; // AFC errors, the scan has holes
+    std::atomic<bool> m_dirty{false};
+    std::atomic<int> m_activeWorkers{0};
+    std::atomic<quint64> m_dirsScanned{0};
+    std::atomic<quint64> m_filesStatted{0};
+    bool m_fullScan = false;
+    bool m_running = false;
+    int m_runId = 0;
+    QTimer *m_updateTimer;
+};
+
+#endif // STORAGEANALYZER_H
@@ -0,0 +1,221 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "storageanalyzerwidget.h"
+#include "appcontext.h"
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLocale>
+#include <QSplitter>
+#include <QVBoxLayout>
+
+StorageAnalyzerWidget::StorageAnalyzerWidget(iDescriptorDevice *device,
+                                             QWidget *parent)
+    : QWidget(parent), m_device(device)
+{
+    setupUI();
+    setRoot(StorageAnalyzer::Root::Media);
+
+    connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
+            [this](const std::string &udid) {
+                if (m_device->udid == udid) {
+                    this->close();
+                    this->deleteLater();
+                }
+            });
+}
+
+void StorageAnalyzerWidget::setupUI()
+{
+    setWindowTitle("Storage - iDescriptor");
+    resize(900, 600);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    QHBoxLayout *toolbar = new QHBoxLayout();
+    m_rootCombo = new QComboBox(this);
+    m_rootCombo->addItem(
+        StorageAnalyzer::rootName(StorageAnalyzer::Root::Media),
+        int(StorageAnalyzer::Root::Media));
+    // Everything outside the media folder needs AFC2
+    if (m_device->afc2Client) {
+        m_rootCombo->addItem(
+            StorageAnalyzer::rootName(StorageAnalyzer::Root::Filesystem),
+            int(StorageAnalyzer::Root::Filesystem));
+    }
+    connect(m_rootCombo, &QComboBox::currentIndexChanged, this, [this]() {
+        setRoot(StorageAnalyzer::Root(m_rootCombo->currentData().toInt()));
+    });
+
+    m_rescanButton = new QPushButton("Rescan", this);
+    connect(m_rescanButton, &QPushButton::clicked, this, [this]() {
+        if (m_analyzer->isRunning()) {
+            m_analyzer->cancel();
+        } else {
+            m_analyzer->start();
+        }
+        updateStatus();
+    });
+
+    m_fullScanButton = new QPushButton("Full Scan", this);
+    m_fullScanButton->setToolTip("Stat every file again instead of reusing "
+                                 "unchanged folders from the last scan");
+    connect(m_fullScanButton, &QPushButton::clicked, this, [this]() {
+        m_analyzer->start(true);
+        updateStatus();
+    });
+
+    m_statusLabel = new QLabel(this);
+    toolbar->addWidget(m_rootCombo);
+    toolbar->addWidget(m_rescanButton);
+    toolbar->addWidget(m_fullScanButton);
+    toolbar->addWidget(m_statusLabel, 1);
+    mainLayout->addLayout(toolbar);
+
+    QHBoxLayout *pathLayout = new QHBoxLayout();
+    m_upButton = new QPushButton("Up", this);
+    connect(m_upButton, &QPushButton::clicked, this, [this]() {
+        openDirectory(m_analyzer->parentOf(m_currentDir));
+    });
+    m_pathLabel = new QLabel(this);
+    m_pathLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    pathLayout->addWidget(m_upButton);
+    pathLayout->addWidget(m_pathLabel, 1);
+    mainLayout->addLayout(pathLayout);
+
+    QSplitter *splitter = new QSplitter(Qt::Horizontal, this);
+    m_treemap = new StorageTreemapWidget(splitter);
+    connect(m_treemap, &StorageTreemapWidget::directoryActivated, this,
+            &StorageAnalyzerWidget::openDirectory);
+
+    m_largestList = new QTreeWidget(splitter);
+    m_largestList->setHeaderLabels({"Largest Files", "Size"});
+    m_largestList->setRootIsDecorated(false);
+    m_largestList->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    m_largestList->header()->setStretchLastSection(false);
+
+    splitter->addWidget(m_treemap);
+    splitter->addWidget(m_largestList);
+    splitter->setStretchFactor(0, 3);
+    splitter->setStretchFactor(1, 2);
+    mainLayout->addWidget(splitter, 1);
+}
+
+void StorageAnalyzerWidget::setRoot(StorageAnalyzer::Root root)
+{
+    delete m_analyzer;
+    m_analyzer = new StorageAnalyzer(m_device, root, this);
+    m_currentDir = StorageAnalyzer::RootNode;
+    m_currentPath = "/";
+
+    connect(m_analyzer, &StorageAnalyzer::updated, this,
+            &StorageAnalyzerWidget::refresh);
+    connect(m_analyzer, &StorageAnalyzer::finished, this, [this]() {
+        // A finished rescan replaces the shown tree, ids change with it
+        const int id = findDirectory(m_currentPath);
+        m_currentDir = id >= 0 ? id : StorageAnalyzer::RootNode;
+        refresh();
+    });
+
+    m_analyzer->loadSaved();
+    m_analyzer->start();
+    refresh();
+}
+
+void StorageAnalyzerWidget::openDirectory(int id)
+{
+    if (id < 0) {
+        return;
+    }
+    m_currentDir = id;
+    m_currentPath = m_analyzer->pathOf(id);
+    refresh();
+}
+
+int StorageAnalyzerWidget::findDirectory(const QString &path) const
+{
+    int id = StorageAnalyzer::RootNode;
+    const QStringList parts = path.split('/', Qt::SkipEmptyParts);
+    for (const QString &part : parts) {
+        int next = -1;
+        for (const StorageDirInfo &child : m_analyzer->children(id)) {
+            if (child.name == part) {
+                next = child.id;
+                break;
+            }
+        }
+        if (next < 0) {
+            return -1;
+        }
+        id = next;
+    }
+    return id;
+}
+
+void StorageAnalyzerWidget::refresh()
+{
+    StorageDirInfo dir = m_analyzer->dir(m_currentDir);
+    if (dir.id < 0) {
+        m_currentDir = StorageAnalyzer::RootNode;
+        m_currentPath = "/";
+        dir = m_analyzer->dir(m_currentDir);
+    }
+
+    m_treemap->setDirectory(dir, m_analyzer->children(m_currentDir));
+    m_upButton->setEnabled(m_currentDir != StorageAnalyzer::RootNode);
+    m_pathLabel->setText(QString("%1 (%2)").arg(
+        m_currentPath, QLocale().formattedDataSize(dir.totalBytes)));
+
+    const QLocale locale;
+    m_largestList->clear();
+    for (const StorageFile &file : m_analyzer->largestFiles()) {
+        auto *item = new QTreeWidgetItem(m_largestList);
+        item->setText(0, file.path);
+        item->setText(1, locale.formattedDataSize(file.size));
+        item->setToolTip(0, file.path);
+        item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    updateStatus();
+}
+
+void StorageAnalyzerWidget::updateStatus()
+{
+    const bool running = m_analyzer->isRunning();
+    m_rescanButton->setText(running ? "Stop" : "Rescan");
+    m_fullScanButton->setEnabled(!running);
+
+    const QDateTime scannedAt = m_analyzer->scannedAt();
+    QString status;
+    if (running) {
+        status = QString("Scanning... %1 folders, %2 items")
+                     .arg(m_analyzer->directoriesScanned())
+                     .arg(m_analyzer->filesStatted());
+        if (scannedAt.isValid()) {
+            status += " - showing scan from " +
+                      QLocale().toString(scannedAt, QLocale::ShortFormat);
+        }
+    } else if (scannedAt.isValid()) {
+        status = "Scanned " +
+                 QLocale().toString(scannedAt, QLocale::ShortFormat);
+    } else {
+        status = "Scan incomplete";
+    }
+    m_statusLabel->setText(status);
+}
@@ -0,0 +1,68 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STORAGEANALYZERWIDGET_H
+#define STORAGEANALYZERWIDGET_H
+
+#include "iDescriptor.h"
+#include "storageanalyzer.h"
+#include "storagetreemapwidget.h"
+#include <QComboBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QWidget>
+
+/**
+ * @brief Window showing where the space on a device goes
+ *
+ * Opens with the last saved scan of the chosen root and refreshes it with a
+ * delta rescan in the background.
+ */
+class StorageAnalyzerWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit StorageAnalyzerWidget(iDescriptorDevice *device,
+                                   QWidget *parent = nullptr);
+
+private:
+    void setupUI();
+    void setRoot(StorageAnalyzer::Root root);
+    void openDirectory(int id);
+    int findDirectory(const QString &path) const;
+    void refresh();
+    void updateStatus();
+
+    iDescriptorDevice *m_device;
+    StorageAnalyzer *m_analyzer = nullptr;
+    int m_currentDir = StorageAnalyzer::RootNode;
+    QString m_currentPath = "/";
+
+    QComboBox *m_rootCombo;
+    QPushButton *m_rescanButton;
+    QPushButton *m_fullScanButton;
+    QPushButton *m_upButton;
+    QLabel *m_pathLabel;
+    QLabel *m_statusLabel;
+    StorageTreemapWidget *m_treemap;
+    QTreeWidget *m_largestList;
+};
+
+#endif // STORAGEANALYZERWIDGET_H
@@ -0,0 +1,204 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "storagetreemapwidget.h"
+#include <QLocale>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+#include <algorithm>
+#include <limits>
+
+StorageTreemapWidget::StorageTreemapWidget(QWidget *parent) : QWidget(parent)
+{
+    setMouseTracking(true);
+    setMinimumSize(300, 200);
+}
+
+void StorageTreemapWidget::setDirectory(const StorageDirInfo &dir,
+                                        const QList<StorageDirInfo> &children)
+{
+    m_items.clear();
+    for (const StorageDirInfo &child : children) {
+        if (child.totalBytes > 0) {
+            m_items.append({child.id, child.name, child.totalBytes,
+                            child.totalFiles, child.complete, QRectF()});
+        }
+    }
+    if (dir.ownBytes > 0) {
+        m_items.append({FilesItem, "(files)", dir.ownBytes, dir.ownFiles,
+                        true, QRectF()});
+    }
+
+    std::sort(m_items.begin(), m_items.end(),
+              [](const Item &a, const Item &b) { return a.bytes > b.bytes; });
+
+    if (m_items.size() > MaxItems) {
+        Item other{OtherItem, "Other", 0, 0, true, QRectF()};
+        for (int i = MaxItems - 1; i < m_items.size(); ++i) {
+            other.bytes += m_items[i].bytes;
+            other.files += m_items[i].files;
+        }
+        m_items.resize(MaxItems - 1);
+        m_items.append(other);
+    }
+
+    layoutItems();
+    update();
+}
+
+/*
+ * Squarified layout (Bruls et al.): items are added to the current row
+ * along the shorter side for as long as that improves the row's worst
+ * aspect ratio, then the row is fixed and the rest goes into what's left.
+ */
+void StorageTreemapWidget::layoutItems()
+{
+    QRectF rect = QRectF(contentsRect()).adjusted(1, 1, -1, -1);
+    quint64 total = 0;
+    for (const Item &item : std::as_const(m_items)) {
+        total += item.bytes;
+    }
+    if (total == 0 || rect.isEmpty()) {
+        return;
+    }
+
+    const double scale = rect.width() * rect.height() / double(total);
+    int i = 0;
+    while (i < m_items.size()) {
+        const double side = qMin(rect.width(), rect.height());
+        if (side <= 0) {
+            break;
+        }
+
+        const double largest = m_items[i].bytes * scale;
+        double rowArea = 0;
+        double worst = std::numeric_limits<double>::max();
+        int end = i;
+        while (end < m_items.size()) {
+            const double area = m_items[end].bytes * scale;
+            const double row = rowArea + area;
+            const double ratio = qMax(side * side * largest / (row * row),
+                                      row * row / (side * side * area));
+            if (end > i && ratio > worst) {
+                break;
+            }
+            worst = ratio;
+            rowArea = row;
+            ++end;
+        }
+
+        const double thickness = rowArea / side;
+        const bool vertical = rect.width() >= rect.height();
+        double offset = 0;
+        for (int k = i; k < end; ++k) {
+            const double length = m_items[k].bytes * scale / thickness;
+            m_items[k].rect =
+                vertical ? QRectF(rect.left(), rect.top() + offset, thickness,
+                                  length)
+                         : QRectF(rect.left() + offset, rect.top(), length,
+                                  thickness);
+            offset += length;
+        }
+        if (vertical) {
+            rect.setLeft(rect.left() + thickness);
+        } else {
+            rect.setTop(rect.top() + thickness);
+        }
+        i = end;
+    }
+}
+
+const StorageTreemapWidget::Item *
+StorageTreemapWidget::itemAt(const QPointF &pos) const
+{
+    for (const Item &item : m_items) {
+        if (item.rect.contains(pos)) {
+            return &item;
+        }
+    }
+    return nullptr;
+}
+
+void StorageTreemapWidget::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    if (m_items.isEmpty()) {
+        painter.setPen(palette().color(QPalette::PlaceholderText));
+        painter.drawText(rect(), Qt::AlignCenter, "Nothing to show yet");
+        return;
+    }
+
+    const QFontMetrics metrics(font());
+    const QLocale locale;
+    for (int i = 0; i < m_items.size(); ++i) {
+        const Item &item = m_items[i];
+        QColor color = item.id < 0 ? QColor(150, 150, 150)
+                                   : QColor::fromHsv((i * 47) % 360, 110, 215);
+        if (!item.complete) {
+            color = color.lighter(115);
+        }
+
+        painter.setPen(palette().color(QPalette::Window));
+        painter.setBrush(color);
+        painter.drawRect(item.rect);
+
+        const QRectF text = item.rect.adjusted(4, 2, -4, -2);
+        if (text.width() < 40 || text.height() < metrics.height()) {
+            continue;
+        }
+        painter.setPen(Qt::black);
+        QString label = metrics.elidedText(item.name, Qt::ElideMiddle,
+                                           int(text.width()));
+        if (text.height() >= metrics.height() * 2) {
+            label += '\n' + locale.formattedDataSize(item.bytes);
+        }
+        painter.drawText(text, Qt::AlignLeft | Qt::AlignTop, label);
+    }
+}
+
+void StorageTreemapWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    layoutItems();
+}
+
+void StorageTreemapWidget::mouseMoveEvent(QMouseEvent *event)
+{
+    const Item *item = itemAt(event->position());
+    if (!item) {
+        QToolTip::hideText();
+        return;
+    }
+    QToolTip::showText(event->globalPosition().toPoint(),
+                       QString("%1\n%2 in %3 files")
+                           .arg(item->name)
+                           .arg(QLocale().formattedDataSize(item->bytes))
+                           .arg(item->files),
+                       this);
+    setCursor(item->id >= 0 ? Qt::PointingHandCursor : Qt::ArrowCursor);
+}
+
+void StorageTreemapWidget::mouseReleaseEvent(QMouseEvent *event)
+{
+    const Item *item = itemAt(event->position());
+    if (event->button() == Qt::LeftButton && item && item->id >= 0) {
+        emit directoryActivated(item->id);
+    }
+}
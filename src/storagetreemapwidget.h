@@ -0,0 +1,73 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef STORAGETREEMAPWIDGET_H
+#define STORAGETREEMAPWIDGET_H
+
+#include "storageanalyzer.h"
+#include <QRectF>
+#include <QVector>
+#include <QWidget>
+
+/**
+ * @brief Squarified treemap of one directory's subdirectories
+ *
+ * Direct files of the directory are drawn as a single gray block and
+ * anything past MaxItems is merged into "Other", so a directory with tens
+ * of thousands of children still lays out instantly.
+ */
+class StorageTreemapWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit StorageTreemapWidget(QWidget *parent = nullptr);
+
+    void setDirectory(const StorageDirInfo &dir,
+                      const QList<StorageDirInfo> &children);
+
+signals:
+    void directoryActivated(int id);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+
+private:
+    static constexpr int MaxItems = 150;
+    static constexpr int FilesItem = -1;
+    static constexpr int OtherItem = -2;
+
+    struct Item {
+        int id;
+        QString name;
+        quint64 bytes;
+        quint64 files;
+        bool complete;
+        QRectF rect;
+    };
+
+    void layoutItems();
+    const Item *itemAt(const QPointF &pos) const;
+
+    QVector<Item> m_items; // biggest first
+};
+
+#endif // STORAGETREEMAPWIDGET_H
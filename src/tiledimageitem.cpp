@@ -0,0 +1,168 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "tiledimageitem.h"
+#include <QFutureWatcher>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+// 128 MB of decoded tiles
+static const int TILE_CACHE_COST = 128 * 1024 * 1024;
+static const int MAX_PENDING_TILES = 8;
+
+// Separate pool so tile decodes never queue behind gallery thumbnails
+static QThreadPool *tilePool()
+{
+    static QThreadPool *pool = [] {
+        auto *p = new QThreadPool();
+        p->setMaxThreadCount(2);
+        return p;
+    }();
+    return pool;
+}
+
+TiledImageItem::TiledImageItem(const QSize &imageSize, QGraphicsItem *parent)
+    : QGraphicsObject(parent), m_imageSize(imageSize)
+{
+    // Needed for option->exposedRect in paint()
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    m_tileCache.setMaxCost(TILE_CACHE_COST);
+}
+
+void TiledImageItem::setImageSize(const QSize &imageSize)
+{
+    if (imageSize == m_imageSize) {
+        return;
+    }
+    prepareGeometryChange();
+    m_imageSize = imageSize;
+    m_tileCache.clear();
+}
+
+void TiledImageItem::setPreview(const QPixmap &preview)
+{
+    m_preview = preview;
+    update();
+}
+
+void TiledImageItem::setTileSource(
+    const std::shared_ptr<ImageTileSource> &source)
+{
+    m_source = source;
+    m_tileCache.clear();
+    m_pendingTiles.clear();
+    update();
+}
+
+QRectF TiledImageItem::boundingRect() const
+{
+    return QRectF(QPointF(0, 0), m_imageSize);
+}
+
+void TiledImageItem::paint(QPainter *painter,
+                           const QStyleOptionGraphicsItem *option,
+                           QWidget *widget)
+{
+    Q_UNUSED(widget)
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+
+    const QRectF bounds = boundingRect();
+    if (!m_preview.isNull()) {
+        painter->drawPixmap(bounds, m_preview, QRectF(m_preview.rect()));
+    }
+
+    if (!m_source || m_preview.isNull()) {
+        return;
+    }
+
+    // Device pixels per image pixel; stay on the preview while it still has
+    // at least as much detail as the screen can show
+    const qreal lod =
+        option->levelOfDetailFromTransform(painter->worldTransform());
+    if (lod * m_imageSize.width() <= m_preview.width()) {
+        return;
+    }
+
+    const QRect exposed = option->exposedRect.toAlignedRect() &
+                          QRect(QPoint(0, 0), m_imageSize);
+    if (exposed.isEmpty()) {
+        return;
+    }
+
+    const QSize tile = m_source->tileSize();
+    const int firstColumn = exposed.left() / tile.width();
+    const int lastColumn = exposed.right() / tile.width();
+    const int firstRow = exposed.top() / tile.height();
+    const int lastRow = exposed.bottom() / tile.height();
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            if (QPixmap *cached = m_tileCache.object(tileKey(column, row))) {
+                painter->drawPixmap(m_source->tileRect(column, row), *cached);
+            } else {
+                requestTile(column, row);
+            }
+        }
+    }
+}
+
+void TiledImageItem::requestTile(int column, int row)
+{
+    const quint64 key = tileKey(column, row);
+    if (m_pendingTiles.contains(key)) {
+        return;
+    }
+    if (m_pendingTiles.size() >= MAX_PENDING_TILES) {
+        m_hasDeferredTiles = true;
+        return;
+    }
+    m_pendingTiles.insert(key);
+
+    auto *watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcher<QImage>::finished, this,
+            [this, watcher, key, column, row,
+             source = std::weak_ptr<ImageTileSource>(m_source)]() {
+                watcher->deleteLater();
+                // Source was swapped out while this tile was decoding
+                if (source.lock() != m_source ||
+                    !m_pendingTiles.remove(key)) {
+                    return;
+                }
+
+                const QImage image = watcher->result();
+                if (!image.isNull()) {
+                    m_tileCache.insert(key,
+                                       new QPixmap(QPixmap::fromImage(image)),
+                                       image.width() * image.height() * 4);
+                    update(m_source->tileRect(column, row));
+                }
+
+                if (m_hasDeferredTiles && m_pendingTiles.isEmpty()) {
+                    m_hasDeferredTiles = false;
+                    update();
+                }
+            });
+
+    watcher->setFuture(QtConcurrent::run(
+        tilePool(), [source = m_source, column, row]() {
+            return source->decodeTile(column, row);
+        }));
+}
@@ -0,0 +1,75 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TILEDIMAGEITEM_H
+#define TILEDIMAGEITEM_H
+
+#include "imagetilesource.h"
+#include <QCache>
+#include <QGraphicsObject>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <memory>
+
+/**
+ * @brief Graphics item that shows a preview and refines it with tiles
+ *
+ * The item is laid out in full-resolution pixel coordinates. Until the view
+ * is zoomed past what the preview pixmap can show, only the preview is
+ * drawn. Beyond that, the visible full-resolution tiles are decoded on a
+ * small worker pool and kept in an LRU cache.
+ */
+class TiledImageItem : public QGraphicsObject
+{
+    Q_OBJECT
+
+public:
+    explicit TiledImageItem(const QSize &imageSize,
+                            QGraphicsItem *parent = nullptr);
+
+    void setImageSize(const QSize &imageSize);
+    QSize imageSize() const { return m_imageSize; }
+
+    void setPreview(const QPixmap &preview);
+    void setTileSource(const std::shared_ptr<ImageTileSource> &source);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option,
+               QWidget *widget = nullptr) override;
+
+private:
+    void requestTile(int column, int row);
+    static quint64 tileKey(int column, int row)
+    {
+        return (static_cast<quint64>(column) << 32) |
+               static_cast<quint32>(row);
+    }
+
+    QSize m_imageSize;
+    QPixmap m_preview;
+    std::shared_ptr<ImageTileSource> m_source;
+
+    QCache<quint64, QPixmap> m_tileCache;
+    QSet<quint64> m_pendingTiles;
+    // Set when visible tiles were skipped because too many were in flight
+    bool m_hasDeferredTiles = false;
+};
+
+#endif // TILEDIMAGEITEM_H
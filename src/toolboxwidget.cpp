@@ -29,7 +29,9 @@
 #include "ifusewidget.h"
 #endif
 #include "livescreenwidget.h"
+#include "performancediagnosticswidget.h"
 #include "querymobilegestaltwidget.h"
+#include "servicebroker.h"
 #include "virtuallocationwidget.h"
 #include "wirelessgalleryimportwidget.h"
 #include <QApplication>
@@ -46,32 +48,14 @@ struct iDescriptorToolWidget {
 
 bool enterRecoveryMode(iDescriptorDevice *device)
 {
-    lockdownd_client_t client = NULL;
-    lockdownd_error_t ldret = LOCKDOWN_E_UNKNOWN_ERROR;
-    idevice_error_t ret = IDEVICE_E_UNKNOWN_ERROR;
-
-    if (LOCKDOWN_E_SUCCESS !=
-        (ldret = lockdownd_client_new(device->device, &client, APP_LABEL))) {
-        printf("ERROR: Could not connect to lockdownd: %s (%d)\n",
-               lockdownd_strerror(ldret), ldret);
-        return false;
-    }
-
-    ldret = lockdownd_enter_recovery(client);
-    if (ldret == LOCKDOWN_E_SESSION_INACTIVE) {
-        lockdownd_client_free(client);
-        client = NULL;
-        if (LOCKDOWN_E_SUCCESS != (ldret = lockdownd_client_new_with_handshake(
-                                       device->device, &client, APP_LABEL))) {
-            printf("ERROR: Could not connect to lockdownd: %s (%d)\n",
-                   lockdownd_strerror(ldret), ldret);
-            return false;
-        }
-        ldret = lockdownd_enter_recovery(client);
-    }
-    lockdownd_client_free(client);
+    // The broker reopens the session itself if it went inactive
+    lockdownd_error_t ldret = ServiceBroker::sharedInstance()->withLockdown(
+        device->device, [](lockdownd_client_t client) {
+            return lockdownd_enter_recovery(client);
+        });
     if (ldret != LOCKDOWN_E_SUCCESS) {
-        printf("Failed to enter recovery mode.\n");
+        printf("Failed to enter recovery mode: %s (%d)\n",
+               lockdownd_strerror(ldret), ldret);
         return false;
     } else {
         printf("Device is successfully switching to recovery mode.\n");
@@ -191,6 +175,12 @@ void ToolboxWidget::setupUI()
         {iDescriptorTool::Shutdown, "Shut down the device", true, ""});
     moreToolWidgets.append({iDescriptorTool::RecoveryMode,
                             "Enter device recovery mode", true, ""});
+    moreToolWidgets.append(
+        {iDescriptorTool::PerformanceDiagnostics,
+         "Measure where time goes in device operations", false, ""});
+    moreToolWidgets.append({iDescriptorTool::FleetOperations,
+                            "Run an action on many devices at once", false,
+                            ""});
 
     for (int i = 0; i < moreToolWidgets.size(); ++i) {
         const auto &tool = moreToolWidgets[i];
@@ -284,6 +274,15 @@ ClickableWidget *ToolboxWidget::createToolbox(iDescriptorTool tool,
         icon->setIcon(QIcon(
             ":/resources/icons/StreamlineUltimateMultipleUsersNetwork.png"));
         break;
+    case iDescriptorTool::PerformanceDiagnostics:
+        title = "Performance Diagnostics";
+        icon->setIcon(QIcon(":/resources/icons/MdiLightningBolt.png"));
+        break;
+    case iDescriptorTool::FleetOperations:
+        title = "Fleet Operations";
+        icon->setIcon(
+            QIcon(":/resources/icons/IconParkTwotoneMoreTwo.png"));
+        break;
     default:
         title = "Unknown Tool";
         break;
@@ -546,6 +545,35 @@ void ToolboxWidget::onToolboxClicked(iDescriptorTool tool)
             m_networkDevicesWidget->activateWindow();
         }
     } break;
+    case iDescriptorTool::PerformanceDiagnostics: {
+        if (!m_performanceDiagnosticsWidget) {
+            m_performanceDiagnosticsWidget =
+                new PerformanceDiagnosticsWidget();
+            m_performanceDiagnosticsWidget->setAttribute(Qt::WA_DeleteOnClose);
+            m_performanceDiagnosticsWidget->setWindowFlag(Qt::Window);
+            m_performanceDiagnosticsWidget->resize(800, 500);
+            connect(m_performanceDiagnosticsWidget, &QObject::destroyed, this,
+                    [this]() { m_performanceDiagnosticsWidget = nullptr; });
+            m_performanceDiagnosticsWidget->show();
+        } else {
+            m_performanceDiagnosticsWidget->raise();
+            m_performanceDiagnosticsWidget->activateWindow();
+        }
+    } break;
+    case iDescriptorTool::FleetOperations: {
+        if (!m_fleetWidget) {
+            m_fleetWidget = new FleetWidget();
+            m_fleetWidget->setAttribute(Qt::WA_DeleteOnClose);
+            m_fleetWidget->setWindowFlag(Qt::Window);
+            m_fleetWidget->resize(900, 600);
+            connect(m_fleetWidget, &QObject::destroyed, this,
+                    [this]() { m_fleetWidget = nullptr; });
+            m_fleetWidget->show();
+        } else {
+            m_fleetWidget->raise();
+            m_fleetWidget->activateWindow();
+        }
+    } break;
     default:
         qDebug() << "Clicked on unimplemented tool";
         break;
@@ -566,7 +594,7 @@ void ToolboxWidget::restartDevice(iDescriptorDevice *device)
         return;
     }
 
-    if (!(restart(device->udid)))
+    if (!(restart(device->device)))
         warn("Failed to restart device");
     else {
         warn("Device will restart once unplugged", "Success");
@@ -23,9 +23,11 @@
 #include "airplaywindow.h"
 #include "devdiskimageswidget.h"
 #include "devicesidebarwidget.h"
+#include "fleetwidget.h"
 #include "iDescriptor-ui.h"
 #include "iDescriptor.h"
 #include "networkdeviceswidget.h"
+#include "performancediagnosticswidget.h"
 #include "wirelessgalleryimportwidget.h"
 #include <QComboBox>
 #include <QGridLayout>
@@ -72,6 +74,8 @@ private:
     DevDiskImagesWidget *m_devDiskImagesWidget = nullptr;
     NetworkDevicesWidget *m_networkDevicesWidget = nullptr;
     AirPlayWindow *m_airplayWindow = nullptr;
+    PerformanceDiagnosticsWidget *m_performanceDiagnosticsWidget = nullptr;
+    FleetWidget *m_fleetWidget = nullptr;
 #ifndef __APPLE__
     iFuseWidget *m_ifuseWidget = nullptr;
 #endif
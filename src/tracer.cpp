@@ -0,0 +1,234 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "tracer.h"
+#include "iDescriptor.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Tracer::s_enabled{false};
+
+namespace
+{
+
+const int DEFAULT_CAPACITY = 100000;
+
+struct TraceEvent {
+    const char *category = nullptr;
+    const char *name = nullptr;
+    qint64 startUs = 0;
+    qint64 durationUs = 0;
+    int threadId = 0;
+    std::string udid;
+    QString detail;
+};
+
+struct TraceBuffer {
+    std::mutex mutex;
+    std::vector<TraceEvent> events =
+        std::vector<TraceEvent>(DEFAULT_CAPACITY);
+    size_t next = 0;
+    size_t size = 0;
+    QHash<int, QString> threadNames;
+};
+
+TraceBuffer &buffer()
+{
+    static TraceBuffer instance;
+    return instance;
+}
+
+const QElapsedTimer &clock()
+{
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+    return timer;
+}
+
+std::atomic<int> nextThreadId{1};
+
+// Called with the buffer mutex held
+int currentThreadId(TraceBuffer &trace)
+{
+    thread_local int threadId = 0;
+    if (threadId == 0) {
+        threadId = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+        QThread *thread = QThread::currentThread();
+        QString name = thread ? thread->objectName() : QString();
+        if (name.isEmpty()) {
+            const QCoreApplication *app = QCoreApplication::instance();
+            name = app && thread == app->thread()
+                       ? QString("main")
+                       : QString("thread %1").arg(threadId);
+        }
+        trace.threadNames.insert(threadId, name);
+    }
+    return threadId;
+}
+
+} // namespace
+
+void Tracer::setEnabled(bool enabled)
+{
+    // Pin the time base before the first event
+    clock();
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::setCapacity(int events)
+{
+    TraceBuffer &trace = buffer();
+    std::lock_guard lock(trace.mutex);
+    trace.events.assign(qMax(events, 1), TraceEvent());
+    trace.next = 0;
+    trace.size = 0;
+}
+
+int Tracer::capacity()
+{
+    TraceBuffer &trace = buffer();
+    std::lock_guard lock(trace.mutex);
+    return static_cast<int>(trace.events.size());
+}
+
+qint64 Tracer::nowUs() { return clock().nsecsElapsed() / 1000; }
+
+void Tracer::addCompleteEvent(const char *category, const char *name,
+                              qint64 startUs, qint64 durationUs,
+                              const std::string &udid, const QString &detail)
+{
+    TraceBuffer &trace = buffer();
+    std::lock_guard lock(trace.mutex);
+
+    TraceEvent &event = trace.events[trace.next];
+    event.category = category;
+    event.name = name;
+    event.startUs = startUs;
+    event.durationUs = durationUs;
+    event.threadId = currentThreadId(trace);
+    event.udid = udid;
+    event.detail = detail;
+
+    trace.next = (trace.next + 1) % trace.events.size();
+    trace.size = qMin(trace.size + 1, trace.events.size());
+}
+
+QByteArray Tracer::toJson(int lastSeconds)
+{
+    const qint64 cutoff =
+        lastSeconds > 0 ? nowUs() - qint64(lastSeconds) * 1000000 : -1;
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray events;
+    QHash<int, QString> threadNames;
+    {
+        TraceBuffer &trace = buffer();
+        std::lock_guard lock(trace.mutex);
+        threadNames = trace.threadNames;
+
+        // Oldest first, the ring starts right after the newest event
+        const size_t capacity = trace.events.size();
+        const size_t first = (trace.next + capacity - trace.size) % capacity;
+        for (size_t i = 0; i < trace.size; ++i) {
+            const TraceEvent &event = trace.events[(first + i) % capacity];
+            if (event.startUs + event.durationUs < cutoff) {
+                continue;
+            }
+
+            QJsonObject args;
+            if (!event.udid.empty()) {
+                args["udid"] = QString::fromStdString(event.udid);
+            }
+            if (!event.detail.isEmpty()) {
+                args["detail"] = event.detail;
+            }
+            events.append(QJsonObject{{"name", event.name},
+                                      {"cat", event.category},
+                                      {"ph", "X"},
+                                      {"ts", event.startUs},
+                                      {"dur", event.durationUs},
+                                      {"pid", pid},
+                                      {"tid", event.threadId},
+                                      {"args", args}});
+        }
+    }
+
+    for (auto it = threadNames.cbegin(); it != threadNames.cend(); ++it) {
+        events.append(QJsonObject{{"name", "thread_name"},
+                                  {"ph", "M"},
+                                  {"pid", pid},
+                                  {"tid", it.key()},
+                                  {"args", QJsonObject{{"name", it.value()}}}});
+    }
+
+    return QJsonDocument(QJsonObject{{"traceEvents", events},
+                                     {"displayTimeUnit", "ms"}})
+        .toJson(QJsonDocument::Compact);
+}
+
+void Tracer::clear()
+{
+    TraceBuffer &trace = buffer();
+    std::lock_guard lock(trace.mutex);
+    trace.next = 0;
+    trace.size = 0;
+}
+
+TraceSpan::TraceSpan(const char *category, const char *name,
+                     const iDescriptorDevice *device)
+    : m_category(category), m_name(name), m_active(Tracer::isEnabled())
+{
+    if (m_active) {
+        if (device) {
+            m_udid = device->udid;
+        }
+        m_startUs = Tracer::nowUs();
+    }
+}
+
+TraceSpan::TraceSpan(const char *category, const char *name,
+                     const char *udid)
+    : m_category(category), m_name(name), m_active(Tracer::isEnabled())
+{
+    if (m_active) {
+        if (udid) {
+            m_udid = udid;
+        }
+        m_startUs = Tracer::nowUs();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (m_active) {
+        Tracer::addCompleteEvent(m_category, m_name, m_startUs,
+                                 Tracer::nowUs() - m_startUs, m_udid,
+                                 m_detail);
+    }
+}
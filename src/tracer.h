@@ -0,0 +1,101 @@
+/*
+ * iDescriptor: A free and open-source idevice management tool.
+ *
+ * Copyright (C) 2025 Uncore <https://github.com/uncor3>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include <string>
+
+struct iDescriptorDevice;
+
+/**
+ * @brief Chrome/Perfetto trace-event recorder for device work
+ *
+ * Spans are kept in a fixed-size ring buffer, so tracing can stay on in the
+ * background and the last N seconds can be saved after a stall. The output
+ * loads in chrome://tracing and ui.perfetto.dev, one track per thread,
+ * every event tagged with the device UDID.
+ *
+ * Disabled by default, a disabled TraceSpan costs a single relaxed load.
+ */
+class Tracer
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    // Number of events kept, older ones are overwritten
+    static void setCapacity(int events);
+    static int capacity();
+
+    // Monotonic microseconds, the trace's time base
+    static qint64 nowUs();
+
+    // category and name must be string literals, they are stored as is
+    static void addCompleteEvent(const char *category, const char *name,
+                                 qint64 startUs, qint64 durationUs,
+                                 const std::string &udid,
+                                 const QString &detail = QString());
+
+    // Trace-event JSON, restricted to the last lastSeconds if > 0
+    static QByteArray toJson(int lastSeconds = 0);
+    static void clear();
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+/**
+ * @brief RAII span, recorded as a complete ("X") event when it goes away
+ */
+class TraceSpan
+{
+public:
+    TraceSpan(const char *category, const char *name,
+              const iDescriptorDevice *device = nullptr);
+    TraceSpan(const char *category, const char *name, const char *udid);
+    ~TraceSpan();
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    // Shown in the event's args, e.g. a file name or byte count
+    void setDetail(const QString &detail)
+    {
+        if (m_active) {
+            m_detail = detail;
+        }
+    }
+    bool isActive() const { return m_active; }
+
+private:
+    const char *m_category;
+    const char *m_name;
+    bool m_active;
+    qint64 m_startUs = 0;
+    std::string m_udid;
+    QString m_detail;
+};
+
+#endif // TRACER_H
@@ -24,7 +24,10 @@
 #include "iDescriptor.h"
 #include "settingsmanager.h"
 #include <QDebug>
+#include <QDir>
 #include <QDoubleValidator>
+#include <QFileDialog>
+#include <QFileInfo>
 #include <QGeoCoordinate>
 #include <QGridLayout>
 #include <QGroupBox>
@@ -111,6 +114,8 @@ VirtualLocation::VirtualLocation(iDescriptorDevice *device, QWidget *parent)
     m_applyButton->setDefault(true);
     m_rightLayout->addWidget(m_applyButton);
 
+    setupRoutePlayback(m_rightLayout);
+
     // Recent locations section
     loadRecentLocations(m_rightLayout);
 
@@ -159,6 +164,8 @@ VirtualLocation::VirtualLocation(iDescriptorDevice *device, QWidget *parent)
     connect(AppContext::sharedInstance(), &AppContext::deviceRemoved, this,
             [this](const std::string &udid) {
                 if (m_device->udid == udid) {
+                    // Must be done before the device handle is freed
+                    stopRoute();
                     this->close();
                     this->deleteLater();
                 }
@@ -299,6 +306,8 @@ void VirtualLocation::updateInputsFromMap(double latitude, double longitude)
 
 void VirtualLocation::onApplyClicked()
 {
+    // A running route would immediately move the device away again
+    stopRoute();
     m_applyButton->setEnabled(false);
     bool latOk, lonOk;
     double latitude = m_latitudeEdit->text().toDouble(&latOk);
@@ -330,12 +339,8 @@ void VirtualLocation::onApplyClicked()
                 // Visual feedback
                 m_applyButton->setText("Applied!");
 
-                bool locationSuccess = set_location(
-                    m_device->device,
-                    const_cast<char *>(
-                        m_latitudeEdit->text().toStdString().c_str()),
-                    const_cast<char *>(
-                        m_longitudeEdit->text().toStdString().c_str()));
+                bool locationSuccess =
+                    set_location(m_device->device, latitude, longitude);
 
                 if (!locationSuccess) {
                     QMessageBox::warning(this, "Error",
@@ -486,3 +491,196 @@ void VirtualLocation::addLocationButtons(QLayout *layout,
         layout->addWidget(locationBtn);
     }
 }
+
+void VirtualLocation::setupRoutePlayback(QVBoxLayout *layout)
+{
+    QGroupBox *routeGroup = new QGroupBox("Route Playback");
+    layout->addWidget(routeGroup);
+    QVBoxLayout *routeLayout = new QVBoxLayout(routeGroup);
+
+    QPushButton *importButton = new QPushButton("Import GPX/KML...");
+    routeLayout->addWidget(importButton);
+
+    m_routeLabel = new QLabel("No route loaded");
+    m_routeLabel->setWordWrap(true);
+    routeLayout->addWidget(m_routeLabel);
+
+    QGridLayout *optionsLayout = new QGridLayout();
+    optionsLayout->addWidget(new QLabel("Speed:"), 0, 0);
+    m_speedSpin = new QDoubleSpinBox();
+    m_speedSpin->setRange(0.5, 300.0);
+    m_speedSpin->setDecimals(1);
+    m_speedSpin->setValue(5.0);
+    m_speedSpin->setSuffix(" km/h");
+    optionsLayout->addWidget(m_speedSpin, 0, 1);
+
+    optionsLayout->addWidget(new QLabel("Updates:"), 1, 0);
+    m_updateRateSpin = new QSpinBox();
+    m_updateRateSpin->setRange(1, 20);
+    m_updateRateSpin->setValue(10);
+    m_updateRateSpin->setSuffix(" Hz");
+    optionsLayout->addWidget(m_updateRateSpin, 1, 1);
+    routeLayout->addLayout(optionsLayout);
+
+    m_loopCheck = new QCheckBox("Loop");
+    routeLayout->addWidget(m_loopCheck);
+
+    m_seekSlider = new QSlider(Qt::Horizontal);
+    m_seekSlider->setRange(0, 1000);
+    m_seekSlider->setEnabled(false);
+    routeLayout->addWidget(m_seekSlider);
+
+    QHBoxLayout *buttonsLayout = new QHBoxLayout();
+    m_playRouteButton = new QPushButton("Play");
+    m_playRouteButton->setEnabled(false);
+    m_stopRouteButton = new QPushButton("Stop");
+    m_stopRouteButton->setEnabled(false);
+    buttonsLayout->addWidget(m_playRouteButton);
+    buttonsLayout->addWidget(m_stopRouteButton);
+    routeLayout->addLayout(buttonsLayout);
+
+    connect(importButton, &QPushButton::clicked, this,
+            &VirtualLocation::onImportRouteClicked);
+    connect(m_playRouteButton, &QPushButton::clicked, this,
+            &VirtualLocation::onPlayRouteClicked);
+    connect(m_stopRouteButton, &QPushButton::clicked, this,
+            &VirtualLocation::stopRoute);
+
+    // Settings apply to a running route right away
+    connect(m_speedSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, [this](double kmh) {
+                if (m_routePlayer)
+                    m_routePlayer->setSpeed(kmh / 3.6);
+            });
+    connect(m_updateRateSpin, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, [this](int hz) {
+                if (m_routePlayer)
+                    m_routePlayer->setUpdateRate(hz);
+            });
+    connect(m_loopCheck, &QCheckBox::toggled, this, [this](bool loop) {
+        if (m_routePlayer)
+            m_routePlayer->setLoop(loop);
+    });
+    connect(m_seekSlider, &QSlider::sliderReleased, this, [this]() {
+        if (m_routePlayer)
+            m_routePlayer->seek(m_seekSlider->value() / 1000.0);
+    });
+}
+
+void VirtualLocation::onImportRouteClicked()
+{
+    QString filePath = QFileDialog::getOpenFileName(
+        this, "Import Route", QDir::homePath(),
+        "Routes (*.gpx *.kml);;All Files (*)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    QString error;
+    QList<QGeoCoordinate> route = RoutePlayer::loadTrack(filePath, &error);
+    if (route.isEmpty()) {
+        QMessageBox::warning(this, "Import Failed",
+                             "Could not read the route:\n" + error);
+        return;
+    }
+
+    stopRoute();
+    m_route = route;
+
+    double length = 0;
+    for (int i = 1; i < m_route.size(); ++i) {
+        length += m_route[i - 1].distanceTo(m_route[i]);
+    }
+    m_routeLabel->setText(QString("%1\n%2 points, %3 km")
+                              .arg(QFileInfo(filePath).fileName())
+                              .arg(m_route.size())
+                              .arg(length / 1000.0, 0, 'f', 2));
+    m_playRouteButton->setEnabled(true);
+
+    // Show where the route starts
+    updateInputsFromMap(m_route.first().latitude(),
+                        m_route.first().longitude());
+    updateMapFromInputs();
+}
+
+void VirtualLocation::onPlayRouteClicked()
+{
+    if (m_routePlayer) {
+        const bool pause = !m_routePlayer->isPaused();
+        m_routePlayer->setPaused(pause);
+        m_playRouteButton->setText(pause ? "Resume" : "Pause");
+        return;
+    }
+
+    m_playRouteButton->setEnabled(false);
+    // The location service lives on the developer disk image
+    DevDiskImageHelper *devDiskImageHelper =
+        new DevDiskImageHelper(m_device, this);
+    connect(devDiskImageHelper, &DevDiskImageHelper::mountingCompleted, this,
+            [this, devDiskImageHelper](bool success) {
+                devDiskImageHelper->deleteLater();
+                m_playRouteButton->setEnabled(true);
+                if (success) {
+                    startRoute();
+                }
+            });
+    devDiskImageHelper->start();
+}
+
+void VirtualLocation::startRoute()
+{
+    if (m_route.isEmpty() || m_routePlayer) {
+        return;
+    }
+
+    m_routePlayer = new RoutePlayer(m_device, this);
+    m_routePlayer->setRoute(m_route);
+    m_routePlayer->setSpeed(m_speedSpin->value() / 3.6);
+    m_routePlayer->setUpdateRate(m_updateRateSpin->value());
+    m_routePlayer->setLoop(m_loopCheck->isChecked());
+
+    connect(m_routePlayer, &RoutePlayer::positionChanged, this,
+            &VirtualLocation::onRoutePositionChanged);
+    connect(m_routePlayer, &RoutePlayer::playbackError, this,
+            [this](const QString &message) {
+                QMessageBox::warning(this, "Route Playback", message);
+            });
+    connect(m_routePlayer, &QThread::finished, this,
+            &VirtualLocation::stopRoute);
+
+    m_playRouteButton->setText("Pause");
+    m_stopRouteButton->setEnabled(true);
+    m_seekSlider->setEnabled(true);
+    m_applyButton->setEnabled(false);
+    m_routePlayer->start();
+}
+
+void VirtualLocation::onRoutePositionChanged(double latitude,
+                                             double longitude, double progress)
+{
+    updateInputsFromMap(latitude, longitude);
+    updateMapFromInputs();
+    if (!m_seekSlider->isSliderDown()) {
+        m_seekSlider->setValue(qRound(progress * 1000));
+    }
+}
+
+void VirtualLocation::stopRoute()
+{
+    if (!m_routePlayer) {
+        return;
+    }
+
+    RoutePlayer *player = m_routePlayer;
+    m_routePlayer = nullptr;
+    player->disconnect(this);
+    player->stop();
+    player->wait();
+    player->deleteLater();
+
+    m_playRouteButton->setText("Play");
+    m_playRouteButton->setEnabled(!m_route.isEmpty());
+    m_stopRouteButton->setEnabled(false);
+    m_seekSlider->setEnabled(false);
+    m_applyButton->setEnabled(true);
+}
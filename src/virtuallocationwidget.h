@@ -22,10 +22,16 @@
 
 #include "devdiskimagehelper.h"
 #include "iDescriptor.h"
+#include "routeplayer.h"
+#include <QCheckBox>
+#include <QDoubleSpinBox>
 #include <QGroupBox>
+#include <QLabel>
 #include <QLineEdit>
 #include <QPushButton>
 #include <QQuickWidget>
+#include <QSlider>
+#include <QSpinBox>
 #include <QTimer>
 #include <QVBoxLayout>
 #include <QWidget>
@@ -51,8 +57,15 @@ private slots:
     void onApplyClicked();
     void updateMapFromInputs();
     void onRecentLocationClicked(double latitude, double longitude);
+    void onImportRouteClicked();
+    void onPlayRouteClicked();
+    void onRoutePositionChanged(double latitude, double longitude,
+                                double progress);
+    void stopRoute();
 
 private:
+    void setupRoutePlayback(QVBoxLayout *layout);
+    void startRoute();
     void loadRecentLocations(QVBoxLayout *layout);
     void refreshRecentLocations();
     void addLocationButtons(QLayout *layout,
@@ -67,6 +80,17 @@ private:
     iDescriptorDevice *m_device;
     QVBoxLayout *m_rightLayout = nullptr;
     QGroupBox *m_recentGroup = nullptr;
+
+    // Route playback
+    QList<QGeoCoordinate> m_route;
+    RoutePlayer *m_routePlayer = nullptr;
+    QLabel *m_routeLabel = nullptr;
+    QDoubleSpinBox *m_speedSpin = nullptr;
+    QSpinBox *m_updateRateSpin = nullptr;
+    QCheckBox *m_loopCheck = nullptr;
+    QPushButton *m_playRouteButton = nullptr;
+    QPushButton *m_stopRouteButton = nullptr;
+    QSlider *m_seekSlider = nullptr;
 };
 
 #endif // VIRTUAL_LOCATION_H
\ No newline at end of file